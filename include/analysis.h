@@ -0,0 +1,233 @@
+ /**
+  * \page analysisheader Background Analysis Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;analysis.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;analysis.cpp, engine.h, gui.cpp</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * Analysis of a position on a worker thread, for the GUI. The engine searches
+  * the position to increasing depths (Engine::analyze()) and the result of
+  * every depth (score and principal variation) is handed to the GUI through a
+  * Mailbox, which never blocks either side: the GUI can poll it every frame
+  * without ever waiting for the search.
+  *
+  * A new position (Analysis::start()) stops the current search right away,
+  * since the engine checks its stop flag at every node.
+  */
+
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "engine.h"
+
+/*! \file */
+
+/**
+ * @brief      This class describes a mailbox that passes the latest value from
+ *             one writer thread to one reader thread without locks (a triple
+ *             buffer). The writer and reader never wait for each other, and a
+ *             value that was not read yet is replaced by a newer one.
+ *
+ * @tparam     T     The type of the values
+ */
+template<class T>
+class Mailbox
+{
+public:
+    /**
+     * @brief      (Writer) Posts a value, replacing the value that was not
+     *             read yet (if any).
+     *
+     * @param[in]  value  The value
+     */
+    void post(const T &value)
+    {
+        slots[back] = value;
+
+        // the written slot becomes the middle one, and the old middle slot is
+        // written next
+        back = middle.exchange(back | NEW_VALUE, memory_order_acq_rel) & ~NEW_VALUE;
+    }
+
+    /**
+     * @brief      (Reader) Takes the latest value, if one was posted since the
+     *             last call.
+     *
+     * @param      value  The value (unchanged if there is none)
+     *
+     * @return     True if there was a new value, False otherwise.
+     */
+    bool take(T &value)
+    {
+        if(!ready())
+            return false;
+
+        front = middle.exchange(front, memory_order_acq_rel) & ~NEW_VALUE;
+        value = slots[front];
+        return true;
+    }
+
+    /**
+     * @brief      (Either side) Finds if a value was posted and not taken yet.
+     *
+     * @return     True if there is a new value, False otherwise.
+     */
+    bool ready() const {return (middle.load(memory_order_acquire) & NEW_VALUE) != 0;}
+
+private:
+    /** Marks the middle slot as holding a value that was not read yet */
+    static const int NEW_VALUE = 4;
+
+    /** The values (each slot is used by one side at a time) */
+    T slots[3];
+
+    /** The slot between the writer and the reader (and the NEW_VALUE flag) */
+    atomic<int> middle{1};
+
+    /** The slot the writer writes next (only used by the writer) */
+    int back = 0;
+
+    /** The slot the reader read last (only used by the reader) */
+    int front = 2;
+};
+
+/**
+ * @brief      This struct describes what the analysis found so far for a
+ *             position.
+ */
+struct AnalysisInfo
+{
+    /** The position the result is for (the number returned by
+     *  Analysis::start()) */
+    unsigned int position = 0;
+
+    /** The result of the deepest complete search */
+    SearchInfo search;
+
+    /** True if the analysis of the position is over (the maximum depth was
+     *  reached or there is nothing to search) */
+    bool done = false;
+};
+
+/**
+ * @brief      This class describes the analysis of positions on a worker
+ *             thread. Its functions are meant to be called from one thread
+ *             (ex. the GUI's render loop), and never wait for the search.
+ */
+class Analysis
+{
+public:
+    /**
+     * @brief      Constructs a new instance and starts its (idle) worker
+     *             thread.
+     *
+     * @param[in]  config     The settings of the engine
+     * @param[in]  max_depth  The depth at which the analysis of a position
+     *                        stops (in plies)
+     */
+    explicit Analysis(const EngineConfig &config = EngineConfig(), int max_depth = 4);
+
+    /**
+     * @brief      Stops the search and the worker thread.
+     */
+    ~Analysis();
+
+    /**
+     * @brief      Starts analysing a position (stopping the analysis of the
+     *             previous one).
+     *
+     * @param[in]  chess  The chess object
+     *
+     * @return     The number of the position (see AnalysisInfo::position).
+     */
+    unsigned int start(const Chess &chess);
+
+    /**
+     * @brief      Stops the analysis (the worker thread waits for the next
+     *             position).
+     */
+    void stop();
+
+    /**
+     * @brief      Takes the latest result, if there is a new one.
+     *
+     * @param      info  The result (unchanged if there is none)
+     *
+     * @return     True if there was a new result, False otherwise.
+     */
+    bool poll(AnalysisInfo &info) {return results.take(info);}
+
+private:
+    /**
+     * @brief      This struct describes a position to analyse.
+     */
+    struct Request
+    {
+        /** The number of the position */
+        unsigned int position = 0;
+
+        /** The FEN of the position (empty to stop) */
+        string fen;
+    };
+
+    /** The settings of the engine */
+    EngineConfig config;
+
+    /** The maximum depth of the analysis */
+    int max_depth;
+
+    /** The number of the last position that was started */
+    unsigned int last_position;
+
+    /** The positions to analyse (from the caller to the worker) */
+    Mailbox<Request> requests;
+
+    /** The results (from the worker to the caller) */
+    Mailbox<AnalysisInfo> results;
+
+    /** Stops the current search when set */
+    atomic<bool> restart;
+
+    /** Stops the worker thread when set */
+    atomic<bool> quit;
+
+    /** Wakes the worker up when it waits for a position */
+    mutex idle;
+    condition_variable wakeup;
+
+    /** The worker thread */
+    thread worker;
+
+    /**
+     * @brief      The worker thread: analyses the positions it is given until
+     *             the instance is destroyed.
+     */
+    void run();
+
+    /**
+     * @brief      Gives a request to the worker thread and stops its current
+     *             search.
+     *
+     * @param[in]  request  The request
+     */
+    void send(const Request &request);
+
+    /**
+     * @brief      Wakes the worker thread up if it waits for a request.
+     */
+    void notifyWorker();
+};
+
+#endif // ANALYSIS_H
@@ -0,0 +1,166 @@
+ /**
+  * \page archiveheader Game Archive Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;archive.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;archive.cpp, chess.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * A game archive is a text file with one game per line. Blank lines and lines
+  * starting with '#' are ignored. Each game has fields separated by '|':
+  *
+  * <i>start FEN | moves | result | final FEN</i>
+  *
+  * - <b>start FEN</b>: the position the game starts from, in the format of
+  *   Chess::setFromFEN(). "startpos" (or an empty field) is the regular start.
+  * - <b>moves</b>: space separated moves in the same coordinates the console
+  *   uses. E.g. <i>e2e4</i>, <i>e7e8q</i> (promotion), <i>N@e4</i> (replace the
+  *   piece on e4 with a knight from the reservoir) and <i>e1h1</i> (castling is
+  *   entered as king to rook).
+  * - <b>result</b>: 1-0, 0-1, 1/2-1/2 or *.
+  * - <b>final FEN</b> (optional): the expected position after the last move.
+  */
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <functional>
+#include "chess.h"
+
+/*! \file */
+
+/** The starting position of a chessCAMO game (with full piece reservoirs) */
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR[QRBBNNPPPPqrbbnnpppp] w KQkq - 0 1"
+
+/**
+ * @brief      This struct describes a single game of an archive.
+ */
+struct GameRecord
+{
+    /** The starting position of the game */
+    string fen;
+
+    /** The moves of the game (e.g. e2e4, e7e8q, N@e4) */
+    vector<string> moves;
+
+    /** The result of the game (1-0, 0-1, 1/2-1/2 or *) */
+    string result;
+
+    /** The expected final position of the game (empty if not given) */
+    string final_fen;
+};
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Parses a single line of an archive into a game.
+     *
+     * @param[in]  line  The line (without the new line character)
+     * @param      game  The game that is filled in
+     *
+     * @return     True if the line has at least the start FEN, moves and result
+     *             fields, False otherwise (including blank and comment lines).
+     */
+    bool parseGame(const string &line, GameRecord &game);
+
+    /**
+     * @brief      Formats a game as a single line of an archive.
+     *
+     * @param[in]  game  The game
+     *
+     * @return     The archive line (without the new line character).
+     */
+    string formatGame(const GameRecord &game);
+
+    /**
+     * @brief      Converts a move of an archive into the source and destination
+     *             values used by Chess::makeMove().
+     *
+     * @param[in]  move       The move (e.g. e2e4, e7e8q, N@e4)
+     * @param      src        The source square, or the ASCII value of the
+     *                        reservoir piece in [110, 114]
+     * @param      dest       The destination square
+     * @param      promotion  The promotion piece ('\0' if none was given)
+     *
+     * @return     True if the move is well formed, False otherwise.
+     */
+    bool parseMove(const string &move, int &src, int &dest, char &promotion);
+
+    /**
+     * @brief      Converts the values used by Chess::makeMove() into a move of
+     *             an archive.
+     *
+     * @param[in]  src        The source square, or the ASCII value of the
+     *                        reservoir piece in [110, 114]
+     * @param[in]  dest       The destination square
+     * @param[in]  promotion  The promotion piece ('\0' if none)
+     *
+     * @return     The move (e.g. e2e4, e7e8q, N@e4).
+     */
+    string formatMove(int src, int dest, char promotion = '\0');
+
+    /**
+     * @brief      Replays a game from its starting position.
+     *
+     * @param      chess  The chess object (should be headless)
+     * @param[in]  game   The game
+     * @param[in]  visit  Called with the object and the ply after the start
+     *                    position (ply 0) and after every move that was made
+     *
+     * @return     The number of moves made, which is less than the number of
+     *             moves of the game if a move was illegal (or the game ended
+     *             early), or -1 if the start FEN is invalid.
+     */
+    int replayGame(Chess &chess, const GameRecord &game, const function<void(const Chess &, int)> &visit = nullptr);
+
+    /**
+     * @brief      Replays a test case script (see the unit tests' page): the
+     *             expected FEN on the first line, followed by the moves and
+     *             the answers to the "Continue?" and promotion questions, just
+     *             like they are typed in the console.
+     *
+     * @param      chess     The chess object (should be headless)
+     * @param      in        The script
+     * @param      expected  The expected FEN (first line of the script)
+     *
+     * @post       'chess' holds the final position of the script. The game
+     *             always starts from the regular starting position.
+     */
+    void replayScript(Chess &chess, istream &in, string &expected);
+
+    /**
+     * @brief      Compares a FEN string with an expected one, which can leave
+     *             out the piece reservoir and any trailing fields (like the
+     *             first line of a test case script).
+     *
+     * @param[in]  expected  The expected FEN
+     * @param[in]  fen       The obtained FEN (e.g. from Chess::toFEN())
+     *
+     * @return     True if the fields that are present in 'expected' match,
+     *             False otherwise.
+     */
+    bool matchesFEN(const string &expected, const string &fen);
+
+    /**
+     * @brief      Finds the games (lines that are not blank or comments) of an
+     *             archive.
+     *
+     * @param[in]  data  The contents of the archive
+     * @param[in]  size  The size of the archive
+     *
+     * @return     The byte offsets of the games' lines.
+     */
+    vector<uint64_t> findGames(const char *data, size_t size);
+}
+
+#endif // ARCHIVE_H
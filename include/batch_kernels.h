@@ -0,0 +1,304 @@
+ /**
+  * \page batchkernelsheader Batch Kernels Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;batch_kernels.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;batch_kernels.cpp, game_batch.h, batchbench.cpp</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * The loops over the games of a GameBatch that do the same bit operations for
+  * every game: the attacked squares and checks, and the evaluation (the one of
+  * Engine::evaluate()). Each one has a scalar version (one game at a time) and,
+  * on x86, an SSE4.2 version (two games at a time) and an AVX2 version (four
+  * games at a time). The fastest version the processor supports is chosen when
+  * the program runs (see chessCAMO::bestKernel()).
+  *
+  * The bit operations are written once, as templates over the type of a lane
+  * of games (uint64_t for one game, or a GCC vector of 2 or 4 of them), and
+  * are compiled for each instruction set by inlining them into the kernel of
+  * that set.
+  *
+  * The AVX2 kernels are not used on Windows, where GCC does not align the
+  * stack for 32-byte vectors.
+  */
+
+#ifndef BATCH_KERNELS_H
+#define BATCH_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "engine.h"
+
+/*! \file */
+
+/** Inlines a bit operation into the kernel of each instruction set */
+#define KERNEL_INLINE inline __attribute__((always_inline))
+
+/**
+ * @brief      The versions of the batch kernels.
+ */
+enum batchKernel
+{
+    KERNEL_SCALAR,  ///< 0 (one game at a time)
+    KERNEL_SSE42,   ///< 1 (two games at a time)
+    KERNEL_AVX2     ///< 2 (four games at a time)
+};
+
+/**
+ * @brief      This struct describes the arrays of a batch of games (see
+ *             GameBatch) that the kernels read.
+ */
+struct BatchArrays
+{
+    /** The squares of the pieces of each type (PAWN to KING), of both colors */
+    const uint64_t *pieces[6];
+
+    /** The squares of the black pieces ([0]) and of the white pieces ([1]) */
+    const uint64_t *colors[2];
+
+    /** Whether white is to move */
+    const uint8_t *white_to_move;
+
+    /** The number of each reservoir piece, in the order of
+     *  Chess::getReservoir() */
+    const uint8_t *reservoir[10];
+};
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /** The squares of the a file and of the h file */
+    const uint64_t FILE_A = 0x0101010101010101ULL, FILE_H = 0x8080808080808080ULL;
+
+    /**
+     * @brief      Shifts a board by a number of squares (towards the 1st rank
+     *             if positive, towards the 8th rank if negative).
+     *
+     * @param[in]  board  The board (or lane of boards)
+     *
+     * @tparam     S      The number of squares
+     *
+     * @return     The shifted board.
+     */
+    template<int S, typename V>
+    KERNEL_INLINE V shiftBoard(V board)
+    {
+        return S > 0 ? board << (S > 0 ? S : 0) : board >> (S < 0 ? -S : 0);
+    }
+
+    /**
+     * @brief      Finds the squares that sliding pieces reach in a direction
+     *             (Kogge-Stone occluded fill: the pieces are shifted over the
+     *             empty squares, doubling the distance each time).
+     *
+     * @param[in]  sliders  The sliding pieces
+     * @param[in]  empty    The empty squares
+     *
+     * @tparam     S        The direction (see shiftBoard())
+     * @tparam     M        The squares a shift in that direction can land on
+     *                      (not wrapping around the board)
+     *
+     * @return     The squares reached, up to and including the first occupied
+     *             square.
+     */
+    template<int S, uint64_t M, typename V>
+    KERNEL_INLINE V slide(V sliders, V empty)
+    {
+        empty &= M;
+        sliders |= empty & shiftBoard<S>(sliders);
+        empty &= shiftBoard<S>(empty);
+        sliders |= empty & shiftBoard<2*S>(sliders);
+        empty &= shiftBoard<2*S>(empty);
+        sliders |= empty & shiftBoard<4*S>(sliders);
+        return shiftBoard<S>(sliders) & M;
+    }
+
+    /**
+     * @brief      Finds the squares attacked by rooks (or queens).
+     *
+     * @param[in]  rooks  The rooks
+     * @param[in]  empty  The empty squares
+     *
+     * @return     The attacked squares.
+     */
+    template<typename V>
+    KERNEL_INLINE V rookAttacks(V rooks, V empty)
+    {
+        return slide<-8, ~0ULL>(rooks, empty) | slide<8, ~0ULL>(rooks, empty) |
+               slide<1, ~FILE_A>(rooks, empty) | slide<-1, ~FILE_H>(rooks, empty);
+    }
+
+    /**
+     * @brief      Finds the squares attacked by bishops (or queens).
+     *
+     * @param[in]  bishops  The bishops
+     * @param[in]  empty    The empty squares
+     *
+     * @return     The attacked squares.
+     */
+    template<typename V>
+    KERNEL_INLINE V bishopAttacks(V bishops, V empty)
+    {
+        return slide<-7, ~FILE_A>(bishops, empty) | slide<-9, ~FILE_H>(bishops, empty) |
+               slide<9, ~FILE_A>(bishops, empty) | slide<7, ~FILE_H>(bishops, empty);
+    }
+
+    /**
+     * @brief      Finds the squares attacked by knights.
+     *
+     * @param[in]  knights  The knights
+     *
+     * @return     The attacked squares.
+     */
+    template<typename V>
+    KERNEL_INLINE V knightAttacks(V knights)
+    {
+        const uint64_t not_ab = ~(FILE_A | (FILE_A << 1)), not_gh = ~(FILE_H | (FILE_H >> 1));
+        return (((knights << 17) | (knights >> 15)) & ~FILE_A) | (((knights << 15) | (knights >> 17)) & ~FILE_H) |
+               (((knights << 10) | (knights >> 6)) & not_ab) | (((knights << 6) | (knights >> 10)) & not_gh);
+    }
+
+    /**
+     * @brief      Finds the squares attacked by kings.
+     *
+     * @param[in]  kings  The kings
+     *
+     * @return     The attacked squares.
+     */
+    template<typename V>
+    KERNEL_INLINE V kingAttacks(V kings)
+    {
+        V row = kings | ((kings << 1) & ~FILE_A) | ((kings >> 1) & ~FILE_H);
+        return (row | (row << 8) | (row >> 8)) & ~kings;
+    }
+
+    /**
+     * @brief      Finds the squares attacked by white pawns (towards the 8th
+     *             rank).
+     *
+     * @param[in]  pawns  The pawns
+     *
+     * @return     The attacked squares.
+     */
+    template<typename V>
+    KERNEL_INLINE V whitePawnAttacks(V pawns)
+    {
+        return ((pawns >> 7) & ~FILE_A) | ((pawns >> 9) & ~FILE_H);
+    }
+
+    /**
+     * @brief      Finds the squares attacked by black pawns (towards the 1st
+     *             rank).
+     *
+     * @param[in]  pawns  The pawns
+     *
+     * @return     The attacked squares.
+     */
+    template<typename V>
+    KERNEL_INLINE V blackPawnAttacks(V pawns)
+    {
+        return ((pawns << 9) & ~FILE_A) | ((pawns << 7) & ~FILE_H);
+    }
+
+    /**
+     * @brief      Finds the squares attacked by the side not to move, and the
+     *             pieces of that side that give check.
+     *
+     * @param[in]  pieces    The pieces of each type (PAWN to KING)
+     * @param[in]  white     The white pieces
+     * @param[in]  black     The black pieces
+     * @param[in]  side      All ones if white is to move, 0 otherwise
+     * @param      attacked  The attacked squares (the king of the side to move
+     *                       does not block the squares behind it)
+     * @param      checkers  The pieces that give check
+     */
+    template<typename V>
+    KERNEL_INLINE void sideAttacks(const V pieces[6], V white, V black, V side, V &attacked, V &checkers)
+    {
+        V own = (white & side) | (black & ~side), enemy = (black & side) | (white & ~side);
+        V king = pieces[KING] & own, empty = ~(own | enemy);
+        V pawns = pieces[PAWN] & enemy, knights = pieces[KNIGHT] & enemy;
+        V diagonal = (pieces[BISHOP] | pieces[QUEEN]) & enemy, straight = (pieces[ROOK] | pieces[QUEEN]) & enemy;
+
+        attacked = (blackPawnAttacks(pawns) & side) | (whitePawnAttacks(pawns) & ~side) | knightAttacks(knights) |
+                   kingAttacks(pieces[KING] & enemy) | bishopAttacks(diagonal, empty | king) |
+                   rookAttacks(straight, empty | king);
+
+        // the enemy pawns that attack the king are where a pawn of the side to
+        // move on the king's square would attack
+        checkers = (((whitePawnAttacks(king) & side) | (blackPawnAttacks(king) & ~side)) & pawns) |
+                   (knightAttacks(king) & knights) | (bishopAttacks(king, empty) & diagonal) |
+                   (rookAttacks(king, empty) & straight);
+    }
+
+    /**
+     * @brief      Finds the fastest version of the kernels that the processor
+     *             supports.
+     *
+     * @return     The version.
+     */
+    batchKernel bestKernel();
+
+    /**
+     * @brief      Finds if the processor (and the build) supports a version of
+     *             the kernels.
+     *
+     * @param[in]  kernel  The version
+     *
+     * @return     True if it is supported, False otherwise.
+     */
+    bool kernelSupported(batchKernel kernel);
+
+    /**
+     * @brief      Gets the name of a version of the kernels.
+     *
+     * @param[in]  kernel  The version
+     *
+     * @return     The name ("scalar", "sse4.2" or "avx2").
+     */
+    const char *kernelName(batchKernel kernel);
+
+    /**
+     * @brief      Finds the squares attacked by the side not to move and the
+     *             pieces that give check, for the games in [begin, end).
+     *
+     * @param[in]  kernel    The version of the kernel (if it is not supported,
+     *                       the scalar one is used)
+     * @param[in]  arrays    The arrays of the games
+     * @param[in]  begin     The first game
+     * @param[in]  end       One past the last game
+     * @param      attacked  The attacked squares of each game (the first entry
+     *                       is for the game 'begin')
+     * @param      checkers  The pieces that give check in each game (the first
+     *                       entry is for the game 'begin')
+     */
+    void batchAttacks(batchKernel kernel, const BatchArrays &arrays, size_t begin, size_t end,
+                      uint64_t *attacked, uint64_t *checkers);
+
+    /**
+     * @brief      Evaluates the games in [begin, end), like
+     *             Engine::evaluate().
+     *
+     * @param[in]  kernel  The version of the kernel (if it is not supported,
+     *                     the scalar one is used)
+     * @param[in]  arrays  The arrays of the games
+     * @param[in]  config  The settings of the evaluation
+     * @param[in]  begin   The first game
+     * @param[in]  end     One past the last game
+     * @param      scores  The score of each game (in centipawns) for the side
+     *                     to move (the first entry is for the game 'begin')
+     */
+    void batchEvaluate(batchKernel kernel, const BatchArrays &arrays, const EngineConfig &config,
+                       size_t begin, size_t end, int *scores);
+}
+
+#endif // BATCH_KERNELS_H
@@ -0,0 +1,116 @@
+ /**
+  * \page benchheader Search Benchmark Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;bench.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;bench.cpp, main.cpp, engine.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * A deterministic benchmark of the search (<b>main bench</b>). A fixed set of
+  * positions (with castling, en-passant, promotions and reservoir pieces) is
+  * searched to a fixed depth on one thread, by a new engine for each position
+  * with the default settings (no book, tablebases or network), so the number
+  * of positions searched only changes when the search or the move generation
+  * does. Their total is the signature of the build: a change of the signature
+  * that was not meant is a change of behavior, and the time and nodes per
+  * second of the same signature compare the speed of two builds.
+  *
+  * <b>main bench</b> checks the signature of BENCH_DEPTH against
+  * BENCH_SIGNATURE, and the unit tests check the one of the quicker
+  * BENCH_QUICK_DEPTH against BENCH_QUICK_SIGNATURE. Both are updated (with the
+  * reason in the commit) by a change that is meant to change the search.
+  */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "engine.h"
+
+using namespace std;
+
+/*! \file */
+
+/** The depth of the benchmark's searches (in plies) */
+#define BENCH_DEPTH 3
+
+/** The total number of positions searched at BENCH_DEPTH */
+#define BENCH_SIGNATURE 196128ULL
+
+/** The depth of the benchmark run by the unit tests (in plies) */
+#define BENCH_QUICK_DEPTH 2
+
+/** The total number of positions searched at BENCH_QUICK_DEPTH */
+#define BENCH_QUICK_SIGNATURE 7020ULL
+
+/**
+ * @brief      This struct describes the search of a benchmark position.
+ */
+struct BenchPosition
+{
+    /** The position */
+    string fen;
+
+    /** The best move found */
+    Move best;
+
+    /** Its score (in centipawns) for the side to move */
+    int score;
+
+    /** The number of positions searched */
+    uint64_t nodes;
+
+    /** The time of the search (in seconds) */
+    double seconds;
+};
+
+/**
+ * @brief      This struct describes the outcome of a benchmark.
+ */
+struct BenchResult
+{
+    /** The search of each position */
+    vector<BenchPosition> positions;
+
+    /** The total number of positions searched (the signature) */
+    uint64_t nodes = 0;
+
+    /** The total time of the searches (in seconds) */
+    double seconds = 0;
+};
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      (Accessor) Gets the positions of the benchmark.
+     *
+     * @return     The FEN strings of the positions.
+     */
+    const vector<string> & benchPositions();
+
+    /**
+     * @brief      Searches every position of the benchmark to a depth, one
+     *             after the other on the calling thread.
+     *
+     * @param[in]  depth     The depth of the searches (in plies)
+     * @param      result    The outcome of the benchmark
+     * @param[in]  searched  Called after the search of each position with its
+     *                       index (can be nullptr)
+     */
+    void runBench(int depth, BenchResult &result, const function<void(const BenchPosition &, int)> &searched = nullptr);
+}
+
+#endif // BENCH_H
@@ -0,0 +1,232 @@
+ /**
+  * \page bookheader Opening Book Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;book.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;book.cpp, bookmaker.cpp, archive.h, mapped_file.h, engine.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * The opening book gives the engine the moves played from a position in a
+  * game archive, instead of searching the opening again in every game. The first moves of every game of the archive are
+  * replayed, and each (position, move) pair is counted with the results of its
+  * games: reservoir moves are book moves like any other. The entries are sorted
+  * by hash and written to a binary file, which is memory mapped and binary
+  * searched when probed (like the position index, see index.h).
+  *
+  * <b>File layout</b> (native byte order)
+  * 1. BookHeader (32 bytes);
+  * 2. BookHeader::num_entries BookEntry entries (32 bytes each), sorted by
+  *    hash, then by decreasing weight.
+  */
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+#include "engine.h"
+
+using namespace std;
+
+/*! \file */
+
+/** Identifies an opening book file (and its version) */
+#define BOOK_MAGIC "CAMOBOK1"
+
+/**
+ * @brief      This struct describes a move played from a position of the
+ *             archive.
+ */
+struct BookEntry
+{
+    /** The Zobrist hash of the position (Chess::getHash()) */
+    uint64_t hash;
+
+    /** The source square, or the ASCII value of the reservoir piece in
+     *  [110, 114] (see Chess::makeMove()) */
+    uint8_t src;
+
+    /** The destination square */
+    uint8_t dest;
+
+    /** The promotion piece ('\0' if none) */
+    char promotion;
+
+    /** Unused (keeps the entry aligned) */
+    uint8_t reserved;
+
+    /** The weight of the move: 2 per win and 1 per draw (or unfinished game)
+     *  of the side that made it */
+    uint32_t weight;
+
+    /** The number of games, and the wins, draws and losses of the side that
+     *  made the move (the rest are unfinished) */
+    uint32_t games, wins, draws, losses;
+};
+
+/**
+ * @brief      This struct describes the header at the start of a book file.
+ */
+struct BookHeader
+{
+    /** BOOK_MAGIC (without the null terminator) */
+    char magic[8];
+
+    /** The number of entries in the file */
+    uint64_t num_entries;
+
+    /** The number of positions (distinct hashes) in the file */
+    uint64_t num_positions;
+
+    /** The number of games of the archive */
+    uint64_t num_games;
+};
+
+/**
+ * @brief      This struct describes the settings of building a book.
+ */
+struct BookOptions
+{
+    /** The number of moves of each game that are added to the book */
+    int max_ply = 24;
+
+    /** The fewest games a move must be played in to be kept */
+    uint32_t min_games = 1;
+};
+
+/**
+ * @brief      This struct describes the outcome of building a book.
+ */
+struct BookStats
+{
+    /** The number of games in the archive */
+    uint64_t games;
+
+    /** The number of games with a malformed line, invalid FEN or illegal move
+     *  (the moves before the first illegal one are still added) */
+    uint64_t invalid;
+
+    /** The number of (position, move) pairs replayed */
+    uint64_t moves;
+
+    /** The number of entries and positions written */
+    uint64_t entries, positions;
+
+    /** The time it took to build the book (in seconds) */
+    double seconds;
+};
+
+/**
+ * @brief      This class describes a memory mapped opening book.
+ */
+class OpeningBook
+{
+public:
+    /**
+     * @brief      Default constructor - Constructs a new instance with no book
+     *             opened.
+     */
+    OpeningBook();
+
+    /**
+     * @brief      Builds the book of an archive. Games are replayed on
+     *             'num_threads' threads (each with its own headless Chess
+     *             object), each thread counts its moves in its own sorted
+     *             entries, and the entries of the threads are merged.
+     *
+     * @param[in]  archive_file  The game archive (see archive.h)
+     * @param[in]  book_file     The book file to write
+     * @param[in]  num_threads   The number of threads (0 uses all cores)
+     * @param[in]  options       The settings of the book
+     * @param      stats         The outcome of the build (can be nullptr)
+     *
+     * @return     True if the book was written, False if the archive could not
+     *             be read or the book could not be written.
+     */
+    static bool build(const string &archive_file, const string &book_file, int num_threads,
+                      const BookOptions &options = BookOptions(), BookStats *stats = nullptr);
+
+    /**
+     * @brief      Opens (memory maps) a book file.
+     *
+     * @param[in]  book_file  The book file
+     *
+     * @return     True if the file is a valid book, False otherwise.
+     */
+    bool open(const string &book_file);
+
+    /**
+     * @brief      Closes the book file.
+     */
+    void close();
+
+    /**
+     * @brief      (Accessor) Gets the number of entries in the book.
+     *
+     * @return     The number of entries.
+     */
+    uint64_t getNumEntries() const {return num_entries;}
+
+    /**
+     * @brief      (Accessor) Gets the number of positions in the book.
+     *
+     * @return     The number of positions.
+     */
+    uint64_t getNumPositions() const {return num_positions;}
+
+    /**
+     * @brief      Finds the entries of a position (without copying them).
+     *
+     * @param[in]  hash   The hash of the position (Chess::getHash())
+     * @param      first  The first entry of the position (if any)
+     *
+     * @return     The number of entries of the position, which are stored one
+     *             after the other (heaviest first) starting at 'first'.
+     */
+    size_t find(uint64_t hash, const BookEntry *&first) const;
+
+    /**
+     * @brief      Finds the entries of a position.
+     *
+     * @param[in]  hash   The hash of the position (Chess::getHash())
+     *
+     * @return     The entries of the position, heaviest first.
+     */
+    vector<BookEntry> query(uint64_t hash) const;
+
+    /**
+     * @brief      Chooses a book move of a position, at random in proportion
+     *             to the weights, among the moves that are legal (a hash can
+     *             be shared by two positions).
+     *
+     * @param[in]  chess   The chess object (it is not changed)
+     * @param[in]  random  A random number (0 always chooses the heaviest
+     *                     legal move)
+     * @param      move    The move
+     *
+     * @return     True if a move was chosen, False if the position is not in
+     *             the book (or none of its moves is legal).
+     */
+    bool choose(const Chess &chess, uint64_t random, Move &move) const;
+
+private:
+    /** The book file */
+    MappedFile file;
+
+    /** The entries (in the mapped file) */
+    const BookEntry *entries;
+
+    /** The number of entries and positions */
+    uint64_t num_entries, num_positions;
+};
+
+#endif // BOOK_H
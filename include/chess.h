@@ -36,9 +36,8 @@
   * 
   * \todo
   * - <b>Regular Chess:</b>
-  *   1. Three move repetition (draw) & 50 move rule.
-  *   2. Board representation undo (use queue?).
-  *   3. GUI - nice to be able to move pieces with mouse rather than inputting coordinates. 
+  *   1. Board representation undo (use queue?).
+  *   2. GUI - nice to be able to move pieces with mouse rather than inputting coordinates. 
   *   \n   
   * - <b>ChessCAMO:</b>
   *   1. Make piece reservoir (stack).
@@ -54,7 +53,11 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <cstdint>
+#include <functional>
+#ifdef _WIN32
 #include <windows.h>    // for console text colors
+#endif
 
 using namespace std;
 
@@ -78,6 +81,9 @@ using namespace std;
 /** Changes console text color to white (default) */
 #define DEFAULT 15
 
+/** Buffer size that fits any FEN string produced by Chess::toFEN (including the null terminator) */
+#define FEN_SIZE 128
+
 /**
  * @brief      Piece's Type
  *
@@ -106,8 +112,92 @@ enum pieceColor
     WHITE       ///< 2
 };
 
-// forward declaration
+// forward declarations
 class Piece;
+class Chess;
+
+namespace chessCAMO
+{
+    void saveObject(const Chess &chess_object);
+    void restoreObject(Chess &chess_object);
+}
+
+/**
+ * @brief      This struct describes the callbacks through which a chess object
+ *             reports to a front end (ex. the GUI) in the same process,
+ *             instead of the front end reading the console output back. Every
+ *             callback is optional and called whether or not the object is
+ *             headless.
+ */
+struct ChessListener
+{
+    /** Called after every Chess::makeMove() with its 'src', 'dest' and
+     *  whether the move was made */
+    function<void(int src, int dest, bool made)> on_move;
+
+    /** Called with every warning or status update, without the console
+     *  formatting (ex. "Check!", "Invalid move! Try again...", "White won by
+     *  Checkmate!") */
+    function<void(const string &message)> on_status;
+
+    /** Called when a pawn is promoted, to choose the piece ('q', 'r', 'b' or
+     *  'n'). The input stream of Chess::makeMove() is read if it is not set */
+    function<char()> on_promotion;
+};
+
+/**
+ * @brief      This struct describes the hashes (Chess::getHash()) of the
+ *             positions of a game, one per ply, so that a repetition is found
+ *             by comparing hashes instead of boards. Only the positions since
+ *             the last irreversible move (a pawn move, capture, loss of a
+ *             castling right or use of the reservoir) can repeat, so only they
+ *             are compared.
+ *
+ * @note       The entry of a ply replaces the entries of the later plies, so
+ *             making a move after an undo (or a search going back up the tree)
+ *             needs no other bookkeeping.
+ */
+struct PositionHistory
+{
+    /** The ply of the first entry (the position the history starts from) */
+    int first_ply = 0;
+
+    /** The hash of the position after each ply */
+    vector<uint64_t> hashes;
+
+    /** The number of plies since the last irreversible move, for each ply */
+    vector<int> reversible;
+
+    /**
+     * @brief      Starts the history from a position.
+     *
+     * @param[in]  ply   The ply of the position (Chess::getNumMoves())
+     * @param[in]  hash  The hash of the position
+     */
+    void reset(int ply, uint64_t hash);
+
+    /**
+     * @brief      Sets the position after a ply (the entries of the later
+     *             plies are dropped).
+     *
+     * @param[in]  ply           The ply (in (first_ply, first_ply +
+     *                           hashes.size()], else the history is reset)
+     * @param[in]  hash          The hash of the position
+     * @param[in]  irreversible  True if the move of the ply was irreversible,
+     *                           False otherwise
+     */
+    void record(int ply, uint64_t hash, bool irreversible);
+
+    /**
+     * @brief      Counts the earlier occurrences of the position of a ply (with
+     *             the same side to move, since the last irreversible move).
+     *
+     * @param[in]  ply   The ply (in [first_ply, first_ply + hashes.size()))
+     *
+     * @return     The number of occurrences (2 for a threefold repetition).
+     */
+    int repetitions(int ply) const;
+};
 
 /*************************************************************************************/
 /*                              CHESS CLASS - MEMBER FUNCTIONS                       */
@@ -116,6 +206,15 @@ class Piece;
  * @brief      This class describes the chess board on which the game takes place. 
  *             It contains functions which analyze specific flags to determinewhen to
  *             switch turns, display warnings, and even end the game.
+ *
+ * @note       An object is not a flat value: each of the 64 squares (empty ones
+ *             included) and the check pieces are polymorphic Piece objects on the
+ *             heap. A new copy (copy constructor) makes about 72 allocations (one
+ *             per piece and per vector), about 3 us at -O2. Assigning into an
+ *             existing object re-uses its piece objects, so it allocates nothing
+ *             when the same piece types are on the same squares (about 1 us). Code
+ *             that copies many positions (such as the engine's search) keeps one
+ *             object per ply and assigns into it.
  */
 class Chess
 {
@@ -126,7 +225,7 @@ public:
      */
     Chess();
 
-    /*********************************** BIG THREE *********************************/
+    /*********************************** BIG FIVE **********************************/
     /**
      * @brief      Destroys the object and frees any dynamically allocated
      *             memory ('new') to avoid memory leaks.
@@ -138,6 +237,16 @@ public:
      *             calling object's values to it.
      *
      * @param[in]  chess_object  The object whose values will be copied
+     *
+     * @note       The position, its history and the saved state of the current
+     *             move are copied (the saved states of the earlier moves and the
+     *             listener are not). The copy is headless, so it never prints,
+     *             and neither copying nor playing on the copy reads or writes
+     *             an object_states file.
+     *
+     * @note       The pieces are objects of their own, so a new copy creates
+     *             them (about 72 allocations). Assigning into an existing
+     *             object re-uses them instead (see operator =()).
      */
     Chess(const Chess &chess_object);
 
@@ -148,8 +257,30 @@ public:
      * @param[in]  chess_object  The object whose values will be copied
      *
      * @return     The resulting object from the assignment
+     *
+     * @note       Copies what the copy constructor copies (the object becomes
+     *             headless), and keeps the listener of the existing object.
      */
     Chess & operator =(const Chess &chess_object);
+
+    /**
+     * @brief      Move constructor - Constructs a new instance that takes the
+     *             pieces (and everything else) of another object.
+     *
+     * @param      chess_object  The object whose values will be moved (it can
+     *                           only be assigned to or destroyed afterwards)
+     */
+    Chess(Chess &&chess_object) noexcept;
+
+    /**
+     * @brief      Move Assignment operator - swaps the values of two objects
+     *
+     * @param      chess_object  The object whose values will be moved (it gets
+     *                           the values of this object)
+     *
+     * @return     The resulting object from the assignment
+     */
+    Chess & operator =(Chess &&chess_object) noexcept;
     /************************************* END *************************************/
 
     /************************ MUTATOR & ACCESSOR FUNCTIONS ************************/
@@ -157,9 +288,20 @@ public:
      * @brief      (Accessor) Gets the board representation at the top of the
      *             board positions stack.
      *
-     * @return     The board with current piece positions in correct indicies.
+     * @return     The board with current piece positions in correct indicies
+     *             (a reference, copied by callers that change it).
      */
-    vector<Piece*> getBoard() const {return board;}
+    const vector<Piece*> & getBoard() const {return board;}
+
+    /**
+     * @brief      (Accessor) Gets the piece on a square, without copying the
+     *             board.
+     *
+     * @param[in]  square  The square (in [0, 64))
+     *
+     * @return     The piece (an empty piece if the square is empty).
+     */
+    const Piece * getPiece(int square) const {return board[square];}
 
     /**
      * @brief      (Mutator) Updates the board representation at the top of the
@@ -229,7 +371,8 @@ public:
     /**
      * @brief      (Accessor) Gets the stalemate information.
      *
-     * @return     True if board representation has a stalemate, False otherwise.
+     * @return     True if the game is drawn (stalemate, threefold repetition or
+     *             50 move rule), False otherwise.
      */
     bool getStalemate() const {return flags[3];}
 
@@ -268,6 +411,138 @@ public:
      */
     void setNumMoves(int num_moves) {this->num_moves = num_moves;}
 
+    /**
+     * @brief      (Accessor) Gets the number of moves made since the last pawn
+     *             move or capture.
+     *
+     * @return     The halfmove clock (used for the 50 move rule).
+     */
+    int getHalfmoveClock() const {return halfmove_clock;}
+
+    /**
+     * @brief      (Mutator) Sets the number of moves made since the last pawn
+     *             move or capture.
+     *
+     * @param[in]  halfmove_clock  The halfmove clock
+     */
+    void setHalfmoveClock(int halfmove_clock) {this->halfmove_clock = halfmove_clock;}
+
+    /**
+     * @brief      (Accessor) Gets the hashes of the positions of the game
+     *             (since the last boardInit() or setFromFEN()).
+     *
+     * @return     The history.
+     */
+    const PositionHistory & getHistory() const {return history;}
+
+    /**
+     * @brief      (Mutator) Sets the hashes of the positions of the game (ex.
+     *             when a game is restored from a packed position).
+     *
+     * @param[in]  history  The history (its last entry is the current
+     *                      position)
+     */
+    void setHistory(const PositionHistory &history) {this->history = history;}
+
+    /**
+     * @brief      Counts the earlier occurrences of the current position (in
+     *             time proportional to the number of moves since the last
+     *             irreversible move).
+     *
+     * @return     The number of occurrences (2 for a threefold repetition).
+     */
+    int getRepetitions() const {return history.repetitions(num_moves);}
+
+    /**
+     * @brief      (Accessor) Gets the headless information.
+     *
+     * @return     True if the object neither prints to the console nor writes
+     *             object_states files, False otherwise.
+     */
+    bool getHeadless() const {return headless;}
+
+    /**
+     * @brief      (Mutator) Sets the headless information. A headless object
+     *             keeps its saved states (used for undo) in memory, so that
+     *             many objects can replay games at the same time without
+     *             sharing the object_states folder.
+     *
+     * @param[in]  headless  The headless flag
+     *
+     * @pre        Set before the board is initialized, since the states saved
+     *             so far are not moved between storages.
+     */
+    void setHeadless(bool headless) {this->headless = headless;}
+
+    /**
+     * @brief      (Accessor) Gets the callbacks that the object reports to.
+     *
+     * @return     The listener.
+     */
+    const ChessListener & getListener() const {return listener;}
+
+    /**
+     * @brief      (Mutator) Sets the callbacks that the object reports to.
+     *
+     * @param[in]  listener  The listener
+     */
+    void setListener(const ChessListener &listener) {this->listener = listener;}
+
+    /**
+     * @brief      Reports a warning or status update to the listener (if it
+     *             has an 'on_status' callback).
+     *
+     * @param[in]  message  The message
+     */
+    void reportStatus(const string &message) const {if(listener.on_status) listener.on_status(message);}
+
+    /**
+     * @brief      (Accessor) Gets the castling rights of the current board
+     *             representation, based on whether the kings and rooks moved.
+     *
+     * @return     A bit mask where bits 0 to 3 correspond to the 'K', 'Q', 'k'
+     *             and 'q' rights of a FEN string.
+     */
+    int getCastlingRights() const;
+
+    /**
+     * @brief      (Accessor) Gets the en-passant target square, which is the
+     *             square that a pawn of the side to move would capture into.
+     *
+     * @return     The en-passant square in [0, 63], or -1 if no pawn of the
+     *             side to move can capture en-passant.
+     */
+    int getEnPassantSquare() const;
+
+    /**
+     * @brief      (Accessor) Gets the <a
+     *             href="https://www.chessprogramming.org/Zobrist_Hashing"
+     *             target="__blank">Zobrist</a> hash of the current position.
+     *
+     * @return     A hash of the piece placement, turn, castling rights,
+     *             en-passant square and piece reservoir. Move counters are not
+     *             part of the hash, so that transpositions hash the same.
+     *
+     * @see        chessCAMO::zobristKey(int index)
+     */
+    uint64_t getHash() const;
+
+    /**
+     * @brief      Makes a null move: the turn passes to the other side, and no
+     *             en-passant capture is possible (used by the engine's null
+     *             move pruning).
+     *
+     * @param[in]  hash  The hash of the position (getHash())
+     *
+     * @pre        The side to move is not in check.
+     *
+     * @post       The null move is recorded in the history as irreversible,
+     *             and the position is saved by the next makeMove().
+     *
+     * @return     The hash of the new position, updated from 'hash'.
+     */
+    uint64_t makeNullMove(uint64_t hash);
+
     /*************************************************************************************/
     /*                            CHESSCAMO RESERVOIR FUNCTIONALITY                      */
     /*************************************************************************************/
@@ -278,6 +553,16 @@ public:
      */
     vector<pair<int, char>> getReservoir() const {return reservoir;}
 
+    /**
+     * @brief      (Accessor) Gets the number of pieces of a reservoir slot,
+     *             without copying the reservoir.
+     *
+     * @param[in]  slot  The slot (in [0, 10), in the order of getReservoir())
+     *
+     * @return     The number of pieces.
+     */
+    int getReservoirCount(int slot) const {return reservoir[slot].first;}
+
     /**
      * @brief      Sets the piece reservoir after a piece on the current board
      *             representation is replaced.
@@ -312,6 +597,62 @@ public:
      */  
     void boardInit();
 
+    /**
+     * @brief      Places the pieces on the board according to a <a
+     *             href="https://en.wikipedia.org/wiki/Forsyth%E2%80%93Edwards_Notation"
+     *             target="__blank">FEN</a> string. The piece placement field
+     *             can be followed by the piece reservoir in brackets, E.g.
+     *             <i>rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR[QRBBNNPPPPqrbbnnpppp]
+     *             w KQkq - 0 1</i>
+     *
+     * @param[in]  fen   The FEN string. The reservoir, en-passant and move
+     *                   counter fields are optional (defaults are the starting
+     *                   reservoir, '-', 0 and 1).
+     *
+     * @pre        The chess object is created
+     *
+     * @post       On success, the board, reservoir, turn, flags and move
+     *             counters describe the given position. Unlike boardInit(),
+     *             the position is only serialized by the next makeMove() (so
+     *             loading positions that are not played writes nothing).
+     *             Nothing is printed. On failure, the object is left
+     *             unchanged.
+     *
+     * @return     True if the string describes a valid position, False
+     *             otherwise.
+     *
+     * @note       The string is parsed in place (no temporary strings or
+     *             streams) and piece objects are re-used whenever a square
+     *             keeps its piece type, so loading positions with the same
+     *             piece types does not allocate.
+     */
+    bool setFromFEN(const char *fen);
+
+    /**
+     * @see        Chess::setFromFEN(const char *fen)
+     */
+    bool setFromFEN(const string &fen) {return setFromFEN(fen.c_str());}
+
+    /**
+     * @brief      Writes the current position as a FEN string, with the piece
+     *             reservoir in brackets after the piece placement field.
+     *
+     * @param      fen   The buffer to write into (FEN_SIZE characters is always
+     *                   enough)
+     * @param[in]  size  The size of the buffer
+     *
+     * @return     The length of the written string, or -1 if the buffer is too
+     *             small.
+     */
+    int toFEN(char *fen, int size) const;
+
+    /**
+     * @see        Chess::toFEN(char *fen, int size)
+     *
+     * @return     The FEN string of the current position.
+     */
+    string toFEN() const;
+
     /**
      * @brief      Moves a piece on the board from 'src' to 'dest' if conditions
      *             for a legal move are met.
@@ -332,6 +673,22 @@ public:
      */
     bool makeMove(int src, int dest, istream &in); 
 
+    /**
+     * @brief      Moves a piece on the board from 'src' to 'dest' if conditions
+     *             for a legal move are met, promoting a pawn to a given piece
+     *             (without reading an input or asking the listener).
+     *
+     * @param[in]  src        The source square (piece's current location)
+     * @param[in]  dest       The destination square (piece's ending location)
+     * @param[in]  promotion  The promotion piece ('q', 'r', 'b' or 'n' in
+     *                        either case, a queen for any other value)
+     *
+     * @return     True if move was made, False otherwise.
+     *
+     * @see        Chess::makeMove(int src, int dest, istream &in)
+     */
+    bool makeMove(int src, int dest, char promotion);
+
     /**
      * @brief      Decide if a move caused a checkmate according to 'check_type'
      *
@@ -396,7 +753,42 @@ private:
     pieceColor turn;
 
 	/** The number of moves made already */
-    int num_moves;          
+    int num_moves;
+
+    /** The number of moves made since the last pawn move or capture */
+    int halfmove_clock;
+
+    /** The hashes of the positions of the game (for threefold repetition) */
+    PositionHistory history;
+
+    /** Whether printing and object_states files are turned off */
+    bool headless;
+
+    /** The serialized object after each move (only used when headless) */
+    mutable vector<string> saved_states;
+
+    /** Whether the position was set by setFromFEN() and not saved yet (it is
+     *  saved by the next makeMove()) */
+    mutable bool unsaved;
+
+    /** The callbacks that the object reports to */
+    ChessListener listener;
+
+    friend void chessCAMO::saveObject(const Chess &chess_object);
+    friend void chessCAMO::restoreObject(Chess &chess_object);
+
+    /**
+     * @brief      Makes a move for both versions of Chess::makeMove().
+     *
+     * @param[in]  src        The source square (piece's current location)
+     * @param[in]  dest       The destination square (piece's ending location)
+     * @param      in         The input the promotion piece is read from, or
+     *                        nullptr to use 'promotion'
+     * @param[in]  promotion  The promotion piece (if 'in' is nullptr)
+     *
+     * @return     True if move was made, False otherwise.
+     */
+    bool makeMove(int src, int dest, istream *in, char promotion);
 
 	/*************************************************************************************/
 	/*                              PIECE CLASS - HELPER FUNCTIONS                       */
@@ -463,6 +855,16 @@ private:
      */
     void handleStalemate();
 
+    /**
+     * @brief      Indicates the game is drawn by threefold repetition or the 50
+     *             move rule via a message to console
+     *
+     * @param[in]  reason  The rule that drew the game
+     *
+     * @post       Object's stalemate state is set to true (to end the game).
+     */
+    void handleDraw(const string &reason);
+
     /**
      * @brief      If in a single check, see if piece can defend the king,
      *             capture attacking piece, or move the king out of check. Used
@@ -840,6 +1242,20 @@ public:
      */
     virtual void promotePawn(Chess &chess, istream &in) {return;}
 
+    /**
+     * @brief      Promotes the pawn to a given piece.
+     *
+     * @param      chess  The chess object
+     * @param[in]  piece  The piece ('q', 'r', 'b' or 'n', in either case)
+     *
+     * @return     True if the pawn was promoted, False if this is not a pawn
+     *             or 'piece' is not a promotion piece.
+     *
+     * @note       The pawn is replaced (deleted), so the object must not be
+     *             used after a promotion.
+     */
+    virtual bool promotePawn(Chess &chess, char piece) {return false;}
+
     /**
      * @brief      Can the king <a href="https://bit.ly/2XQEXFr"
      *             target="__blank">castle</a>?
@@ -964,6 +1380,19 @@ public:
      */
     void promotePawn(Chess &chess, istream &in) override;
 
+    /**
+     * @see        virtual Piece::promotePawn(Chess &chess, char piece)
+     *
+     * @brief      Promotes the pawn to a given piece.
+     *
+     * @param      chess  The chess object
+     * @param[in]  piece  The piece ('q', 'r', 'b' or 'n', in either case)
+     *
+     * @return     True if the pawn was promoted, False if 'piece' is not a
+     *             promotion piece.
+     */
+    bool promotePawn(Chess &chess, char piece) override;
+
 private:
     /** * Can this pawn en-passant it's left rival currently? */
     bool en_passant_left;
@@ -1374,6 +1803,8 @@ namespace chessCAMO
      *             file, allowing it to later be reset.
      *
      * @param[in]  chess_object  The chess object
+     *
+     * @note       Headless objects are serialized to memory instead.
      */
     void saveObject(const Chess &chess_object);
 
@@ -1383,8 +1814,24 @@ namespace chessCAMO
      *             properties (in the file).
      *
      * @param      chess_object  The chess object
+     *
+     * @note       Headless objects are de-serialized from memory instead.
      */
     void restoreObject(Chess &chess_object);
+
+    /**
+     * @brief      Gets the random key of a position feature, used to build the
+     *             Zobrist hash of a position (Chess::getHash()).
+     *
+     * @param[in]  index  The feature: [0, 768) piece type and color on a
+     *                    square ((type*2 + is_white)*64 + square), 768 white to
+     *                    move, [769, 773) castling rights (KQkq), [773, 781)
+     *                    en-passant file, [781, 881) reservoir slot and count
+     *                    (781 + slot*10 + count)
+     *
+     * @return     The key, which is the same on every platform and run.
+     */
+    uint64_t zobristKey(int index);
 } // end namespace chessCAMO
 
 #endif // CHESS_H
@@ -1516,7 +1963,7 @@ namespace chessCAMO
  * - [x] Board representation undo <strike>(use queue?)</strike> - used serialization.
  * - [x] Input as PGN rather than two integers (using template).
  * - [x] GUI - <strike>nice to be able to move pieces with mouse rather than inputting coordinates.</strike> in progress (more details for user in the interface will be added).
- * - [ ] Three move repetition (draw) & 50 move rule.
+ * - [x] Three move repetition (draw) & 50 move rule - hashes of the positions since the last irreversible move.
  * 
  * ### ChessCAMO:
  * - [x] Make piece reservoir <strike>(stack)</strike> used <span style="background-color:#F3F4F4;">vector<pair<int, char>></span>
@@ -0,0 +1,648 @@
+ /**
+  * \page engineheader Engine Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;engine.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;engine.cpp, chess.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * A small alpha-beta engine for chessCAMO. The rules are not duplicated: the
+  * legal moves of a position are the ones Chess::makeMove() accepts (including
+  * the piece reservoir), and every move of the search is made on a headless
+  * Chess object copied from its parent position.
+  *
+  * The alpha-beta search prunes like other engines do (null move, late move
+  * reductions, futility pruning, reverse futility pruning and razoring), each
+  * with its switch in EngineConfig so that its effect can be measured (see
+  * prunebench.cpp). The reservoir moves are quiet moves with their own
+  * reduction.
+  *
+  * Endgames of the opened tablebases (see tablebase.h) are not searched: their
+  * score is the checkmate distance of the table. Neither are the positions of
+  * the opening book (see book.h): Engine::search() plays one of their moves.
+  *
+  * The positions are evaluated either by the hand-crafted evaluation or by a
+  * neural network (see nnue.h), whose accumulators are updated move by move
+  * along the line being searched.
+  *
+  * The engine is configured through EngineConfig, so that two configurations
+  * can be compared in engine-vs-engine matches (see match.h). Its search is
+  * either alpha-beta or a Monte Carlo tree search (see mcts.h).
+  */
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include "chess.h"
+
+/*! \file */
+
+/** The score of a position where the side to move is checkmated (before the
+ *  distance to the checkmate is subtracted) */
+#define MATE_SCORE 100000
+
+/** Scores at least this far from 0 are checkmates (the pruning of the search
+ *  is not applied near them) */
+#define MATE_BOUND (MATE_SCORE - 1000)
+
+/** The size of each dimension of the table of late move reductions (larger
+ *  depths and move numbers use the last entry) */
+#define MAX_REDUCTION_INDEX 64
+
+/**
+ * @brief      This struct describes a move in the values used by
+ *             Chess::makeMove().
+ */
+struct Move
+{
+    /** The source square, or the ASCII value of the reservoir piece in
+     *  [110, 114] (-1 if there is no move) */
+    int src;
+
+    /** The destination square */
+    int dest;
+
+    /** The promotion piece ('q', 'r', 'b' or 'n') or '\0' if none */
+    char promotion;
+};
+
+/**
+ * @brief      This struct describes the result of a search to a given depth.
+ */
+struct SearchInfo
+{
+    /** The depth that was searched (in plies) */
+    int depth = 0;
+
+    /** The score (in centipawns) for the side to move */
+    int score = 0;
+
+    /** The number of positions searched by the engine so far */
+    uint64_t nodes = 0;
+
+    /** The principal variation: the best move followed by the best replies
+     *  that the search found */
+    vector<Move> pv;
+};
+
+/**
+ * @brief      The search algorithms of the engine.
+ */
+enum searchMode
+{
+    SEARCH_ALPHABETA,   ///< 0 (see Engine::negamax())
+    SEARCH_MCTS         ///< 1 (Monte Carlo tree search, see mcts.h)
+};
+
+/**
+ * @brief      This struct describes the settings of an engine.
+ */
+struct EngineConfig
+{
+    /** The search algorithm */
+    searchMode search = SEARCH_ALPHABETA;
+
+    /** The depth of the search (in plies). Every position of the search is
+     *  made through Chess::makeMove(), so each ply costs a lot */
+    int depth = 1;
+
+    /** The value of a pawn, knight, bishop, rook and queen (in centipawns) */
+    int material[5] = {100, 320, 330, 500, 900};
+
+    /** The value of a reservoir piece, as a percentage of its value on the
+     *  board (the reservoir can only replace pieces) */
+    int reservoir_percent = 60;
+
+    /** The bonus (in centipawns) per step a knight, bishop or pawn is closer
+     *  to the center of the board */
+    int center_bonus = 4;
+
+    /** True if the search considers the reservoir moves, False otherwise */
+    bool reservoir_moves = true;
+
+    /** True to try a null move (passing the turn) first, and cut the
+     *  position if the opponent cannot reach 'beta' even then */
+    bool null_move = true;
+
+    /** The depth reduction of the search after a null move (in plies, on
+     *  top of the ply of the null move) */
+    int null_move_reduction = 2;
+
+    /** The non-pawn material (in centipawns, on the board) below which a cut
+     *  from a null move is verified with a reduced search of the position
+     *  itself (zugzwang is likely in such endgames, unless the reservoir has
+     *  pieces to drop instead of moving) */
+    int null_move_verify = 1300;
+
+    /** True to search the late quiet moves with reduced depth (and again at
+     *  full depth if they reach 'alpha') */
+    bool late_move_reductions = true;
+
+    /** The reduction of the late moves is 'lmr_base' + ln(depth) *
+     *  ln(move number) / 'lmr_divisor' plies (see Engine::getReduction()) */
+    double lmr_base = 0.5;
+
+    /** See 'lmr_base' */
+    double lmr_divisor = 2.5;
+
+    /** The number of moves searched at full depth before the quiet moves are
+     *  reduced */
+    int lmr_moves = 3;
+
+    /** The extra reduction of a reservoir move (in plies). Most of them are
+     *  quiet, so they are reduced from the first one on */
+    int reservoir_reduction = 1;
+
+    /** True to skip the quiet moves of a position near the leaves whose
+     *  evaluation is far below 'alpha' */
+    bool futility = true;
+
+    /** The margin of futility pruning, per ply of remaining depth (in
+     *  centipawns) */
+    int futility_margin = 150;
+
+    /** True to cut a position near the leaves whose evaluation is far above
+     *  'beta' (without searching its moves) */
+    bool reverse_futility = true;
+
+    /** The margin of reverse futility pruning, per ply of remaining depth (in
+     *  centipawns) */
+    int reverse_futility_margin = 120;
+
+    /** True to search a position near the leaves whose evaluation is far
+     *  below 'alpha' one ply shallower (razoring) */
+    bool razoring = true;
+
+    /** The margin of razoring, per ply of remaining depth (in centipawns) */
+    int razor_margin = 300;
+
+    /** The number of playouts of a Monte Carlo tree search (per call of
+     *  Engine::search(), or per depth of Engine::analyze()) */
+    int playouts = 4000;
+
+    /** The number of threads of a Monte Carlo tree search (they share the
+     *  tree) */
+    int search_threads = 1;
+
+    /** The number of random moves of a playout before its position is
+     *  evaluated */
+    int playout_plies = 8;
+
+    /** True if the playouts play a capture (when there is one) half of the
+     *  time, False if every move is random */
+    bool light_playouts = true;
+
+    /** True to select the moves of the tree with PUCT (visits shared by the
+     *  prior of each move), False for UCT (every move is tried once first) */
+    bool puct = true;
+
+    /** The exploration constant of PUCT or UCT */
+    double exploration = 1.5;
+
+    /** The prior of a reservoir move, as a percentage of the prior of a
+     *  board move (there are many more reservoir moves than board moves, and
+     *  few of them are good) */
+    int reservoir_prior = 20;
+
+    /** The number of nodes of the tree of a Monte Carlo tree search (its
+     *  memory is allocated once) */
+    unsigned int tree_nodes = 1 << 18;
+
+    /** The seed of the choice among the moves of the opening book (0 always
+     *  plays the heaviest book move, see OpeningBook::choose()) */
+    uint64_t book_seed = 0;
+};
+
+class MctsTree;
+class Tablebase;
+class OpeningBook;
+class Nnue;
+struct NnueAccumulator;
+
+/**
+ * @brief      This class describes an engine, which searches for the best move
+ *             of a position.
+ */
+class Engine
+{
+public:
+    /**
+     * @brief      Default constructor - Constructs a new instance with the
+     *             default settings.
+     */
+    Engine();
+
+    /**
+     * @brief      Constructs a new instance.
+     *
+     * @param[in]  config  The settings of the engine
+     */
+    explicit Engine(const EngineConfig &config);
+
+    /**
+     * @brief      Move constructor.
+     *
+     * @param      other  The engine to move
+     */
+    Engine(Engine &&other);
+
+    /**
+     * @brief      Destroys the object.
+     */
+    ~Engine();
+
+    /**
+     * @brief      (Accessor) Gets the settings of the engine.
+     *
+     * @return     The settings.
+     */
+    EngineConfig getConfig() const {return config;}
+
+    /**
+     * @brief      (Mutator) Sets the settings of the engine.
+     *
+     * @param[in]  config  The settings
+     */
+    void setConfig(const EngineConfig &config);
+
+    /**
+     * @brief      (Accessor) Gets the depth reduction of a late move (see
+     *             EngineConfig::late_move_reductions).
+     *
+     * @param[in]  depth        The remaining depth (in plies)
+     * @param[in]  move_number  The number of the move in the position (1 for
+     *                          the first one searched)
+     * @param[in]  reservoir    True for a reservoir move, False otherwise
+     *
+     * @return     The reduction (in plies), 0 if the move is not reduced.
+     */
+    int getReduction(int depth, int move_number, bool reservoir) const;
+
+    /**
+     * @brief      (Mutator) Sets the endgame tables the alpha-beta search
+     *             probes (a position of a table is scored by its result and
+     *             distance to the checkmate instead of being searched).
+     *
+     * @param[in]  tables  The opened tables (they must outlive the engine, or
+     *                     be replaced before they are closed)
+     */
+    void setTablebases(const vector<const Tablebase *> &tables) {tablebases = tables;}
+
+    /**
+     * @brief      (Mutator) Sets the opening book whose moves Engine::search()
+     *             plays (without searching) in the positions of the book.
+     *
+     * @param[in]  book  The opened book (nullptr for none), which must outlive
+     *                   the engine or be replaced before it is closed
+     */
+    void setBook(const OpeningBook *book) {this->book = book;}
+
+    /**
+     * @brief      (Mutator) Sets the neural network that evaluates the
+     *             positions instead of the hand-crafted evaluation (the Monte
+     *             Carlo tree search keeps evaluating its batched playouts by
+     *             hand).
+     *
+     * @param[in]  network  The network (nullptr for the hand-crafted
+     *                      evaluation), which must outlive the engine or be
+     *                      replaced first
+     */
+    void setNetwork(const Nnue *network) {this->network = network;}
+
+    /**
+     * @brief      (Accessor) Gets the number of positions searched since the
+     *             engine was made.
+     *
+     * @return     The number of positions.
+     */
+    uint64_t getNodes() const {return nodes;}
+
+    /**
+     * @brief      Evaluates a position without searching.
+     *
+     * @param[in]  chess  The chess object
+     *
+     * @return     The score of the position (in centipawns) for the side to
+     *             move.
+     */
+    int evaluate(const Chess &chess) const;
+
+    /**
+     * @brief      Searches for the best move of a position.
+     *
+     * @param[in]  chess  The chess object (it is not changed)
+     * @param      score  The score of the best move (in centipawns) for the
+     *                    side to move
+     *
+     * @return     The best move (or a move of the opening book, scored by
+     *             Engine::evaluate()), or a move with 'src' = -1 if the side to
+     *             move has no legal move (or the game is over).
+     */
+    Move search(const Chess &chess, int &score);
+
+    /**
+     * @brief      Searches a position to increasing depths (iterative
+     *             deepening), until 'max_depth' is reached, a checkmate is
+     *             found or 'stop' is set.
+     *
+     * @param[in]  chess      The chess object (it is not changed)
+     * @param[in]  max_depth  The maximum depth (in plies)
+     * @param[in]  stop       Set (ex. by another thread) to stop the search
+     *                        as soon as possible
+     * @param[in]  on_depth   Called after every depth that was searched
+     *                        completely
+     *
+     * @return     The best move of the deepest complete search, or a move
+     *             with 'src' = -1 if there is none.
+     */
+    Move analyze(const Chess &chess, int max_depth, const atomic<bool> &stop,
+                 const function<void(const SearchInfo &)> &on_depth = nullptr);
+
+private:
+    /** The settings of the engine */
+    EngineConfig config;
+
+    /** The number of positions searched */
+    uint64_t nodes;
+
+    /** The headless chess objects of the search (one per ply) */
+    vector<unique_ptr<Chess>> positions;
+
+    /** The best line found from each ply (lines[0] is the principal
+     *  variation) */
+    vector<vector<Move>> lines;
+
+    /** Stops the search when set (nullptr if the search cannot be stopped) */
+    const atomic<bool> *stop;
+
+    /** True if the last search was stopped before it was complete */
+    bool aborted;
+
+    /** The positions of the game and of the line being searched (a position
+     *  seen before in either is scored as a draw) */
+    PositionHistory history;
+
+    /** The ply of the root in 'history' (Chess::getNumMoves()) */
+    int root_ply;
+
+    /** The reduction of a late move by remaining depth and move number (both
+     *  up to MAX_REDUCTION_INDEX - 1), from EngineConfig::lmr_base and
+     *  EngineConfig::lmr_divisor */
+    vector<vector<int>> reductions;
+
+    /** The endgame tables probed by the search */
+    vector<const Tablebase *> tablebases;
+
+    /** The opening book played by Engine::search() (nullptr if none) */
+    const OpeningBook *book;
+
+    /** The neural network of the evaluation (nullptr for the hand-crafted
+     *  one) */
+    const Nnue *network;
+
+    /** The accumulators of the network for each ply of the search (the
+     *  accumulator of a ply belongs to positions[ply]) */
+    vector<NnueAccumulator> accumulators;
+
+    /** The tree of the Monte Carlo tree search, kept from one search to the
+     *  next (nullptr until the first one) */
+    unique_ptr<MctsTree> tree;
+
+    /**
+     * @brief      Searches a position with Monte Carlo tree search, reusing
+     *             the tree of the last search if the position follows from it.
+     *
+     * @param[in]  chess     The chess object (it is not changed)
+     * @param[in]  rounds    The number of rounds of EngineConfig::playouts
+     *                       playouts
+     * @param      score     The score of the best move (in centipawns) for the
+     *                       side to move
+     * @param[in]  on_depth  Called after every round (with the round as the
+     *                       depth)
+     *
+     * @return     The best move, or a move with 'src' = -1 if there is none.
+     */
+    Move searchMcts(const Chess &chess, int rounds, int &score,
+                    const function<void(const SearchInfo &)> &on_depth = nullptr);
+
+    /**
+     * @brief      Sets up the root of a search (positions[0]) from a position.
+     *
+     * @param[in]  chess  The chess object
+     *
+     * @return     True if the position can be searched, False if the game is
+     *             over or the position is invalid.
+     */
+    bool setRoot(const Chess &chess);
+
+    /**
+     * @brief      Searches the root (positions[0]) to a given depth.
+     *
+     * @param[in]  depth  The depth (in plies)
+     * @param      best   The best move ('src' = -1 if there is none)
+     *
+     * @return     The score of the best move for the side to move.
+     */
+    int searchRoot(int depth, Move &best);
+
+    /**
+     * @brief      The negamax (alpha-beta) search of a position.
+     *
+     * @param      chess  The position (positions[ply], or the root)
+     * @param[in]  depth  The remaining depth (in plies)
+     * @param[in]  alpha  The lower bound of the score
+     * @param[in]  beta   The upper bound of the score
+     * @param[in]  ply    The distance from the root (in plies)
+     * @param[in]  null   True if a null move can be tried, False otherwise
+     *                    (after a null move, or in its verification)
+     *
+     * @return     The score of the position for the side to move.
+     */
+    int negamax(Chess &chess, int depth, int alpha, int beta, int ply, bool null = true);
+
+    /**
+     * @brief      Evaluates a position of the search (with the accumulator of
+     *             its ply if the network evaluates the positions).
+     *
+     * @param[in]  chess  The position (positions[ply])
+     * @param[in]  ply    The distance from the root (in plies)
+     *
+     * @return     The score of the position (in centipawns) for the side to
+     *             move.
+     */
+    int evaluateNode(const Chess &chess, int ply) const;
+
+    /**
+     * @brief      Makes a move of a position (positions[ply]) on the chess
+     *             object of the next ply.
+     *
+     * @param[in]  move  The move
+     * @param[in]  ply   The distance of the position from the root
+     *
+     * @return     The chess object of the next ply, or nullptr if the move was
+     *             rejected.
+     *
+     * @post       The position is recorded in the history (at its ply).
+     */
+    Chess *makeChild(const Move &move, int ply);
+
+    /**
+     * @brief      Makes a null move (the turn is passed) of a position
+     *             (positions[ply]) on the chess object of the next ply.
+     *
+     * @param[in]  ply   The distance of the position from the root
+     *
+     * @return     The chess object of the next ply.
+     */
+    Chess *makeNullChild(int ply);
+
+    /**
+     * @brief      Fills the table of the late move reductions from the
+     *             settings.
+     */
+    void buildReductions();
+};
+
+/**
+ * @brief      This struct describes the legal moves of a position as bit masks
+ *             of destination squares (bit i is square i), so that a move can
+ *             be looked up in constant time.
+ */
+struct MoveTable
+{
+    /** The squares of the pieces of the side to move (whether or not they
+     *  can move) */
+    uint64_t side = 0;
+
+    /** The destinations of the piece on each square */
+    uint64_t from_square[64] = {};
+
+    /** The destinations (replaced pieces) of each reservoir piece of the side
+     *  to move, in the order of RESERVOIR_PIECES */
+    uint64_t from_reservoir[5] = {};
+
+    /**
+     * @brief      Finds if a move is legal.
+     *
+     * @param[in]  src   The source square, or the ASCII value of the reservoir
+     *                   piece in [110, 114]
+     * @param[in]  dest  The destination square
+     *
+     * @return     True if the move is legal, False otherwise.
+     */
+    bool isLegal(int src, int dest) const {return 0 <= dest && dest <= 63 && (destinations(src) >> dest & 1) != 0;}
+
+    /**
+     * @brief      Gets the destinations of a source.
+     *
+     * @param[in]  src   The source square, or the ASCII value of the reservoir
+     *                   piece in [110, 114]
+     *
+     * @return     The bit mask of destinations (0 for an invalid source).
+     */
+    uint64_t destinations(int src) const;
+};
+
+/** The reservoir pieces in the order of MoveTable::from_reservoir ('o' is a
+ *  bishop) */
+#define RESERVOIR_PIECES "pnorq"
+
+/**
+ * @brief      This class describes a cache of the legal moves of positions,
+ *             keyed by their hash (Chess::getHash()), so that the moves of a
+ *             position are found once however often they are asked for (ex. by
+ *             the GUI on every click, or after an undo).
+ */
+class MoveCache
+{
+public:
+    /**
+     * @brief      Constructs a new instance.
+     *
+     * @param[in]  capacity  The number of positions kept (the cache is
+     *                       emptied when it is full)
+     */
+    explicit MoveCache(unsigned int capacity = 1024) : capacity{capacity}, hits{0}, misses{0} {}
+
+    /**
+     * @brief      Gets the legal moves of a position, finding them if they are
+     *             not in the cache.
+     *
+     * @param      chess  The chess object (it is not changed)
+     *
+     * @return     The legal moves (valid until the next call).
+     */
+    const MoveTable & get(Chess &chess);
+
+    /**
+     * @brief      (Accessor) Gets the number of calls answered from the cache.
+     *
+     * @return     The number of hits.
+     */
+    uint64_t getHits() const {return hits;}
+
+    /**
+     * @brief      (Accessor) Gets the number of calls that had to find the
+     *             moves.
+     *
+     * @return     The number of misses.
+     */
+    uint64_t getMisses() const {return misses;}
+
+private:
+    /** The number of positions kept */
+    unsigned int capacity;
+
+    /** The legal moves of each position */
+    unordered_map<uint64_t, MoveTable> tables;
+
+    /** The legal moves of a finished game (there are none) */
+    MoveTable game_over;
+
+    /** The number of hits and misses */
+    uint64_t hits, misses;
+};
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Finds the legal moves of the side to move, by asking the
+     *             pieces of the board (Piece::isLegalMove()) and following the
+     *             rules of Chess::useReservoirPiece().
+     *
+     * @param      chess      The chess object (it is not changed)
+     * @param[in]  reservoir  True to include the reservoir moves, False
+     *                        otherwise
+     *
+     * @return     The legal moves (a pawn reaching the last rank gives one move
+     *             per promotion piece), or none if the game is over.
+     */
+    vector<Move> legalMoves(Chess &chess, bool reservoir = true);
+
+    /**
+     * @brief      Makes a move (a move without a promotion piece promotes to a
+     *             queen, should its pawn reach the last rank).
+     *
+     * @param      chess  The chess object
+     * @param[in]  move   The move
+     *
+     * @return     True if the move was made, False otherwise.
+     */
+    bool playMove(Chess &chess, const Move &move);
+}
+
+#endif // ENGINE_H
@@ -0,0 +1,429 @@
+ /**
+  * \page gamebatchheader Game Batch Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;game_batch.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;game_batch.cpp, batch_kernels.h, engine.h, game_store.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * Thousands of chessCAMO games played in lockstep (self-play, Monte Carlo
+  * playouts). A Chess object keeps 64 heap allocated pieces and finds a move by
+  * asking them, which is fine for one game but not for many. A GameBatch keeps
+  * every game as a few 64-bit boards (bit i is square i, so bit 0 is a8), and
+  * every field of the games in its own array (structure of arrays): the loops
+  * over the games (finding the attacked squares and the checks of every game,
+  * and evaluating them) are straight bit operations, run on several games at
+  * once with SSE4.2 or AVX2 when the processor has them (see
+  * batch_kernels.h).
+  *
+  * The moves are the ones of chessCAMO::legalMoves(), in the same Move values,
+  * including the piece reservoir, with these exceptions (where the Chess class
+  * accepts a move that leaves its own king attacked, or keeps a right for too
+  * long):
+  * - en-passant is only possible on the move right after the pawn moved two
+  *   squares (a Chess object keeps the right until a pawn moves);
+  * - castling also needs the squares the king crosses and moves to not to be
+  *   attacked (by any piece), and an en-passant capture cannot leave the king
+  *   in check.
+  *
+  * A game is over when the side to move has no legal move: it is checkmated
+  * if it is in check, and stalemated otherwise.
+  */
+
+#ifndef GAME_BATCH_H
+#define GAME_BATCH_H
+
+#include <cstdint>
+#include <vector>
+#include "batch_kernels.h"
+#include "engine.h"
+#include "game_store.h"
+
+using namespace std;
+
+/*! \file */
+
+/** More than the number of legal moves of any position (board moves and
+ *  reservoir moves) */
+#define MAX_BATCH_MOVES 512
+
+/**
+ * @brief      The status of a game of a batch.
+ */
+enum batchStatus
+{
+    BATCH_ONGOING,      ///< 0
+    BATCH_CHECKMATE,    ///< 1 (the side to move lost)
+    BATCH_STALEMATE     ///< 2
+};
+
+/**
+ * @brief      This class describes a batch of games, stored as arrays of
+ *             bitboards, counts and flags (one entry per game).
+ */
+class GameBatch
+{
+public:
+    /**
+     * @brief      Constructs a new instance.
+     *
+     * @param[in]  size  The number of games (all at the starting position)
+     */
+    explicit GameBatch(size_t size = 0);
+
+    /**
+     * @brief      Changes the number of games (new games are at the starting
+     *             position).
+     *
+     * @param[in]  size  The number of games
+     */
+    void resize(size_t size);
+
+    /**
+     * @brief      Sets a game to the starting position.
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     */
+    void reset(size_t game);
+
+    /**
+     * @brief      Sets a game to the position of a chess object (including the
+     *             pawns that did not move yet and the en-passant square).
+     *
+     * @param[in]  game   The game (in [0, getSize()))
+     * @param[in]  chess  The chess object
+     */
+    void set(size_t game, const Chess &chess);
+
+    /**
+     * @brief      Sets a game to the position of a FEN string (in the format of
+     *             Chess::setFromFEN()).
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     * @param[in]  fen   The FEN string
+     *
+     * @return     True if the FEN string is valid, False otherwise (the game is
+     *             not changed).
+     */
+    bool setFromFEN(size_t game, const char *fen);
+
+    /**
+     * @brief      Sets a game to a game of a batch (this one or another one).
+     *
+     * @param[in]  game       The game (in [0, getSize()))
+     * @param[in]  from       The batch of the other game
+     * @param[in]  from_game  The other game (in [0, from.getSize()))
+     */
+    void copyGame(size_t game, const GameBatch &from, size_t from_game);
+
+    /**
+     * @brief      Finds if a game is at the same position as a game of a batch
+     *             (this one or another one). The halfmove clock and the number
+     *             of moves are not compared.
+     *
+     * @param[in]  game        The game (in [0, getSize()))
+     * @param[in]  other       The batch of the other game
+     * @param[in]  other_game  The other game (in [0, other.getSize()))
+     *
+     * @return     True if the positions are the same, False otherwise.
+     */
+    bool samePosition(size_t game, const GameBatch &other, size_t other_game) const;
+
+    /**
+     * @brief      (Accessor) Gets the Zobrist hash of the position of a game
+     *             (the same as Chess::getHash() for the same position).
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     *
+     * @return     The hash.
+     */
+    uint64_t getHash(size_t game) const;
+
+    /**
+     * @brief      Packs the position of a game (in the format of
+     *             chessCAMO::packPosition()).
+     *
+     * @param[in]  game      The game (in [0, getSize()))
+     * @param      position  The packed position
+     */
+    void pack(size_t game, PackedPosition &position) const;
+
+    /**
+     * @brief      Writes the position of a game as a FEN string (in the format
+     *             of Chess::toFEN()).
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     * @param      fen   The buffer to write into (FEN_SIZE characters is always
+     *                   enough)
+     * @param[in]  size  The size of the buffer
+     *
+     * @return     The length of the written string, or -1 if the buffer is too
+     *             small.
+     */
+    int toFEN(size_t game, char *fen, int size) const;
+
+    /**
+     * @brief      Finds the legal moves of every game (none for a game that is
+     *             over).
+     *
+     * @param      moves      The moves of all the games, one game after the
+     *                        other
+     * @param      first      The index of the first move of each game: the
+     *                        moves of game i are moves[first[i]] to
+     *                        moves[first[i+1] - 1] (getSize() + 1 entries)
+     * @param[in]  reservoir  True to include the reservoir moves, False
+     *                        otherwise
+     */
+    void generateMoves(vector<Move> &moves, vector<uint32_t> &first, bool reservoir = true);
+
+    /**
+     * @brief      Finds the legal moves of a game.
+     *
+     * @param[in]  game       The game (in [0, getSize()))
+     * @param      moves      The moves (MAX_BATCH_MOVES entries is always
+     *                        enough)
+     * @param[in]  reservoir  True to include the reservoir moves, False
+     *                        otherwise
+     *
+     * @return     The number of moves.
+     */
+    int gameMoves(size_t game, Move *moves, bool reservoir = true);
+
+    /**
+     * @brief      Makes a move in every game.
+     *
+     * @param[in]  moves  The move of each game (a move with a source of -1, or
+     *                    a missing entry, leaves its game as it is)
+     *
+     * @pre        Each move is a legal move of its game (see generateMoves()).
+     */
+    void applyMoves(const vector<Move> &moves);
+
+    /**
+     * @brief      Makes a move in a game.
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     * @param[in]  move  The move
+     *
+     * @pre        The move is a legal move of the game (see gameMoves()).
+     */
+    void applyMove(size_t game, const Move &move);
+
+    /**
+     * @brief      Finds which games are over (the side to move has no legal
+     *             move, with the reservoir moves).
+     *
+     * @return     The number of games that are not over.
+     */
+    size_t updateStatus();
+
+    /**
+     * @brief      Finds the squares attacked by the side not to move and the
+     *             pieces that give check, for every game (see getAttacked()
+     *             and getCheckers()).
+     */
+    void updateAttacks();
+
+    /**
+     * @brief      Evaluates every game, like Engine::evaluate().
+     *
+     * @param[in]  config  The settings of the evaluation
+     * @param      scores  The score of each game (in centipawns) for the side
+     *                     to move
+     */
+    void evaluate(const EngineConfig &config, vector<int> &scores) const;
+
+    /**
+     * @brief      (Mutator) Sets the version of the kernels (see
+     *             batch_kernels.h).
+     *
+     * @param[in]  kernel  The version
+     *
+     * @return     True if it was set, False otherwise (the processor does not
+     *             support it).
+     */
+    bool setKernel(batchKernel kernel);
+
+    /**
+     * @brief      (Accessor) Gets the version of the kernels (the fastest one
+     *             the processor supports, unless it was set).
+     *
+     * @return     The version.
+     */
+    batchKernel getKernel() const {return kernel;}
+
+    /**
+     * @brief      (Accessor) Gets the squares attacked by the side not to move
+     *             of a game, as of the last updateAttacks(), generateMoves()
+     *             or updateStatus().
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     *
+     * @return     The bitboard.
+     */
+    uint64_t getAttacked(size_t game) const {return attacked[game];}
+
+    /**
+     * @brief      (Accessor) Gets the pieces that give check in a game, as of
+     *             the last updateAttacks(), generateMoves() or updateStatus().
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     *
+     * @return     The bitboard.
+     */
+    uint64_t getCheckers(size_t game) const {return checkers[game];}
+
+    /**
+     * @brief      (Accessor) Gets the number of games.
+     *
+     * @return     The number of games.
+     */
+    size_t getSize() const {return num_games;}
+
+    /**
+     * @brief      (Accessor) Gets the status of a game (see updateStatus()).
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     *
+     * @return     The status.
+     */
+    batchStatus getStatus(size_t game) const {return (batchStatus) status[game];}
+
+    /**
+     * @brief      (Accessor) Gets the side to move of a game.
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     *
+     * @return     WHITE or BLACK.
+     */
+    pieceColor getTurn(size_t game) const {return white_to_move[game] ? WHITE : BLACK;}
+
+    /**
+     * @brief      (Accessor) Finds if the side to move of a game is in check.
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     *
+     * @return     True if it is in check, False otherwise.
+     */
+    bool getCheck(size_t game) const;
+
+    /**
+     * @brief      (Accessor) Gets the castling rights of a game (in the format
+     *             of Chess::getCastlingRights()).
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     *
+     * @return     The rights (bit 0 to 3 for K, Q, k and q).
+     */
+    int getCastlingRights(size_t game) const;
+
+    /**
+     * @brief      (Accessor) Gets the squares of the pieces of a type and color
+     *             of a game.
+     *
+     * @param[in]  game   The game (in [0, getSize()))
+     * @param[in]  type   The type (PAWN to KING)
+     * @param[in]  color  The color (WHITE or BLACK)
+     *
+     * @return     The bitboard (bit i is set if the piece is on square i).
+     */
+    uint64_t getPieces(size_t game, pieceType type, pieceColor color) const
+    {return pieces[type][game] & colors[color == WHITE][game];}
+
+    /**
+     * @brief      (Accessor) Gets the halfmove clock of a game.
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     *
+     * @return     The halfmove clock.
+     */
+    int getHalfmoveClock(size_t game) const {return halfmove[game];}
+
+    /**
+     * @brief      (Accessor) Gets the number of moves made in a game
+     *             (Chess::getNumMoves()).
+     *
+     * @param[in]  game  The game (in [0, getSize()))
+     *
+     * @return     The number of moves.
+     */
+    int getNumMoves(size_t game) const {return num_moves[game];}
+
+private:
+    /** The number of games */
+    size_t num_games;
+
+    /** The squares of the pieces of each type (PAWN to KING), of both colors */
+    vector<uint64_t> pieces[6];
+
+    /** The squares of the black pieces ([0]) and of the white pieces ([1]) */
+    vector<uint64_t> colors[2];
+
+    /** The squares of the pawns, kings and rooks that have not moved (pawns
+     *  that can move two squares, and castling rights) */
+    vector<uint64_t> unmoved;
+
+    /** The number of each reservoir piece, in the order of
+     *  Chess::getReservoir() */
+    vector<uint8_t> reservoir[10];
+
+    /** The en-passant square (64 for none) */
+    vector<uint8_t> en_passant;
+
+    /** Whether white is to move */
+    vector<uint8_t> white_to_move;
+
+    /** The status (see batchStatus) */
+    vector<uint8_t> status;
+
+    /** The halfmove clock */
+    vector<uint16_t> halfmove;
+
+    /** The number of moves made */
+    vector<uint32_t> num_moves;
+
+    /** The squares attacked by the side not to move (through the king of the
+     *  side to move), and the pieces that give check (see findAttacks()) */
+    vector<uint64_t> attacked, checkers;
+
+    /** The version of the kernels */
+    batchKernel kernel;
+
+    /**
+     * @brief      Finds the squares attacked by the side not to move and the
+     *             pieces that give check, for the games in [begin, end).
+     *
+     * @param[in]  begin  The first game
+     * @param[in]  end    One past the last game
+     */
+    void findAttacks(size_t begin, size_t end);
+
+    /**
+     * @brief      Finds the legal moves of a game from its attacked squares and
+     *             checks (see findAttacks()).
+     *
+     * @param[in]  game       The game
+     * @param      moves      The moves (MAX_BATCH_MOVES entries)
+     * @param[in]  reservoir  True to include the reservoir moves, False
+     *                        otherwise
+     *
+     * @return     The number of moves.
+     */
+    int listMoves(size_t game, Move *moves, bool reservoir) const;
+
+    /**
+     * @brief      Gets the arrays of the games that the kernels read.
+     *
+     * @return     The arrays.
+     */
+    BatchArrays getArrays() const;
+};
+
+#endif // GAME_BATCH_H
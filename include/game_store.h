@@ -0,0 +1,216 @@
+ /**
+  * \page gamestoreheader Saved Games Store Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;game_store.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;game_store.cpp, mapped_file.h, gui_state.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * The saved games of the GUI, kept across sessions in a single binary file.
+  * Every position of a saved game is stored (PackedPosition, 42 bytes), so a
+  * game is resumed at any ply by setting that position (Chess::setFromFEN())
+  * instead of replaying its moves. The file is memory mapped, and games are
+  * only ever appended to it.
+  *
+  * <b>File layout</b> (native byte order)
+  * 1. STORE_MAGIC (8 bytes);
+  * 2. for every game, a StoredGame (16 bytes) followed by its
+  *    StoredGame::num_positions PackedPosition entries (the starting position,
+  *    then the position after each move).
+  *
+  * A game that was only partly written (e.g. the program was stopped while
+  * saving) is ignored.
+  */
+
+#ifndef GAME_STORE_H
+#define GAME_STORE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "chess.h"
+#include "mapped_file.h"
+
+using namespace std;
+
+/*! \file */
+
+/** Identifies a saved games file (and its version) */
+#define STORE_MAGIC "CAMOGMS1"
+
+/**
+ * @brief      This struct describes a position in 42 bytes (a FEN string with
+ *             its piece reservoir takes about 70).
+ */
+struct PackedPosition
+{
+    /** The piece on each square, two squares per byte (low nibble first): 0 is
+     *  empty, 1 + pieceType for white and 9 + pieceType for black */
+    uint8_t squares[32];
+
+    /** The number of reservoir pieces, one per nibble (low nibble first), in
+     *  the order of Chess::getReservoir() */
+    uint8_t reservoir[5];
+
+    /** The side to move (bit 0 set for white) and the castling rights (bits 1
+     *  to 4, see Chess::getCastlingRights()) */
+    uint8_t flags;
+
+    /** The en-passant square (255 for none) */
+    uint8_t en_passant;
+
+    /** The halfmove clock (255 or more is stored as 255) */
+    uint8_t halfmove;
+
+    /** The number of moves made (Chess::getNumMoves()), low byte first */
+    uint8_t num_moves[2];
+};
+
+/**
+ * @brief      This struct describes the header of a saved game.
+ */
+struct StoredGame
+{
+    /** The number of positions (one more than the number of moves) */
+    uint32_t num_positions;
+
+    /** The result: 0 if the game is not over, 1 if white won, 2 if black won,
+     *  3 if it was drawn */
+    uint32_t result;
+
+    /** When the game was saved (seconds since the epoch) */
+    int64_t saved_time;
+};
+
+/**
+ * @brief      This class describes a memory mapped file of saved games.
+ */
+class GameStore
+{
+public:
+    /**
+     * @brief      Default constructor - Constructs a new instance with no file
+     *             opened.
+     */
+    GameStore() {}
+
+    /**
+     * @brief      Opens a saved games file, creating it if it does not exist.
+     *
+     * @param[in]  filename  The name of the file
+     *
+     * @post       Any previously opened file is closed first.
+     *
+     * @return     True if the file was opened, False otherwise (e.g. it is not
+     *             a saved games file).
+     */
+    bool open(const string &filename);
+
+    /**
+     * @brief      Closes the file (if any).
+     */
+    void close();
+
+    /**
+     * @brief      Saves a game at the end of the file.
+     *
+     * @param[in]  positions  The positions of the game (the starting position,
+     *                        then the position after each move)
+     * @param[in]  result     The result (see StoredGame::result)
+     *
+     * @pre        The file is opened
+     *
+     * @return     True if the game was saved, False otherwise.
+     */
+    bool append(const vector<PackedPosition> &positions, uint32_t result);
+
+    /**
+     * @brief      (Accessor) Gets the number of saved games.
+     *
+     * @return     The number of games.
+     */
+    uint32_t getNumGames() const {return (uint32_t) offsets.size();}
+
+    /**
+     * @brief      (Accessor) Gets the header of a saved game.
+     *
+     * @param[in]  game  The game (in [0, getNumGames()), in the order they were
+     *                   saved)
+     *
+     * @return     The header.
+     */
+    StoredGame getGame(uint32_t game) const;
+
+    /**
+     * @brief      (Accessor) Gets the positions of a saved game (in place, in
+     *             the mapped file).
+     *
+     * @param[in]  game  The game (in [0, getNumGames()))
+     *
+     * @return     The first of getGame(game).num_positions positions.
+     */
+    const PackedPosition * getPositions(uint32_t game) const;
+
+private:
+    /** The name of the file */
+    string filename;
+
+    /** The mapped file */
+    MappedFile file;
+
+    /** The byte offset of each game in the file */
+    vector<uint64_t> offsets;
+
+    /**
+     * @brief      Maps the file and finds its games.
+     *
+     * @return     True if the file is a saved games file, False otherwise.
+     */
+    bool load();
+};
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Packs the current position of a chess object.
+     *
+     * @param[in]  chess     The chess object
+     * @param      position  The packed position
+     */
+    void packPosition(const Chess &chess, PackedPosition &position);
+
+    /**
+     * @brief      Writes a packed position as a FEN string (in the format of
+     *             Chess::toFEN()).
+     *
+     * @param[in]  position  The packed position
+     * @param      fen       The buffer to write into (FEN_SIZE characters is
+     *                       always enough)
+     * @param[in]  size      The size of the buffer
+     *
+     * @return     The length of the written string, or -1 if the buffer is
+     *             too small.
+     */
+    int unpackPosition(const PackedPosition &position, char *fen, int size);
+
+    /**
+     * @brief      Finds the result of a game (see StoredGame::result).
+     *
+     * @param[in]  chess  The chess object
+     *
+     * @return     The result.
+     */
+    uint32_t gameResult(const Chess &chess);
+}
+
+#endif // GAME_STORE_H
@@ -0,0 +1,419 @@
+ /**
+  * \page guistateheader GUI State Machine Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;gui_state.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;gui_state.cpp, gui.cpp, guibench.cpp, engine.h, game_store.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * What the GUI does with the mouse and the keyboard, without a window: which
+  * square or reservoir piece a click picks, which move a release makes, what
+  * the keys do, and which squares are highlighted. The GUI (gui.cpp) only
+  * turns SFML events into calls to GuiState and draws what it holds, so the
+  * interface can be tested, and timed, on a machine without a display.
+  *
+  * The positions of the game (since it started, or was resumed) are kept
+  * packed, so the game can be saved to a GameStore, and a saved game can be
+  * resumed at any ply without replaying its moves.
+  *
+  * An input script is a list of inputs (GuiInput), one per line of text:
+  * <b>press x y</b>, <b>move x y</b>, <b>release x y</b> (window pixels) or
+  * <b>key name</b>, where the names are new, undo, resign, draw, queen, rook,
+  * bishop, knight, side and moves (see guiKey).
+  */
+
+#ifndef GUI_STATE_H
+#define GUI_STATE_H
+
+#include "engine.h"
+#include "game_store.h"
+
+/*! \file */
+
+/**
+ * @brief      The keys of the GUI (S, U, Esc, D, Q, R, B, N, 1 and numpad 1)
+ */
+enum guiKey
+{
+    KEY_NEW_GAME,           ///< 0
+    KEY_UNDO,               ///< 1
+    KEY_RESIGN,             ///< 2
+    KEY_DRAW,               ///< 3
+    KEY_QUEEN,              ///< 4
+    KEY_ROOK,               ///< 5
+    KEY_BISHOP,             ///< 6
+    KEY_KNIGHT,             ///< 7
+    KEY_SIDE_HIGHLIGHTING,  ///< 8
+    KEY_MOVE_HIGHLIGHTING   ///< 9
+};
+
+/**
+ * @brief      The kinds of inputs of the GUI
+ */
+enum guiInputType
+{
+    INPUT_PRESS,    ///< 0 (left mouse button)
+    INPUT_MOVE,     ///< 1 (mouse)
+    INPUT_RELEASE,  ///< 2 (left mouse button)
+    INPUT_KEY       ///< 3
+};
+
+/**
+ * @brief      This struct describes an input of the GUI.
+ */
+struct GuiInput
+{
+    /** The kind of input */
+    guiInputType type = INPUT_MOVE;
+
+    /** The position of the mouse (in window pixels) */
+    int x = 0, y = 0;
+
+    /** The key (only for INPUT_KEY) */
+    guiKey key = KEY_NEW_GAME;
+};
+
+/**
+ * @brief      This struct describes how long a script of inputs took.
+ */
+struct GuiBenchStats
+{
+    /** The number of inputs */
+    uint64_t interactions = 0;
+
+    /** The number of moves made */
+    uint64_t moves = 0;
+
+    /** The latency of an input (handling it and finding the highlighted
+     *  squares of the next frame), in microseconds */
+    double mean_us = 0, p50_us = 0, p99_us = 0, max_us = 0;
+};
+
+/**
+ * @brief      This class describes the state of the GUI: the game, the piece
+ *             that is held, the status message and the settings that are
+ *             changed by the keys.
+ */
+class GuiState
+{
+public:
+    /**
+     * @brief      Constructs a new instance (a new game, with a headless
+     *             chess object).
+     */
+    GuiState();
+
+    /**
+     * @brief      The chess object reports to this instance, so it is not
+     *             copied.
+     */
+    GuiState(const GuiState &) = delete;
+    GuiState & operator=(const GuiState &) = delete;
+
+    /**
+     * @brief      Handles an input.
+     *
+     * @param[in]  input  The input
+     *
+     * @return     True if what is shown may have changed, False otherwise.
+     */
+    bool apply(const GuiInput &input);
+
+    /**
+     * @brief      Handles a press of the left mouse button, which picks up a
+     *             board or reservoir piece.
+     *
+     * @param[in]  x     The x position of the mouse
+     * @param[in]  y     The y position of the mouse
+     *
+     * @return     True if what is shown may have changed, False otherwise.
+     */
+    bool press(int x, int y);
+
+    /**
+     * @brief      Handles a move of the mouse (which drags the held board
+     *             piece).
+     *
+     * @param[in]  x     The x position of the mouse
+     * @param[in]  y     The y position of the mouse
+     *
+     * @return     True if what is shown may have changed, False otherwise.
+     */
+    bool moveMouse(int x, int y);
+
+    /**
+     * @brief      Handles a release of the left mouse button, which makes the
+     *             move of the held piece to the square under the mouse (if it
+     *             is legal).
+     *
+     * @param[in]  x     The x position of the mouse
+     * @param[in]  y     The y position of the mouse
+     *
+     * @return     True if what is shown may have changed, False otherwise.
+     */
+    bool release(int x, int y);
+
+    /**
+     * @brief      Handles a key press.
+     *
+     * @param[in]  key   The key
+     *
+     * @return     True if what is shown may have changed, False otherwise.
+     */
+    bool pressKey(guiKey key);
+
+    /**
+     * @brief      Gets the highlighting of each square: the legal moves of the
+     *             held piece, or else the pieces of the side to move.
+     *
+     * @param      highlights  The highlighting of each square (0 for none, 1
+     *                         for a legal move, 2 for a piece of the side to
+     *                         move)
+     */
+    void getHighlights(vector<int> &highlights);
+
+    /**
+     * @brief      Saves the game (from its starting position to the current
+     *             one).
+     *
+     * @param      store  The saved games
+     *
+     * @return     True if the game was saved, False otherwise.
+     */
+    bool save(GameStore &store);
+
+    /**
+     * @brief      Resumes a saved game at a ply, by setting its position (the
+     *             moves are not replayed). Moves before that ply can still be
+     *             undone.
+     *
+     * @param[in]  store  The saved games
+     * @param[in]  game   The game (in [0, store.getNumGames()))
+     * @param[in]  ply    The number of moves of the game to resume after
+     *
+     * @return     True if the game was resumed, False otherwise (e.g. there is
+     *             no such ply).
+     */
+    bool resume(const GameStore &store, uint32_t game, uint32_t ply);
+
+    /**
+     * @brief      Finds if a position can be clicked (a board square or the
+     *             reservoir).
+     *
+     * @param[in]  x     The x position of the mouse
+     * @param[in]  y     The y position of the mouse
+     *
+     * @return     True if it can be clicked, False otherwise.
+     */
+    static bool isClickable(int x, int y);
+
+    /**
+     * @brief      Finds what a click picks up.
+     *
+     * @param[in]  x     The x position of the mouse
+     * @param[in]  y     The y position of the mouse
+     *
+     * @return     The board square, the ASCII value of the reservoir piece in
+     *             [110, 114], or -1 if the position is not on either.
+     */
+    static int sourceAt(int x, int y);
+
+    /**
+     * @brief      Finds the board square under a position.
+     *
+     * @param[in]  x     The x position of the mouse
+     * @param[in]  y     The y position of the mouse
+     *
+     * @return     The square, or -1 if the position is not on the board.
+     */
+    static int squareAt(int x, int y);
+
+    /**
+     * @brief      (Accessor) Gets the chess object.
+     *
+     * @return     The chess object.
+     */
+    Chess & getChess() {return chess;}
+
+    /**
+     * @brief      (Accessor) Finds if a piece is held.
+     *
+     * @return     True if a piece is held, False otherwise.
+     */
+    bool getHolding() const {return holding;}
+
+    /**
+     * @brief      (Accessor) Gets the held piece.
+     *
+     * @return     The square or reservoir piece (see sourceAt()), -1 if none.
+     */
+    int getSource() const {return holding ? src : -1;}
+
+    /**
+     * @brief      (Accessor) Gets the last position of the mouse.
+     *
+     * @param      x     The x position of the mouse
+     * @param      y     The y position of the mouse
+     */
+    void getMouse(int &x, int &y) const {x = mouse_x; y = mouse_y;}
+
+    /**
+     * @brief      (Accessor) Gets the last warning or status update.
+     *
+     * @return     The message.
+     */
+    const string & getMessage() const {return message;}
+
+    /**
+     * @brief      (Accessor) Gets the piece pawns are promoted to.
+     *
+     * @return     The piece ('q', 'r', 'b' or 'n').
+     */
+    char getPromotion() const {return promotion;}
+
+    /**
+     * @brief      (Accessor) Gets the number of moves made (not counting
+     *             those that were undone).
+     *
+     * @return     The number of moves.
+     */
+    uint64_t getMovesMade() const {return moves_made;}
+
+    /**
+     * @brief      (Accessor) Gets the number of moves of the game (since it
+     *             started, or since the start of the saved game it resumed).
+     *
+     * @return     The ply.
+     */
+    int getPly() const {return (int) line.size() - 1;}
+
+    /**
+     * @brief      (Accessor) Gets the saved game that was resumed, if no move
+     *             was made since.
+     *
+     * @return     The game, or -1 if none.
+     */
+    int getResumedGame() const {return resumed_game;}
+
+    /**
+     * @brief      (Accessor) Finds if the game changed since it was started,
+     *             saved or resumed.
+     *
+     * @return     True if it has unsaved moves, False otherwise.
+     */
+    bool getUnsaved() const {return unsaved;}
+
+private:
+    /** The game */
+    Chess chess;
+
+    /** The legal moves of each position */
+    MoveCache move_cache;
+
+    /** The held piece (valid while holding) */
+    int src;
+
+    /** The last position of the mouse */
+    int mouse_x, mouse_y;
+
+    /** Whether a piece is held, the game was resigned, and the highlighting
+     *  settings */
+    bool holding, resigned, side_highlighting, move_highlighting;
+
+    /** The last warning or status update */
+    string message;
+
+    /** The piece pawns are promoted to (default is Queen, always, even if the
+     *  game is reset after another piece is set) */
+    char promotion;
+
+    /** The number of moves made */
+    uint64_t moves_made;
+
+    /** The positions of the game, from its starting position to the current
+     *  one */
+    vector<PackedPosition> line;
+
+    /** The first position of the line that the chess object's saved states
+     *  (for undo) hold; the positions before it are set from the line */
+    size_t base;
+
+    /** The saved game that was resumed (-1 if none, or if a move was made
+     *  since) */
+    int resumed_game;
+
+    /** Whether the game changed since it was started, saved or resumed */
+    bool unsaved;
+
+    /**
+     * @brief      Sets the position of the chess object from the last
+     *             position of the line.
+     *
+     * @return     True if the position was set, False otherwise.
+     */
+    bool setFromLine();
+
+    /**
+     * @brief      Resets the position to the corresponding position indicated
+     *             by 'move_num'
+     *
+     * @param[in]  move_num  The move number to revert the position to
+     */
+    void resetPosition(int move_num);
+};
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Makes a script of a session: games of random legal moves
+     *             (dragged across the board, or from the reservoir), with
+     *             invalid drops, undos, promotion and highlighting keys mixed
+     *             in.
+     *
+     * @param[in]  interactions  The number of inputs
+     * @param[in]  seed          The seed of the random choices (the same seed
+     *                           gives the same script)
+     *
+     * @return     The inputs.
+     */
+    vector<GuiInput> scriptSession(int interactions, unsigned int seed);
+
+    /**
+     * @brief      Reads a script of inputs (see gui_state.h).
+     *
+     * @param      in      The input stream
+     * @param      script  The inputs
+     *
+     * @return     True if every line is a valid input, False otherwise.
+     */
+    bool readScript(istream &in, vector<GuiInput> &script);
+
+    /**
+     * @brief      Writes a script of inputs (see gui_state.h).
+     *
+     * @param      out     The output stream
+     * @param[in]  script  The inputs
+     */
+    void writeScript(ostream &out, const vector<GuiInput> &script);
+
+    /**
+     * @brief      Plays a script on a new GuiState and times every input.
+     *
+     * @param[in]  script  The inputs
+     *
+     * @return     The latencies of the inputs.
+     */
+    GuiBenchStats benchScript(const vector<GuiInput> &script);
+}
+
+#endif // GUI_STATE_H
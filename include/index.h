@@ -0,0 +1,224 @@
+ /**
+  * \page indexheader Position Index Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;index.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;index.cpp, indexer.cpp, archive.h, mapped_file.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * The position index answers "which games reached this position?" for a game
+  * archive. Every position of every game is hashed (Chess::getHash()) and
+  * stored as a (hash, game, ply) posting. The postings are sorted by hash and
+  * written to a binary file, which is memory mapped and binary searched when
+  * queried, so a query takes a few page reads regardless of the archive size.
+  *
+  * <b>File layout</b> (native byte order)
+  * 1. IndexHeader (32 bytes);
+  * 2. IndexHeader::num_postings Posting entries (16 bytes each), sorted by
+  *    hash, game and ply;
+  * 3. IndexHeader::num_games byte offsets (8 bytes each) of the games' lines
+  *    in the archive.
+  */
+
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+
+using namespace std;
+
+/*! \file */
+
+/** Identifies a position index file (and its version) */
+#define INDEX_MAGIC "CAMOIDX1"
+
+/**
+ * @brief      This struct describes a position that was reached in a game.
+ */
+struct Posting
+{
+    /** The Zobrist hash of the position */
+    uint64_t hash;
+
+    /** The game that reached the position (its number in the archive) */
+    uint32_t game;
+
+    /** The number of moves made in the game before the position was reached */
+    uint32_t ply;
+};
+
+/**
+ * @brief      Orders the postings by hash, then by game and ply.
+ *
+ * @param[in]  a     The first posting
+ * @param[in]  b     The second posting
+ *
+ * @return     True if 'a' comes before 'b', False otherwise.
+ */
+inline bool operator <(const Posting &a, const Posting &b)
+{
+    return a.hash != b.hash ? a.hash < b.hash : a.game != b.game ? a.game < b.game : a.ply < b.ply;
+}
+
+/**
+ * @brief      This struct describes the header at the start of an index file.
+ */
+struct IndexHeader
+{
+    /** INDEX_MAGIC (without the null terminator) */
+    char magic[8];
+
+    /** The number of postings in the file */
+    uint64_t num_postings;
+
+    /** The number of games in the archive */
+    uint64_t num_games;
+
+    /** The number of games with a malformed line, invalid FEN or illegal move */
+    uint64_t num_invalid;
+};
+
+/**
+ * @brief      This struct describes the outcome of building an index.
+ */
+struct IndexStats
+{
+    /** The number of games in the archive */
+    uint64_t games;
+
+    /** The number of games with a malformed line, invalid FEN or illegal move
+     *  (positions before the first illegal move are still indexed) */
+    uint64_t invalid;
+
+    /** The number of postings written */
+    uint64_t postings;
+
+    /** The time it took to build the index (in seconds) */
+    double seconds;
+};
+
+/**
+ * @brief      This class describes a memory mapped position index.
+ */
+class PositionIndex
+{
+public:
+    /**
+     * @brief      Default constructor - Constructs a new instance with no
+     *             index opened.
+     */
+    PositionIndex();
+
+    /**
+     * @brief      Builds the index of an archive. Games are replayed on
+     *             'num_threads' threads (each with its own headless Chess
+     *             object) and the postings of the threads are merged into the
+     *             file in sorted order.
+     *
+     * @param[in]  archive_file  The game archive (see archive.h)
+     * @param[in]  index_file    The index file to write
+     * @param[in]  num_threads   The number of threads (0 uses all cores)
+     * @param      stats         The outcome of the build (can be nullptr)
+     *
+     * @return     True if the index was written, False if the archive could
+     *             not be read or the index could not be written.
+     */
+    static bool build(const string &archive_file, const string &index_file, int num_threads, IndexStats *stats = nullptr);
+
+    /**
+     * @brief      Opens (memory maps) an index file.
+     *
+     * @param[in]  index_file  The index file
+     *
+     * @return     True if the file is a valid index, False otherwise.
+     */
+    bool open(const string &index_file);
+
+    /**
+     * @brief      Closes the index file.
+     */
+    void close();
+
+    /**
+     * @brief      (Accessor) Gets the number of postings in the index.
+     *
+     * @return     The number of postings.
+     */
+    uint64_t getNumPostings() const {return num_postings;}
+
+    /**
+     * @brief      (Accessor) Gets the number of games in the indexed archive.
+     *
+     * @return     The number of games.
+     */
+    uint64_t getNumGames() const {return num_games;}
+
+    /**
+     * @brief      (Accessor) Gets the number of invalid games in the indexed
+     *             archive.
+     *
+     * @return     The number of invalid games.
+     */
+    uint64_t getNumInvalid() const {return num_invalid;}
+
+    /**
+     * @brief      (Accessor) Gets where a game starts in the archive.
+     *
+     * @param[in]  game  The game (its number in the archive)
+     *
+     * @return     The byte offset of the game's line in the archive.
+     */
+    uint64_t getGameOffset(uint32_t game) const {return offsets[game];}
+
+    /**
+     * @brief      Finds the postings of a position (without copying them).
+     *
+     * @param[in]  hash   The hash of the position (Chess::getHash())
+     * @param      first  The first posting of the position (if any)
+     *
+     * @return     The number of postings of the position, which are stored
+     *             one after the other starting at 'first'.
+     */
+    size_t find(uint64_t hash, const Posting *&first) const;
+
+    /**
+     * @brief      Finds the postings of a position.
+     *
+     * @param[in]  hash   The hash of the position (Chess::getHash())
+     * @param[in]  limit  The maximum number of postings to return
+     *
+     * @return     The postings of the position, ordered by game and ply.
+     */
+    vector<Posting> query(uint64_t hash, size_t limit = SIZE_MAX) const;
+
+private:
+    /** The mapped index file */
+    MappedFile file;
+
+    /** The sorted postings (inside the mapped file) */
+    const Posting *postings;
+
+    /** The byte offsets of the games in the archive (inside the mapped file) */
+    const uint64_t *offsets;
+
+    /** The number of postings */
+    uint64_t num_postings;
+
+    /** The number of games */
+    uint64_t num_games;
+
+    /** The number of invalid games */
+    uint64_t num_invalid;
+};
+
+#endif // INDEX_H
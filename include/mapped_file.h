@@ -0,0 +1,103 @@
+ /**
+  * \page mappedfileheader Memory Mapped File Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;mapped_file.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;mapped_file.cpp</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * Read-only memory mapping of a file, so that large tables (e.g. the position
+  * index) can be searched in place without reading them into memory first.
+  */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+using namespace std;
+
+/*! \file */
+
+/**
+ * @brief      This class describes a file that is mapped into memory for
+ *             reading. The mapping is released when the object is destroyed.
+ */
+class MappedFile
+{
+public:
+    /**
+     * @brief      Default constructor - Constructs a new instance with no file
+     *             mapped.
+     */
+    MappedFile();
+
+    /**
+     * @brief      Destroys the object and releases the mapping.
+     */
+    ~MappedFile();
+
+    // a mapping is owned by a single object
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator =(const MappedFile &) = delete;
+
+    /**
+     * @brief      Maps a file into memory (read-only).
+     *
+     * @param[in]  filename  The name of the file
+     *
+     * @post       Any previously mapped file is released first.
+     *
+     * @return     True if the file was mapped, False otherwise.
+     */
+    bool open(const string &filename);
+
+    /**
+     * @brief      Releases the mapping (if any).
+     */
+    void close();
+
+    /**
+     * @brief      (Accessor) Gets the contents of the file.
+     *
+     * @return     The first byte of the file, or nullptr if no file (or an
+     *             empty file) is mapped.
+     */
+    const char * getData() const {return data;}
+
+    /**
+     * @brief      (Accessor) Gets the size of the file.
+     *
+     * @return     The number of bytes mapped.
+     */
+    size_t getSize() const {return size;}
+
+private:
+    /** The contents of the file */
+    const char *data;
+
+    /** The number of bytes mapped */
+    size_t size;
+
+#ifdef _WIN32
+    /** The handle of the opened file */
+    HANDLE file;
+
+    /** The handle of the file mapping object */
+    HANDLE mapping;
+#endif
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,201 @@
+ /**
+  * \page matchheader Engine Match Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;match.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;match.cpp, arena.cpp, engine.h, archive.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * Engine-vs-engine matches between two engine configurations. The games are
+  * played concurrently (each thread has its own engines and headless Chess
+  * object) from a set of opening positions. Every opening is played twice,
+  * once with each configuration as white, so that neither side is favoured by
+  * the openings.
+  *
+  * The results are summarized by an Elo difference (with its 95% error
+  * margin) and a sequential probability ratio test (SPRT) of the hypotheses
+  * H0: elo = elo0 against H1: elo = elo1, which stops the match as soon as
+  * one of them is accepted.
+  */
+
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <functional>
+#include "archive.h"
+#include "engine.h"
+
+/*! \file */
+
+/**
+ * @brief      This struct describes when a game is ended before checkmate or
+ *             stalemate.
+ */
+struct Adjudication
+{
+    /** The game is drawn after this many plies (0 to never draw) */
+    int max_plies = 300;
+
+    /** The game is drawn when the halfmove clock reaches 100 (50 moves
+     *  without a pawn move or capture) */
+    bool fifty_moves = true;
+
+    /** A side loses when both engines agree that it is behind by at least
+     *  this score (in centipawns) ... */
+    int resign_score = 1000;
+
+    /** ... for this many plies in a row (0 to never resign) */
+    int resign_plies = 6;
+
+    /** The game is drawn when both engines score it within this score (in
+     *  centipawns) of equality ... */
+    int draw_score = 10;
+
+    /** ... for this many plies in a row (0 to never draw) ... */
+    int draw_plies = 20;
+
+    /** ... after this many plies were played */
+    int draw_start = 60;
+};
+
+/**
+ * @brief      This struct describes the settings of a match.
+ */
+struct MatchConfig
+{
+    /** The two engine configurations (the results are for engines[0]) */
+    EngineConfig engines[2];
+
+    /** The opening positions (FEN strings). The regular start position is
+     *  used if there are none */
+    vector<string> openings;
+
+    /** The number of random moves made after an opening (the same for both
+     *  games of the opening), to vary the games */
+    int random_plies = 4;
+
+    /** The seed of the random moves */
+    unsigned int seed = 1;
+
+    /** The maximum number of games */
+    int games = 1000;
+
+    /** The number of threads (0 uses all cores) */
+    int threads = 0;
+
+    /** When the games are ended early */
+    Adjudication adjudication;
+
+    /** The Elo difference of H0 (engines[0] is not stronger) */
+    double elo0 = 0;
+
+    /** The Elo difference of H1 (engines[0] is stronger) */
+    double elo1 = 10;
+
+    /** The probability of accepting H1 when H0 is true */
+    double alpha = 0.05;
+
+    /** The probability of accepting H0 when H1 is true */
+    double beta = 0.05;
+};
+
+/**
+ * @brief      This struct describes the results of a match (so far) for
+ *             engines[0].
+ */
+struct MatchStats
+{
+    /** The number of games won, drawn and lost */
+    uint64_t wins = 0, draws = 0, losses = 0;
+
+    /** The number of games ended by adjudication */
+    uint64_t adjudicated = 0;
+
+    /** The number of moves made by the engines */
+    uint64_t plies = 0;
+
+    /** The number of positions searched by the engines */
+    uint64_t nodes = 0;
+
+    /** The time the games took (in seconds) */
+    double seconds = 0;
+
+    /** The log-likelihood ratio of the SPRT */
+    double llr = 0;
+
+    /** 1 if H1 was accepted, -1 if H0 was accepted, 0 otherwise */
+    int sprt = 0;
+};
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Plays a game between two engines.
+     *
+     * @param      white  The engine playing white
+     * @param      black  The engine playing black
+     * @param      chess  The chess object (should be headless), which holds
+     *                    the starting position
+     * @param[in]  rules  When the game is ended early
+     * @param      game   The moves and result are appended to it
+     * @param[in]  visit  Called with each position an engine moved from and
+     *                    the score of its search (for the side to move), before
+     *                    the move is made (can be nullptr)
+     *
+     * @return     True if the game was ended by adjudication, False if it
+     *             ended by checkmate or stalemate.
+     */
+    bool playGame(Engine &white, Engine &black, Chess &chess, const Adjudication &rules, GameRecord &game,
+                  const function<void(const Chess &, int)> &visit = nullptr);
+
+    /**
+     * @brief      Plays a match between two engine configurations on a pool
+     *             of threads.
+     *
+     * @param[in]  config   The settings of the match
+     * @param      stats    The results of the match
+     * @param[in]  on_game  Called after every game with the game, its number
+     *                      and the results so far (one call at a time, so it
+     *                      can write to a file without locking)
+     *
+     * @return     True if the match was played, False if an opening is not a
+     *             valid FEN.
+     */
+    bool runMatch(const MatchConfig &config, MatchStats &stats,
+                  const function<void(const GameRecord &, int, const MatchStats &)> &on_game = nullptr);
+
+    /**
+     * @brief      Computes the log-likelihood ratio of the SPRT, using the
+     *             normal approximation of the trinomial (win, draw, loss)
+     *             results.
+     *
+     * @param[in]  stats  The results
+     * @param[in]  elo0   The Elo difference of H0
+     * @param[in]  elo1   The Elo difference of H1
+     *
+     * @return     The log-likelihood ratio (0 if the results do not vary yet).
+     */
+    double sprtLLR(const MatchStats &stats, double elo0, double elo1);
+
+    /**
+     * @brief      Estimates the Elo difference from the results.
+     *
+     * @param[in]  stats   The results
+     * @param      margin  The 95% error margin of the estimate
+     *
+     * @return     The Elo difference (positive if engines[0] is stronger).
+     */
+    double eloDifference(const MatchStats &stats, double &margin);
+}
+
+#endif // MATCH_H
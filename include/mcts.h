@@ -0,0 +1,259 @@
+ /**
+  * \page mctsheader Monte Carlo Tree Search Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;mcts.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;mcts.cpp, engine.h, game_batch.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * The Monte Carlo tree search of the engine (EngineConfig::search set to
+  * SEARCH_MCTS). The reservoir gives a chessCAMO position about a hundred legal
+  * moves, most of them poor, which an alpha-beta search has to look at one by
+  * one. A Monte Carlo tree search instead grows a tree towards the moves that
+  * did well in short random games (playouts), and the prior of each move
+  * (PUCT) keeps it from spending its visits on the reservoir moves.
+  *
+  * The moves are found and made on GameBatch games (bitboards, without
+  * allocating), so a playout costs about a microsecond per move. Several
+  * threads search the same tree: a thread going down the tree counts a visit
+  * at once but its result only when the playout is done (a virtual loss), so
+  * that the other threads go down other lines meanwhile.
+  *
+  * Like the alpha-beta search, a position of the tree that repeats one of its
+  * line or of the game (Chess::getHistory()), or that reached the 50 move
+  * rule, is a draw. The playouts only stop at the 50 move rule, since they do
+  * not keep the hashes of their moves.
+  *
+  * The nodes come from a pool allocated once (EngineConfig::tree_nodes). When
+  * the next search is from a position one or two moves after the root (the
+  * engine's move and the reply), the subtree of that position is kept (copied
+  * to the front of the other pool) instead of being searched again.
+  */
+
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "engine.h"
+#include "game_batch.h"
+
+using namespace std;
+
+/*! \file */
+
+/**
+ * @brief      The states of a node of the tree.
+ */
+enum nodeState
+{
+    NODE_LEAF,          ///< 0 (its moves were not found yet)
+    NODE_EXPANDING,     ///< 1 (a thread is adding its children)
+    NODE_EXPANDED,      ///< 2 (its children are in the tree)
+    NODE_TERMINAL,      ///< 3 (the game is over)
+    NODE_FULL           ///< 4 (the pool had no room for its children)
+};
+
+/**
+ * @brief      This struct describes a node of the tree: a move and the
+ *             statistics of the position after it.
+ */
+struct MctsNode
+{
+    /** The sum of the results of the playouts through the node, for the side
+     *  that made the move (1000 for a win, 500 for a draw, 0 for a loss) */
+    atomic<uint64_t> value;
+
+    /** The move from the parent position */
+    Move move;
+
+    /** The prior of the move (the children of a node add up to 1) */
+    float prior;
+
+    /** The number of visits, including the ones of playouts that are not
+     *  done yet (virtual losses) */
+    atomic<uint32_t> visits;
+
+    /** The index of the first child in the pool */
+    uint32_t first_child;
+
+    /** The number of children */
+    uint16_t num_children;
+
+    /** The result (as in 'value') for the side to move when the game is over
+     *  (NODE_TERMINAL) */
+    uint16_t outcome;
+
+    /** The state (see nodeState) */
+    atomic<uint8_t> state;
+};
+
+/**
+ * @brief      This struct describes the statistics of a search.
+ */
+struct MctsStats
+{
+    /** The number of playouts */
+    uint64_t playouts = 0;
+
+    /** The number of playouts per second */
+    double playouts_per_second = 0;
+
+    /** The number of nodes in the tree */
+    uint32_t nodes = 0;
+
+    /** The number of visits of the root that were kept from the last search
+     *  (see MctsTree::setRoot()) */
+    uint32_t reused = 0;
+};
+
+/**
+ * @brief      This class describes a Monte Carlo tree search.
+ */
+class MctsTree
+{
+public:
+    /**
+     * @brief      Constructs a new instance.
+     *
+     * @param[in]  config  The settings of the search
+     */
+    explicit MctsTree(const EngineConfig &config);
+
+    /**
+     * @brief      (Mutator) Sets the settings of the search (the tree is kept
+     *             unless the number of nodes changed).
+     *
+     * @param[in]  config  The settings
+     */
+    void setConfig(const EngineConfig &config);
+
+    /**
+     * @brief      Sets the position to search. If it is the root of the tree
+     *             or follows from it by one or two moves, the subtree of the
+     *             position is kept, otherwise the tree is cleared.
+     *
+     * @param[in]  chess  The chess object
+     *
+     * @return     True if a subtree was kept, False otherwise.
+     */
+    bool setRoot(const Chess &chess);
+
+    /**
+     * @brief      Runs playouts from the root (on EngineConfig::search_threads
+     *             threads).
+     *
+     * @param[in]  playouts  The number of playouts
+     * @param[in]  stop      Set (ex. by another thread) to stop as soon as
+     *                       possible (nullptr if it cannot be stopped)
+     *
+     * @return     The number of playouts that were run.
+     */
+    uint64_t run(uint64_t playouts, const atomic<bool> *stop = nullptr);
+
+    /**
+     * @brief      Gets the best move of the root (the most visited one).
+     *
+     * @param      score  The score of the move (in centipawns) for the side to
+     *                    move, from its average result
+     * @param      pv     The most visited line from the root (nullptr if it is
+     *                    not needed)
+     *
+     * @return     The best move, or a move with 'src' = -1 if there is none
+     *             (or no playout was run).
+     */
+    Move best(int &score, vector<Move> *pv = nullptr) const;
+
+    /**
+     * @brief      (Accessor) Gets the statistics of the last run() (and the
+     *             tree).
+     *
+     * @return     The statistics.
+     */
+    MctsStats getStats() const {return stats;}
+
+    /**
+     * @brief      (Accessor) Gets the number of visits of the root.
+     *
+     * @return     The number of visits.
+     */
+    uint32_t getRootVisits() const {return pool[current][0].visits;}
+
+private:
+    /** The settings of the search */
+    EngineConfig config;
+
+    /** The two pools of nodes (the tree is in pool[current], the other one
+     *  is used to keep a subtree) */
+    unique_ptr<MctsNode[]> pool[2];
+
+    /** The pool of the tree */
+    int current;
+
+    /** The number of nodes taken from the pool of the tree (it can be more
+     *  than EngineConfig::tree_nodes when the pool is full) */
+    atomic<uint32_t> used;
+
+    /** The position of the root (game 0) */
+    GameBatch root;
+
+    /** The positions of the game up to the root (its last entry), for the
+     *  repetitions */
+    PositionHistory history;
+
+    /** The statistics */
+    MctsStats stats;
+
+    /**
+     * @brief      Clears the tree (only the root is left).
+     */
+    void clear();
+
+    /**
+     * @brief      Makes a node the root of the tree, with its subtree (copied
+     *             to the front of the other pool, which becomes the pool of
+     *             the tree).
+     *
+     * @param[in]  node  The node
+     */
+    void keepSubtree(uint32_t node);
+
+    /**
+     * @brief      Runs playouts until 'next' reaches 'playouts' (one thread).
+     *
+     * @param[in]  playouts  The number of playouts
+     * @param      next      The number of playouts started (by all threads)
+     * @param[in]  stop      Stops the playouts when set (can be nullptr)
+     * @param[in]  seed      The seed of the random moves
+     */
+    void worker(uint64_t playouts, atomic<uint64_t> &next, const atomic<bool> *stop, unsigned int seed);
+
+    /**
+     * @brief      Adds the children (legal moves) of a node.
+     *
+     * @param[in]  node   The node (in the state NODE_EXPANDING)
+     * @param      game   The position of the node (game 0)
+     * @param      moves  A buffer of MAX_BATCH_MOVES moves
+     */
+    void expand(uint32_t node, GameBatch &game, Move *moves);
+
+    /**
+     * @brief      Selects the child of a node to visit (PUCT or UCT).
+     *
+     * @param[in]  node  The node (in the state NODE_EXPANDED)
+     *
+     * @return     The index of the child in the pool.
+     */
+    uint32_t select(uint32_t node) const;
+};
+
+#endif // MCTS_H
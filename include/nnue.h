@@ -0,0 +1,270 @@
+ /**
+  * \page nnueheader Neural Network Evaluation Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;nnue.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;nnue.cpp, nnuebench.cpp, engine.h, batch_kernels.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * An efficiently updatable neural network (NNUE) evaluation. The inputs are
+  * sparse features of the position seen by each side (its "perspective"):
+  *
+  * - [0, 768): a piece of the side (0) or of the opponent (1), of a type, on a
+  *   square, at ((relative color * 6 + type) * 64 + square). The squares are
+  *   flipped for black, so both sides see their pieces from their own 1st
+  *   rank;
+  * - [768, 808): the reservoir, as levels: (relative color * 5 + type) * 4 +
+  *   level is set for each level below the number of reservoir pieces of the
+  *   type (up to NNUE_RESERVOIR_LEVELS).
+  *
+  * A position has about 32 of the 808 features set, and a move changes only a
+  * few of them, so the first layer (808 to NNUE_HIDDEN, int16) is kept in an
+  * accumulator per perspective that is updated with the changed features
+  * instead of being computed again: the engine keeps one accumulator per ply
+  * of its search, updated from the one of the parent position, and going back
+  * to the parent (unmaking the move) leaves its accumulator as it was.
+  *
+  * The accumulators of the side to move and of the other side are clipped to
+  * [0, NNUE_ACTIVATION_MAX], converted to 8 bit and multiplied by the int8
+  * weights of the output layer. Both layers have a scalar version and, on x86,
+  * an AVX2 version chosen when the program runs (see chessCAMO::bestKernel()).
+  *
+  * The embedded default network is the hand-crafted evaluation written as a
+  * network (Nnue::setEvaluation()): material, center bonus and reservoir of
+  * each side are spread over a few hidden neurons, so the engine plays the
+  * same with either evaluation. A trained network replaces it with
+  * Nnue::load().
+  *
+  * <b>Network file layout</b> (native byte order)
+  * 1. NnueHeader (24 bytes);
+  * 2. the feature weights (NNUE_INPUTS x NNUE_HIDDEN int16, feature major);
+  * 3. the hidden biases (NNUE_HIDDEN int16);
+  * 4. the output weights (2 x NNUE_HIDDEN int8, side to move first).
+  */
+
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "engine.h"
+#include "batch_kernels.h"
+
+using namespace std;
+
+/*! \file */
+
+/** Identifies a network file (and its version) */
+#define NNUE_MAGIC "CAMONNU1"
+
+/** The number of piece features (see the file description) */
+#define NNUE_PIECE_INPUTS 768
+
+/** The most reservoir pieces of a type that have their own feature */
+#define NNUE_RESERVOIR_LEVELS 4
+
+/** The number of input features */
+#define NNUE_INPUTS (NNUE_PIECE_INPUTS + 2 * 5 * NNUE_RESERVOIR_LEVELS)
+
+/** The number of hidden neurons per perspective (a multiple of 32, the
+ *  int8 values of an AVX2 register) */
+#define NNUE_HIDDEN 128
+
+/** The largest value of a hidden neuron after its activation (clipped ReLU).
+ *  127 * 127 * 2 fits the 16 bit sums of the AVX2 output layer */
+#define NNUE_ACTIVATION_MAX 127
+
+/** The most features a move changes per perspective (a castling changes 4,
+ *  a capture with a promotion 3, a reservoir move 2 and 1 level) */
+#define NNUE_MAX_CHANGES 8
+
+/**
+ * @brief      This struct describes the header at the start of a network
+ *             file.
+ */
+struct NnueHeader
+{
+    /** NNUE_MAGIC (without the null terminator) */
+    char magic[8];
+
+    /** NNUE_INPUTS and NNUE_HIDDEN (the network must have the same shape) */
+    uint32_t inputs, hidden;
+
+    /** The bias of the output layer */
+    int32_t output_bias;
+
+    /** The output layer's sum is divided by this to give centipawns */
+    int32_t output_divisor;
+};
+
+/**
+ * @brief      This struct describes the first layer of a position, for both
+ *             perspectives, and the position it was computed for.
+ */
+struct NnueAccumulator
+{
+    /** The hidden neurons of black's ([0]) and white's ([1]) perspective */
+    int16_t values[2][NNUE_HIDDEN];
+
+    /** The piece on each square: its type (+ 6 for black), 12 if empty */
+    int8_t pieces[64];
+
+    /** The number of reservoir pieces, in the order of Chess::getReservoir() */
+    uint8_t reservoir[10];
+};
+
+/**
+ * @brief      This class describes an NNUE network and its evaluation.
+ */
+class Nnue
+{
+public:
+    /**
+     * @brief      Default constructor - Constructs a new instance with the
+     *             embedded default network.
+     */
+    Nnue();
+
+    /**
+     * @brief      (Mutator) Sets the network to the hand-crafted evaluation
+     *             of an engine (see Engine::evaluate()), written as a network.
+     *
+     * @param[in]  config  The settings of the evaluation (the material, center
+     *                     bonus and reservoir percentage)
+     *
+     * @note       The values are rounded to 4 centipawns, and a neuron can
+     *             saturate with many pieces of a type (ex. five queens).
+     */
+    void setEvaluation(const EngineConfig &config);
+
+    /**
+     * @brief      Loads a network file.
+     *
+     * @param[in]  filename  The network file
+     *
+     * @return     True if the network was loaded, False if the file is not a
+     *             network of this shape (the network is not changed).
+     */
+    bool load(const string &filename);
+
+    /**
+     * @brief      Writes the network to a file.
+     *
+     * @param[in]  filename  The network file
+     *
+     * @return     True if the file was written, False otherwise.
+     */
+    bool save(const string &filename) const;
+
+    /**
+     * @brief      (Mutator) Sets the version of the kernels used by the layers
+     *             (an unsupported version uses the scalar one).
+     *
+     * @param[in]  kernel  The version (KERNEL_SSE42 uses the scalar kernels)
+     */
+    void setKernel(batchKernel kernel);
+
+    /**
+     * @brief      (Accessor) Gets the version of the kernels used by the
+     *             layers.
+     *
+     * @return     The version.
+     */
+    batchKernel getKernel() const {return kernel;}
+
+    /**
+     * @brief      Computes the accumulator of a position from all of its
+     *             features.
+     *
+     * @param[in]  chess  The chess object
+     * @param      acc    The accumulator
+     */
+    void refresh(const Chess &chess, NnueAccumulator &acc) const;
+
+    /**
+     * @brief      Computes the accumulator of a position from the one of
+     *             another position (usually its parent), with only the
+     *             features that differ.
+     *
+     * @param[in]  chess   The chess object
+     * @param[in]  parent  The accumulator of the other position
+     * @param      acc     The accumulator of the position (can be 'parent')
+     */
+    void update(const Chess &chess, const NnueAccumulator &parent, NnueAccumulator &acc) const;
+
+    /**
+     * @brief      Computes the accumulator of a position from the one of its
+     *             parent, reading only the squares changed by the move that
+     *             was played.
+     *
+     * @param[in]  chess   The chess object (after the move)
+     * @param[in]  parent  The accumulator of the parent position
+     * @param      acc     The accumulator of the position (can be 'parent')
+     * @param[in]  move    The move played from the parent position
+     */
+    void update(const Chess &chess, const NnueAccumulator &parent, NnueAccumulator &acc, const Move &move) const;
+
+    /**
+     * @brief      Evaluates a position from its accumulator.
+     *
+     * @param[in]  acc   The accumulator
+     * @param[in]  turn  The side to move
+     *
+     * @return     The score of the position (in centipawns) for the side to
+     *             move.
+     */
+    int evaluate(const NnueAccumulator &acc, pieceColor turn) const;
+
+    /**
+     * @brief      Evaluates a position (its accumulator is computed from all
+     *             of its features).
+     *
+     * @param[in]  chess  The chess object
+     *
+     * @return     The score of the position (in centipawns) for the side to
+     *             move.
+     */
+    int evaluate(const Chess &chess) const;
+
+private:
+    /**
+     * @brief      Computes the accumulator of a position from the one of
+     *             another position, with the features of some squares and of
+     *             the reservoir (the other squares are the same in both
+     *             positions).
+     *
+     * @param[in]  chess        The chess object
+     * @param[in]  parent       The accumulator of the other position
+     * @param      acc          The accumulator of the position (can be
+     *                          'parent')
+     * @param[in]  squares      The squares that can differ
+     * @param[in]  num_squares  The number of squares
+     */
+    void updateSquares(const Chess &chess, const NnueAccumulator &parent, NnueAccumulator &acc,
+                       const int *squares, int num_squares) const;
+
+    /** The weights of each feature (NNUE_INPUTS x NNUE_HIDDEN) */
+    vector<int16_t> feature_weights;
+
+    /** The biases of the hidden neurons */
+    vector<int16_t> feature_biases;
+
+    /** The weights of the output layer (side to move, then the other side) */
+    vector<int8_t> output_weights;
+
+    /** The bias and divisor of the output layer (see NnueHeader) */
+    int32_t output_bias, output_divisor;
+
+    /** The version of the kernels */
+    batchKernel kernel;
+};
+
+#endif // NNUE_H
@@ -0,0 +1,150 @@
+ /**
+  * \page residentgamesheader Resident Games Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;resident_games.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;resident_games.cpp, game_store.h, chess.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * Many live games kept in memory at once (ex. by a game server). A Chess
+  * object keeps its board as 64 heap pieces, its flags and reservoir in
+  * vectors and a serialized state per move, which is a few kilobytes over
+  * about a hundred allocations. A resident game is a PackedPosition (the
+  * packed board, 4 bit reservoir counters, side to move, castling rights,
+  * en-passant square and counters) with the game over flags in a bitfield, in
+  * 43 bytes. The hashes of the positions since the last irreversible move
+  * (all that threefold repetition needs) are stored separately.
+  *
+  * A game is loaded into a Chess object to make a move, and stored back
+  * after it.
+  */
+
+#ifndef RESIDENT_GAMES_H
+#define RESIDENT_GAMES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chess.h"
+#include "game_store.h"
+
+using namespace std;
+
+/*! \file */
+
+/**
+ * @brief      This struct describes a resident game (43 bytes).
+ */
+struct ResidentGame
+{
+    /** The current position */
+    PackedPosition position;
+
+    /** True if the game ended in checkmate */
+    uint8_t checkmate : 1;
+
+    /** True if the game was drawn (stalemate, threefold repetition or 50 move
+     *  rule) */
+    uint8_t drawn : 1;
+
+    /** True if the slot holds a game (False once it was erased) */
+    uint8_t live : 1;
+};
+
+/**
+ * @brief      This class describes the resident games. A game is referred to
+ *             by its index, and the index of an erased game is given to the
+ *             next added one.
+ */
+class ResidentGames
+{
+public:
+    /**
+     * @brief      Default constructor - Constructs a new instance with no
+     *             games.
+     */
+    ResidentGames() : num_live{0} {}
+
+    /**
+     * @brief      Adds a game.
+     *
+     * @param[in]  chess  The chess object of the game
+     *
+     * @return     The index of the game.
+     */
+    uint32_t add(const Chess &chess);
+
+    /**
+     * @brief      Stores a game (ex. after a move was made on the chess object
+     *             it was loaded into).
+     *
+     * @param[in]  game   The index of the game
+     * @param[in]  chess  The chess object of the game
+     */
+    void store(uint32_t game, const Chess &chess);
+
+    /**
+     * @brief      Loads a game into a chess object (as Chess::setFromFEN()
+     *             does, with the game over flags and the repetition history).
+     *
+     * @param[in]  game   The index of the game
+     * @param      chess  The chess object
+     *
+     * @return     True if the game was loaded, False if there is no such game.
+     */
+    bool load(uint32_t game, Chess &chess) const;
+
+    /**
+     * @brief      Erases a game (its index is re-used).
+     *
+     * @param[in]  game  The index of the game
+     */
+    void erase(uint32_t game);
+
+    /**
+     * @brief      (Accessor) Gets the number of games (that were not erased).
+     *
+     * @return     The number of games.
+     */
+    size_t size() const {return num_live;}
+
+    /**
+     * @brief      (Accessor) Gets a resident game.
+     *
+     * @param[in]  game  The index of the game
+     *
+     * @return     The game.
+     */
+    const ResidentGame & getGame(uint32_t game) const {return games[game];}
+
+    /**
+     * @brief      Finds the memory held by the games (the object and the
+     *             memory it allocated).
+     *
+     * @return     The number of bytes.
+     */
+    size_t memoryUsage() const;
+
+private:
+    /** The games */
+    vector<ResidentGame> games;
+
+    /** The hashes of the positions of each game since its last irreversible
+     *  move (the current position last) */
+    vector<vector<uint64_t>> windows;
+
+    /** The indices of the erased games */
+    vector<uint32_t> erased;
+
+    /** The number of games that were not erased */
+    size_t num_live;
+};
+
+#endif // RESIDENT_GAMES_H
@@ -0,0 +1,295 @@
+ /**
+  * \page selfplayheader Self-Play Training Data Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;selfplay.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;selfplay.cpp, datagen.cpp, match.h, game_store.h, mapped_file.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * Training data for evaluation networks (see nnue.h): the positions of
+  * low-depth self-play games, each with the score of its search and the
+  * result of its game. The games are played concurrently (each thread has its
+  * own engine and headless Chess object, like a match, see match.h), and each
+  * thread packs the samples of its games into its own buffer, which is
+  * appended to the file when it is full, so the threads only share the file.
+  *
+  * A sample is 32 bytes: the occupied squares as a bitboard, the piece of each
+  * occupied square as a nibble (a position has at most 32 pieces, since the
+  * reservoir only replaces pieces), the reservoir counters as nibbles, and the
+  * side to move, castling rights, result and score. The en-passant square and
+  * move counters are not kept.
+  *
+  * The reader memory maps the file and streams its samples in order, or
+  * shuffled: the file is read in chunks of SAMPLE_CHUNK samples in a random
+  * order, and a window of SAMPLE_WINDOW chunks is shuffled before it is
+  * streamed, so the file is read sequentially (chunk by chunk) while the
+  * samples next to each other come from different games.
+  *
+  * <b>File layout</b> (native byte order)
+  * 1. SampleHeader (16 bytes);
+  * 2. TrainingSample samples (32 bytes each), game by game.
+  */
+
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+#include "game_store.h"
+#include "match.h"
+
+using namespace std;
+
+/*! \file */
+
+/** Identifies a training data file (and its version) */
+#define SAMPLE_MAGIC "CAMOSMP1"
+
+/** The number of samples of a chunk that the reader reads in one piece
+ *  (128 KB) */
+#define SAMPLE_CHUNK 4096
+
+/** The number of chunks shuffled together by the reader (2 MB) */
+#define SAMPLE_WINDOW 16
+
+/**
+ * @brief      This struct describes a position of a self-play game, its score
+ *             and the result of its game (32 bytes).
+ */
+struct TrainingSample
+{
+    /** The occupied squares (bit 'square' set, square 0 is a8) */
+    uint64_t occupied;
+
+    /** The piece of each occupied square, in the order of the squares, two
+     *  per byte (low nibble first): 1 + pieceType for white and 9 +
+     *  pieceType for black (see PackedPosition::squares) */
+    uint8_t pieces[16];
+
+    /** The number of reservoir pieces, one per nibble (see
+     *  PackedPosition::reservoir) */
+    uint8_t reservoir[5];
+
+    /** The side to move (bit 0 set for white), the castling rights (bits 1
+     *  to 4, see Chess::getCastlingRights()) and the result of the game for
+     *  the side to move (bits 5 and 6: 0 for a loss, 1 for a draw, 2 for a
+     *  win) */
+    uint8_t flags;
+
+    /** The score of the search for the side to move (in centipawns, mates
+     *  are clipped to +/- 32000) */
+    int16_t score;
+};
+
+/**
+ * @brief      This struct describes the header at the start of a training
+ *             data file.
+ */
+struct SampleHeader
+{
+    /** SAMPLE_MAGIC (without the null terminator) */
+    char magic[8];
+
+    /** The number of samples in the file */
+    uint64_t num_samples;
+};
+
+/**
+ * @brief      This struct describes the settings of the self-play games.
+ */
+struct SelfPlayConfig
+{
+    /** The settings of the engine playing both sides (its depth is low, to
+     *  play many games) */
+    EngineConfig engine;
+
+    /** The number of games */
+    int games = 1000;
+
+    /** The number of threads (0 uses all cores) */
+    int threads = 0;
+
+    /** The number of random moves made from the start position, to vary the
+     *  games (their positions are not sampled) */
+    int random_plies = 8;
+
+    /** The seed of the random moves (game 'n' uses seed + n, so a game is
+     *  the same whatever thread plays it) */
+    unsigned int seed = 1;
+
+    /** When the games are ended early */
+    Adjudication adjudication;
+
+    /** The number of samples each thread keeps before they are written */
+    size_t buffer_samples = 1 << 15;
+};
+
+/**
+ * @brief      This struct describes the outcome of the self-play games.
+ */
+struct SelfPlayStats
+{
+    /** The number of games played */
+    uint64_t games = 0;
+
+    /** The number of games won by white, drawn and won by black */
+    uint64_t white_wins = 0, draws = 0, black_wins = 0;
+
+    /** The number of samples written */
+    uint64_t samples = 0;
+
+    /** The number of positions searched */
+    uint64_t nodes = 0;
+
+    /** The number of threads that played */
+    int threads = 0;
+
+    /** The time the games took (in seconds) */
+    double seconds = 0;
+};
+
+/**
+ * @brief      This class describes a memory mapped training data file, whose
+ *             samples are streamed in order or shuffled.
+ */
+class SampleReader
+{
+public:
+    /**
+     * @brief      Default constructor - Constructs a new instance with no
+     *             file opened.
+     */
+    SampleReader();
+
+    /**
+     * @brief      Opens (memory maps) a training data file, and starts
+     *             streaming its samples in order.
+     *
+     * @param[in]  filename  The training data file
+     *
+     * @return     True if the file is valid training data, False otherwise.
+     */
+    bool open(const string &filename);
+
+    /**
+     * @brief      Closes the file.
+     */
+    void close();
+
+    /**
+     * @brief      (Accessor) Gets the number of samples of the file.
+     *
+     * @return     The number of samples.
+     */
+    uint64_t getNumSamples() const {return num_samples;}
+
+    /**
+     * @brief      (Accessor) Gets the samples of the file, in order (without
+     *             copying them).
+     *
+     * @return     The first sample.
+     */
+    const TrainingSample * getSamples() const {return samples;}
+
+    /**
+     * @brief      Starts streaming the samples again (a new epoch).
+     *
+     * @param[in]  shuffle  True to stream them shuffled, False in order
+     * @param[in]  seed     The seed of the shuffle
+     */
+    void rewind(bool shuffle, uint64_t seed = 0);
+
+    /**
+     * @brief      Streams the next samples of the epoch.
+     *
+     * @param      out    The samples read
+     * @param[in]  count  The most samples read
+     *
+     * @return     The number of samples read (less than 'count' at the end of
+     *             the epoch, and 0 after it).
+     */
+    size_t read(TrainingSample *out, size_t count);
+
+private:
+    /**
+     * @brief      Copies and shuffles the next window of chunks.
+     */
+    void fillWindow();
+
+    /** The mapped file */
+    MappedFile file;
+
+    /** The samples of the file */
+    const TrainingSample *samples;
+
+    /** The number of samples */
+    uint64_t num_samples;
+
+    /** True if the epoch is shuffled */
+    bool shuffled;
+
+    /** The order of the chunks of the epoch, and the next one to read */
+    vector<uint32_t> chunks;
+    size_t next_chunk;
+
+    /** The shuffled samples of the current window, and the next one to
+     *  stream (the next sample of the file when not shuffled) */
+    vector<TrainingSample> window;
+    size_t next_sample;
+
+    /** The random generator of the shuffle */
+    mt19937_64 rng;
+};
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Packs a position and its labels into a sample.
+     *
+     * @param[in]  chess   The chess object
+     * @param[in]  score   The score of the position for the side to move
+     * @param[in]  result  The result of the game for the side to move (0 for a
+     *                     loss, 1 for a draw, 2 for a win)
+     * @param      sample  The sample
+     *
+     * @return     True if the position was packed, False if it has more than 32
+     *             pieces (only possible from a custom FEN).
+     */
+    bool packSample(const Chess &chess, int score, int result, TrainingSample &sample);
+
+    /**
+     * @brief      Unpacks the position of a sample (without an en-passant
+     *             square, at move 1).
+     *
+     * @param[in]  sample    The sample
+     * @param      position  The packed position
+     */
+    void unpackSample(const TrainingSample &sample, PackedPosition &position);
+
+    /**
+     * @brief      Plays self-play games on a pool of threads and writes the
+     *             samples of their positions to a training data file.
+     *
+     * @param[in]  filename  The training data file (it is replaced)
+     * @param[in]  config    The settings of the games
+     * @param      stats     The outcome of the games
+     *
+     * @return     True if every sample was written, False otherwise.
+     */
+    bool generateSamples(const string &filename, const SelfPlayConfig &config, SelfPlayStats &stats);
+}
+
+#endif // SELFPLAY_H
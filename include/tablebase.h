@@ -0,0 +1,304 @@
+ /**
+  * \page tablebaseheader Endgame Tablebase Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;tablebase.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;tablebase.cpp, tbgen.cpp, mapped_file.h, engine.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * Endgame tablebases: the exact result (win, draw or loss) and distance to the
+  * checkmate (in plies) of every position of a small endgame, solved by
+  * retrograde analysis.
+  *
+  * A table holds a king and one piece against a lone king, together with the
+  * reservoir of the side with the piece (the reservoir of the lone king cannot
+  * be used, since it has no piece to replace). Its name gives the piece and the
+  * most reservoir pieces of each type, ex. "KRvK", "KBvK+q" (a bishop and a
+  * queen in the reservoir) or "KNvK+pr". A reservoir piece or a promotion
+  * changes the type of the piece, so every type the piece can become is in the
+  * table, and so are the reservoir contents: the index is
+  *
+  *     ((((reservoir * types + type) * 2 + side) * 64 + king) * 64 + lone king) * 64 + piece
+  *
+  * for the side with the piece (as white) or the lone king to move. The other
+  * color is probed with the board flipped. A capture of the piece is a draw,
+  * so no other table is needed.
+  *
+  * The tables are solved in passes over the whole index: the positions with no
+  * legal move first, then the positions whose moves lead to a position solved
+  * in the last pass. Every pass is split into one part of the index per thread.
+  *
+  * The rules are the ones of the board without history: castling rights,
+  * en-passant, the 50 move rule and repetitions are not part of the index, and a
+  * pawn on its second rank can move two squares (even one that was placed from
+  * the reservoir, which a Chess object does not allow; such a position is not
+  * probed).
+  *
+  * <b>File layout</b> (native byte order, one WDL and one DTM file per table)
+  * 1. TablebaseHeader (40 bytes);
+  * 2. TablebaseHeader::num_blocks + 1 byte offsets (8 bytes each) of the blocks,
+  *    from the end of the offsets;
+  * 3. the blocks of TablebaseHeader::block_size positions, each as runs of
+  *    (value, varint length). The WDL values are 0 (draw), 1 (win) and 2
+  *    (loss) for the side to move, the DTM values are 0 (draw) or the distance
+  *    to the checkmate plus 1 (odd for a loss, even for a win). An illegal
+  *    position takes the value before it, which makes the runs longer.
+  */
+
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+#include "chess.h"
+
+using namespace std;
+
+/*! \file */
+
+/** Identifies a WDL tablebase file (and its version) */
+#define TB_WDL_MAGIC "CAMOTBW1"
+
+/** Identifies a DTM tablebase file (and its version) */
+#define TB_DTM_MAGIC "CAMOTBD1"
+
+/** The number of positions of a compressed block (a probe decodes at most one
+ *  block) */
+#define TB_BLOCK_SIZE 1024
+
+/** The longest distance to the checkmate (in plies) a table can hold */
+#define TB_MAX_DTM 253
+
+/**
+ * @brief      The result of a position for the side to move.
+ */
+enum tbResult
+{
+    TB_DRAW,    ///< 0
+    TB_WIN,     ///< 1
+    TB_LOSS     ///< 2
+};
+
+/**
+ * @brief      This struct describes the header at the start of a tablebase
+ *             file.
+ */
+struct TablebaseHeader
+{
+    /** TB_WDL_MAGIC or TB_DTM_MAGIC (without the null terminator) */
+    char magic[8];
+
+    /** The name of the table (null terminated) */
+    char material[16];
+
+    /** The number of positions (the size of the index) */
+    uint64_t num_positions;
+
+    /** The number of positions of a block */
+    uint32_t block_size;
+
+    /** The number of blocks */
+    uint32_t num_blocks;
+};
+
+/**
+ * @brief      This struct describes the layout of the index of a table.
+ */
+struct TablebaseLayout
+{
+    /** The name of the table (its reservoir pieces in the order p, n, b, r,
+     *  q) */
+    string material;
+
+    /** The types the piece can be (its own, the reservoir pieces, and the
+     *  promotions of a pawn), in increasing order */
+    vector<int> types;
+
+    /** The slot of each type in 'types' (-1 if it is not there) */
+    int slot[6];
+
+    /** The most reservoir pieces of each type (PAWN to QUEEN) */
+    int reservoir[5];
+
+    /** The step of the count of each reservoir type in the reservoir part of
+     *  the index */
+    uint64_t stride[5];
+
+    /** The number of reservoir contents */
+    uint64_t reservoirs;
+
+    /** The number of positions */
+    uint64_t positions;
+};
+
+/**
+ * @brief      This struct describes the result of a probe.
+ */
+struct TablebaseProbe
+{
+    /** The result for the side to move */
+    tbResult wdl;
+
+    /** The distance to the checkmate (in plies, with best play by both sides),
+     *  0 for a draw or if it was not probed */
+    int dtm;
+};
+
+/**
+ * @brief      This struct describes the outcome of generating a table.
+ */
+struct TablebaseStats
+{
+    /** The number of positions of the index */
+    uint64_t positions;
+
+    /** The number of legal positions, and of the ones won, lost and drawn by
+     *  the side to move */
+    uint64_t legal, wins, losses, draws;
+
+    /** The number of passes (after the first one, which finds the checkmates
+     *  and stalemates) */
+    int passes;
+
+    /** The longest distance to the checkmate (in plies) */
+    int longest;
+
+    /** The size of the WDL and DTM files (in bytes) */
+    uint64_t wdl_bytes, dtm_bytes;
+
+    /** The time it took to solve the table and write its files (in seconds) */
+    double seconds;
+};
+
+/**
+ * @brief      This class describes a memory mapped endgame table (its WDL and
+ *             DTM files).
+ */
+class Tablebase
+{
+public:
+    /**
+     * @brief      Default constructor - Constructs a new instance with no
+     *             table opened.
+     */
+    Tablebase();
+
+    /**
+     * @brief      Solves a table and writes its files ('material'.wdl and
+     *             'material'.dtm in 'directory').
+     *
+     * @param[in]  material     The name of the table (ex. "KRvK" or "KBvK+q")
+     * @param[in]  directory    The directory of the files
+     * @param[in]  num_threads  The number of threads (0 uses all cores)
+     * @param      stats        The outcome of the generation (can be nullptr)
+     *
+     * @return     True if the files were written, False if the name is
+     *             invalid, the table has a distance to the checkmate longer
+     *             than TB_MAX_DTM or the files could not be written.
+     */
+    static bool generate(const string &material, const string &directory, int num_threads, TablebaseStats *stats = nullptr);
+
+    /**
+     * @brief      Finds the layout of the index of a table.
+     *
+     * @param[in]  material  The name of the table
+     * @param      layout    The layout
+     *
+     * @return     True if the name is valid, False otherwise.
+     */
+    static bool parseMaterial(const string &material, TablebaseLayout &layout);
+
+    /**
+     * @brief      Opens (memory maps) the files of a table.
+     *
+     * @param[in]  directory  The directory of the files
+     * @param[in]  material   The name of the table
+     *
+     * @return     True if both files are valid files of the table, False
+     *             otherwise.
+     */
+    bool open(const string &directory, const string &material);
+
+    /**
+     * @brief      Closes the files of the table.
+     */
+    void close();
+
+    /**
+     * @brief      Probes a position.
+     *
+     * @param[in]  chess   The chess object
+     * @param      result  The result of the position
+     * @param[in]  dtm     True to also find the distance to the checkmate
+     *                     (from the DTM file), False for the result only
+     *
+     * @return     True if the position is in the table, False otherwise (no
+     *             table is opened, other material, too many reservoir pieces,
+     *             a castling right, or a pawn that cannot move as the table
+     *             assumes).
+     */
+    bool probe(const Chess &chess, TablebaseProbe &result, bool dtm = true) const;
+
+    /**
+     * @brief      Probes a position by its index.
+     *
+     * @param[in]  index   The index of the position (in [0, getSize()))
+     * @param      result  The result of the position (meaningless for an
+     *                     illegal position)
+     * @param[in]  dtm     True to also find the distance to the checkmate,
+     *                     False for the result only
+     */
+    void probeIndex(uint64_t index, TablebaseProbe &result, bool dtm = true) const;
+
+    /**
+     * @brief      Finds the index of a position.
+     *
+     * @param[in]  chess  The chess object
+     * @param      index  The index of the position
+     *
+     * @return     True if the position is in the table, False otherwise.
+     */
+    bool findIndex(const Chess &chess, uint64_t &index) const;
+
+    /**
+     * @brief      (Accessor) Gets the name of the opened table.
+     *
+     * @return     The name ("" if no table is opened).
+     */
+    string getMaterial() const {return layout.material;}
+
+    /**
+     * @brief      (Accessor) Gets the number of positions of the opened table.
+     *
+     * @return     The number of positions.
+     */
+    uint64_t getSize() const {return layout.positions;}
+
+private:
+    /** The layout of the index */
+    TablebaseLayout layout;
+
+    /** The WDL and DTM files */
+    MappedFile wdl_file, dtm_file;
+
+    /**
+     * @brief      Decodes the value of a position from a file.
+     *
+     * @param[in]  file   The file (already checked by open())
+     * @param[in]  index  The index of the position
+     *
+     * @return     The value.
+     */
+    static uint8_t readValue(const MappedFile &file, uint64_t index);
+};
+
+#endif // TABLEBASE_H
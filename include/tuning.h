@@ -0,0 +1,289 @@
+ /**
+  * \page tuningheader Evaluation Tuning Header File
+  *
+  * <b>Title</b><br>
+  * <span>&emsp;&emsp;&emsp;tuning.h </span>
+  * \author Lior Bragilevsky<br>
+  *
+  * <b>Related</b><br>
+  * <span>&emsp;&emsp;&emsp;tuning.cpp, tuner.cpp, engine.h, archive.h</span><br>
+  *
+  * <b>Project</b><br>
+  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+  * \version \version_num
+  * \date \today
+  *
+  * Texel tuning of the hand-crafted evaluation (see Engine::evaluate()). Every
+  * position of the finished games of an archive is labeled with the result of
+  * its game (1, 0.5 or 0 for white), and the parameters of the evaluation are
+  * the ones whose win probability, 1 / (1 + 10^(-K * score / 400)), is closest
+  * (in mean squared error) to the labels.
+  *
+  * The evaluation is the material of each side, its center bonus and its
+  * reservoir pieces, so a position is reduced to the difference between
+  * white's and black's count of each piece type on the board and in the
+  * reservoir, and of their steps from the corners: a TuningPosition of 14
+  * bytes, and millions of them fit in memory. The score of a position is then
+  * a few multiplications, and the loss and its gradient are summed over all
+  * positions on several threads, each with its own share of the positions.
+  *
+  * The tuned parameters are written to a text file of "name values" lines
+  * (see writeEvaluation()), which the engine tools read back with
+  * readEvaluation().
+  */
+
+#ifndef TUNING_H
+#define TUNING_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "engine.h"
+
+using namespace std;
+
+/*! \file */
+
+/** The number of tuned parameters: the material of each piece type (5), the
+ *  center bonus and the reservoir percentage (see EngineConfig) */
+#define TUNING_PARAMETERS 7
+
+/**
+ * @brief      This struct describes a labeled position, reduced to the terms
+ *             of the evaluation (14 bytes).
+ */
+struct TuningPosition
+{
+    /** White's minus black's number of pawns, knights, bishops, rooks and
+     *  queens on the board */
+    int8_t board[5];
+
+    /** White's minus black's number of reservoir pieces of each type */
+    int8_t reservoir[5];
+
+    /** White's minus black's steps of the pawns, knights and bishops from the
+     *  corners (the multiple of the center bonus) */
+    int16_t center;
+
+    /** The result of the game for white, in half points (2 for a win) */
+    uint8_t result;
+
+    /** Unused (keeps the position aligned) */
+    uint8_t reserved;
+};
+
+/**
+ * @brief      This struct describes the settings of loading and tuning.
+ */
+struct TuningOptions
+{
+    /** The first plies of each game are skipped (they come from the
+     *  openings, not from the evaluation) */
+    int skip_plies = 8;
+
+    /** The most positions loaded (0 for all of them) */
+    uint64_t max_positions = 0;
+
+    /** The number of iterations of the gradient descent */
+    int iterations = 200;
+
+    /** The step of each iteration (in units of each parameter) */
+    double learning_rate = 2.0;
+
+    /** The scale K of the win probability (0 fits it to the positions with
+     *  the starting parameters, see EvalTuner::fitScale()) */
+    double scale = 0;
+};
+
+/**
+ * @brief      This struct describes the outcome of loading positions.
+ */
+struct TuningStats
+{
+    /** The number of games in the archive */
+    uint64_t games;
+
+    /** The number of games with a malformed line, invalid FEN or illegal move
+     *  (the positions before the first illegal move are still loaded) */
+    uint64_t invalid;
+
+    /** The number of unfinished games (they are skipped) */
+    uint64_t unfinished;
+
+    /** The number of positions loaded */
+    uint64_t positions;
+
+    /** The time it took to load the positions (in seconds) */
+    double seconds;
+};
+
+/**
+ * @brief      This struct describes an iteration of the tuning.
+ */
+struct TuningIteration
+{
+    /** The number of the iteration (0 is the starting parameters) */
+    int iteration;
+
+    /** The mean squared error of the parameters of the iteration */
+    double loss;
+
+    /** The positions per second of the loss and gradient computation */
+    double positions_per_second;
+
+    /** The parameters of the iteration */
+    double parameters[TUNING_PARAMETERS];
+};
+
+/**
+ * @brief      This class describes the labeled positions of an archive and
+ *             the tuning of the evaluation parameters over them.
+ */
+class EvalTuner
+{
+public:
+    /**
+     * @brief      Constructs a new instance with no positions.
+     *
+     * @param[in]  num_threads  The number of threads of the loss and gradient
+     *                          computation (0 uses all cores)
+     */
+    explicit EvalTuner(int num_threads = 0);
+
+    /**
+     * @brief      Loads the positions of the finished games of an archive.
+     *             Games are replayed on the threads of the tuner (each with
+     *             its own headless Chess object) into their own positions,
+     *             which are appended to the positions already loaded.
+     *
+     * @param[in]  archive_file  The game archive (see archive.h)
+     * @param[in]  options       The settings of loading (skip_plies and
+     *                           max_positions)
+     * @param      stats         The outcome of loading (can be nullptr)
+     *
+     * @return     True if the archive was read, False otherwise.
+     */
+    bool load(const string &archive_file, const TuningOptions &options = TuningOptions(), TuningStats *stats = nullptr);
+
+    /**
+     * @brief      Adds a labeled position.
+     *
+     * @param[in]  chess   The chess object
+     * @param[in]  result  The result of its game for white, in half points
+     *                     (2 for a win, 1 for a draw, 0 for a loss)
+     */
+    void addPosition(const Chess &chess, int result);
+
+    /**
+     * @brief      (Accessor) Gets the positions.
+     *
+     * @return     The positions.
+     */
+    const vector<TuningPosition> & getPositions() const {return positions;}
+
+    /**
+     * @brief      Computes the score of a position for white (as the engine
+     *             does, without its rounding).
+     *
+     * @param[in]  position    The position
+     * @param[in]  parameters  The parameters (see toParameters())
+     *
+     * @return     The score in centipawns.
+     */
+    static double evaluate(const TuningPosition &position, const double parameters[TUNING_PARAMETERS]);
+
+    /**
+     * @brief      Computes the mean squared error of the parameters over all
+     *             positions, and its gradient, on the threads of the tuner.
+     *
+     * @param[in]  parameters  The parameters
+     * @param[in]  scale       The scale K of the win probability
+     * @param      gradient    The gradient of the error (can be nullptr)
+     *
+     * @return     The mean squared error (0 without positions).
+     */
+    double loss(const double parameters[TUNING_PARAMETERS], double scale, double gradient[TUNING_PARAMETERS] = nullptr) const;
+
+    /**
+     * @brief      Finds the scale K of the win probability with the smallest
+     *             error for some parameters.
+     *
+     * @param[in]  parameters  The parameters
+     *
+     * @return     The scale (in [0.1, 5]).
+     */
+    double fitScale(const double parameters[TUNING_PARAMETERS]) const;
+
+    /**
+     * @brief      Tunes the parameters of an evaluation with a gradient
+     *             descent (Adam) over all positions.
+     *
+     * @param      config    The evaluation, whose parameters are tuned
+     *                       (rounded to whole values)
+     * @param[in]  options   The settings of tuning (iterations, learning_rate
+     *                       and scale)
+     * @param[in]  progress  Called after each iteration (can be nullptr)
+     *
+     * @return     The mean squared error of the tuned parameters.
+     */
+    double tune(EngineConfig &config, const TuningOptions &options = TuningOptions(),
+                const function<void(const TuningIteration &)> &progress = nullptr) const;
+
+    /**
+     * @brief      Reads the parameters of an evaluation.
+     *
+     * @param[in]  config      The evaluation
+     * @param      parameters  The parameters: the material of each piece
+     *                         type, the center bonus and the reservoir
+     *                         percentage
+     */
+    static void toParameters(const EngineConfig &config, double parameters[TUNING_PARAMETERS]);
+
+    /**
+     * @brief      Sets the parameters of an evaluation (rounded to whole
+     *             values).
+     *
+     * @param[in]  parameters  The parameters (see toParameters())
+     * @param      config      The evaluation
+     */
+    static void fromParameters(const double parameters[TUNING_PARAMETERS], EngineConfig &config);
+
+private:
+    /** The labeled positions */
+    vector<TuningPosition> positions;
+
+    /** The number of threads */
+    int num_threads;
+};
+
+namespace chessCAMO
+{
+    /**
+     * @brief      Writes the parameters of an evaluation to a text file, one
+     *             "name values" line per parameter (ex. "material 100 320 330
+     *             500 900").
+     *
+     * @param[in]  filename  The file
+     * @param[in]  config    The evaluation
+     *
+     * @return     True if the file was written, False otherwise.
+     */
+    bool writeEvaluation(const string &filename, const EngineConfig &config);
+
+    /**
+     * @brief      Reads the parameters of an evaluation from a text file (see
+     *             writeEvaluation()). Lines starting with '#' are comments, and
+     *             the parameters missing from the file are not changed.
+     *
+     * @param[in]  filename  The file
+     * @param      config    The evaluation
+     *
+     * @return     True if the file was read, False if it could not be opened
+     *             or has an unknown or malformed line (the evaluation is then
+     *             not changed).
+     */
+    bool readEvaluation(const string &filename, EngineConfig &config);
+}
+
+#endif // TUNING_H
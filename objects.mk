@@ -0,0 +1,14 @@
+# Objects shared by the Makefile of the tools and tests and the one of the GUI (GUI/Makefile), so a
+# module added to the engine is linked into both
+
+# objects shared by the archive tools (and their tests)
+ARCHIVE_OBJS = chess.o archive.o mapped_file.o index.o
+
+# objects of the batched and resident games (many games played in lockstep or kept in memory, packed like
+# the saved games)
+BATCH_OBJS = game_batch.o batch_kernels.o game_store.o resident_games.o
+
+# objects of the engine (its Monte Carlo tree search plays batched games, its search probes the endgame
+# tablebases, plays the opening book and can evaluate with a network), the tuning of its evaluation,
+# engine-vs-engine matches, self-play training data and background analysis
+ENGINE_OBJS = engine.o mcts.o tablebase.o book.o nnue.o tuning.o match.o selfplay.o bench.o analysis.o $(BATCH_OBJS)
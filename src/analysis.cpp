@@ -0,0 +1,165 @@
+/**
+ * \page analysis Background Analysis Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;analysis.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;analysis.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * The worker thread of the background analysis (see analysis.h).
+ */
+
+#include "analysis.h"
+
+// included in 'analysis.h' but good to re-state
+using namespace std;
+
+/*************************************************************************************/
+/*                              ANALYSIS CLASS - MEMBER FUNCTIONS                    */
+/*************************************************************************************/
+/**
+ * @brief      Constructs a new instance and starts its (idle) worker thread.
+ *
+ * @param[in]  config     The settings of the engine
+ * @param[in]  max_depth  The depth at which the analysis of a position stops
+ *                        (in plies)
+ */
+Analysis::Analysis(const EngineConfig &config, int max_depth)
+    : config(config), max_depth{max_depth}, last_position{0}, restart{false}, quit{false}
+{
+    worker = thread(&Analysis::run, this);
+}
+
+/**
+ * @brief      Stops the search and the worker thread.
+ */
+Analysis::~Analysis()
+{
+    quit = true;
+    restart = true;
+    notifyWorker();
+    worker.join();
+}
+
+/**
+ * @brief      Starts analysing a position (stopping the analysis of the
+ *             previous one).
+ *
+ * @param[in]  chess  The chess object
+ *
+ * @return     The number of the position (see AnalysisInfo::position).
+ */
+unsigned int Analysis::start(const Chess &chess)
+{
+    Request request;
+    request.position = ++last_position;
+    request.fen = chess.toFEN();
+
+    send(request);
+    return request.position;
+}
+
+/**
+ * @brief      Stops the analysis (the worker thread waits for the next
+ *             position).
+ */
+void Analysis::stop()
+{
+    Request request;
+    request.position = ++last_position;
+
+    send(request);
+}
+
+/**
+ * @brief      Gives a request to the worker thread and stops its current
+ *             search.
+ *
+ * @param[in]  request  The request
+ */
+void Analysis::send(const Request &request)
+{
+    requests.post(request);
+    restart = true;
+    notifyWorker();
+}
+
+/**
+ * @brief      Wakes the worker thread up if it waits for a request.
+ *
+ * @note       The notification is sent while holding the lock, so the worker
+ *             is either waiting (and is woken up) or has not checked for
+ *             requests yet (and finds the one that was posted). The worker
+ *             only holds the lock to check, so this does not wait for a
+ *             search.
+ */
+void Analysis::notifyWorker()
+{
+    lock_guard<mutex> lock(idle);
+    wakeup.notify_one();
+}
+
+/**
+ * @brief      The worker thread: analyses the positions it is given until the
+ *             instance is destroyed.
+ */
+void Analysis::run()
+{
+    Engine engine(config);
+    Chess chess;
+    chess.setHeadless(true);
+
+    Request current;
+    bool pending = false;
+
+    while(!quit)
+    {
+        // cleared before taking the request, so that a request posted after
+        // this point always stops the search below
+        restart = false;
+
+        if(requests.take(current))
+            pending = true;
+
+        if(!pending)
+        {
+            unique_lock<mutex> lock(idle);
+            wakeup.wait(lock, [&]() {return quit || requests.ready();});
+            continue;
+        }
+
+        pending = false;
+        if(current.fen.empty())
+            continue;
+
+        AnalysisInfo info;
+        info.position = current.position;
+
+        if(chess.setFromFEN(current.fen))
+        {
+            engine.analyze(chess, max_depth, restart, [&](const SearchInfo &search)
+            {
+                info.search = search;
+                results.post(info);
+            });
+        }
+
+        // stopped by a request (which may be this position again, if it was
+        // posted before the request was taken)
+        if(restart)
+        {
+            pending = true;
+            continue;
+        }
+
+        info.done = true;
+        results.post(info);
+    }
+}
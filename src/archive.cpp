@@ -0,0 +1,364 @@
+/**
+ * \page archive Game Archive Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;archive.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;archive.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Reading, writing and replaying the games of an archive (see archive.h for
+ * the format).
+ */
+
+#include "archive.h"
+#include <cstring>
+#include <sstream>
+
+// included in 'chess.h' but good to re-state
+using namespace std;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Removes the leading and trailing whitespace of a field.
+     *
+     * @param[in]  field  The field
+     *
+     * @return     The trimmed field.
+     */
+    string trim(const string &field);
+
+    /**
+     * @brief      Converts a square in algebraic notation (e.g. e4) into the
+     *             board index used by the Chess class.
+     *
+     * @param[in]  square  The first of the two characters of the square
+     *
+     * @return     The square in [0, 63] (0 is a8), or -1 if it is invalid.
+     */
+    int squareIndex(const char *square);
+} // unnamed namespace (makes these functions local to this implementation file)
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Parses a single line of an archive into a game.
+     *
+     * @param[in]  line  The line (without the new line character)
+     * @param      game  The game that is filled in
+     *
+     * @return     True if the line has at least the start FEN, moves and result
+     *             fields, False otherwise (including blank and comment lines).
+     */
+    bool parseGame(const string &line, GameRecord &game)
+    {
+        string fields[4];
+        int num_fields = 0;
+        size_t begin = 0;
+
+        while(num_fields < 4)
+        {
+            size_t end = line.find('|', begin);
+            fields[num_fields++] = trim(line.substr(begin, end == string::npos ? string::npos : end - begin));
+
+            if(end == string::npos)
+                break;
+            begin = end + 1;
+        }
+
+        if(num_fields < 3 || fields[0][0] == '#')
+            return false;
+
+        game.fen = fields[0].empty() || fields[0] == "startpos" ? START_FEN : fields[0];
+        game.result = fields[2];
+        game.final_fen = fields[3];
+
+        game.moves.clear();
+        istringstream moves(fields[1]);
+        for(string move; moves >> move; )
+            game.moves.push_back(move);
+
+        return true;
+    }
+
+    /**
+     * @brief      Formats a game as a single line of an archive.
+     *
+     * @param[in]  game  The game
+     *
+     * @return     The archive line (without the new line character).
+     */
+    string formatGame(const GameRecord &game)
+    {
+        string line = (game.fen == START_FEN ? "startpos" : game.fen) + " |";
+
+        for(const auto & move : game.moves)
+            line += " " + move;
+
+        line += " | " + (game.result.empty() ? "*" : game.result);
+
+        if(!game.final_fen.empty())
+            line += " | " + game.final_fen;
+
+        return line;
+    }
+
+    /**
+     * @brief      Converts a move of an archive into the source and destination
+     *             values used by Chess::makeMove().
+     *
+     * @param[in]  move       The move (e.g. e2e4, e7e8q, N@e4)
+     * @param      src        The source square, or the ASCII value of the
+     *                        reservoir piece in [110, 114]
+     * @param      dest       The destination square
+     * @param      promotion  The promotion piece ('\0' if none was given)
+     *
+     * @return     True if the move is well formed, False otherwise.
+     */
+    bool parseMove(const string &move, int &src, int &dest, char &promotion)
+    {
+        promotion = '\0';
+
+        // piece from the reservoir (a bishop is 'o' in the reservoir)
+        if(move.length() == 4 && move[1] == '@')
+        {
+            char piece = std::tolower(move[0]) == 'b' ? 'o' : std::tolower(move[0]);
+            src = (unsigned char) piece;
+            dest = squareIndex(&move[2]);
+            return piece != '\0' && std::strchr("nopqr", piece) != nullptr && dest != -1;
+        }
+
+        if(move.length() != 4 && move.length() != 5)
+            return false;
+
+        src = squareIndex(&move[0]);
+        dest = squareIndex(&move[2]);
+        if(move.length() == 5)
+            promotion = std::tolower(move[4]);
+
+        return src != -1 && dest != -1 && (promotion == '\0' || std::strchr("qrbn", promotion) != nullptr);
+    }
+
+    /**
+     * @brief      Converts the values used by Chess::makeMove() into a move of
+     *             an archive.
+     *
+     * @param[in]  src        The source square, or the ASCII value of the
+     *                        reservoir piece in [110, 114]
+     * @param[in]  dest       The destination square
+     * @param[in]  promotion  The promotion piece ('\0' if none)
+     *
+     * @return     The move (e.g. e2e4, e7e8q, N@e4).
+     */
+    string formatMove(int src, int dest, char promotion)
+    {
+        string move;
+
+        if(src > 63)
+            move = string(1, src == 'o' ? 'B' : std::toupper(src)) + "@";
+        else
+            move = {char('a' + src % 8), char('8' - src / 8)};
+
+        move += {char('a' + dest % 8), char('8' - dest / 8)};
+
+        if(promotion != '\0')
+            move += (char) std::tolower(promotion);
+
+        return move;
+    }
+
+    /**
+     * @brief      Replays a game from its starting position.
+     *
+     * @param      chess  The chess object (should be headless)
+     * @param[in]  game   The game
+     * @param[in]  visit  Called with the object and the ply after the start
+     *                    position (ply 0) and after every move that was made
+     *
+     * @return     The number of moves made, which is less than the number of
+     *             moves of the game if a move was illegal (or the game ended
+     *             early), or -1 if the start FEN is invalid.
+     */
+    int replayGame(Chess &chess, const GameRecord &game, const function<void(const Chess &, int)> &visit)
+    {
+        if(!chess.setFromFEN(game.fen))
+            return -1;
+
+        if(visit)
+            visit(chess, 0);
+
+        istringstream promotion;
+        int ply = 0, src, dest;
+        char piece;
+
+        for(const auto & move : game.moves)
+        {
+            if(chess.getCheckmate() || chess.getStalemate() || !parseMove(move, src, dest, piece))
+                break;
+
+            // the promotion piece is read from a stream, like in the console
+            promotion.clear();
+            promotion.str(string(1, piece == '\0' ? 'q' : piece));
+
+            if(!chess.makeMove(src, dest, promotion))
+                break;
+
+            ply++;
+            if(visit)
+                visit(chess, ply);
+        }
+
+        return ply;
+    }
+
+    /**
+     * @brief      Replays a test case script (see the unit tests' page): the
+     *             expected FEN on the first line, followed by the moves and the
+     *             answers to the "Continue?" and promotion questions, just like
+     *             they are typed in the console.
+     *
+     * @param      chess     The chess object (should be headless)
+     * @param      in        The script
+     * @param      expected  The expected FEN (first line of the script)
+     *
+     * @post       'chess' holds the final position of the script. The game
+     *             always starts from the regular starting position.
+     */
+    void replayScript(Chess &chess, istream &in, string &expected)
+    {
+        string src, dest;
+
+        getline(in, expected);
+        chess.setFromFEN(START_FEN);
+
+        // same loop as the console, until the script ends or the game is
+        // finished (checkmate, stalemate, draw, resign)
+        while(!chess.getCheckmate() && !chess.getStalemate() && in >> src >> dest)
+        {
+            chess.makeMove(preProcessInput(src), preProcessInput(dest), in);
+
+            // prevent asking again after game is over
+            if(!chess.getCheckmate() && !chess.getStalemate())
+                drawOrResign(false, chess, in);
+        }
+    }
+
+    /**
+     * @brief      Compares a FEN string with an expected one, which can leave
+     *             out the piece reservoir and any trailing fields (like the
+     *             first line of a test case script).
+     *
+     * @param[in]  expected  The expected FEN
+     * @param[in]  fen       The obtained FEN (e.g. from Chess::toFEN())
+     *
+     * @return     True if the fields that are present in 'expected' match,
+     *             False otherwise.
+     */
+    bool matchesFEN(const string &expected, const string &fen)
+    {
+        istringstream expected_fields(expected), fields(fen);
+        string expected_field, field;
+        bool placement = true;
+
+        while(expected_fields >> expected_field)
+        {
+            if(!(fields >> field))
+                return false;
+
+            // the reservoir is only compared if it is expected
+            if(placement && expected_field.find('[') == string::npos && field.find('[') != string::npos)
+                field.erase(field.find('['));
+
+            if(expected_field != field)
+                return false;
+
+            placement = false;
+        }
+
+        return !placement; // an empty FEN matches nothing
+    }
+
+    /**
+     * @brief      Finds the games (lines that are not blank or comments) of an
+     *             archive.
+     *
+     * @param[in]  data  The contents of the archive
+     * @param[in]  size  The size of the archive
+     *
+     * @return     The byte offsets of the games' lines.
+     */
+    vector<uint64_t> findGames(const char *data, size_t size)
+    {
+        vector<uint64_t> games;
+
+        for(size_t begin = 0; begin < size; )
+        {
+            const char *end = (const char *) memchr(data + begin, '\n', size - begin);
+            size_t length = (end == nullptr ? data + size : end) - (data + begin);
+
+            // skip leading whitespace to decide whether the line is a game
+            size_t i = begin;
+            while(i < begin + length && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r'))
+                i++;
+
+            if(i < begin + length && data[i] != '#')
+                games.push_back(begin);
+
+            begin += length + 1;
+        }
+
+        return games;
+    }
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Removes the leading and trailing whitespace of a field.
+     *
+     * @param[in]  field  The field
+     *
+     * @return     The trimmed field.
+     */
+    string trim(const string &field)
+    {
+        size_t begin = field.find_first_not_of(" \t\r");
+        if(begin == string::npos)
+            return "";
+
+        return field.substr(begin, field.find_last_not_of(" \t\r") - begin + 1);
+    }
+
+    /**
+     * @brief      Converts a square in algebraic notation (e.g. e4) into the
+     *             board index used by the Chess class.
+     *
+     * @param[in]  square  The first of the two characters of the square
+     *
+     * @return     The square in [0, 63] (0 is a8), or -1 if it is invalid.
+     */
+    int squareIndex(const char *square)
+    {
+        char file = std::tolower(square[0]), rank = square[1];
+        if(file < 'a' || file > 'h' || rank < '1' || rank > '8')
+            return -1;
+
+        return (file - 'a') + (8 - (rank - '0'))*8;
+    }
+}
@@ -0,0 +1,269 @@
+/**
+ * \page arena Engine Match Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;arena.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;match.h, engine.h, archive.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Plays a match between two engine configurations (A and B) and reports the
+ * results for A, to judge whether a change made the engine stronger.
+ *
+ * Simply run <b>mingw32-make all_arena</b> on a Windows machine and then
+ * <b>arena [options]</b>, where the options are:
+ * - <b>--games N</b>: the maximum number of games (1000);
+ * - <b>--threads N</b>: the number of threads (all cores);
+ * - <b>--depth A B</b>: the search depth of each configuration (1 1);
+ * - <b>--reservoir A B</b>: the value of a reservoir piece of each
+ *   configuration, as a percentage of its value on the board (60 60);
+ * - <b>--eval A B</b>: the evaluation parameters of each configuration, read
+ *   from a file written by the tuner ('-' keeps the default ones);
+ * - <b>--playouts A B</b>: the playouts of a Monte Carlo tree search per
+ *   move, for each configuration (0 for the alpha-beta search, 0 0);
+ * - <b>--openings file</b>: the opening positions, one FEN per line (or a game
+ *   archive, whose start positions are used);
+ * - <b>--random-plies N</b>: random moves made after each opening (4);
+ * - <b>--seed N</b>: the seed of the random moves (1);
+ * - <b>--max-plies N</b>: games are drawn after N plies (300);
+ * - <b>--elo0 E</b>, <b>--elo1 E</b>, <b>--alpha P</b>, <b>--beta P</b>: the
+ *   SPRT hypotheses and error probabilities (0, 10, 0.05, 0.05);
+ * - <b>--out file</b>: the archive the games are written to.
+ *
+ * The match stops once the SPRT accepts one of the hypotheses. The results,
+ * the Elo difference and the throughput (games per hour) are printed every 10
+ * games and at the end.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "match.h"
+#include "tuning.h"
+
+// included in 'match.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Reads the opening positions of a file.
+     *
+     * @param[in]  filename  The file (one FEN per line, or a game archive)
+     * @param      openings  The opening positions
+     *
+     * @return     True if the file could be read, False otherwise.
+     */
+    bool readOpenings(const string &filename, vector<string> &openings);
+
+    /**
+     * @brief      Prints the results of a match (so far).
+     *
+     * @param[in]  config  The settings of the match
+     * @param[in]  stats   The results
+     */
+    void printStats(const MatchConfig &config, const MatchStats &stats);
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+}
+
+/**
+ * @brief      Plays a match between two engine configurations.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if the match was played, 1 otherwise.
+ */
+int main(int argc, char *argv[])
+{
+    MatchConfig config;
+    string out_file;
+
+    for(int i = 1; i < argc; i++)
+    {
+        bool two_values = i + 2 < argc;
+
+        if(strcmp(argv[i], "--depth") == 0 && two_values)
+        {
+            config.engines[0].depth = atoi(argv[++i]);
+            config.engines[1].depth = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--reservoir") == 0 && two_values)
+        {
+            config.engines[0].reservoir_percent = atoi(argv[++i]);
+            config.engines[1].reservoir_percent = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--eval") == 0 && two_values)
+        {
+            for(auto & engine : config.engines)
+            {
+                if(strcmp(argv[++i], "-") != 0 && !readEvaluation(argv[i], engine))
+                {
+                    printf("'%s' is not an evaluation file\n", argv[i]);
+                    return 1;
+                }
+            }
+        }
+        else if(strcmp(argv[i], "--playouts") == 0 && two_values)
+        {
+            for(auto & engine : config.engines)
+            {
+                engine.playouts = atoi(argv[++i]);
+                engine.search = engine.playouts > 0 ? SEARCH_MCTS : SEARCH_ALPHABETA;
+            }
+        }
+        else if(i + 1 >= argc)
+            return usage();
+        else if(strcmp(argv[i], "--games") == 0)
+            config.games = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--threads") == 0)
+            config.threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--random-plies") == 0)
+            config.random_plies = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0)
+            config.seed = strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--max-plies") == 0)
+            config.adjudication.max_plies = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--elo0") == 0)
+            config.elo0 = atof(argv[++i]);
+        else if(strcmp(argv[i], "--elo1") == 0)
+            config.elo1 = atof(argv[++i]);
+        else if(strcmp(argv[i], "--alpha") == 0)
+            config.alpha = atof(argv[++i]);
+        else if(strcmp(argv[i], "--beta") == 0)
+            config.beta = atof(argv[++i]);
+        else if(strcmp(argv[i], "--out") == 0)
+            out_file = argv[++i];
+        else if(strcmp(argv[i], "--openings") == 0)
+        {
+            if(!readOpenings(argv[++i], config.openings))
+            {
+                printf("Could not read the openings of '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else
+            return usage();
+    }
+
+    ofstream out;
+    if(!out_file.empty())
+    {
+        out.open(out_file, ios::trunc);
+        if(!out)
+        {
+            printf("Could not write to '%s'\n", out_file.c_str());
+            return 1;
+        }
+    }
+
+    MatchStats stats;
+    bool played = runMatch(config, stats, [&](const GameRecord &game, int, const MatchStats &so_far)
+    {
+        if(out.is_open())
+            out << formatGame(game) << endl;
+
+        if((so_far.wins + so_far.draws + so_far.losses) % 10 == 0)
+            printStats(config, so_far);
+    });
+
+    if(!played)
+    {
+        printf("Invalid opening position\n");
+        return 1;
+    }
+
+    printStats(config, stats);
+    if(stats.sprt != 0)
+        printf("SPRT: %s accepted\n", stats.sprt > 0 ? "H1 (A is stronger)" : "H0 (A is not stronger)");
+
+    return 0;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Reads the opening positions of a file.
+     *
+     * @param[in]  filename  The file (one FEN per line, or a game archive)
+     * @param      openings  The opening positions
+     *
+     * @return     True if the file could be read, False otherwise.
+     */
+    bool readOpenings(const string &filename, vector<string> &openings)
+    {
+        ifstream in(filename);
+        if(!in)
+            return false;
+
+        GameRecord game;
+        for(string line; getline(in, line); )
+        {
+            if(line.find('|') != string::npos)
+            {
+                if(parseGame(line, game))
+                    openings.push_back(game.fen);
+            }
+            else if(line.find_first_not_of(" \t\r") != string::npos && line[line.find_first_not_of(" \t\r")] != '#')
+            {
+                size_t begin = line.find_first_not_of(" \t\r"), end = line.find_last_not_of(" \t\r");
+                openings.push_back(line.substr(begin, end - begin + 1));
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief      Prints the results of a match (so far).
+     *
+     * @param[in]  config  The settings of the match
+     * @param[in]  stats   The results
+     */
+    void printStats(const MatchConfig &config, const MatchStats &stats)
+    {
+        double margin, elo = eloDifference(stats, margin);
+        uint64_t games = stats.wins + stats.draws + stats.losses;
+
+        printf("Games %llu: +%llu =%llu -%llu (%llu adjudicated)  Elo %+.1f +/- %.1f  LLR %.2f [%.2f, %.2f]  %.0f games/h  %.0f nodes/s\n",
+               (unsigned long long) games, (unsigned long long) stats.wins, (unsigned long long) stats.draws,
+               (unsigned long long) stats.losses, (unsigned long long) stats.adjudicated, elo, margin, stats.llr,
+               log(config.beta / (1 - config.alpha)), log((1 - config.beta) / config.alpha),
+               stats.seconds > 0 ? 3600 * games / stats.seconds : 0.0, stats.seconds > 0 ? stats.nodes / stats.seconds : 0.0);
+        fflush(stdout);
+    }
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage: arena [--games N] [--threads N] [--depth A B] [--reservoir A B] [--eval A B] [--playouts A B]\n"
+               "             [--openings file] [--random-plies N] [--seed N] [--max-plies N] [--elo0 E] [--elo1 E]\n"
+               "             [--alpha P] [--beta P] [--out archive]\n");
+        return 1;
+    }
+}
@@ -0,0 +1,527 @@
+/**
+ * \page batchkernels Batch Kernels Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;batch_kernels.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;batch_kernels.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * The scalar, SSE4.2 and AVX2 versions of the batch kernels, and the choice
+ * between them (see batch_kernels.h). A kernel runs on as many lanes of games
+ * as it can, and the games left over (fewer than a lane) are done by the
+ * scalar version.
+ */
+
+#include "batch_kernels.h"
+
+#include <cstring>
+
+// included in 'batch_kernels.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+#if defined(__x86_64__) || defined(__i386__)
+/** The SSE4.2 and AVX2 kernels are built (on x86) */
+#define BATCH_SIMD
+#endif
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /** Two games (the lane of the SSE4.2 kernels) */
+    typedef uint64_t Lane2 __attribute__((vector_size(16)));
+
+    /** Four games (the lane of the AVX2 kernels) */
+    typedef uint64_t Lane4 __attribute__((vector_size(32)));
+
+    /**
+     * @brief      Gets the squares closer to the center than a distance, for
+     *             the distances 1 to 6 (see Engine::evaluate()). A piece at
+     *             distance d is in 6 - d of them, which is its center bonus.
+     *
+     * @return     The 6 boards.
+     */
+    const uint64_t * centerRings();
+
+    /**
+     * @brief      Loads a lane of games from an array.
+     *
+     * @param[in]  data  The entry of the first game
+     *
+     * @tparam     V     The lane
+     *
+     * @return     The lane.
+     */
+    template<typename V>
+    KERNEL_INLINE V loadLane(const uint64_t *data);
+
+    /**
+     * @brief      Loads the side to move of a lane of games.
+     *
+     * @param[in]  white_to_move  The entry of the first game
+     *
+     * @tparam     V              The lane
+     *
+     * @return     All ones for the games where white is to move, 0 for the
+     *             others.
+     */
+    template<typename V>
+    KERNEL_INLINE V loadSide(const uint8_t *white_to_move);
+
+    /**
+     * @brief      Counts the set bits of each board of a lane.
+     *
+     * @param[in]  boards  The boards
+     *
+     * @tparam     V       The lane
+     *
+     * @return     The counts.
+     */
+    template<typename V>
+    KERNEL_INLINE V popcountLane(V boards);
+
+    /**
+     * @brief      Runs the attack kernel on lanes of games.
+     *
+     * @param[in]  arrays    The arrays of the games
+     * @param[in]  begin     The first game
+     * @param[in]  end       One past the last game
+     * @param      attacked  The attacked squares (from the game 'begin')
+     * @param      checkers  The pieces that give check (from the game 'begin')
+     *
+     * @tparam     V         The lane
+     *
+     * @return     The first game that was not done (fewer than a lane left).
+     */
+    template<typename V>
+    KERNEL_INLINE size_t attackLanes(const BatchArrays &arrays, size_t begin, size_t end,
+                                     uint64_t *attacked, uint64_t *checkers);
+
+    /**
+     * @brief      Runs the board part of the evaluation kernel (the material
+     *             and center bonus, for white) on lanes of games.
+     *
+     * @param[in]  arrays    The arrays of the games
+     * @param[in]  material  The value of each piece type
+     * @param[in]  center    The center bonus
+     * @param[in]  begin     The first game
+     * @param[in]  end       One past the last game
+     * @param      scores    The scores (from the game 'begin')
+     *
+     * @tparam     V         The lane
+     *
+     * @return     The first game that was not done (fewer than a lane left).
+     */
+    template<typename V>
+    KERNEL_INLINE size_t evaluateLanes(const BatchArrays &arrays, const uint64_t material[5], uint64_t center,
+                                       size_t begin, size_t end, int *scores);
+
+    size_t attacksScalar(const BatchArrays &arrays, size_t begin, size_t end, uint64_t *attacked, uint64_t *checkers);
+    size_t evaluateScalar(const BatchArrays &arrays, const uint64_t material[5], uint64_t center,
+                          size_t begin, size_t end, int *scores);
+
+#ifdef BATCH_SIMD
+    size_t attacksSSE42(const BatchArrays &arrays, size_t begin, size_t end, uint64_t *attacked, uint64_t *checkers);
+    size_t attacksAVX2(const BatchArrays &arrays, size_t begin, size_t end, uint64_t *attacked, uint64_t *checkers);
+    size_t evaluateSSE42(const BatchArrays &arrays, const uint64_t material[5], uint64_t center,
+                         size_t begin, size_t end, int *scores);
+    size_t evaluateAVX2(const BatchArrays &arrays, const uint64_t material[5], uint64_t center,
+                        size_t begin, size_t end, int *scores);
+#endif
+}
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Finds the fastest version of the kernels that the processor
+     *             supports.
+     *
+     * @return     The version.
+     */
+    batchKernel bestKernel()
+    {
+        if(kernelSupported(KERNEL_AVX2))
+            return KERNEL_AVX2;
+
+        return kernelSupported(KERNEL_SSE42) ? KERNEL_SSE42 : KERNEL_SCALAR;
+    }
+
+    /**
+     * @brief      Finds if the processor (and the build) supports a version of
+     *             the kernels.
+     *
+     * @param[in]  kernel  The version
+     *
+     * @return     True if it is supported, False otherwise.
+     */
+    bool kernelSupported(batchKernel kernel)
+    {
+#ifdef BATCH_SIMD
+        __builtin_cpu_init();
+        switch(kernel)
+        {
+            case KERNEL_SCALAR:
+                return true;
+            case KERNEL_SSE42:
+                return __builtin_cpu_supports("sse4.2");
+            case KERNEL_AVX2:
+#ifdef _WIN32
+                return false;
+#else
+                return __builtin_cpu_supports("avx2");
+#endif
+        }
+
+        return false;
+#else
+        return kernel == KERNEL_SCALAR;
+#endif
+    }
+
+    /**
+     * @brief      Gets the name of a version of the kernels.
+     *
+     * @param[in]  kernel  The version
+     *
+     * @return     The name ("scalar", "sse4.2" or "avx2").
+     */
+    const char *kernelName(batchKernel kernel)
+    {
+        return kernel == KERNEL_AVX2 ? "avx2" : kernel == KERNEL_SSE42 ? "sse4.2" : "scalar";
+    }
+
+    /**
+     * @brief      Finds the squares attacked by the side not to move and the
+     *             pieces that give check, for the games in [begin, end).
+     *
+     * @param[in]  kernel    The version of the kernel (if it is not supported,
+     *                       the scalar one is used)
+     * @param[in]  arrays    The arrays of the games
+     * @param[in]  begin     The first game
+     * @param[in]  end       One past the last game
+     * @param      attacked  The attacked squares of each game (the first entry
+     *                       is for the game 'begin')
+     * @param      checkers  The pieces that give check in each game (the first
+     *                       entry is for the game 'begin')
+     */
+    void batchAttacks(batchKernel kernel, const BatchArrays &arrays, size_t begin, size_t end,
+                      uint64_t *attacked, uint64_t *checkers)
+    {
+        size_t done = begin;
+#ifdef BATCH_SIMD
+        if(kernel == KERNEL_AVX2 && kernelSupported(KERNEL_AVX2))
+            done = attacksAVX2(arrays, begin, end, attacked, checkers);
+        else if(kernel == KERNEL_SSE42 && kernelSupported(KERNEL_SSE42))
+            done = attacksSSE42(arrays, begin, end, attacked, checkers);
+#endif
+
+        attacksScalar(arrays, done, end, attacked + (done - begin), checkers + (done - begin));
+    }
+
+    /**
+     * @brief      Evaluates the games in [begin, end), like
+     *             Engine::evaluate().
+     *
+     * @param[in]  kernel  The version of the kernel (if it is not supported,
+     *                     the scalar one is used)
+     * @param[in]  arrays  The arrays of the games
+     * @param[in]  config  The settings of the evaluation
+     * @param[in]  begin   The first game
+     * @param[in]  end     One past the last game
+     * @param      scores  The score of each game (in centipawns) for the side
+     *                     to move (the first entry is for the game 'begin')
+     */
+    void batchEvaluate(batchKernel kernel, const BatchArrays &arrays, const EngineConfig &config,
+                       size_t begin, size_t end, int *scores)
+    {
+        uint64_t material[5];
+        for(int type = PAWN; type <= QUEEN; type++)
+            material[type] = (uint64_t) config.material[type];
+
+        size_t done = begin;
+#ifdef BATCH_SIMD
+        if(kernel == KERNEL_AVX2 && kernelSupported(KERNEL_AVX2))
+            done = evaluateAVX2(arrays, material, (uint64_t) config.center_bonus, begin, end, scores);
+        else if(kernel == KERNEL_SSE42 && kernelSupported(KERNEL_SSE42))
+            done = evaluateSSE42(arrays, material, (uint64_t) config.center_bonus, begin, end, scores);
+#endif
+
+        evaluateScalar(arrays, material, (uint64_t) config.center_bonus, done, end, scores + (done - begin));
+
+        // the reservoir (a few bytes per game) and the side to move
+        for(size_t game = begin; game < end; game++)
+        {
+            int score = scores[game - begin];
+            for(int type = PAWN; type <= QUEEN; type++)
+            {
+                score += arrays.reservoir[type + 5][game] * config.material[type] * config.reservoir_percent / 100;
+                score -= arrays.reservoir[type][game] * config.material[type] * config.reservoir_percent / 100;
+            }
+
+            scores[game - begin] = arrays.white_to_move[game] ? score : -score;
+        }
+    }
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Gets the squares closer to the center than a distance, for
+     *             the distances 1 to 6 (see Engine::evaluate()). A piece at
+     *             distance d is in 6 - d of them, which is its center bonus.
+     *
+     * @return     The 6 boards.
+     */
+    const uint64_t * centerRings()
+    {
+        static const struct Rings
+        {
+            uint64_t boards[6] = {};
+
+            Rings()
+            {
+                for(int square = 0; square < 64; square++)
+                {
+                    int file = square % 8, rank = square / 8;
+                    int distance = max(3 - file, file - 4) + max(3 - rank, rank - 4);
+                    for(int ring = distance; ring < 6; ring++)
+                        boards[ring] |= 1ULL << square;
+                }
+            }
+        } rings;
+
+        return rings.boards;
+    }
+
+    /**
+     * @brief      Loads a lane of games from an array.
+     *
+     * @param[in]  data  The entry of the first game
+     *
+     * @tparam     V     The lane
+     *
+     * @return     The lane.
+     */
+    template<typename V>
+    KERNEL_INLINE V loadLane(const uint64_t *data)
+    {
+        V lane;
+        memcpy(&lane, data, sizeof(V));
+        return lane;
+    }
+
+    /**
+     * @brief      Loads the side to move of a lane of games.
+     *
+     * @param[in]  white_to_move  The entry of the first game
+     *
+     * @tparam     V              The lane
+     *
+     * @return     All ones for the games where white is to move, 0 for the
+     *             others.
+     */
+    template<typename V>
+    KERNEL_INLINE V loadSide(const uint8_t *white_to_move)
+    {
+        uint64_t sides[sizeof(V) / 8];
+        for(size_t i = 0; i < sizeof(V) / 8; i++)
+            sides[i] = 0 - (uint64_t) white_to_move[i];
+
+        return loadLane<V>(sides);
+    }
+
+    /**
+     * @brief      Counts the set bits of each board of a lane (with shifts and
+     *             adds only, which every instruction set has for a lane).
+     *
+     * @param[in]  boards  The boards
+     *
+     * @tparam     V       The lane
+     *
+     * @return     The counts.
+     */
+    template<typename V>
+    KERNEL_INLINE V popcountLane(V boards)
+    {
+        boards -= (boards >> 1) & 0x5555555555555555ULL;
+        boards = (boards & 0x3333333333333333ULL) + ((boards >> 2) & 0x3333333333333333ULL);
+        boards = (boards + (boards >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        boards += boards >> 8;
+        boards += boards >> 16;
+        boards += boards >> 32;
+        return boards & 127;
+    }
+
+    /**
+     * @brief      Counts the set bits of a board (one game).
+     *
+     * @param[in]  board  The board
+     *
+     * @return     The count.
+     */
+    template<>
+    KERNEL_INLINE uint64_t popcountLane<uint64_t>(uint64_t board)
+    {
+        return (uint64_t) __builtin_popcountll(board);
+    }
+
+    /**
+     * @brief      Runs the attack kernel on lanes of games.
+     *
+     * @param[in]  arrays    The arrays of the games
+     * @param[in]  begin     The first game
+     * @param[in]  end       One past the last game
+     * @param      attacked  The attacked squares (from the game 'begin')
+     * @param      checkers  The pieces that give check (from the game 'begin')
+     *
+     * @tparam     V         The lane
+     *
+     * @return     The first game that was not done (fewer than a lane left).
+     */
+    template<typename V>
+    KERNEL_INLINE size_t attackLanes(const BatchArrays &arrays, size_t begin, size_t end,
+                                     uint64_t *attacked, uint64_t *checkers)
+    {
+        const size_t width = sizeof(V) / 8;
+
+        size_t game = begin;
+        for(; game + width <= end; game += width)
+        {
+            V pieces[6], lane_attacked, lane_checkers;
+            for(int type = PAWN; type <= KING; type++)
+                pieces[type] = loadLane<V>(arrays.pieces[type] + game);
+
+            sideAttacks(pieces, loadLane<V>(arrays.colors[1] + game), loadLane<V>(arrays.colors[0] + game),
+                        loadSide<V>(arrays.white_to_move + game), lane_attacked, lane_checkers);
+
+            memcpy(attacked + (game - begin), &lane_attacked, sizeof(V));
+            memcpy(checkers + (game - begin), &lane_checkers, sizeof(V));
+        }
+
+        return game;
+    }
+
+    /**
+     * @brief      Runs the board part of the evaluation kernel (the material
+     *             and center bonus, for white) on lanes of games.
+     *
+     * @param[in]  arrays    The arrays of the games
+     * @param[in]  material  The value of each piece type
+     * @param[in]  center    The center bonus
+     * @param[in]  begin     The first game
+     * @param[in]  end       One past the last game
+     * @param      scores    The scores (from the game 'begin')
+     *
+     * @tparam     V         The lane
+     *
+     * @return     The first game that was not done (fewer than a lane left).
+     */
+    template<typename V>
+    KERNEL_INLINE size_t evaluateLanes(const BatchArrays &arrays, const uint64_t material[5], uint64_t center,
+                                       size_t begin, size_t end, int *scores)
+    {
+        const size_t width = sizeof(V) / 8;
+        const uint64_t *rings = centerRings();
+
+        size_t game = begin;
+        for(; game + width <= end; game += width)
+        {
+            V white = loadLane<V>(arrays.colors[1] + game), black = loadLane<V>(arrays.colors[0] + game);
+
+            // the counts are unsigned, but the sum wraps around to the
+            // signed score
+            V score = white ^ white, minors = score;
+            for(int type = PAWN; type <= QUEEN; type++)
+            {
+                V board = loadLane<V>(arrays.pieces[type] + game);
+                score += (popcountLane(board & white) - popcountLane(board & black)) * material[type];
+                if(type <= BISHOP)
+                    minors |= board;
+            }
+
+            V bonus = score ^ score;
+            for(int ring = 0; ring < 6; ring++)
+                bonus += popcountLane(minors & white & rings[ring]) - popcountLane(minors & black & rings[ring]);
+            score += bonus * center;
+
+            uint64_t values[sizeof(V) / 8];
+            memcpy(values, &score, sizeof(V));
+            for(size_t i = 0; i < width; i++)
+                scores[game - begin + i] = (int) (int64_t) values[i];
+        }
+
+        return game;
+    }
+
+    /**
+     * @brief      The scalar attack kernel (see attackLanes()).
+     */
+    size_t attacksScalar(const BatchArrays &arrays, size_t begin, size_t end, uint64_t *attacked, uint64_t *checkers)
+    {
+        return attackLanes<uint64_t>(arrays, begin, end, attacked, checkers);
+    }
+
+    /**
+     * @brief      The scalar evaluation kernel (see evaluateLanes()).
+     */
+    size_t evaluateScalar(const BatchArrays &arrays, const uint64_t material[5], uint64_t center,
+                          size_t begin, size_t end, int *scores)
+    {
+        return evaluateLanes<uint64_t>(arrays, material, center, begin, end, scores);
+    }
+
+#ifdef BATCH_SIMD
+    /**
+     * @brief      The SSE4.2 attack kernel (see attackLanes()).
+     */
+    __attribute__((target("sse4.2")))
+    size_t attacksSSE42(const BatchArrays &arrays, size_t begin, size_t end, uint64_t *attacked, uint64_t *checkers)
+    {
+        return attackLanes<Lane2>(arrays, begin, end, attacked, checkers);
+    }
+
+    /**
+     * @brief      The AVX2 attack kernel (see attackLanes()).
+     */
+    __attribute__((target("avx2")))
+    size_t attacksAVX2(const BatchArrays &arrays, size_t begin, size_t end, uint64_t *attacked, uint64_t *checkers)
+    {
+        return attackLanes<Lane4>(arrays, begin, end, attacked, checkers);
+    }
+
+    /**
+     * @brief      The SSE4.2 evaluation kernel (see evaluateLanes()).
+     */
+    __attribute__((target("sse4.2")))
+    size_t evaluateSSE42(const BatchArrays &arrays, const uint64_t material[5], uint64_t center,
+                         size_t begin, size_t end, int *scores)
+    {
+        return evaluateLanes<Lane2>(arrays, material, center, begin, end, scores);
+    }
+
+    /**
+     * @brief      The AVX2 evaluation kernel (see evaluateLanes()).
+     */
+    __attribute__((target("avx2")))
+    size_t evaluateAVX2(const BatchArrays &arrays, const uint64_t material[5], uint64_t center,
+                        size_t begin, size_t end, int *scores)
+    {
+        return evaluateLanes<Lane4>(arrays, material, center, begin, end, scores);
+    }
+#endif
+}
@@ -0,0 +1,275 @@
+/**
+ * \page batchbench Batch Kernels Benchmark Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;batchbench.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;batch_kernels.h, game_batch.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Plays a batch of random games for a few moves, then times the batch kernels
+ * (the attacked squares and checks, and the evaluation) with each version the
+ * processor supports (scalar, SSE4.2, AVX2), and checks that every version
+ * finds the same results as the scalar one. The time of a random move of a
+ * game in the batch is also compared with the one of a game played with a
+ * chess object.
+ *
+ * Simply run <b>mingw32-make all_batchbench</b> and then <b>batchbench
+ * [options]</b>, where the options are:
+ * - <b>--games N</b>: the number of games of the batch (4096);
+ * - <b>--iterations N</b>: the number of times each kernel runs over the batch
+ *   (200);
+ * - <b>--plies N</b>: the number of random moves played in each game before
+ *   the kernels are timed (30);
+ * - <b>--seed N</b>: the seed of the random moves (1);
+ * - <b>--min-speedup X</b>: fails (exit code 3) if a move of the batch is not
+ *   at least X times faster than a move of a chess object.
+ *
+ * The exit code is 2 if a version does not find the same results as the
+ * scalar one.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#include "game_batch.h"
+#include "archive.h"
+
+// included in 'game_batch.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+
+    /**
+     * @brief      Times random moves (from the start position) of games played
+     *             in a batch and of games played with chess objects.
+     *
+     * @param[in]  num_games  The number of games of the batch
+     * @param[in]  plies      The number of moves of each game
+     * @param[in]  seed       The seed of the random moves
+     * @param      batch_us   The time of a move of a game in the batch (in
+     *                        microseconds)
+     * @param      chess_us   The time of a move of a chess object (in
+     *                        microseconds)
+     */
+    void timeGames(int num_games, int plies, unsigned int seed, double &batch_us, double &chess_us);
+}
+
+/**
+ * @brief      Times the batch kernels with each version the processor
+ *             supports.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if every version agrees with the scalar one (and the batch is
+ *             fast enough), 1 for invalid usage, 2 if a version does not
+ *             agree, 3 if the batch is too slow.
+ */
+int main(int argc, char *argv[])
+{
+    int num_games = 4096, iterations = 200, plies = 30;
+    unsigned int seed = 1;
+    double min_speedup = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(i + 1 >= argc)
+            return usage();
+        else if(strcmp(argv[i], "--games") == 0)
+            num_games = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--iterations") == 0)
+            iterations = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--plies") == 0)
+            plies = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0)
+            seed = strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--min-speedup") == 0)
+            min_speedup = atof(argv[++i]);
+        else
+            return usage();
+    }
+
+    if(num_games <= 0 || iterations <= 0 || plies < 0)
+        return usage();
+
+    // random positions (the games that end early keep their last position)
+    GameBatch batch(num_games);
+    vector<Move> moves, chosen(num_games);
+    vector<uint32_t> first;
+    mt19937 rng(seed);
+    for(int ply = 0; ply < plies; ply++)
+    {
+        batch.generateMoves(moves, first);
+        for(int game = 0; game < num_games; game++)
+        {
+            uint32_t count = first[game + 1] - first[game];
+            chosen[game] = count > 0 ? moves[first[game] + rng() % count] : Move{-1, -1, '\0'};
+        }
+        batch.applyMoves(chosen);
+    }
+
+    EngineConfig config;
+    vector<uint64_t> expected_attacked, expected_checkers;
+    vector<int> expected_scores, scores;
+    double scalar_ns = 0;
+    bool agree = true;
+
+    printf("Games %d  iterations %d  plies %d\n", num_games, iterations, plies);
+    for(batchKernel kernel : {KERNEL_SCALAR, KERNEL_SSE42, KERNEL_AVX2})
+    {
+        if(!batch.setKernel(kernel))
+        {
+            printf("%-8s not supported\n", kernelName(kernel));
+            continue;
+        }
+
+        auto start = chrono::steady_clock::now();
+        for(int i = 0; i < iterations; i++)
+            batch.updateAttacks();
+        double attacks_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() /
+                            ((double) iterations * num_games);
+
+        start = chrono::steady_clock::now();
+        for(int i = 0; i < iterations; i++)
+            batch.evaluate(config, scores);
+        double evaluate_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() /
+                             ((double) iterations * num_games);
+
+        // the scalar version runs first, and is the reference
+        bool same = true;
+        for(int game = 0; game < num_games; game++)
+        {
+            if(kernel == KERNEL_SCALAR)
+            {
+                expected_attacked.push_back(batch.getAttacked(game));
+                expected_checkers.push_back(batch.getCheckers(game));
+            }
+            else
+                same = same && batch.getAttacked(game) == expected_attacked[game] &&
+                       batch.getCheckers(game) == expected_checkers[game];
+        }
+
+        if(kernel == KERNEL_SCALAR)
+        {
+            expected_scores = scores;
+            scalar_ns = attacks_ns + evaluate_ns;
+        }
+        else
+            same = same && scores == expected_scores;
+
+        printf("%-8s attacks %6.2f ns/game  evaluate %6.2f ns/game  speedup %.2fx%s\n", kernelName(kernel),
+               attacks_ns, evaluate_ns, scalar_ns / (attacks_ns + evaluate_ns), same ? "" : "  MISMATCH");
+        agree = agree && same;
+    }
+
+    // a few hundred games are enough to fill the batch kernels
+    double batch_us, chess_us;
+    timeGames(min(num_games, 256), max(plies, 1), seed, batch_us, chess_us);
+    printf("Random games  batch %.2f us/move  chess objects %.2f us/move  speedup %.1fx\n", batch_us, chess_us,
+           chess_us / batch_us);
+
+    if(!agree)
+        return 2;
+    if(min_speedup > 0 && chess_us < batch_us * min_speedup)
+    {
+        printf("The batch is not %.1fx faster than chess objects\n", min_speedup);
+        return 3;
+    }
+
+    return 0;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage: batchbench [--games N] [--iterations N] [--plies N] [--seed N] [--min-speedup X]\n");
+        return 1;
+    }
+
+    /**
+     * @brief      Times random moves (from the start position) of games played
+     *             in a batch and of games played with chess objects.
+     *
+     * @param[in]  num_games  The number of games of the batch
+     * @param[in]  plies      The number of moves of each game
+     * @param[in]  seed       The seed of the random moves
+     * @param      batch_us   The time of a move of a game in the batch (in
+     *                        microseconds)
+     * @param      chess_us   The time of a move of a chess object (in
+     *                        microseconds)
+     */
+    void timeGames(int num_games, int plies, unsigned int seed, double &batch_us, double &chess_us)
+    {
+        GameBatch batch(num_games);
+        vector<Move> moves, chosen(num_games);
+        vector<uint32_t> first;
+        mt19937 rng(seed);
+
+        auto start = chrono::steady_clock::now();
+        uint64_t batch_plies = 0;
+        for(int ply = 0; ply < plies && batch.updateStatus() > 0; ply++)
+        {
+            batch.generateMoves(moves, first);
+            for(int game = 0; game < num_games; game++)
+            {
+                uint32_t count = first[game + 1] - first[game];
+                chosen[game] = count > 0 ? moves[first[game] + rng() % count] : Move{-1, -1, '\0'};
+                batch_plies += count > 0;
+            }
+            batch.applyMoves(chosen);
+        }
+        batch_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() /
+                   max<uint64_t>(batch_plies, 1);
+
+        // a chess object is much slower, so a few games are enough
+        start = chrono::steady_clock::now();
+        uint64_t chess_plies = 0;
+        for(int game = 0; game < 4; game++)
+        {
+            Chess chess;
+            chess.setHeadless(true);
+            chess.setFromFEN(START_FEN);
+            for(int ply = 0; ply < plies; ply++)
+            {
+                vector<Move> legal = legalMoves(chess);
+                if(legal.empty())
+                    break;
+                playMove(chess, legal[rng() % legal.size()]);
+                chess_plies++;
+            }
+        }
+        chess_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() /
+                   max<uint64_t>(chess_plies, 1);
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ * \page bench Search Benchmark Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;bench.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;bench.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * The positions of the benchmark and their searches (see bench.h).
+ */
+
+#include "bench.h"
+#include "archive.h"
+
+#include <chrono>
+
+// included in 'bench.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      (Accessor) Gets the positions of the benchmark.
+     *
+     * @return     The FEN strings of the positions.
+     */
+    const vector<string> & benchPositions()
+    {
+        // written as Chess::toFEN() writes them; changing a position changes
+        // the signatures (see BENCH_SIGNATURE and BENCH_QUICK_SIGNATURE)
+        static const vector<string> positions = {
+            START_FEN,
+            "r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR[QRBBNNPPPPqrbbnnpppp] w KQkq - 4 4", // mate in one
+            "r3k2r/pppq1ppp/2n2n2/3pP3/8/2N2N2/PPPQ1PPP/R3K2R[BNPPq] w KQkq d6 0 8",                   // castling, en-passant
+            "r2q1rk1/pp2bppp/2n1pn2/3p4/3P4/2NBPN2/PP3PPP/R2Q1RK1[NPqr] w - - 2 10",
+            "r4rk1/1pp2ppp/p1np1q2/2b1p3/2B1P1b1/2NP1N2/PPP2PPP/R1BQR1K1[] b - - 0 10",                // no reservoir
+            "1n2k3/P7/8/8/8/8/7p/4K1N1[QBNPrbnp] w - - 0 40",                                         // promotions
+            "8/5pk1/6p1/8/3R4/6P1/5PK1/3r4[Pp] w - - 0 40",
+            "4k3/3ppp2/8/8/8/8/3PPP2/4K3[QRBBNNPPPPqrbbnnppp] b - - 0 20"                              // full reservoirs
+        };
+
+        return positions;
+    }
+
+    /**
+     * @brief      Searches every position of the benchmark to a depth, one
+     *             after the other on the calling thread.
+     *
+     * @param[in]  depth     The depth of the searches (in plies)
+     * @param      result    The outcome of the benchmark
+     * @param[in]  searched  Called after the search of each position with its
+     *                       index (can be nullptr)
+     */
+    void runBench(int depth, BenchResult &result, const function<void(const BenchPosition &, int)> &searched)
+    {
+        result = BenchResult();
+
+        EngineConfig config;
+        config.depth = depth;
+
+        for(const auto & fen : benchPositions())
+        {
+            // a new engine for each position, so a search does not depend on
+            // the tables filled by the one before it
+            Engine engine(config);
+            Chess chess;
+            chess.setHeadless(true);
+            chess.setFromFEN(fen);
+
+            BenchPosition position;
+            position.fen = fen;
+
+            auto start = chrono::steady_clock::now();
+            position.best = engine.search(chess, position.score);
+            position.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            position.nodes = engine.getNodes();
+
+            result.positions.push_back(position);
+            result.nodes += position.nodes;
+            result.seconds += position.seconds;
+
+            if(searched)
+                searched(position, (int) result.positions.size() - 1);
+        }
+    }
+}
@@ -0,0 +1,560 @@
+/**
+ * \page book Opening Book Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;book.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;book.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Building and probing the opening book (see book.h for the file layout).
+ */
+
+#include "book.h"
+#include "archive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <thread>
+
+// included in 'book.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /** The number of games a thread takes from the archive at a time */
+    const size_t GAME_BATCH = 64;
+
+    /** The number of entries written to the book file at a time */
+    const size_t WRITE_BATCH = 1 << 16;
+
+    /**
+     * @brief      Orders the entries by hash and move (the entries of the same
+     *             move are next to each other).
+     *
+     * @param[in]  a     The first entry
+     * @param[in]  b     The second entry
+     *
+     * @return     True if 'a' comes before 'b', False otherwise.
+     */
+    bool byMove(const BookEntry &a, const BookEntry &b);
+
+    /**
+     * @brief      Checks if two entries are of the same move of the same
+     *             position.
+     *
+     * @param[in]  a     The first entry
+     * @param[in]  b     The second entry
+     *
+     * @return     True if they are, False otherwise.
+     */
+    bool sameMove(const BookEntry &a, const BookEntry &b);
+
+    /**
+     * @brief      Adds the counts of an entry to another one (of the same
+     *             move).
+     *
+     * @param      to    The entry added to
+     * @param[in]  from  The entry added
+     */
+    void addCounts(BookEntry &to, const BookEntry &from);
+
+    /**
+     * @brief      Sorts entries by move and combines the ones of the same move.
+     *
+     * @param      entries  The entries
+     */
+    void combine(vector<BookEntry> &entries);
+
+    /**
+     * @brief      Merges the combined entries of the threads, keeps the moves
+     *             played in enough games and writes them to the book file,
+     *             heaviest first for each position.
+     *
+     * @param      out        The book file
+     * @param[in]  sorted     The combined entries of each thread
+     * @param[in]  min_games  The fewest games of a move that is kept
+     * @param      header     The header, whose counts are set
+     *
+     * @return     True if all entries were written, False otherwise.
+     */
+    bool writeMerged(ofstream &out, const vector<vector<BookEntry>> &sorted, uint32_t min_games, BookHeader &header);
+} // unnamed namespace (makes these functions local to this implementation file)
+
+/*************************************************************************************/
+/*                              OPENING BOOK - MEMBER FUNCTIONS                      */
+/*************************************************************************************/
+/**
+ * @brief      Default constructor - Constructs a new instance with no book
+ *             opened.
+ */
+OpeningBook::OpeningBook()
+    : entries{nullptr}, num_entries{0}, num_positions{0}
+{
+}
+
+/**
+ * @brief      Builds the book of an archive. Games are replayed on
+ *             'num_threads' threads (each with its own headless Chess object),
+ *             each thread counts its moves in its own sorted entries, and the
+ *             entries of the threads are merged.
+ *
+ * @param[in]  archive_file  The game archive (see archive.h)
+ * @param[in]  book_file     The book file to write
+ * @param[in]  num_threads   The number of threads (0 uses all cores)
+ * @param[in]  options       The settings of the book
+ * @param      stats         The outcome of the build (can be nullptr)
+ *
+ * @return     True if the book was written, False if the archive could not be
+ *             read or the book could not be written.
+ */
+bool OpeningBook::build(const string &archive_file, const string &book_file, int num_threads,
+                        const BookOptions &options, BookStats *stats)
+{
+    auto start = chrono::steady_clock::now();
+
+    MappedFile archive;
+    if(!archive.open(archive_file))
+        return false;
+
+    const char *data = archive.getData();
+    size_t size = archive.getSize();
+    vector<uint64_t> games = findGames(data, size);
+
+    if(num_threads <= 0)
+        num_threads = max(1u, thread::hardware_concurrency());
+
+    // each thread replays batches of games and keeps its own entries, so
+    // nothing is shared but the counter of the next batch
+    atomic<size_t> next_game{0};
+    vector<vector<BookEntry>> sorted(num_threads);
+    vector<uint64_t> invalid(num_threads, 0), moves(num_threads, 0);
+    vector<thread> threads;
+
+    for(int t = 0; t < num_threads; t++)
+    {
+        threads.emplace_back([&, t]()
+        {
+            Chess chess;
+            chess.setHeadless(true);
+
+            GameRecord game;
+            vector<BookEntry> &entries = sorted[t];
+            size_t combined = 0;
+
+            for(size_t first = next_game.fetch_add(GAME_BATCH); first < games.size(); first = next_game.fetch_add(GAME_BATCH))
+            {
+                for(size_t g = first; g < min(first + GAME_BATCH, games.size()); g++)
+                {
+                    const char *line = data + games[g];
+                    const char *end = (const char *) memchr(line, '\n', size - games[g]);
+                    string text(line, end == nullptr ? data + size : end);
+
+                    if(!parseGame(text, game))
+                    {
+                        invalid[t]++;
+                        continue;
+                    }
+
+                    int plies = min((int) game.moves.size(), options.max_ply);
+                    BookEntry pending;
+                    bool white = false;
+
+                    // the move of a position is known when its position is
+                    // visited, but it is only added once the next position
+                    // shows that it was legal
+                    int replayed = replayGame(chess, game, [&](const Chess &position, int ply)
+                    {
+                        if(ply > 0 && ply <= plies)
+                        {
+                            int result = game.result == "1-0" ? (white ? 1 : -1) : game.result == "0-1" ? (white ? -1 : 1) :
+                                         game.result == "1/2-1/2" ? 0 : 2;
+
+                            pending.games = 1;
+                            pending.wins = result == 1;
+                            pending.draws = result == 0;
+                            pending.losses = result == -1;
+                            pending.weight = result == 1 ? 2 : result == -1 ? 0 : 1;
+                            entries.push_back(pending);
+                        }
+
+                        int src, dest;
+                        char promotion;
+                        if(ply >= plies || !parseMove(game.moves[ply], src, dest, promotion))
+                            return;
+
+                        // a promotion without its piece is to a queen (see
+                        // replayGame()), as the legal moves give it
+                        if(src < 64 && promotion == '\0' && position.getBoard()[src]->isPawn() && (dest/8 == 0 || dest/8 == 7))
+                            promotion = 'q';
+
+                        pending.hash = position.getHash();
+                        pending.src = (uint8_t) src;
+                        pending.dest = (uint8_t) dest;
+                        pending.promotion = promotion;
+                        pending.reserved = 0;
+                        white = position.getTurn() == WHITE;
+                    });
+
+                    moves[t] += max(0, min(replayed, plies));
+                    if(replayed != (int) game.moves.size())
+                        invalid[t]++;
+                }
+
+                // combined as it grows, so a thread keeps about one entry per
+                // (position, move) it has seen
+                if(entries.size() >= 2 * max(combined, WRITE_BATCH))
+                {
+                    combine(entries);
+                    combined = entries.size();
+                }
+            }
+
+            combine(entries);
+        });
+    }
+
+    for(auto & elem : threads)
+        elem.join();
+
+    // -------- write the book file -------- //
+    BookHeader header;
+    memcpy(header.magic, BOOK_MAGIC, sizeof(header.magic));
+    header.num_entries = header.num_positions = 0;
+    header.num_games = games.size();
+
+    // the counts are written again once the entries are merged
+    ofstream out(book_file, ios::binary | ios::trunc);
+    out.write((const char *) &header, sizeof(header));
+    bool ok = out && writeMerged(out, sorted, options.min_games, header);
+    out.seekp(0);
+    out.write((const char *) &header, sizeof(header));
+    ok = ok && out;
+    out.close();
+
+    if(stats != nullptr)
+    {
+        stats->games = games.size();
+        stats->invalid = stats->moves = 0;
+        for(int t = 0; t < num_threads; t++)
+        {
+            stats->invalid += invalid[t];
+            stats->moves += moves[t];
+        }
+
+        stats->entries = header.num_entries;
+        stats->positions = header.num_positions;
+        stats->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    return ok;
+}
+
+/**
+ * @brief      Opens (memory maps) a book file.
+ *
+ * @param[in]  book_file  The book file
+ *
+ * @return     True if the file is a valid book, False otherwise.
+ */
+bool OpeningBook::open(const string &book_file)
+{
+    close();
+
+    if(!file.open(book_file) || file.getSize() < sizeof(BookHeader))
+    {
+        close();
+        return false;
+    }
+
+    const BookHeader *header = (const BookHeader *) file.getData();
+    if( memcmp(header->magic, BOOK_MAGIC, sizeof(header->magic)) != 0 ||
+        file.getSize() != sizeof(BookHeader) + header->num_entries*sizeof(BookEntry) )
+    {
+        close();
+        return false;
+    }
+
+    num_entries = header->num_entries;
+    num_positions = header->num_positions;
+    entries = (const BookEntry *) (file.getData() + sizeof(BookHeader));
+
+    return true;
+}
+
+/**
+ * @brief      Closes the book file.
+ */
+void OpeningBook::close()
+{
+    file.close();
+    entries = nullptr;
+    num_entries = num_positions = 0;
+}
+
+/**
+ * @brief      Finds the entries of a position (without copying them).
+ *
+ * @param[in]  hash   The hash of the position (Chess::getHash())
+ * @param      first  The first entry of the position (if any)
+ *
+ * @return     The number of entries of the position, which are stored one
+ *             after the other (heaviest first) starting at 'first'.
+ */
+size_t OpeningBook::find(uint64_t hash, const BookEntry *&first) const
+{
+    const BookEntry *end = entries + num_entries;
+
+    first = lower_bound(entries, end, hash, [](const BookEntry &entry, uint64_t value) {return entry.hash < value;});
+    const BookEntry *last = upper_bound(first, end, hash, [](uint64_t value, const BookEntry &entry) {return value < entry.hash;});
+
+    return last - first;
+}
+
+/**
+ * @brief      Finds the entries of a position.
+ *
+ * @param[in]  hash   The hash of the position (Chess::getHash())
+ *
+ * @return     The entries of the position, heaviest first.
+ */
+vector<BookEntry> OpeningBook::query(uint64_t hash) const
+{
+    const BookEntry *first;
+    size_t count = find(hash, first);
+
+    return vector<BookEntry>(first, first + count);
+}
+
+/**
+ * @brief      Chooses a book move of a position, at random in proportion to
+ *             the weights, among the moves that are legal (a hash can be
+ *             shared by two positions).
+ *
+ * @param[in]  chess   The chess object (it is not changed)
+ * @param[in]  random  A random number (0 always chooses the heaviest legal
+ *                     move)
+ * @param      move    The move
+ *
+ * @return     True if a move was chosen, False if the position is not in the
+ *             book (or none of its moves is legal).
+ */
+bool OpeningBook::choose(const Chess &chess, uint64_t random, Move &move) const
+{
+    const BookEntry *first;
+    size_t count = find(chess.getHash(), first);
+    if(count == 0)
+        return false;
+
+    // the legal moves are only generated for a position of the book
+    Chess position(chess);
+    position.setHeadless(true);
+    vector<Move> legal = legalMoves(position);
+
+    vector<const BookEntry *> candidates;
+    uint64_t total = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        for(const auto & elem : legal)
+        {
+            if(elem.src == first[i].src && elem.dest == first[i].dest && elem.promotion == first[i].promotion)
+            {
+                candidates.push_back(first + i);
+                total += first[i].weight;
+                break;
+            }
+        }
+    }
+
+    if(candidates.empty())
+        return false;
+
+    // the candidates are heaviest first, so a weight of 0 (or no randomness)
+    // picks the first one
+    const BookEntry *chosen = candidates[0];
+    if(random != 0 && total != 0)
+    {
+        uint64_t target = random % total;
+        for(const auto & elem : candidates)
+        {
+            if(target < elem->weight)
+            {
+                chosen = elem;
+                break;
+            }
+            target -= elem->weight;
+        }
+    }
+
+    move = {chosen->src, chosen->dest, chosen->promotion};
+    return true;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Orders the entries by hash and move (the entries of the same
+     *             move are next to each other).
+     *
+     * @param[in]  a     The first entry
+     * @param[in]  b     The second entry
+     *
+     * @return     True if 'a' comes before 'b', False otherwise.
+     */
+    bool byMove(const BookEntry &a, const BookEntry &b)
+    {
+        if(a.hash != b.hash)
+            return a.hash < b.hash;
+        if(a.src != b.src)
+            return a.src < b.src;
+        if(a.dest != b.dest)
+            return a.dest < b.dest;
+        return a.promotion < b.promotion;
+    }
+
+    /**
+     * @brief      Checks if two entries are of the same move of the same
+     *             position.
+     *
+     * @param[in]  a     The first entry
+     * @param[in]  b     The second entry
+     *
+     * @return     True if they are, False otherwise.
+     */
+    bool sameMove(const BookEntry &a, const BookEntry &b)
+    {
+        return a.hash == b.hash && a.src == b.src && a.dest == b.dest && a.promotion == b.promotion;
+    }
+
+    /**
+     * @brief      Adds the counts of an entry to another one (of the same
+     *             move).
+     *
+     * @param      to    The entry added to
+     * @param[in]  from  The entry added
+     */
+    void addCounts(BookEntry &to, const BookEntry &from)
+    {
+        to.weight += from.weight;
+        to.games += from.games;
+        to.wins += from.wins;
+        to.draws += from.draws;
+        to.losses += from.losses;
+    }
+
+    /**
+     * @brief      Sorts entries by move and combines the ones of the same move.
+     *
+     * @param      entries  The entries
+     */
+    void combine(vector<BookEntry> &entries)
+    {
+        sort(entries.begin(), entries.end(), byMove);
+
+        size_t last = 0;
+        for(size_t i = 1; i < entries.size(); i++)
+        {
+            if(sameMove(entries[last], entries[i]))
+                addCounts(entries[last], entries[i]);
+            else
+                entries[++last] = entries[i];
+        }
+
+        if(!entries.empty())
+            entries.resize(last + 1);
+    }
+
+    /**
+     * @brief      Merges the combined entries of the threads, keeps the moves
+     *             played in enough games and writes them to the book file,
+     *             heaviest first for each position.
+     *
+     * @param      out        The book file
+     * @param[in]  sorted     The combined entries of each thread
+     * @param[in]  min_games  The fewest games of a move that is kept
+     * @param      header     The header, whose counts are set
+     *
+     * @return     True if all entries were written, False otherwise.
+     */
+    bool writeMerged(ofstream &out, const vector<vector<BookEntry>> &sorted, uint32_t min_games, BookHeader &header)
+    {
+        // (next entry, thread) pairs with the smallest entry on top
+        typedef pair<BookEntry, size_t> Head;
+        auto later = [](const Head &a, const Head &b) {return byMove(b.first, a.first);};
+        priority_queue<Head, vector<Head>, decltype(later)> heads(later);
+        vector<size_t> positions(sorted.size(), 0);
+
+        for(size_t t = 0; t < sorted.size(); t++)
+            if(!sorted[t].empty())
+                heads.push({sorted[t][0], t});
+
+        // the moves of the position being merged, and the entries to write
+        vector<BookEntry> group, buffer;
+        buffer.reserve(WRITE_BATCH);
+
+        auto flush = [&]()
+        {
+            // the same move may come from several threads (next to each other)
+            vector<BookEntry> kept;
+            for(const auto & elem : group)
+            {
+                if(!kept.empty() && sameMove(kept.back(), elem))
+                    addCounts(kept.back(), elem);
+                else
+                    kept.push_back(elem);
+            }
+
+            kept.erase(remove_if(kept.begin(), kept.end(), [&](const BookEntry &entry) {return entry.games < min_games;}), kept.end());
+            stable_sort(kept.begin(), kept.end(), [](const BookEntry &a, const BookEntry &b)
+            {
+                return a.weight != b.weight ? a.weight > b.weight : a.games > b.games;
+            });
+
+            header.num_entries += kept.size();
+            header.num_positions += !kept.empty();
+            buffer.insert(buffer.end(), kept.begin(), kept.end());
+            group.clear();
+
+            if(buffer.size() >= WRITE_BATCH)
+            {
+                out.write((const char *) buffer.data(), buffer.size() * sizeof(BookEntry));
+                buffer.clear();
+            }
+        };
+
+        while(!heads.empty())
+        {
+            Head head = heads.top();
+            heads.pop();
+
+            if(!group.empty() && group.back().hash != head.first.hash)
+                flush();
+            group.push_back(head.first);
+
+            if(++positions[head.second] < sorted[head.second].size())
+                heads.push({sorted[head.second][positions[head.second]], head.second});
+        }
+
+        flush();
+        out.write((const char *) buffer.data(), buffer.size() * sizeof(BookEntry));
+
+        return (bool) out;
+    }
+}
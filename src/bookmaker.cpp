@@ -0,0 +1,244 @@
+/**
+ * \page bookmaker Opening Book Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;bookmaker.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;book.h, archive.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Builds and probes the opening book of a game archive.
+ *
+ * Simply run <b>mingw32-make all_bookmaker</b> on a Windows machine and then:
+ * - <b>bookmaker build games.txt games.book [options]</b> to add the first
+ *   moves of every game in <i>games.txt</i> to a book, where the options are:
+ *   - <b>--threads N</b>: the number of threads (all cores);
+ *   - <b>--max-ply N</b>: the number of moves of each game added (24);
+ *   - <b>--min-games N</b>: the fewest games of a move that is kept (1);
+ *   - <b>--scaling</b>: builds the book with 1, 2, 4, ... threads (up to
+ *     --threads) and prints the speedup of each;
+ * - <b>bookmaker probe games.book "FEN" [--probes N]</b> to list the book moves
+ *   of a position (and their statistics) and time N probes of it (100000).
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "archive.h"
+#include "book.h"
+
+// included in 'book.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Builds the book of an archive and prints the statistics.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the book was built, 1 otherwise.
+     */
+    int buildCommand(int argc, char *argv[]);
+
+    /**
+     * @brief      Lists the book moves of a position and times its probes.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the book was probed, 1 otherwise.
+     */
+    int probeCommand(int argc, char *argv[]);
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+}
+
+/**
+ * @brief      Builds or probes an opening book depending on the first
+ *             argument.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if program exited successfully
+ */
+int main(int argc, char *argv[])
+{
+    if(argc >= 4 && strcmp(argv[1], "build") == 0)
+        return buildCommand(argc, argv);
+    else if(argc >= 4 && strcmp(argv[1], "probe") == 0)
+        return probeCommand(argc, argv);
+    else
+        return usage();
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Builds the book of an archive and prints the statistics.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the book was built, 1 otherwise.
+     */
+    int buildCommand(int argc, char *argv[])
+    {
+        int num_threads = 0;
+        bool scaling = false;
+        BookOptions options;
+
+        for(int i = 4; i < argc; i++)
+        {
+            if(strcmp(argv[i], "--scaling") == 0)
+                scaling = true;
+            else if(i + 1 >= argc)
+                return usage();
+            else if(strcmp(argv[i], "--threads") == 0)
+                num_threads = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--max-ply") == 0)
+                options.max_ply = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--min-games") == 0)
+                options.min_games = strtoul(argv[++i], nullptr, 10);
+            else
+                return usage();
+        }
+
+        if(num_threads <= 0)
+            num_threads = max(1u, thread::hardware_concurrency());
+
+        // the same book is built with more threads each time (the last build
+        // is the one that is kept)
+        vector<int> counts;
+        for(int threads = 1; scaling && threads < num_threads; threads *= 2)
+            counts.push_back(threads);
+        counts.push_back(num_threads);
+
+        double single = 0;
+        for(const auto & threads : counts)
+        {
+            BookStats stats;
+            if(!OpeningBook::build(argv[2], argv[3], threads, options, &stats))
+            {
+                printf("Could not build the book of '%s' into '%s'\n", argv[2], argv[3]);
+                return 1;
+            }
+
+            if(threads == 1)
+                single = stats.seconds;
+
+            if(threads == num_threads)
+            {
+                printf("Games:     %llu (%llu invalid)\n", (unsigned long long) stats.games, (unsigned long long) stats.invalid);
+                printf("Moves:     %llu replayed\n", (unsigned long long) stats.moves);
+                printf("Book:      %llu entries, %llu positions\n", (unsigned long long) stats.entries, (unsigned long long) stats.positions);
+            }
+
+            printf("Threads:   %d, %.3f s (%.0f games/s)", threads, stats.seconds, stats.seconds > 0 ? stats.games / stats.seconds : 0.0);
+            if(scaling && single > 0 && stats.seconds > 0)
+                printf(", %.2fx", single / stats.seconds);
+            printf("\n");
+        }
+
+        return 0;
+    }
+
+    /**
+     * @brief      Lists the book moves of a position and times its probes.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the book was probed, 1 otherwise.
+     */
+    int probeCommand(int argc, char *argv[])
+    {
+        int probes = 100000;
+
+        for(int i = 4; i + 1 < argc; i += 2)
+        {
+            if(strcmp(argv[i], "--probes") == 0)
+                probes = atoi(argv[i+1]);
+            else
+                return usage();
+        }
+
+        OpeningBook book;
+        if(!book.open(argv[2]))
+        {
+            printf("'%s' is not an opening book\n", argv[2]);
+            return 1;
+        }
+
+        Chess chess;
+        chess.setHeadless(true);
+        if(!chess.setFromFEN(argv[3]) || probes <= 0)
+        {
+            printf("Invalid FEN: %s\n", argv[3]);
+            return 1;
+        }
+
+        printf("%llu entries, %llu positions\n", (unsigned long long) book.getNumEntries(), (unsigned long long) book.getNumPositions());
+
+        const BookEntry *first;
+        size_t count = book.find(chess.getHash(), first);
+        for(size_t i = 0; i < count; i++)
+        {
+            printf("%-6s weight %u  games %u  +%u =%u -%u\n", formatMove(first[i].src, first[i].dest, first[i].promotion).c_str(),
+                   first[i].weight, first[i].games, first[i].wins, first[i].draws, first[i].losses);
+        }
+
+        // a lookup of the hash, and a choice that also checks the moves are legal
+        auto start = chrono::steady_clock::now();
+        size_t found = 0;
+        for(int i = 0; i < probes; i++)
+            found += book.find(chess.getHash() + (i & 1), first);
+        double find_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / probes;
+
+        Move move;
+        int choices = max(1, probes / 100);
+        start = chrono::steady_clock::now();
+        for(int i = 0; i < choices; i++)
+            found += book.choose(chess, i, move);
+        double choose_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / choices;
+
+        printf("Probe:     %.3f us (find), %.3f us (choose a legal move)  (checksum %zu)\n", find_us, choose_us, found);
+        return 0;
+    }
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage:\n"
+               "  bookmaker build <archive> <book> [--threads N] [--max-ply N] [--min-games N] [--scaling]\n"
+               "  bookmaker probe <book> <FEN> [--probes N]\n");
+        return 1;
+    }
+}
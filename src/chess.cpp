@@ -28,6 +28,13 @@
  */
 
 #include "chess.h"
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 // included in 'chess.h' but good to re-state
 using namespace std;
@@ -55,7 +62,7 @@ ostream & operator << (ostream &out, const Chess &chess_object)
     for(const auto & elem : chess_object.getReservoir())
         out << elem.first << elem.second << endl;
 
-    out << chess_object.getTurn() << endl;
+    out << chess_object.getTurn() << endl << chess_object.getHalfmoveClock() << endl;
 
     return out;
 }
@@ -137,6 +144,8 @@ istream & operator >> (istream &in, Chess &chess_object)
 
     in >> input;
     chess_object.setTurn((pieceColor) (input[0] - '0'));
+    in >> input;
+    chess_object.setHalfmoveClock(stoi(input));
 
     return in;
 }
@@ -248,8 +257,108 @@ namespace
      * @note       The return value depends on target of the global makefile
      */
     string getPath(int num_moves);    
+
+    /**
+     * @brief      Places a piece of the given type and color in a board slot,
+     *             re-using the existing piece object if it is of the same type.
+     *
+     * @param      slot    The board (or check pieces) slot to fill
+     * @param[in]  square  The square of the piece
+     * @param[in]  type    The type of the piece
+     * @param[in]  color   The color of the piece
+     *
+     * @post       'slot' points to a piece with the given information, with its
+     *             moved and en-passant information cleared.
+     */
+    void placePiece(Piece *&slot, int square, pieceType type, pieceColor color);
+
+    /**
+     * @brief      Appends a character to a FEN buffer if there is room for it
+     *             (and the null terminator).
+     *
+     * @param      fen   The FEN buffer
+     * @param[in]  size  The size of the buffer
+     * @param      len   The current length of the string (updated by reference)
+     * @param[in]  c     The character to append
+     *
+     * @return     True if the character was appended, False otherwise.
+     */
+    bool appendFEN(char *fen, int size, int &len, char c);
+
+    /**
+     * @brief      Copies the pieces of a board (or check pieces) to another one,
+     *             re-using the piece objects of the same type.
+     *
+     * @param[in]  from  The pieces to copy
+     * @param      to    The pieces to overwrite (resized to the size of 'from')
+     */
+    void copyPieces(const vector<Piece*> &from, vector<Piece*> &to);
 } // unnamed namespace (makes these functions local to this implementation file)
 
+/*************************************************************************************/
+/*                              POSITION HISTORY - MEMBER FUNCTIONS                  */
+/*************************************************************************************/
+/**
+ * @brief      Starts the history from a position.
+ *
+ * @param[in]  ply   The ply of the position (Chess::getNumMoves())
+ * @param[in]  hash  The hash of the position
+ */
+void PositionHistory::reset(int ply, uint64_t hash)
+{
+    first_ply = ply;
+    hashes.assign(1, hash);
+    reversible.assign(1, 0);
+}
+
+/**
+ * @brief      Sets the position after a ply (the entries of the later plies
+ *             are dropped).
+ *
+ * @param[in]  ply           The ply (in (first_ply, first_ply +
+ *                           hashes.size()], else the history is reset)
+ * @param[in]  hash          The hash of the position
+ * @param[in]  irreversible  True if the move of the ply was irreversible,
+ *                           False otherwise
+ */
+void PositionHistory::record(int ply, uint64_t hash, bool irreversible)
+{
+    int index = ply - first_ply;
+    if(index <= 0 || index > (int) hashes.size())
+    {
+        reset(ply, hash);
+        return;
+    }
+
+    // the vectors keep their capacity, so a search does not allocate once
+    // they reached its depth
+    hashes.resize(index + 1);
+    reversible.resize(index + 1);
+    hashes[index] = hash;
+    reversible[index] = irreversible ? 0 : reversible[index - 1] + 1;
+}
+
+/**
+ * @brief      Counts the earlier occurrences of the position of a ply (with the
+ *             same side to move, since the last irreversible move).
+ *
+ * @param[in]  ply   The ply (in [first_ply, first_ply + hashes.size()))
+ *
+ * @return     The number of occurrences (2 for a threefold repetition).
+ */
+int PositionHistory::repetitions(int ply) const
+{
+    int index = ply - first_ply;
+    if(index < 0 || index >= (int) hashes.size())
+        return 0;
+
+    int count = 0;
+    for(int i = index - 2; i >= index - reversible[index]; i -= 2)
+        count += hashes[i] == hashes[index];
+
+    return count;
+}
+
 /*************************************************************************************/
 /*                              CHESS CLASS - MEMBER FUNCTIONS                       */
 /*************************************************************************************/
@@ -258,7 +367,7 @@ namespace
  *             Constructs a new instance.
  */
 Chess::Chess()
-    : board(64), check_pieces(2), flags(4), reservoir(10), turn{WHITE}, num_moves{0} 
+    : board(64), check_pieces(2), flags(4), reservoir(10), turn{WHITE}, num_moves{0}, halfmove_clock{0}, headless{false}, unsaved{false}
 {
     for(int i = 0; i < 10; i++)
     {
@@ -293,22 +402,22 @@ Chess::~Chess()
         delete elem; // GCOVR_EXCL_LINE
 }
 
-// GCOV_EXCL_START
 /**
  * @brief      Copy constructor - Constructs a new instance and copies the
  *             calling object's values to it.
  *
  * @param[in]  chess_object  The object whose values will be copied
+ *
+ * @note       The position, its history and the saved state of the current
+ *             move are copied (the saved states of the earlier moves and the
+ *             listener are not). The copy is headless, so it never prints, and
+ *             neither copying nor playing on the copy reads or writes an
+ *             object_states file.
  */
 Chess::Chess(const Chess &chess_object)
+    : turn{WHITE}, num_moves{0}, halfmove_clock{0}, headless{false}, unsaved{false}
 {
-    // create the new object via a dynamic allocation
-    Chess *chess_ptr = new Chess;
-
-    // assign it the same number of moves as current object and then restore the
-    // member variables based on that move number (into the NEW object)
-    chess_ptr->setNumMoves(chess_object.getNumMoves());
-    chessCAMO::restoreObject(*chess_ptr);
+    *this = chess_object;
 }
 
 /**
@@ -318,17 +427,95 @@ Chess::Chess(const Chess &chess_object)
  * @param[in]  chess_object  The object whose values will be copied
  *
  * @return     The resulting object from the assignment
+ *
+ * @note       Copies what the copy constructor copies (the object becomes
+ *             headless), and keeps the listener of the existing object. The
+ *             piece objects (and the memory of the history and saved state) of
+ *             the existing object are re-used, so copying into the same object
+ *             again does not allocate.
  */
 Chess & Chess::operator =(const Chess &chess_object)
 {
-    // assign it the same number of moves as current object and then restore the
-    // member variables based on that move number (into the EXISTING object)
-    setNumMoves(chess_object.getNumMoves());
-    chessCAMO::restoreObject(*this);
+    if(this == &chess_object)
+        return *this;
+
+    copyPieces(chess_object.board, board);
+    copyPieces(chess_object.check_pieces, check_pieces);
+    flags = chess_object.flags;
+    reservoir = chess_object.reservoir;
+    turn = chess_object.turn;
+    num_moves = chess_object.num_moves;
+    halfmove_clock = chess_object.halfmove_clock;
+    history = chess_object.history;
+
+    // a copy keeps its saved states in memory (a game shown on the console or
+    // the GUI owns the object_states files), so a saved state that is in a
+    // file is saved again by the copy's next move
+    headless = true;
+    unsaved = chess_object.unsaved || !chess_object.headless;
+
+    // only the current move can be restored (makeMove() needs it), the earlier
+    // ones belong to the other object's game
+    for(auto & state : saved_states)
+        state.clear();
+
+    unsigned int current = num_moves >= 0 ? num_moves : 0;
+    if(!unsaved && current < chess_object.saved_states.size())
+    {
+        if(saved_states.size() <= current)
+            saved_states.resize(current + 1);
+        saved_states[current] = chess_object.saved_states[current];
+    }
+
+    return *this;
+}
+
+/**
+ * @brief      Move constructor - Constructs a new instance that takes the
+ *             pieces (and everything else) of another object.
+ *
+ * @param      chess_object  The object whose values will be moved (it can
+ *                           only be assigned to or destroyed afterwards)
+ */
+Chess::Chess(Chess &&chess_object) noexcept
+    : board(std::move(chess_object.board)), check_pieces(std::move(chess_object.check_pieces)),
+      flags(std::move(chess_object.flags)), reservoir(std::move(chess_object.reservoir)), turn{chess_object.turn},
+      num_moves{chess_object.num_moves}, halfmove_clock{chess_object.halfmove_clock},
+      history(std::move(chess_object.history)), headless{chess_object.headless},
+      saved_states(std::move(chess_object.saved_states)), unsaved{chess_object.unsaved},
+      listener(std::move(chess_object.listener))
+{
+    // the moved-from object must not delete the pieces it gave away
+    chess_object.board.clear();
+    chess_object.check_pieces.clear();
+}
+
+/**
+ * @brief      Move Assignment operator - swaps the values of two objects
+ *
+ * @param      chess_object  The object whose values will be moved (it gets the
+ *                           values of this object)
+ *
+ * @return     The resulting object from the assignment
+ */
+Chess & Chess::operator =(Chess &&chess_object) noexcept
+{
+    // the pieces of this object are deleted with the other one
+    board.swap(chess_object.board);
+    check_pieces.swap(chess_object.check_pieces);
+    flags.swap(chess_object.flags);
+    reservoir.swap(chess_object.reservoir);
+    std::swap(turn, chess_object.turn);
+    std::swap(num_moves, chess_object.num_moves);
+    std::swap(halfmove_clock, chess_object.halfmove_clock);
+    std::swap(history, chess_object.history);
+    std::swap(headless, chess_object.headless);
+    saved_states.swap(chess_object.saved_states);
+    std::swap(unsaved, chess_object.unsaved);
+    std::swap(listener, chess_object.listener);
 
     return *this;
 }
-// GCOV_EXCL_STOP
 
 /**
  * @brief      Places the pieces on the board at their correct starting
@@ -387,15 +574,528 @@ void Chess::boardInit()
     check_pieces[0] = new Empty(0, EMPTY, NEUTRAL);
     check_pieces[1] = new Empty(0, EMPTY, NEUTRAL);
 
+    history.reset(getNumMoves(), getHash());
+
     // printing the board and letting user know whose turn it is
     // white always starts first in chess!
-    chessCAMO::printBoard(getBoard(), getReservoir());
-    chessCAMO::printFooterMessage("'s move", *this);
+    if(!getHeadless())
+    {
+        chessCAMO::printBoard(getBoard(), getReservoir());
+        chessCAMO::printFooterMessage("'s move", *this);
+    }
 
     // serializing the object to a file for later re-use
     chessCAMO::saveObject(*this);
 }
 
+/**
+ * @brief      Places the pieces on the board according to a FEN string. The
+ *             piece placement field can be followed by the piece reservoir in
+ *             brackets.
+ *
+ * @param[in]  fen   The FEN string. The reservoir, en-passant and move counter
+ *                   fields are optional (defaults are the starting reservoir,
+ *                   '-', 0 and 1).
+ *
+ * @pre        The chess object is created
+ *
+ * @post       On success, the board, reservoir, turn, flags and move counters
+ *             describe the given position, which the next makeMove()
+ *             serializes before moving. On failure, the object is left
+ *             unchanged.
+ *
+ * @return     True if the string describes a valid position, False otherwise.
+ */
+bool Chess::setFromFEN(const char *fen)
+{
+    // parse everything into local arrays first, so that a malformed string
+    // leaves the object untouched
+    pieceType types[64];
+    pieceColor colors[64];
+    int reservoir_count[10] = {4, 2, 2, 1, 1, 4, 2, 2, 1, 1}; // same order as the reservoir vector
+    int square = 0, kings[3] = {0, 0, 0}, en_passant = -1, halfmove = 0, fullmove = 1;
+    bool castle[4] = {false, false, false, false};
+    const char castle_chars[] = "KQkq";
+    const char *c = fen;
+
+    // -------- piece placement -------- //
+    for(; *c != '\0' && *c != ' ' && *c != '['; c++)
+    {
+        // a rank separator must follow a complete rank
+        if(*c == '/')
+        {
+            if(square == 0 || square % 8 != 0 || square >= 64 || c[-1] == '/')
+                return false;
+            continue;
+        }
+
+        // a new rank must start after a separator
+        if(square >= 64 || (square > 0 && square % 8 == 0 && c[-1] != '/'))
+            return false;
+
+        // empty squares
+        if('1' <= *c && *c <= '8')
+        {
+            if(square % 8 + (*c - '0') > 8)
+                return false;
+
+            for(int i = 0; i < *c - '0'; i++, square++)
+            {
+                types[square] = EMPTY;
+                colors[square] = NEUTRAL;
+            }
+            continue;
+        }
+
+        switch(std::tolower(*c))
+        {
+            case 'p':
+                // pawns can never stand on the first or last rank
+                if(square / 8 == 0 || square / 8 == 7)
+                    return false;
+                types[square] = PAWN;
+                break;
+            case 'n':
+                types[square] = KNIGHT;
+                break;
+            case 'b':
+                types[square] = BISHOP;
+                break;
+            case 'r':
+                types[square] = ROOK;
+                break;
+            case 'q':
+                types[square] = QUEEN;
+                break;
+            case 'k':
+                types[square] = KING;
+                break;
+            default:
+                return false;
+        }
+
+        colors[square] = std::isupper(*c) ? WHITE : BLACK;
+        if(types[square] == KING)
+            kings[colors[square]]++;
+        square++;
+    }
+
+    // exactly 64 squares and one king per side are needed (the engine always looks for the kings)
+    if(square != 64 || kings[WHITE] != 1 || kings[BLACK] != 1)
+        return false;
+
+    // -------- piece reservoir (optional) -------- //
+    if(*c == '[')
+    {
+        for(int i = 0; i < 10; i++)
+            reservoir_count[i] = 0;
+
+        for(c++; *c != ']'; c++)
+        {
+            int index;
+            switch(std::tolower(*c))
+            {
+                case 'p':
+                    index = 0;
+                    break;
+                case 'n':
+                    index = 1;
+                    break;
+                case 'b':
+                case 'o':
+                    index = 2;
+                    break;
+                case 'r':
+                    index = 3;
+                    break;
+                case 'q':
+                    index = 4;
+                    break;
+                case '-':
+                    continue;
+                default:
+                    return false; // unknown piece or unterminated field
+            }
+
+            index += std::isupper(*c) ? 5 : 0; // white pieces are in the second half of the reservoir
+
+            // the serialized reservoir stores each quantity as a single digit
+            if(++reservoir_count[index] > 9)
+                return false;
+        }
+        c++;
+    }
+
+    // -------- side to move -------- //
+    while(*c == ' ') { c++; }
+    if(*c != 'w' && *c != 'b')
+        return false;
+    pieceColor side = *c == 'w' ? WHITE : BLACK;
+    c++;
+
+    // -------- castling rights -------- //
+    while(*c == ' ') { c++; }
+    if(*c == '-') { c++; }
+    else
+    {
+        for(; *c != '\0' && *c != ' '; c++)
+        {
+            const char *found = std::strchr(castle_chars, *c);
+            if(found == nullptr)
+                return false;
+            castle[found - castle_chars] = true;
+        }
+    }
+
+    // -------- en-passant square (optional) -------- //
+    while(*c == ' ') { c++; }
+    if(*c == '-') { c++; }
+    else if('a' <= *c && *c <= 'h')
+    {
+        if(c[1] != (side == WHITE ? '6' : '3'))
+            return false;
+        en_passant = (*c - 'a') + (8 - (c[1] - '0'))*8;
+        c += 2;
+    }
+
+    // -------- halfmove clock and fullmove number (optional) -------- //
+    while(*c == ' ') { c++; }
+    if(std::isdigit(*c))
+    {
+        for(halfmove = 0; std::isdigit(*c); c++)
+            halfmove = halfmove*10 + (*c - '0');
+
+        while(*c == ' ') { c++; }
+        if(std::isdigit(*c))
+        {
+            for(fullmove = 0; std::isdigit(*c); c++)
+                fullmove = fullmove*10 + (*c - '0');
+        }
+    }
+
+    while(*c == ' ') { c++; }
+    if(*c != '\0' || fullmove < 1)
+        return false;
+
+    // -------- apply the position -------- //
+    for(int i = 0; i < 64; i++)
+    {
+        placePiece(board[i], i, types[i], colors[i]);
+
+        // a pawn outside of its starting rank cannot move 2 squares anymore
+        if(types[i] == PAWN)
+            board[i]->setPieceMoveInfo(colors[i] == WHITE ? i / 8 != 6 : i / 8 != 1);
+    }
+
+    // castling rights are stored as the moved information of the king and rooks
+    // (a king or rook outside of its starting square has moved)
+    for(int i = 0; i < 64; i++)
+        if(board[i]->isKing() || board[i]->isRook())
+            board[i]->setPieceMoveInfo(true);
+
+    int corners[4] = {63, 56, 7, 0}; // K, Q, k, q
+    for(int i = 0; i < 4; i++)
+    {
+        int king_square = i < 2 ? 60 : 4;
+        pieceColor color = i < 2 ? WHITE : BLACK;
+        if( castle[i] && board[king_square]->isKing() && board[king_square]->getPieceColor() == color &&
+            board[corners[i]]->isRook() && board[corners[i]]->getPieceColor() == color )
+        {
+            board[king_square]->setPieceMoveInfo(false);
+            board[corners[i]]->setPieceMoveInfo(false);
+        }
+    }
+
+    // en-passant abilities belong to the pawns next to the one that moved 2 squares
+    if(en_passant != -1)
+    {
+        int moved_pawn = side == WHITE ? en_passant + 8 : en_passant - 8;
+        int sign = side == WHITE ? -1 : 1; // +1 if the pawn that moved 2 squares is white
+
+        if( board[moved_pawn]->isPawn() && board[moved_pawn]->getPieceColor() != side )
+        {
+            if( (moved_pawn - sign) / 8 == moved_pawn / 8 && board[moved_pawn - sign]->isPawn() && board[moved_pawn - sign]->getPieceColor() == side )
+                board[moved_pawn - sign]->setEnPassantLeft(true);
+            if( (moved_pawn + sign) / 8 == moved_pawn / 8 && board[moved_pawn + sign]->isPawn() && board[moved_pawn + sign]->getPieceColor() == side )
+                board[moved_pawn + sign]->setEnPassantRight(true);
+        }
+    }
+
+    for(int i = 0; i < 10; i++)
+        reservoir[i].first = reservoir_count[i];
+
+    setTurn(side);
+    setNumMoves(2*(fullmove - 1) + (side == BLACK));
+    setHalfmoveClock(halfmove);
+    setCheck(false);
+    setDoubleCheck(false);
+    setCheckmate(false);
+    setStalemate(false);
+
+    // check information for the side to move
+    int king_square = 0, attackers = 0;
+    for(int i = 0; i < 64; i++)
+        if(board[i]->isKing() && board[i]->getPieceColor() == side)
+            king_square = i;
+
+    for(const auto & elem : board)
+    {
+        if(elem->getPieceColor() != side && !elem->isEmpty() && elem->isPossibleMove(king_square, *this))
+        {
+            if(attackers++ == 0)
+                placePiece(check_pieces[0], elem->getPieceSquare(), elem->getPieceType(), elem->getPieceColor());
+            else
+                placePiece(check_pieces[0], king_square, KING, side);
+        }
+    }
+
+    if(attackers == 0)
+        placePiece(check_pieces[0], 0, EMPTY, NEUTRAL); // like boardInit()
+    placePiece(check_pieces[1], king_square, KING, side);
+    if(attackers == 1)
+        setCheck(true);
+    else if(attackers >= 2)
+        setDoubleCheck(true);
+
+    // the moves before the position are not known
+    history.reset(getNumMoves(), getHash());
+
+    // serialized by the next move only, so that loading positions (to search
+    // or index them) neither writes a file nor allocates a string
+    unsaved = true;
+
+    return true;
+}
+
+/**
+ * @brief      Writes the current position as a FEN string, with the piece
+ *             reservoir in brackets after the piece placement field.
+ *
+ * @param      fen   The buffer to write into (FEN_SIZE characters is always
+ *                   enough)
+ * @param[in]  size  The size of the buffer
+ *
+ * @return     The length of the written string, or -1 if the buffer is too
+ *             small.
+ */
+int Chess::toFEN(char *fen, int size) const
+{
+    const char piece_chars[] = "pnbrqk";
+    int len = 0, empty_count = 0;
+    bool ok = size > 0;
+
+    if(ok)
+        fen[0] = '\0';
+
+    // -------- piece placement -------- //
+    for(int i = 0; i < 64 && ok; i++)
+    {
+        if(board[i]->isEmpty())
+            empty_count++;
+        else
+        {
+            if(empty_count > 0)
+                ok = appendFEN(fen, size, len, '0' + empty_count);
+            empty_count = 0;
+
+            char piece = piece_chars[board[i]->getPieceType()];
+            ok = ok && appendFEN(fen, size, len, board[i]->isPieceWhite() ? std::toupper(piece) : piece);
+        }
+
+        if(i % 8 == 7)
+        {
+            if(empty_count > 0)
+                ok = ok && appendFEN(fen, size, len, '0' + empty_count);
+            empty_count = 0;
+
+            if(i != 63)
+                ok = ok && appendFEN(fen, size, len, '/');
+        }
+    }
+
+    // -------- piece reservoir -------- //
+    // white then black, from the most valuable piece to the least valuable
+    ok = ok && appendFEN(fen, size, len, '[');
+    for(int index : {9, 8, 7, 6, 5, 4, 3, 2, 1, 0})
+    {
+        char piece = std::tolower(reservoir[index].second) == 'o' ? 'b' : std::tolower(reservoir[index].second);
+        for(int i = 0; i < reservoir[index].first && ok; i++)
+            ok = appendFEN(fen, size, len, index >= 5 ? std::toupper(piece) : piece);
+    }
+    ok = ok && appendFEN(fen, size, len, ']');
+
+    // -------- side to move -------- //
+    ok = ok && appendFEN(fen, size, len, ' ');
+    ok = ok && appendFEN(fen, size, len, getTurn() == WHITE ? 'w' : 'b');
+    ok = ok && appendFEN(fen, size, len, ' ');
+
+    // -------- castling rights -------- //
+    int rights = getCastlingRights();
+    for(int i = 0; i < 4; i++)
+        if(rights & (1 << i))
+            ok = ok && appendFEN(fen, size, len, "KQkq"[i]);
+    if(rights == 0)
+        ok = ok && appendFEN(fen, size, len, '-');
+
+    // -------- en-passant square -------- //
+    int en_passant = getEnPassantSquare();
+    ok = ok && appendFEN(fen, size, len, ' ');
+    if(en_passant == -1)
+        ok = ok && appendFEN(fen, size, len, '-');
+    else
+    {
+        ok = ok && appendFEN(fen, size, len, 'a' + en_passant % 8);
+        ok = ok && appendFEN(fen, size, len, '8' - en_passant / 8);
+    }
+
+    // -------- halfmove clock and fullmove number -------- //
+    char counters[24];
+    snprintf(counters, sizeof(counters), " %d %d", getHalfmoveClock(), getNumMoves() / 2 + 1);
+    for(int i = 0; counters[i] != '\0' && ok; i++)
+        ok = appendFEN(fen, size, len, counters[i]);
+
+    return ok ? len : -1;
+}
+
+/**
+ * @see        Chess::toFEN(char *fen, int size)
+ *
+ * @return     The FEN string of the current position.
+ */
+string Chess::toFEN() const
+{
+    char fen[FEN_SIZE];
+    toFEN(fen, FEN_SIZE);
+    return string(fen);
+}
+
+/**
+ * @brief      (Accessor) Gets the castling rights of the current board
+ *             representation, based on whether the kings and rooks moved.
+ *
+ * @return     A bit mask where bits 0 to 3 correspond to the 'K', 'Q', 'k' and
+ *             'q' rights of a FEN string.
+ */
+int Chess::getCastlingRights() const
+{
+    int rights = 0, corners[4] = {63, 56, 7, 0}; // K, Q, k, q
+    for(int i = 0; i < 4; i++)
+    {
+        int king_square = i < 2 ? 60 : 4;
+        pieceColor color = i < 2 ? WHITE : BLACK;
+        if( board[king_square]->isKing() && board[king_square]->getPieceColor() == color && !board[king_square]->getPieceMoveInfo() &&
+            board[corners[i]]->isRook() && board[corners[i]]->getPieceColor() == color && !board[corners[i]]->getPieceMoveInfo() )
+        {
+            rights |= 1 << i;
+        }
+    }
+
+    return rights;
+}
+
+/**
+ * @brief      (Accessor) Gets the en-passant target square, which is the
+ *             square that a pawn of the side to move would capture into.
+ *
+ * @return     The en-passant square in [0, 63], or -1 if no pawn of the side
+ *             to move can capture en-passant.
+ */
+int Chess::getEnPassantSquare() const
+{
+    for(int i = 0; i < 64; i++)
+    {
+        if(board[i]->getPieceColor() != getTurn())
+            continue;
+
+        // pawns capture towards the opposite side of the board
+        int sign = board[i]->isPieceWhite() ? -1 : 1;
+        if(board[i]->getEnPassantLeft())
+            return i + sign*9;
+        else if(board[i]->getEnPassantRight())
+            return i + sign*7;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief      (Accessor) Gets the Zobrist hash of the current position.
+ *
+ * @return     A hash of the piece placement, turn, castling rights, en-passant
+ *             square and piece reservoir. Move counters are not part of the
+ *             hash, so that transpositions hash the same.
+ */
+uint64_t Chess::getHash() const
+{
+    uint64_t hash = 0;
+
+    for(int i = 0; i < 64; i++)
+        if(!board[i]->isEmpty())
+            hash ^= chessCAMO::zobristKey((board[i]->getPieceType()*2 + board[i]->isPieceWhite())*64 + i);
+
+    if(getTurn() == WHITE)
+        hash ^= chessCAMO::zobristKey(768);
+
+    int rights = getCastlingRights();
+    for(int i = 0; i < 4; i++)
+        if(rights & (1 << i))
+            hash ^= chessCAMO::zobristKey(769 + i);
+
+    int en_passant = getEnPassantSquare();
+    if(en_passant != -1)
+        hash ^= chessCAMO::zobristKey(773 + en_passant % 8);
+
+    for(int i = 0; i < 10; i++)
+        hash ^= chessCAMO::zobristKey(781 + i*10 + std::min(reservoir[i].first, 9));
+
+    return hash;
+}
+
+/**
+ * @brief      Makes a null move: the turn passes to the other side, and no
+ *             en-passant capture is possible (used by the engine's null move
+ *             pruning).
+ *
+ * @param[in]  hash  The hash of the position (getHash())
+ *
+ * @pre        The side to move is not in check.
+ *
+ * @post       The null move is recorded in the history as irreversible, and
+ *             the position is saved by the next makeMove().
+ *
+ * @return     The hash of the new position, updated from 'hash'.
+ */
+uint64_t Chess::makeNullMove(uint64_t hash)
+{
+    int en_passant = getEnPassantSquare();
+    if(en_passant != -1)
+        hash ^= chessCAMO::zobristKey(773 + en_passant % 8);
+    hash ^= chessCAMO::zobristKey(768);
+
+    pieceColor side = getTurn() == WHITE ? BLACK : WHITE;
+    int king_square = 0;
+    for(int i = 0; i < 64; i++)
+    {
+        board[i]->setEnPassantLeft(false);
+        board[i]->setEnPassantRight(false);
+        if(board[i]->isKing() && board[i]->getPieceColor() == side)
+            king_square = i;
+    }
+
+    // neither side is in check (like setFromFEN())
+    placePiece(check_pieces[0], 0, EMPTY, NEUTRAL);
+    placePiece(check_pieces[1], king_square, KING, side);
+
+    setTurn(side);
+    setNumMoves(getNumMoves() + 1);
+    history.record(getNumMoves(), hash, true);
+
+    // the checkpoint of the last move is not this position
+    unsaved = true;
+
+    return hash;
+}
+
 /**
  * @brief      Moves a piece on the board from 'src' to 'dest' if conditions for
  *             a legal move are met.
@@ -414,7 +1114,45 @@ void Chess::boardInit()
  * @return     True if move was made, False otherwise.
  */
 bool Chess::makeMove(int src, int dest, istream &in)
+{
+    return makeMove(src, dest, &in, '\0');
+}
+
+/**
+ * @brief      Moves a piece on the board from 'src' to 'dest' if conditions
+ *             for a legal move are met, promoting a pawn to a given piece
+ *             (without reading an input or asking the listener).
+ *
+ * @param[in]  src        The source square (piece's current location)
+ * @param[in]  dest       The destination square (piece's ending location)
+ * @param[in]  promotion  The promotion piece ('q', 'r', 'b' or 'n' in either
+ *                        case, a queen for any other value)
+ *
+ * @return     True if move was made, False otherwise.
+ */
+bool Chess::makeMove(int src, int dest, char promotion)
+{
+    return makeMove(src, dest, nullptr, promotion);
+}
+
+/**
+ * @brief      Makes a move for both versions of Chess::makeMove().
+ *
+ * @param[in]  src        The source square (piece's current location)
+ * @param[in]  dest       The destination square (piece's ending location)
+ * @param      in         The input the promotion piece is read from, or
+ *                        nullptr to use 'promotion'
+ * @param[in]  promotion  The promotion piece (if 'in' is nullptr)
+ *
+ * @return     True if move was made, False otherwise.
+ */
+bool Chess::makeMove(int src, int dest, istream *in, char promotion)
 {   
+    // a position set by setFromFEN() is saved before its first move, since
+    // the move restores it below
+    if(unsaved)
+        chessCAMO::saveObject(*this);
+
     // first check to see if reservoir is used
     // if so, there is nothing to do as everything is handled there
     // else, check regular chess functionality
@@ -426,6 +1164,18 @@ bool Chess::makeMove(int src, int dest, istream &in)
 
         chessCAMO::restoreObject(*this);
 
+        // pawn moves and captures reset the halfmove clock. Using the reservoir
+        // does not, since it cannot be used to prolong the game
+        board = getBoard();
+        if( src <= 63 && (board[src]->isPawn() || (!board[dest]->isEmpty() && !board[src]->isSameColor(dest, *this))) )
+            setHalfmoveClock(0);
+        else
+            setHalfmoveClock(getHalfmoveClock()+1);
+
+        // no earlier position can repeat after an irreversible move
+        int castling_rights = getCastlingRights();
+        bool irreversible = src > 63 || getHalfmoveClock() == 0;
+
         // make the appropriate move from 'src' to 'dest' (if not using piece reservoir)
         if(src <= 63)
             makeMoveForType(src, dest);
@@ -439,16 +1189,23 @@ bool Chess::makeMove(int src, int dest, istream &in)
         // en-passant checking/updating
         board[dest]->enPassantHandling(src, *this); 
 
-        // pawn promotion
+        // pawn promotion (to a queen if the given piece is not a promotion
+        // piece)
         if(dest/8 == 0 || dest/8 == 7)
-            board[dest]->promotePawn(*this, in);
+        {
+            if(in != nullptr)
+                board[dest]->promotePawn(*this, *in);
+            else if(!board[dest]->promotePawn(*this, promotion))
+                board[dest]->promotePawn(*this, 'q');
+        }
 
-        // did the move cause a double check?
-        if(board[src]->causeDoubleCheck(dest, *this)) 
+        // did the move cause a double check? (a reservoir piece was placed
+        // on 'dest', since 'src' is not a square)
+        if(board[src <= 63 ? src : dest]->causeDoubleCheck(dest, *this)) 
             isCheckmate("double"); // .. and for checkmate
 
         // did the move cause a check?
-        else if(board[src]->causeCheck(dest, *this)) 
+        else if(board[src <= 63 ? src : dest]->causeCheck(dest, *this)) 
             isCheckmate("single"); // .. and for checkmate
 
         // check for stalemate
@@ -461,21 +1218,42 @@ bool Chess::makeMove(int src, int dest, istream &in)
         // increment move counter by 1 since a move was made (if not used the reservoir)
         src <= 63 ? setNumMoves(getNumMoves()+1) : setNumMoves(getNumMoves());
 
+        // threefold repetition & 50 move rule
+        history.record(getNumMoves(), getHash(), irreversible || getCastlingRights() != castling_rights);
+        if(!getCheckmate() && !getStalemate())
+        {
+            if(getRepetitions() >= 2)
+                handleDraw("Threefold repetition");
+            else if(getHalfmoveClock() >= 100)
+                handleDraw("50 move rule");
+        }
+
         // save the object in the corresponding file
         chessCAMO::saveObject(*this);
 
+        if(listener.on_move)
+            listener.on_move(src, dest, true);
+
         return true;
     }
     else
     {
-        chessCAMO::printBoard(getBoard(), getReservoir());
+        if(!getHeadless())
+        {
+            chessCAMO::printBoard(getBoard(), getReservoir());
 
-        if(getDoubleCheck())
-            chessCAMO::printMessage("\nYou must move your king!\n", YELLOW);
-        else
-            chessCAMO::printMessage("\nInvalid move! Try again...\n", YELLOW);
+            if(getDoubleCheck())
+                chessCAMO::printMessage("\nYou must move your king!\n", YELLOW);
+            else
+                chessCAMO::printMessage("\nInvalid move! Try again...\n", YELLOW);
 
-        chessCAMO::printFooterMessage("'s move", *this);
+            chessCAMO::printFooterMessage("'s move", *this);
+        }
+
+        reportStatus(getDoubleCheck() ? "You must move your king!" : "Invalid move! Try again...");
+
+        if(listener.on_move)
+            listener.on_move(src, dest, false);
 
         return false;
     }
@@ -608,12 +1386,17 @@ void Chess::isCheckmate(string check_type)
     }   
     else
     {
-        chessCAMO::printBoard(getBoard(), getReservoir());
+        if(!getHeadless())
+        {
+            chessCAMO::printBoard(getBoard(), getReservoir());
 
-        if(getCheck())
-            chessCAMO::printMessage("\nCheck!\n", CYAN);
-        else
-            chessCAMO::printMessage("\nDouble Check!\n", CYAN);
+            if(getCheck())
+                chessCAMO::printMessage("\nCheck!\n", CYAN);
+            else
+                chessCAMO::printMessage("\nDouble Check!\n", CYAN);
+        }
+
+        reportStatus(getCheck() ? "Check!" : "Double Check!");
     }
 }
 
@@ -752,6 +1535,9 @@ void Chess::handleChangeTurn()
 {
     setTurn(switchTurn());
 
+    if(getHeadless())
+        return;
+
     if(!getCheck() && !getDoubleCheck())
         chessCAMO::printBoard(getBoard(), getReservoir());
 
@@ -769,8 +1555,12 @@ void Chess::handleChangeTurn()
  */
 void Chess::handleCheckmate()
 {
-    chessCAMO::printBoard(getBoard(), getReservoir());
-    chessCAMO::printFooterMessage(" won by Checkmate!\n", *this);
+    if(!getHeadless())
+    {
+        chessCAMO::printBoard(getBoard(), getReservoir());
+        chessCAMO::printFooterMessage(" won by Checkmate!\n", *this);
+    }
+    reportStatus(getTurn() == WHITE ? "White won by Checkmate!" : "Black won by Checkmate!");
     setCheckmate(true);
 }
 
@@ -782,10 +1572,34 @@ void Chess::handleCheckmate()
  */
 void Chess::handleStalemate()
 {
-    chessCAMO::printBoard(getBoard(), getReservoir());
-    chessCAMO::printFooterMessage(" won by Checkmate!\n", *this);
+    if(!getHeadless())
+    {
+        chessCAMO::printBoard(getBoard(), getReservoir());
+        chessCAMO::printFooterMessage(" won by Checkmate!\n", *this);
+    }
+    // the turn is not switched yet, so the other side has no moves
+    reportStatus(getTurn() == WHITE ? "Black has no moves -> Game is Drawn!" : "White has no moves -> Game is Drawn!");
     setStalemate(true);
 } 
+
+/**
+ * @brief      Indicates the game is drawn by threefold repetition or the 50
+ *             move rule via a message to console
+ *
+ * @param[in]  reason  The rule that drew the game
+ *
+ * @post       Object's stalemate state is set to true (to end the game).
+ */
+void Chess::handleDraw(const string &reason)
+{
+    if(!getHeadless())
+    {
+        chessCAMO::printBoard(getBoard(), getReservoir());
+        chessCAMO::printMessage("\n" + reason + " -> Game is Drawn!\n", CYAN);
+    }
+    reportStatus(reason + " -> Game is Drawn!");
+    setStalemate(true);
+}
        
 /**
  * @brief      If in a single check, see if piece can defend the king, capture
@@ -885,8 +1699,7 @@ pieceColor Chess::switchTurn() { return getTurn() == WHITE ? BLACK : WHITE; }
  */
 bool Piece::isSameColor(int dest, const Chess &chess)
 {
-
-    vector<Piece*> board = chess.getBoard();
+    const vector<Piece*> &board = chess.getBoard();
 
     // cannot use getPieceColor() here since the board might be updated
     return board[getPieceSquare()]->getPieceColor() == board[dest]->getPieceColor();
@@ -906,7 +1719,7 @@ bool Piece::isSameColor(int dest, const Chess &chess)
 bool Piece::isPinned(int dest, const Chess &chess)
 {
     int king_pos, src = getPieceSquare();
-    vector<Piece*> board = chess.getBoard();
+    const vector<Piece*> &board = chess.getBoard();
 
     if(!isKing())
     {
@@ -938,7 +1751,7 @@ bool Piece::isPinned(int dest, const Chess &chess)
 bool Piece::isPathFree(int dest, const Chess &chess)
 {
     int increment, src = getPieceSquare();
-    vector<Piece*> board = chess.getBoard();
+    const vector<Piece*> &board = chess.getBoard();
 
     // get the increment value for the path and see if the squares in (src, dest) are empty
     increment = incrementChoice(src, dest);
@@ -1129,7 +1942,7 @@ bool Piece::causeDoubleCheck(int dest, Chess &chess)
  */
 bool Pawn::isPossibleMove(int dest, const Chess &chess)
 {
-    vector<Piece*> board = chess.getBoard();
+    const vector<Piece*> &board = chess.getBoard();
 
     bool legal = false;
     int src = getPieceSquare();
@@ -1198,47 +2011,70 @@ void Pawn::enPassantHandling(int src, Chess &chess)
  */
 void Pawn::promotePawn(Chess &chess, istream &in)
 {
-    vector<Piece*> board = chess.getBoard();
-    bool white_turn = chess.getTurn() == WHITE;
-
     char piece;
-    int dest = getPieceSquare();
 
     while(true)
     {
-        chessCAMO::printMessage("Which Piece: Q/q | R/r | B/b | N/n? ", PINK);
-
-        in >> piece;
-        
-        if(std::tolower(piece) == 'q')
-        {
-            delete board[dest]; // GCOVR_EXCL_LINE
-            board[dest] = white_turn ? new Queen(dest, QUEEN, WHITE) : new Queen(dest, QUEEN, BLACK);
-            break;
-        }
-        else if(std::tolower(piece) == 'r')
-        {
-            delete board[dest]; // GCOVR_EXCL_LINE  
-            board[dest] = white_turn ? new Rook(dest, ROOK, WHITE) : new Rook(dest, ROOK, BLACK);
-            break;
-        }
-        else if(std::tolower(piece) == 'b')
-        {
-            delete board[dest]; // GCOVR_EXCL_LINE 
-            board[dest] = white_turn ? new Bishop(dest, BISHOP, WHITE) : new Bishop(dest, BISHOP, BLACK);
-            break;
-        }
-        else if(std::tolower(piece) == 'n')
-        {
-            delete board[dest]; // GCOVR_EXCL_LINE
-            board[dest] = white_turn ? new Knight(dest, KNIGHT, WHITE) : new Knight(dest, KNIGHT, BLACK);
+        if(!chess.getHeadless())
+            chessCAMO::printMessage("Which Piece: Q/q | R/r | B/b | N/n? ", PINK);
+
+        // the listener chooses the piece if it can, and an exhausted input
+        // promotes to a queen rather than asking forever
+        if(chess.getListener().on_promotion)
+            piece = chess.getListener().on_promotion();
+        else if(!(in >> piece))
+            piece = 'q';
+
+        // the pawn is deleted by a promotion, so nothing of it is used after
+        if(promotePawn(chess, piece))
             break;
-        }
-        else
+        else if(!chess.getHeadless())
             chessCAMO::printMessage("\nPick one of the choices\n", YELLOW);
     }
+}
+
+/**
+ * @see        virtual Piece::promotePawn(Chess &chess, char piece)
+ *
+ * @brief      Promotes the pawn to a given piece.
+ *
+ * @param      chess  The chess object
+ * @param[in]  piece  The piece ('q', 'r', 'b' or 'n', in either case)
+ *
+ * @return     True if the pawn was promoted, False if 'piece' is not a
+ *             promotion piece.
+ */
+bool Pawn::promotePawn(Chess &chess, char piece)
+{
+    vector<Piece*> board = chess.getBoard();
+    bool white_turn = chess.getTurn() == WHITE;
+    int dest = getPieceSquare();
+
+    if(std::tolower(piece) == 'q')
+    {
+        delete board[dest]; // GCOVR_EXCL_LINE
+        board[dest] = white_turn ? new Queen(dest, QUEEN, WHITE) : new Queen(dest, QUEEN, BLACK);
+    }
+    else if(std::tolower(piece) == 'r')
+    {
+        delete board[dest]; // GCOVR_EXCL_LINE  
+        board[dest] = white_turn ? new Rook(dest, ROOK, WHITE) : new Rook(dest, ROOK, BLACK);
+    }
+    else if(std::tolower(piece) == 'b')
+    {
+        delete board[dest]; // GCOVR_EXCL_LINE 
+        board[dest] = white_turn ? new Bishop(dest, BISHOP, WHITE) : new Bishop(dest, BISHOP, BLACK);
+    }
+    else if(std::tolower(piece) == 'n')
+    {
+        delete board[dest]; // GCOVR_EXCL_LINE
+        board[dest] = white_turn ? new Knight(dest, KNIGHT, WHITE) : new Knight(dest, KNIGHT, BLACK);
+    }
+    else
+        return false;
 
     chess.setBoard(board);
+    return true;
 }
 
 /*************************************************************************************/
@@ -1375,7 +2211,7 @@ bool King::canCastle(int dest, const Chess &chess)
     int src = getPieceSquare();
     int increment = src > dest ? -1 : 1;
 
-    vector<Piece*> board = chess.getBoard();
+    const vector<Piece*> &board = chess.getBoard();
 
     if( getPieceMoveInfo() || board[dest]->getPieceMoveInfo() || chess.getCheck() || !board[dest]->isRook() )  { return false; }
     else
@@ -1511,7 +2347,7 @@ namespace
     int squareOfPieceInPath(int src, int dest, const Chess &chess)
     {
         int increment;
-        vector<Piece*> board = chess.getBoard();
+        const vector<Piece*> &board = chess.getBoard();
         vector<int> pieces_in_path;
 
         // determine the increment along the path from 'src' to 'dest' and store
@@ -1549,8 +2385,8 @@ namespace
             return 1;
         else if(sameCol(src, dest))     // column path
             return 8;
-        else if(sameDiag(src, dest))    // diagonal path
-            return std::abs(src - dest) % 7 == 0 ? 7 : 9;
+        else if(sameDiag(src, dest))    // diagonal path (a8-h1 is 63 squares, a multiple of both 7 and 9)
+            return (src < dest) == (src % 8 < dest % 8) ? 9 : 7;
         else                            // knight / impossible path
             return 0;
     }
@@ -1590,13 +2426,117 @@ namespace
     string getPath(int num_moves)
     {
         const unsigned long maxDir = 260;
-        char currentDir[maxDir];
+        char currentDir[maxDir] = "";
+#ifdef _WIN32
         GetCurrentDirectory(maxDir, currentDir);
+#else
+        if(!getcwd(currentDir, maxDir))
+            currentDir[0] = '\0';
+#endif
 
         return string(currentDir).find("GUI") != string::npos ? "object_states/move" + to_string(num_moves) + ".txt" 
                                                               : "GUI/object_states/move" + to_string(num_moves) + ".txt"; 
     }
     // GCOVR_EXCL_STOP
+
+    /**
+     * @brief      Places a piece of the given type and color in a board slot,
+     *             re-using the existing piece object if it is of the same type.
+     *
+     * @param      slot    The board (or check pieces) slot to fill
+     * @param[in]  square  The square of the piece
+     * @param[in]  type    The type of the piece
+     * @param[in]  color   The color of the piece
+     *
+     * @post       'slot' points to a piece with the given information, with its
+     *             moved and en-passant information cleared.
+     */
+    void placePiece(Piece *&slot, int square, pieceType type, pieceColor color)
+    {
+        if(slot == nullptr || slot->getPieceType() != type)
+        {
+            delete slot; // GCOVR_EXCL_LINE
+            switch(type)
+            {
+                case PAWN:
+                    slot = new Pawn(square, PAWN, color);
+                    break;
+                case KNIGHT:
+                    slot = new Knight(square, KNIGHT, color);
+                    break;
+                case BISHOP:
+                    slot = new Bishop(square, BISHOP, color);
+                    break;
+                case ROOK:
+                    slot = new Rook(square, ROOK, color);
+                    break;
+                case QUEEN:
+                    slot = new Queen(square, QUEEN, color);
+                    break;
+                case KING:
+                    slot = new King(square, KING, color);
+                    break;
+                default:
+                    slot = new Empty(square, EMPTY, NEUTRAL);
+            }
+        }
+
+        slot->setPieceSquare(square);
+        slot->setPieceColor(color);
+        slot->setPieceMoveInfo(false);
+        slot->setEnPassantLeft(false);
+        slot->setEnPassantRight(false);
+    }
+
+    /**
+     * @brief      Appends a character to a FEN buffer if there is room for it
+     *             (and the null terminator).
+     *
+     * @param      fen   The FEN buffer
+     * @param[in]  size  The size of the buffer
+     * @param      len   The current length of the string (updated by reference)
+     * @param[in]  c     The character to append
+     *
+     * @return     True if the character was appended, False otherwise.
+     */
+    bool appendFEN(char *fen, int size, int &len, char c)
+    {
+        if(len + 1 >= size)
+            return false;
+
+        fen[len++] = c;
+        fen[len] = '\0';
+        return true;
+    }
+
+    /**
+     * @brief      Copies the pieces of a board (or check pieces) to another one,
+     *             re-using the piece objects of the same type.
+     *
+     * @param[in]  from  The pieces to copy
+     * @param      to    The pieces to overwrite (resized to the size of 'from')
+     */
+    void copyPieces(const vector<Piece*> &from, vector<Piece*> &to)
+    {
+        for(size_t i = from.size(); i < to.size(); i++)
+            delete to[i]; // GCOVR_EXCL_LINE
+        to.resize(from.size(), nullptr);
+
+        for(size_t i = 0; i < from.size(); i++)
+        {
+            if(from[i] == nullptr)
+            {
+                delete to[i]; // GCOVR_EXCL_LINE
+                to[i] = nullptr;
+                continue;
+            }
+
+            placePiece(to[i], from[i]->getPieceSquare(), from[i]->getPieceType(), from[i]->getPieceColor());
+            to[i]->setPieceMoveInfo(from[i]->getPieceMoveInfo());
+            to[i]->setEnPassantLeft(from[i]->getEnPassantLeft());
+            to[i]->setEnPassantRight(from[i]->getEnPassantRight());
+        }
+    }
 } // unnamed namespace
 
 /*************************************************************************************/
@@ -1731,19 +2671,25 @@ namespace chessCAMO
      */
     void drawOrResign(bool clear_screen, Chess &chess, istream &in)
     {
-        char user_input, draw_reply;
+        char user_input = '\0', draw_reply = '\0';
         string message;
+        bool print = !chess.getHeadless();
 
-        chessCAMO::printMessage("\nContinue? [y -> yes, r -> resign, d -> offer draw, u -> undo move] ", PINK);
+        if(print) { chessCAMO::printMessage("\nContinue? [y -> yes, r -> resign, d -> offer draw, u -> undo move] ", PINK); }
         in >> user_input;
         in.ignore(100, '\n'); // ignore rest of the previous input (if invalid input was entered)
 
-        // error check
+        // error check (an exhausted input continues the game)
         while( std::tolower(user_input) != 'y' && std::tolower(user_input) != 'd' &&
                std::tolower(user_input) != 'r' && std::tolower(user_input) != 'u' )
         {
-            chessCAMO::printMessage("Pick one of the choices... try again!", YELLOW);
-            chessCAMO::printMessage("\nContinue? [y -> yes, r -> resign, d -> offer draw, u -> undo move] ", PINK);
+            if(!in) { return; }
+
+            if(print)
+            {
+                chessCAMO::printMessage("Pick one of the choices... try again!", YELLOW);
+                chessCAMO::printMessage("\nContinue? [y -> yes, r -> resign, d -> offer draw, u -> undo move] ", PINK);
+            }
 
             in >> user_input; // get new input
             in.ignore(100, '\n'); // ignore rest of the previous input (if invalid input was entered)
@@ -1751,42 +2697,62 @@ namespace chessCAMO
 
         if(std::tolower(user_input) == 'r')
         {
-            chessCAMO::clearScreen(clear_screen);
-            chessCAMO::printBoard(chess.getBoard(), chess.getReservoir());
-            message = chess.getTurn() == WHITE ? "\nWhite resigned => Black wins\n" 
-                                               : "\nBlack resigned => White wins\n";
-            chessCAMO::printMessage(message, CYAN);
+            if(print)
+            {
+                chessCAMO::clearScreen(clear_screen);
+                chessCAMO::printBoard(chess.getBoard(), chess.getReservoir());
+                message = chess.getTurn() == WHITE ? "\nWhite resigned => Black wins\n" 
+                                                   : "\nBlack resigned => White wins\n";
+                chessCAMO::printMessage(message, CYAN);
+            }
+            chess.reportStatus(chess.getTurn() == WHITE ? "White resigned => Black wins" : "Black resigned => White wins");
             chess.setCheckmate(true); // to end the game
         }
         else if(std::tolower(user_input) == 'd')
         {
-            chessCAMO::clearScreen(clear_screen);
-            chessCAMO::printBoard(chess.getBoard(), chess.getReservoir());
-            chessCAMO::printMessage("\nOffered draw... do you accept? [y -> yes, n -> no] ", PINK);
+            if(print)
+            {
+                chessCAMO::clearScreen(clear_screen);
+                chessCAMO::printBoard(chess.getBoard(), chess.getReservoir());
+                chessCAMO::printMessage("\nOffered draw... do you accept? [y -> yes, n -> no] ", PINK);
+            }
             in >> draw_reply;
             in.ignore(100, '\n'); // ignore rest of the previous input
 
-            // error check
+            // error check (an exhausted input rejects the draw)
             while(std::tolower(draw_reply) != 'y' && std::tolower(draw_reply) != 'n')
             {
-                chessCAMO::printMessage("Pick one of the choices... try again! ", YELLOW);
-                chessCAMO::printMessage("\nOffered draw... do you accept? [y -> yes, n -> no] ", PINK);
+                if(!in) { draw_reply = 'n'; break; }
+
+                if(print)
+                {
+                    chessCAMO::printMessage("Pick one of the choices... try again! ", YELLOW);
+                    chessCAMO::printMessage("\nOffered draw... do you accept? [y -> yes, n -> no] ", PINK);
+                }
                 in >> draw_reply; // get new input
                 in.ignore(100, '\n'); // ignore rest of the previous input
             }
 
-            chessCAMO::clearScreen(clear_screen);
-            chessCAMO::printBoard(chess.getBoard(), chess.getReservoir());
+            if(print)
+            {
+                chessCAMO::clearScreen(clear_screen);
+                chessCAMO::printBoard(chess.getBoard(), chess.getReservoir());
+            }
 
             if(std::tolower(draw_reply) == 'y')
             {
-                chessCAMO::printMessage("\nGame drawn by agreement", CYAN);
+                if(print) { chessCAMO::printMessage("\nGame drawn by agreement", CYAN); }
+                chess.reportStatus("Game drawn by agreement");
                 chess.setCheckmate(true); // to end the game
             }
             else // std::tolower(draw_reply) == 'n'
             {
-                chessCAMO::printMessage("\nDraw rejected. Game continues...\n", CYAN);
-                chessCAMO::printFooterMessage("'s move", chess);
+                if(print)
+                {
+                    chessCAMO::printMessage("\nDraw rejected. Game continues...\n", CYAN);
+                    chessCAMO::printFooterMessage("'s move", chess);
+                }
+                chess.reportStatus("Draw rejected. Game continues...");
             }
         }
         else if(std::tolower(user_input) == 'u')
@@ -1798,9 +2764,12 @@ namespace chessCAMO
             chessCAMO::restoreObject(chess);
 
             // re-print board and display move information
-            chessCAMO::clearScreen(clear_screen);
-            chessCAMO::printBoard(chess.getBoard(), chess.getReservoir());
-            chessCAMO::printFooterMessage("'s move", chess);
+            if(print)
+            {
+                chessCAMO::clearScreen(clear_screen);
+                chessCAMO::printBoard(chess.getBoard(), chess.getReservoir());
+                chessCAMO::printFooterMessage("'s move", chess);
+            }
         }
         else { return ; } // do nothing, player wants to continue
     }
@@ -1829,9 +2798,15 @@ namespace chessCAMO
      */
     void printMessage(string text, int color)
     {
+#ifdef _WIN32
         SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), color);
         cout << text;
         SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), DEFAULT);
+#else
+        // the colors are attributes of the Windows console
+        (void) color;
+        cout << text;
+#endif
     }
 
     /**
@@ -1842,6 +2817,19 @@ namespace chessCAMO
      */
     void saveObject(const Chess &chess_object)
     {
+        chess_object.unsaved = false;
+
+        if(chess_object.getHeadless())
+        {
+            ostringstream out;
+            out << chess_object;
+
+            if(chess_object.saved_states.size() <= (unsigned int) chess_object.getNumMoves())
+                chess_object.saved_states.resize(chess_object.getNumMoves() + 1);
+            chess_object.saved_states[chess_object.getNumMoves()] = out.str();
+            return;
+        }
+
         string filename = getPath(chess_object.getNumMoves());
         ofstream out(filename, ios::trunc);
         out << chess_object;
@@ -1858,14 +2846,45 @@ namespace chessCAMO
     void restoreObject(Chess &chess_object)
     {
         // only undo if a move was made
-        if(chess_object.getNumMoves() >= 0)
+        if(chess_object.getNumMoves() >= 0 && chess_object.getHeadless())
+        {
+            // nothing to restore if this move was never saved
+            if((unsigned int) chess_object.getNumMoves() < chess_object.saved_states.size() &&
+               !chess_object.saved_states[chess_object.getNumMoves()].empty())
+            {
+                istringstream in(chess_object.saved_states[chess_object.getNumMoves()]);
+                in >> chess_object;
+                chess_object.unsaved = false;
+            }
+        }
+        else if(chess_object.getNumMoves() >= 0)
         {
             string filename = getPath(chess_object.getNumMoves());
             ifstream in(filename);
             in >> chess_object;
             in.close(); 
+            chess_object.unsaved = false;
         }
         // if undo was asked multiple times after 0, set number of moves to 0 and do nothing
         else { chess_object.setNumMoves(0); }
     }
+
+    /**
+     * @brief      Gets the random key of a position feature, used to build the
+     *             Zobrist hash of a position (Chess::getHash()).
+     *
+     * @param[in]  index  The feature index (see chess.h for the layout)
+     *
+     * @return     The key, which is the same on every platform and run.
+     *
+     * @note       The keys come from the splitmix64 generator, so no table
+     *             needs to be initialized (or shared) before use.
+     */
+    uint64_t zobristKey(int index)
+    {
+        uint64_t key = (uint64_t) (index + 1) * 0x9E3779B97F4A7C15ULL;
+        key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+        return key ^ (key >> 31);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,242 @@
+/**
+ * \page datagen Self-Play Training Data Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;datagen.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;selfplay.h, match.h, game_store.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Generates and reads the training data of evaluation networks.
+ *
+ * Simply run <b>mingw32-make all_datagen</b> on a Windows machine and then:
+ * - <b>datagen generate samples.bin [options]</b> to write the samples of
+ *   self-play games, where the options are:
+ *   - <b>--games N</b>: the number of games (1000);
+ *   - <b>--threads N</b>: the number of threads (all cores);
+ *   - <b>--depth N</b>: the search depth of the engine (1);
+ *   - <b>--random-plies N</b>: the random moves at the start of each game (8);
+ *   - <b>--seed N</b>: the seed of the random moves (1);
+ *   - <b>--max-plies N</b>: games are drawn after N plies (300);
+ *   - <b>--buffer N</b>: the samples each thread keeps before writing them
+ *     (32768);
+ * - <b>datagen read samples.bin [--epochs N] [--batch N] [--print N]</b> to
+ *   stream the samples in order and shuffled N times (3), in batches of N
+ *   samples (16384), and print the first N samples (0).
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "selfplay.h"
+
+// included in 'selfplay.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Plays the self-play games and prints their throughput.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the samples were written, 1 otherwise.
+     */
+    int generateCommand(int argc, char *argv[]);
+
+    /**
+     * @brief      Streams the samples of a file and prints the throughput.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the samples were read, 1 otherwise.
+     */
+    int readCommand(int argc, char *argv[]);
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+}
+
+/**
+ * @brief      Generates or reads training data depending on the first
+ *             argument.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if program exited successfully
+ */
+int main(int argc, char *argv[])
+{
+    if(argc >= 3 && strcmp(argv[1], "generate") == 0)
+        return generateCommand(argc, argv);
+    else if(argc >= 3 && strcmp(argv[1], "read") == 0)
+        return readCommand(argc, argv);
+    else
+        return usage();
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Plays the self-play games and prints their throughput.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the samples were written, 1 otherwise.
+     */
+    int generateCommand(int argc, char *argv[])
+    {
+        SelfPlayConfig config;
+
+        for(int i = 3; i < argc; i++)
+        {
+            if(i + 1 >= argc)
+                return usage();
+            else if(strcmp(argv[i], "--games") == 0)
+                config.games = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--threads") == 0)
+                config.threads = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--depth") == 0)
+                config.engine.depth = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--random-plies") == 0)
+                config.random_plies = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--seed") == 0)
+                config.seed = strtoul(argv[++i], nullptr, 10);
+            else if(strcmp(argv[i], "--max-plies") == 0)
+                config.adjudication.max_plies = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--buffer") == 0)
+                config.buffer_samples = strtoull(argv[++i], nullptr, 10);
+            else
+                return usage();
+        }
+
+        SelfPlayStats stats;
+        if(config.games <= 0 || config.buffer_samples == 0 || !generateSamples(argv[2], config, stats))
+        {
+            printf("Could not write the samples to '%s'\n", argv[2]);
+            return 1;
+        }
+
+        double per_second = stats.seconds > 0 ? stats.samples / stats.seconds : 0;
+        printf("Games:     %llu (+%llu =%llu -%llu for white)\n", (unsigned long long) stats.games,
+               (unsigned long long) stats.white_wins, (unsigned long long) stats.draws, (unsigned long long) stats.black_wins);
+        printf("Samples:   %llu (%.1f per game, %.1f MB)\n", (unsigned long long) stats.samples,
+               stats.games > 0 ? (double) stats.samples / stats.games : 0.0, stats.samples * sizeof(TrainingSample) / 1e6);
+        printf("Time:      %.2f s, %.0f nodes/s\n", stats.seconds, stats.seconds > 0 ? stats.nodes / stats.seconds : 0.0);
+        printf("Samples/s: %.0f (%.0f per core, %d threads)\n", per_second, per_second / stats.threads, stats.threads);
+        return 0;
+    }
+
+    /**
+     * @brief      Streams the samples of a file and prints the throughput.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the samples were read, 1 otherwise.
+     */
+    int readCommand(int argc, char *argv[])
+    {
+        int epochs = 3, printed = 0;
+        size_t batch = 16384;
+
+        for(int i = 3; i < argc; i++)
+        {
+            if(i + 1 >= argc)
+                return usage();
+            else if(strcmp(argv[i], "--epochs") == 0)
+                epochs = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--batch") == 0)
+                batch = strtoull(argv[++i], nullptr, 10);
+            else if(strcmp(argv[i], "--print") == 0)
+                printed = atoi(argv[++i]);
+            else
+                return usage();
+        }
+
+        SampleReader reader;
+        if(!reader.open(argv[2]) || batch == 0)
+        {
+            printf("'%s' is not a training data file\n", argv[2]);
+            return 1;
+        }
+
+        printf("Samples:   %llu (%.1f MB)\n", (unsigned long long) reader.getNumSamples(),
+               reader.getNumSamples() * sizeof(TrainingSample) / 1e6);
+
+        const char *results[] = {"loss", "draw", "win"};
+        for(int i = 0; i < printed && (uint64_t) i < reader.getNumSamples(); i++)
+        {
+            const TrainingSample &sample = reader.getSamples()[i];
+            PackedPosition position;
+            char fen[FEN_SIZE];
+
+            unpackSample(sample, position);
+            unpackPosition(position, fen, sizeof(fen));
+            printf("%-90s %6d %s\n", fen, sample.score, results[min(2, sample.flags >> 5)]);
+        }
+
+        // the checksum keeps the copies from being optimized away
+        vector<TrainingSample> samples(batch);
+        for(int shuffle = 0; shuffle < 2; shuffle++)
+        {
+            int64_t checksum = 0;
+            uint64_t streamed = 0;
+            auto start = chrono::steady_clock::now();
+
+            for(int epoch = 0; epoch < epochs; epoch++)
+            {
+                reader.rewind(shuffle, epoch + 1);
+                for(size_t count = reader.read(samples.data(), batch); count > 0; count = reader.read(samples.data(), batch))
+                {
+                    streamed += count;
+                    checksum += samples[0].score + samples[count - 1].score;
+                }
+            }
+
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            printf("%-10s %llu samples in %.3f s: %.0f samples/s, %.2f GB/s  (checksum %lld)\n", shuffle ? "Shuffled:" : "In order:",
+                   (unsigned long long) streamed, seconds, seconds > 0 ? streamed / seconds : 0.0,
+                   seconds > 0 ? streamed * sizeof(TrainingSample) / seconds / 1e9 : 0.0, (long long) checksum);
+        }
+
+        return 0;
+    }
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage:\n"
+               "  datagen generate <file> [--games N] [--threads N] [--depth N] [--random-plies N] [--seed N]\n"
+               "                          [--max-plies N] [--buffer N]\n"
+               "  datagen read <file> [--epochs N] [--batch N] [--print N]\n");
+        return 1;
+    }
+}
@@ -0,0 +1,899 @@
+/**
+ * \page engine Engine Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;engine.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;engine.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Move generation, evaluation and the alpha-beta search of the engine (see
+ * engine.h).
+ */
+
+#include "engine.h"
+#include "mcts.h"
+#include "tablebase.h"
+#include "book.h"
+#include "nnue.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// included in 'engine.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Converts a reservoir character into its piece type.
+     *
+     * @param[in]  piece  The reservoir character (p, n, o, r or q in any case)
+     *
+     * @return     The piece type ('o' is a bishop).
+     */
+    pieceType reservoirType(char piece);
+
+    /**
+     * @brief      Orders the moves so that the search tries the most promising
+     *             ones first: captures (most valuable victim, least valuable
+     *             attacker), promotions, other moves and then reservoir moves.
+     *
+     * @param[in]  board   The board of the position
+     * @param      moves   The moves (sorted in place)
+     * @param[in]  config  The settings of the engine (for the piece values)
+     */
+    void orderMoves(const vector<Piece*> &board, vector<Move> &moves, const EngineConfig &config);
+} // unnamed namespace (makes these functions local to this implementation file)
+
+/*************************************************************************************/
+/*                              ENGINE CLASS - MEMBER FUNCTIONS                      */
+/*************************************************************************************/
+/**
+ * @brief      Default constructor - Constructs a new instance with the default
+ *             settings.
+ */
+Engine::Engine()
+    : nodes{0}, stop{nullptr}, aborted{false}, root_ply{0}, book{nullptr}, network{nullptr}
+{
+    buildReductions();
+}
+
+/**
+ * @brief      Constructs a new instance.
+ *
+ * @param[in]  config  The settings of the engine
+ */
+Engine::Engine(const EngineConfig &config)
+    : config(config), nodes{0}, stop{nullptr}, aborted{false}, root_ply{0}, book{nullptr}, network{nullptr}
+{
+    buildReductions();
+}
+
+/**
+ * @brief      Move constructor.
+ *
+ * @param      other  The engine to move
+ */
+Engine::Engine(Engine &&other) = default;
+
+/**
+ * @brief      Destroys the object.
+ */
+Engine::~Engine() = default;
+
+/**
+ * @brief      (Mutator) Sets the settings of the engine.
+ *
+ * @param[in]  config  The settings
+ */
+void Engine::setConfig(const EngineConfig &config)
+{
+    this->config = config;
+    buildReductions();
+}
+
+/**
+ * @brief      (Accessor) Gets the depth reduction of a late move (see
+ *             EngineConfig::late_move_reductions).
+ *
+ * @param[in]  depth        The remaining depth (in plies)
+ * @param[in]  move_number  The number of the move in the position (1 for the
+ *                          first one searched)
+ * @param[in]  reservoir    True for a reservoir move, False otherwise
+ *
+ * @return     The reduction (in plies), 0 if the move is not reduced.
+ */
+int Engine::getReduction(int depth, int move_number, bool reservoir) const
+{
+    // the board moves are reduced after the first 'lmr_moves', the reservoir
+    // moves from the first one on (and by more)
+    if(!reservoir && move_number <= config.lmr_moves)
+        return 0;
+
+    int reduction = reductions[min(max(depth, 0), MAX_REDUCTION_INDEX - 1)][min(max(move_number, 0), MAX_REDUCTION_INDEX - 1)];
+    if(reservoir)
+        reduction += config.reservoir_reduction;
+
+    // at least the ply of the move itself is searched
+    return max(0, min(reduction, depth - 1));
+}
+
+/**
+ * @brief      Evaluates a position without searching.
+ *
+ * @param[in]  chess  The chess object
+ *
+ * @return     The score of the position (in centipawns) for the side to move.
+ */
+int Engine::evaluate(const Chess &chess) const
+{
+    if(network != nullptr)
+        return network->evaluate(chess);
+
+    int score = 0; // for white
+
+    for(const auto & elem : chess.getBoard())
+    {
+        pieceType type = elem->getPieceType();
+        if(type == EMPTY || type == KING)
+            continue;
+
+        // 0 in the four center squares, up to 6 in the corners
+        int file = elem->getPieceSquare() % 8, rank = elem->getPieceSquare() / 8;
+        int distance = max(3 - file, file - 4) + max(3 - rank, rank - 4);
+
+        int value = config.material[type];
+        if(type == PAWN || type == KNIGHT || type == BISHOP)
+            value += (6 - distance) * config.center_bonus;
+
+        score += elem->getPieceColor() == WHITE ? value : -value;
+    }
+
+    for(const auto & elem : chess.getReservoir())
+    {
+        int value = elem.first * config.material[reservoirType(elem.second)] * config.reservoir_percent / 100;
+        score += std::isupper(elem.second) ? value : -value;
+    }
+
+    return chess.getTurn() == WHITE ? score : -score;
+}
+
+/**
+ * @brief      Searches for the best move of a position.
+ *
+ * @param[in]  chess  The chess object (it is not changed)
+ * @param      score  The score of the best move (in centipawns) for the side
+ *                    to move
+ *
+ * @return     The best move (or a move of the opening book, scored by
+ *             Engine::evaluate()), or a move with 'src' = -1 if the side to
+ *             move has no legal move (or the game is over).
+ */
+Move Engine::search(const Chess &chess, int &score)
+{
+    Move best = {-1, -1, '\0'};
+
+    // the seed is mixed with the position (splitmix64), so one seed varies
+    // the book moves of every position, and is never 0 (the heaviest move)
+    uint64_t random = 0;
+    if(config.book_seed != 0)
+    {
+        random = config.book_seed ^ chess.getHash();
+        random = (random ^ (random >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        random = (random ^ (random >> 27)) * 0x94D049BB133111EBULL;
+        random = (random ^ (random >> 31)) | 1;
+    }
+
+    if(book != nullptr && book->choose(chess, random, best))
+    {
+        score = evaluate(chess);
+        return best;
+    }
+
+    if(config.search == SEARCH_MCTS)
+        return searchMcts(chess, 1, score);
+
+    score = setRoot(chess) ? searchRoot(config.depth, best) : 0;
+    return best;
+}
+
+/**
+ * @brief      Searches a position to increasing depths (iterative deepening),
+ *             until 'max_depth' is reached, a checkmate is found or 'stop' is
+ *             set.
+ *
+ * @param[in]  chess      The chess object (it is not changed)
+ * @param[in]  max_depth  The maximum depth (in plies)
+ * @param[in]  stop       Set (ex. by another thread) to stop the search as
+ *                        soon as possible
+ * @param[in]  on_depth   Called after every depth that was searched completely
+ *
+ * @return     The best move of the deepest complete search, or a move with
+ *             'src' = -1 if there is none.
+ */
+Move Engine::analyze(const Chess &chess, int max_depth, const atomic<bool> &stop,
+                     const function<void(const SearchInfo &)> &on_depth)
+{
+    Move best = {-1, -1, '\0'};
+
+    if(config.search == SEARCH_MCTS)
+    {
+        int score;
+        this->stop = &stop;
+        best = searchMcts(chess, max_depth, score, on_depth);
+        this->stop = nullptr;
+        return best;
+    }
+
+    if(!setRoot(chess))
+        return best;
+
+    this->stop = &stop;
+
+    for(int depth = 1; depth <= max_depth && !stop; depth++)
+    {
+        Move move = {-1, -1, '\0'};
+        int score = searchRoot(depth, move);
+
+        // an incomplete search may have missed the best move
+        if(aborted)
+            break;
+
+        best = move;
+
+        if(on_depth)
+        {
+            SearchInfo info;
+            info.depth = depth;
+            info.score = score;
+            info.nodes = nodes;
+            info.pv = lines[0];
+            on_depth(info);
+        }
+
+        // a deeper search cannot find a shorter checkmate
+        if(best.src == -1 || std::abs(score) >= MATE_SCORE - depth)
+            break;
+    }
+
+    this->stop = nullptr;
+    aborted = false;
+
+    return best;
+}
+
+/**
+ * @brief      Searches a position with Monte Carlo tree search, reusing the
+ *             tree of the last search if the position follows from it.
+ *
+ * @param[in]  chess     The chess object (it is not changed)
+ * @param[in]  rounds    The number of rounds of EngineConfig::playouts
+ *                       playouts
+ * @param      score     The score of the best move (in centipawns) for the
+ *                       side to move
+ * @param[in]  on_depth  Called after every round (with the round as the depth)
+ *
+ * @return     The best move, or a move with 'src' = -1 if there is none.
+ */
+Move Engine::searchMcts(const Chess &chess, int rounds, int &score,
+                        const function<void(const SearchInfo &)> &on_depth)
+{
+    Move best = {-1, -1, '\0'};
+    score = 0;
+
+    if(chess.getCheckmate() || chess.getStalemate())
+        return best;
+
+    if(tree == nullptr)
+        tree.reset(new MctsTree(config));
+    else
+        tree->setConfig(config);
+
+    tree->setRoot(chess);
+
+    for(int round = 1; round <= rounds && (stop == nullptr || !*stop); round++)
+    {
+        nodes += tree->run(config.playouts, stop);
+
+        SearchInfo info;
+        best = tree->best(score, on_depth ? &info.pv : nullptr);
+        if(best.src == -1)
+            break;
+
+        if(on_depth)
+        {
+            info.depth = round;
+            info.score = score;
+            info.nodes = nodes;
+            on_depth(info);
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief      Sets up the root of a search (positions[0]) from a position.
+ *
+ * @param[in]  chess  The chess object
+ *
+ * @return     True if the position can be searched, False if the game is over
+ *             or the position is invalid.
+ */
+bool Engine::setRoot(const Chess &chess)
+{
+    if(chess.getCheckmate() || chess.getStalemate())
+        return false;
+
+    // the root is copied through its FEN, since the caller's object may print
+    // or save its states to files (the positions of the search are copies of it)
+    char fen[FEN_SIZE];
+    chess.toFEN(fen, FEN_SIZE);
+
+    // the positions of the game, for the repetitions in the search
+    history = chess.getHistory();
+    root_ply = chess.getNumMoves();
+
+    if(positions.empty())
+    {
+        positions.emplace_back(new Chess);
+        positions.back()->setHeadless(true);
+    }
+
+    if(!positions[0]->setFromFEN(fen))
+        return false;
+
+    // the accumulators of the other plies are updated from this one
+    if(network != nullptr)
+    {
+        accumulators.resize(max(accumulators.size(), positions.size()));
+        network->refresh(*positions[0], accumulators[0]);
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Searches the root (positions[0]) to a given depth.
+ *
+ * @param[in]  depth  The depth (in plies)
+ * @param      best   The best move ('src' = -1 if there is none)
+ *
+ * @return     The score of the best move for the side to move.
+ */
+int Engine::searchRoot(int depth, Move &best)
+{
+    Chess &root = *positions[0];
+    int alpha = -MATE_SCORE - 1;
+
+    aborted = false;
+    nodes++;
+
+    if(lines.size() < 2)
+        lines.resize(2);
+    lines[0].clear();
+
+    vector<Move> moves = legalMoves(root, config.reservoir_moves);
+    orderMoves(root.getBoard(), moves, config);
+
+    for(const auto & move : moves)
+    {
+        Chess *child = makeChild(move, 0);
+        if(child == nullptr)
+            continue;
+
+        lines[1].clear();
+
+        int value;
+        if(child->getCheckmate())
+            value = MATE_SCORE - 1;
+        else if(child->getStalemate() || history.repetitions(root_ply + 1) > 0)
+            value = 0;
+        else
+            value = -negamax(*child, depth - 1, -MATE_SCORE - 1, -alpha, 1);
+
+        if(aborted)
+            break;
+
+        if(value > alpha)
+        {
+            alpha = value;
+            best = move;
+
+            lines[0].assign(1, move);
+            lines[0].insert(lines[0].end(), lines[1].begin(), lines[1].end());
+        }
+    }
+
+    return best.src == -1 ? 0 : alpha;
+}
+
+/**
+ * @brief      The negamax (alpha-beta) search of a position.
+ *
+ * @param      chess  The position (positions[ply], or the root)
+ * @param[in]  depth  The remaining depth (in plies)
+ * @param[in]  alpha  The lower bound of the score
+ * @param[in]  beta   The upper bound of the score
+ * @param[in]  ply    The distance from the root (in plies)
+ *
+ * @return     The score of the position for the side to move.
+ */
+int Engine::negamax(Chess &chess, int depth, int alpha, int beta, int ply, bool null)
+{
+    nodes++;
+
+    if(stop != nullptr && stop->load(memory_order_relaxed))
+    {
+        aborted = true;
+        return 0;
+    }
+
+    if(lines.size() <= (unsigned int) ply + 1)
+        lines.resize(ply + 2);
+    lines[ply].clear();
+
+    // an endgame of a table has its exact score (a checkmate is counted from
+    // the root, like the ones the search finds)
+    TablebaseProbe probe;
+    for(const auto & elem : tablebases)
+    {
+        if(elem->probe(chess, probe))
+        {
+            if(probe.wdl == TB_DRAW)
+                return 0;
+            return probe.wdl == TB_WIN ? MATE_SCORE - ply - probe.dtm : -(MATE_SCORE - ply - probe.dtm);
+        }
+    }
+
+    if(depth <= 0)
+        return evaluateNode(chess, ply);
+
+    // the pruning trusts the evaluation, which means nothing in check or when
+    // a checkmate is in sight ('alpha' is a checkmate score only if 'beta' is)
+    bool in_check = chess.getCheck() || chess.getDoubleCheck();
+    bool prune = !in_check && std::abs(beta) < MATE_BOUND;
+    int static_eval = prune ? evaluateNode(chess, ply) : 0;
+
+    // reverse futility pruning: far above 'beta', the opponent will not allow
+    // this position
+    if(prune && config.reverse_futility && depth <= 3 && static_eval - config.reverse_futility_margin * depth >= beta)
+        return static_eval - config.reverse_futility_margin * depth;
+
+    // razoring: far below 'alpha', a shallower search is enough to confirm it
+    if(prune && config.razoring && depth <= 2 && static_eval + config.razor_margin * depth <= alpha)
+    {
+        if(--depth == 0)
+            return static_eval;
+    }
+
+    // null move pruning: the side to move passes, and if the opponent still
+    // cannot reach 'beta' the position is cut. A side without pieces (other
+    // than the king and pawns) on the board is likely in zugzwang, and one
+    // with few of them (and an empty reservoir, whose drops are moves that
+    // change little) is verified
+    int material = 0, reservoir_pieces = 0;
+    if(prune && config.null_move && null && depth >= 3 && static_eval >= beta)
+    {
+        for(const auto & elem : chess.getBoard())
+            if(elem->getPieceColor() == chess.getTurn() && !elem->isPawn() && !elem->isKing())
+                material += config.material[elem->getPieceType()];
+        for(const auto & elem : chess.getReservoir())
+            if((std::isupper(elem.second) != 0) == (chess.getTurn() == WHITE))
+                reservoir_pieces += elem.first;
+    }
+
+    if(material > 0)
+    {
+        Chess *child = makeNullChild(ply);
+        int reduced = max(depth - 1 - config.null_move_reduction, 0);
+        int value = -negamax(*child, reduced, -beta, -beta + 1, ply + 1, false);
+        if(aborted)
+            return 0;
+
+        if(value >= beta)
+        {
+            if(material >= config.null_move_verify || reservoir_pieces > 0)
+                return beta;
+
+            value = negamax(chess, depth - 1, beta - 1, beta, ply, false);
+            if(aborted)
+                return 0;
+            if(value >= beta)
+                return beta;
+        }
+    }
+
+    vector<Move> moves = legalMoves(chess, config.reservoir_moves);
+    if(moves.empty())
+        return in_check ? -(MATE_SCORE - ply) : 0;
+
+    orderMoves(chess.getBoard(), moves, config);
+
+    // futility pruning: near the leaves and far below 'alpha', a quiet move
+    // will not raise the score enough (checks are not spared, since finding
+    // them costs as much as making the move)
+    bool futile = prune && config.futility && depth <= 2 && static_eval + config.futility_margin * depth <= alpha;
+
+    const vector<Piece*> &board = chess.getBoard();
+    int best = -MATE_SCORE - 1, move_number = 0;
+    for(const auto & move : moves)
+    {
+        bool quiet = move.src > 63 || (move.promotion == '\0' && (board[move.dest]->isEmpty() ||
+                                       board[move.dest]->getPieceColor() == board[move.src]->getPieceColor()));
+
+        // at least one move is searched, so that the score is not a loss
+        if(futile && quiet && best > -MATE_SCORE - 1)
+        {
+            best = max(best, static_eval);
+            continue;
+        }
+
+        Chess *child = makeChild(move, ply);
+        if(child == nullptr)
+            continue;
+
+        move_number++;
+        lines[ply + 1].clear();
+
+        int value;
+        if(child->getCheckmate())
+            value = MATE_SCORE - ply - 1;
+        else if(child->getStalemate() || history.repetitions(root_ply + ply + 1) > 0)
+            value = 0;
+        else
+        {
+            // late move reductions: a quiet move (that does not check) late in
+            // the order is searched shallower, and again at full depth if it
+            // reaches 'alpha'
+            int reduction = 0;
+            if(config.late_move_reductions && quiet && !in_check && depth >= 2 && !child->getCheck() &&
+               !child->getDoubleCheck())
+                reduction = getReduction(depth, move_number, move.src > 63);
+
+            int bound = max(alpha, best);
+            value = reduction > 0 ? -negamax(*child, depth - 1 - reduction, -bound - 1, -bound, ply + 1) : bound + 1;
+            if(!aborted && value > bound)
+                value = -negamax(*child, depth - 1, -beta, -bound, ply + 1);
+        }
+
+        if(aborted)
+            return 0;
+
+        if(value > best)
+        {
+            best = value;
+
+            lines[ply].assign(1, move);
+            lines[ply].insert(lines[ply].end(), lines[ply + 1].begin(), lines[ply + 1].end());
+
+            if(best >= beta)
+                break; // the opponent will not allow this position
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief      Evaluates a position of the search (with the accumulator of its
+ *             ply if the network evaluates the positions).
+ *
+ * @param[in]  chess  The position (positions[ply])
+ * @param[in]  ply    The distance from the root (in plies)
+ *
+ * @return     The score of the position (in centipawns) for the side to move.
+ */
+int Engine::evaluateNode(const Chess &chess, int ply) const
+{
+    if(network != nullptr)
+        return network->evaluate(accumulators[ply], chess.getTurn());
+
+    return evaluate(chess);
+}
+
+/**
+ * @brief      Makes a move of a position (positions[ply]) on the chess object of
+ *             the next ply.
+ *
+ * @param[in]  move  The move
+ * @param[in]  ply   The distance of the position from the root
+ *
+ * @return     The chess object of the next ply, or nullptr if the move was
+ *             rejected.
+ *
+ * @post       The position is recorded in the history (at its ply).
+ */
+Chess *Engine::makeChild(const Move &move, int ply)
+{
+    while(positions.size() <= (unsigned int) ply + 1)
+    {
+        positions.emplace_back(new Chess);
+        positions.back()->setHeadless(true);
+    }
+
+    // the copy re-uses the pieces of the child of the last sibling
+    Chess *child = positions[ply + 1].get();
+    *child = *positions[ply];
+    if(!playMove(*child, move))
+        return nullptr;
+
+    // the entry of the ply replaces the one of the last sibling, so the
+    // history is always the line being searched
+    bool irreversible = move.src > 63 || child->getHalfmoveClock() == 0 ||
+                        child->getCastlingRights() != positions[ply]->getCastlingRights();
+    history.record(root_ply + ply + 1, child->getHash(), irreversible);
+
+    if(network != nullptr)
+    {
+        accumulators.resize(max(accumulators.size(), positions.size()));
+        network->update(*child, accumulators[ply], accumulators[ply + 1], move);
+    }
+
+    return child;
+}
+
+/**
+ * @brief      Makes a null move (the turn is passed) of a position
+ *             (positions[ply]) on the chess object of the next ply.
+ *
+ * @param[in]  ply   The distance of the position from the root
+ *
+ * @return     The chess object of the next ply.
+ *
+ * @post       The position is recorded in the history (at its ply).
+ */
+Chess *Engine::makeNullChild(int ply)
+{
+    while(positions.size() <= (unsigned int) ply + 1)
+    {
+        positions.emplace_back(new Chess);
+        positions.back()->setHeadless(true);
+    }
+
+    // the copy re-uses the pieces of the child of the last sibling, and its
+    // hash is updated from the one recorded for the line (the root's history
+    // comes from the caller's game, so its hash is found again)
+    Chess *child = positions[ply + 1].get();
+    *child = *positions[ply];
+    uint64_t hash = ply > 0 ? history.hashes[root_ply + ply - history.first_ply] : positions[0]->getHash();
+
+    // a null move cannot repeat a position
+    history.record(root_ply + ply + 1, child->makeNullMove(hash), true);
+
+    // the same pieces, so only the side to move differs
+    if(network != nullptr)
+    {
+        accumulators.resize(max(accumulators.size(), positions.size()));
+        accumulators[ply + 1] = accumulators[ply];
+    }
+
+    return child;
+}
+
+/**
+ * @brief      Fills the table of the late move reductions from the settings.
+ */
+void Engine::buildReductions()
+{
+    reductions.assign(MAX_REDUCTION_INDEX, vector<int>(MAX_REDUCTION_INDEX, 0));
+    for(int depth = 1; depth < MAX_REDUCTION_INDEX; depth++)
+        for(int move_number = 1; move_number < MAX_REDUCTION_INDEX; move_number++)
+            reductions[depth][move_number] = (int) (config.lmr_base + log(depth) * log(move_number) / config.lmr_divisor);
+}
+
+/*************************************************************************************/
+/*                              MOVE TABLE / CACHE - MEMBER FUNCTIONS                */
+/*************************************************************************************/
+/**
+ * @brief      Gets the destinations of a source.
+ *
+ * @param[in]  src   The source square, or the ASCII value of the reservoir
+ *                   piece in [110, 114]
+ *
+ * @return     The bit mask of destinations (0 for an invalid source).
+ */
+uint64_t MoveTable::destinations(int src) const
+{
+    if(0 <= src && src <= 63)
+        return from_square[src];
+
+    const char *piece = src > 0 && src < 128 ? strchr(RESERVOIR_PIECES, src) : nullptr;
+    return piece != nullptr && *piece != '\0' ? from_reservoir[piece - RESERVOIR_PIECES] : 0;
+}
+
+/**
+ * @brief      Gets the legal moves of a position, finding them if they are not
+ *             in the cache.
+ *
+ * @param      chess  The chess object (it is not changed)
+ *
+ * @return     The legal moves (valid until the next call).
+ */
+const MoveTable & MoveCache::get(Chess &chess)
+{
+    if(chess.getCheckmate() || chess.getStalemate())
+        return game_over;
+
+    uint64_t hash = chess.getHash();
+    auto found = tables.find(hash);
+    if(found != tables.end())
+    {
+        hits++;
+        return found->second;
+    }
+
+    misses++;
+    if(tables.size() >= capacity)
+        tables.clear();
+
+    MoveTable &table = tables[hash];
+
+    for(const auto & elem : chess.getBoard())
+        if(elem->getPieceColor() == chess.getTurn())
+            table.side |= 1ULL << elem->getPieceSquare();
+
+    for(const auto & move : legalMoves(chess))
+    {
+        if(move.src <= 63)
+            table.from_square[move.src] |= 1ULL << move.dest;
+        else
+            table.from_reservoir[strchr(RESERVOIR_PIECES, move.src) - RESERVOIR_PIECES] |= 1ULL << move.dest;
+    }
+
+    return table;
+}
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Finds the legal moves of the side to move, by asking the
+     *             pieces of the board (Piece::isLegalMove()) and following the
+     *             rules of Chess::useReservoirPiece().
+     *
+     * @param      chess      The chess object (it is not changed)
+     * @param[in]  reservoir  True to include the reservoir moves, False
+     *                        otherwise
+     *
+     * @return     The legal moves (a pawn reaching the last rank gives one move
+     *             per promotion piece), or none if the game is over.
+     */
+    vector<Move> legalMoves(Chess &chess, bool reservoir)
+    {
+        vector<Move> moves;
+        if(chess.getCheckmate() || chess.getStalemate())
+            return moves;
+
+        const vector<Piece*> &board = chess.getBoard();
+        for(const auto & elem : board)
+        {
+            if(elem->getPieceColor() != chess.getTurn())
+                continue;
+
+            int src = elem->getPieceSquare();
+            for(int dest = 0; dest < 64; dest++)
+            {
+                if(!elem->isLegalMove(dest, chess))
+                    continue;
+
+                if(elem->isPawn() && (dest/8 == 0 || dest/8 == 7))
+                    for(char piece : {'q', 'r', 'b', 'n'})
+                        moves.push_back({src, dest, piece});
+                else
+                    moves.push_back({src, dest, '\0'});
+            }
+        }
+
+        // same conditions as Chess::useReservoirPiece()
+        if(reservoir && !chess.getCheck() && !chess.getDoubleCheck())
+        {
+            for(const auto & elem : chess.getReservoir())
+            {
+                if(elem.first <= 0 || (std::isupper(elem.second) != 0) != (chess.getTurn() == WHITE))
+                    continue;
+
+                pieceType type = reservoirType(elem.second);
+                for(const auto & piece : board)
+                {
+                    int dest = piece->getPieceSquare();
+                    if( piece->getPieceColor() == chess.getTurn() && !piece->isKing() && piece->getPieceType() != type &&
+                        !(type == PAWN && (dest/8 == 0 || dest/8 == 7)) )
+                    {
+                        moves.push_back({std::tolower(elem.second), dest, '\0'});
+                    }
+                }
+            }
+        }
+
+        return moves;
+    }
+
+    /**
+     * @brief      Makes a move (a move without a promotion piece promotes to a
+     *             queen, should its pawn reach the last rank).
+     *
+     * @param      chess  The chess object
+     * @param[in]  move   The move
+     *
+     * @return     True if the move was made, False otherwise.
+     */
+    bool playMove(Chess &chess, const Move &move)
+    {
+        return chess.makeMove(move.src, move.dest, move.promotion);
+    }
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Converts a reservoir character into its piece type.
+     *
+     * @param[in]  piece  The reservoir character (p, n, o, r or q in any case)
+     *
+     * @return     The piece type ('o' is a bishop).
+     */
+    pieceType reservoirType(char piece)
+    {
+        switch(std::tolower(piece))
+        {
+            case 'n':
+                return KNIGHT;
+            case 'o':
+                return BISHOP;
+            case 'r':
+                return ROOK;
+            case 'q':
+                return QUEEN;
+            default:
+                return PAWN;
+        }
+    }
+
+    /**
+     * @brief      Orders the moves so that the search tries the most promising
+     *             ones first: captures (most valuable victim, least valuable
+     *             attacker), promotions, other moves and then reservoir moves.
+     *
+     * @param[in]  board   The board of the position
+     * @param      moves   The moves (sorted in place)
+     * @param[in]  config  The settings of the engine (for the piece values)
+     */
+    void orderMoves(const vector<Piece*> &board, vector<Move> &moves, const EngineConfig &config)
+    {
+        auto priority = [&](const Move &move)
+        {
+            if(move.src > 63)
+                return -1;
+
+            pieceType victim = board[move.dest]->getPieceType();
+            if(victim != EMPTY && victim != KING && board[move.dest]->getPieceColor() != board[move.src]->getPieceColor())
+                return 10 * config.material[victim] - board[move.src]->getPieceType();
+
+            return move.promotion == 'q' ? 1 : 0;
+        };
+
+        // stable, so that equal moves keep the board order (the search is
+        // deterministic)
+        stable_sort(moves.begin(), moves.end(), [&](const Move &a, const Move &b) {return priority(a) > priority(b);});
+    }
+}
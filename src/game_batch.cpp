@@ -0,0 +1,859 @@
+/**
+ * \page gamebatch Game Batch Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;game_batch.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;game_batch.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Finding and making the moves of a batch of games with bitboards (see
+ * game_batch.h). The loops over all the games are the kernels of
+ * batch_kernels.h; the moves of a game are found with the same bit operations,
+ * one piece at a time.
+ */
+
+#include "game_batch.h"
+
+#include <algorithm>
+#include <cstring>
+
+// included in 'game_batch.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /** Every square */
+    const uint64_t ALL_SQUARES = ~0ULL;
+
+    /** The squares of the 8th and of the 1st rank (a pawn cannot be placed
+     *  there) */
+    const uint64_t LAST_RANKS = 0xFF000000000000FFULL;
+
+    /** The pieces of the starting position */
+    const uint64_t START_PIECES[6] = {0x00FF00000000FF00ULL, 0x4200000000000042ULL, 0x2400000000000024ULL,
+                                      0x8100000000000081ULL, 0x0800000000000008ULL, 0x1000000000000010ULL};
+
+    /** The reservoir of the starting position (in the order of
+     *  Chess::getReservoir()) */
+    const uint8_t START_RESERVOIR[10] = {4, 2, 2, 1, 1, 4, 2, 2, 1, 1};
+
+    /** The reservoir pieces (in the order of pieceType) */
+    const char RESERVOIR_CHARS[] = "pnorq";
+
+    /**
+     * @brief      This struct describes the squares between, and on the line
+     *             through, any two squares.
+     */
+    struct LineTables
+    {
+        /** The squares strictly between two squares on a line (0 if they
+         *  are not on a line) */
+        uint64_t between[64][64];
+
+        /** The squares of the line through two squares (0 if they are not
+         *  on a line) */
+        uint64_t line[64][64];
+    };
+
+    /**
+     * @brief      Gets the line tables (made on the first call).
+     *
+     * @return     The tables.
+     */
+    const LineTables & lineTables();
+
+    /**
+     * @brief      Finds the square of the lowest set bit (and clears it).
+     *
+     * @param      board  The bitboard (not 0)
+     *
+     * @return     The square.
+     */
+    int popSquare(uint64_t &board);
+}
+
+/*************************************************************************************/
+/*                              GAME BATCH - MEMBER FUNCTIONS                        */
+/*************************************************************************************/
+/**
+ * @brief      Constructs a new instance.
+ *
+ * @param[in]  size  The number of games (all at the starting position)
+ */
+GameBatch::GameBatch(size_t size)
+    : num_games(0), kernel(bestKernel())
+{
+    resize(size);
+}
+
+/**
+ * @brief      Changes the number of games (new games are at the starting
+ *             position).
+ *
+ * @param[in]  size  The number of games
+ */
+void GameBatch::resize(size_t size)
+{
+    for(auto & elem : pieces)
+        elem.resize(size);
+    for(auto & elem : colors)
+        elem.resize(size);
+    for(auto & elem : reservoir)
+        elem.resize(size);
+
+    unmoved.resize(size);
+    en_passant.resize(size);
+    white_to_move.resize(size);
+    status.resize(size);
+    halfmove.resize(size);
+    num_moves.resize(size);
+    attacked.resize(size);
+    checkers.resize(size);
+
+    for(size_t game = num_games; game < size; game++)
+        reset(game);
+
+    num_games = size;
+}
+
+/**
+ * @brief      Sets a game to the starting position.
+ *
+ * @param[in]  game  The game (in [0, getSize()))
+ */
+void GameBatch::reset(size_t game)
+{
+    for(int type = PAWN; type <= KING; type++)
+        pieces[type][game] = START_PIECES[type];
+    for(int i = 0; i < 10; i++)
+        reservoir[i][game] = START_RESERVOIR[i];
+
+    colors[0][game] = 0x000000000000FFFFULL;
+    colors[1][game] = 0xFFFF000000000000ULL;
+    unmoved[game] = START_PIECES[PAWN] | START_PIECES[ROOK] | START_PIECES[KING];
+    en_passant[game] = 64;
+    white_to_move[game] = 1;
+    status[game] = BATCH_ONGOING;
+    halfmove[game] = 0;
+    num_moves[game] = 0;
+}
+
+/**
+ * @brief      Sets a game to the position of a chess object (including the
+ *             pawns that did not move yet and the en-passant square).
+ *
+ * @param[in]  game   The game (in [0, getSize()))
+ * @param[in]  chess  The chess object
+ */
+void GameBatch::set(size_t game, const Chess &chess)
+{
+    for(int type = PAWN; type <= KING; type++)
+        pieces[type][game] = 0;
+    colors[0][game] = colors[1][game] = unmoved[game] = 0;
+
+    // the pawns that can move two squares and the castling rights are the
+    // moved information of the pieces
+    for(const auto & elem : chess.getBoard())
+    {
+        if(elem->isEmpty())
+            continue;
+
+        uint64_t square = 1ULL << elem->getPieceSquare();
+        pieces[elem->getPieceType()][game] |= square;
+        colors[elem->isPieceWhite()][game] |= square;
+
+        if((elem->isPawn() || elem->isRook() || elem->isKing()) && !elem->getPieceMoveInfo())
+            unmoved[game] |= square;
+    }
+
+    vector<pair<int, char>> chess_reservoir = chess.getReservoir();
+    for(int i = 0; i < 10; i++)
+        reservoir[i][game] = (uint8_t) chess_reservoir[i].first;
+
+    white_to_move[game] = chess.getTurn() == WHITE;
+    halfmove[game] = (uint16_t) chess.getHalfmoveClock();
+    num_moves[game] = (uint32_t) chess.getNumMoves();
+    status[game] = chess.getCheckmate() ? BATCH_CHECKMATE : chess.getStalemate() ? BATCH_STALEMATE : BATCH_ONGOING;
+
+    // only an en-passant square behind a pawn of the side not to move that
+    // just moved two squares, and that a pawn can take (like applyMove(); a
+    // Chess object can keep an older one)
+    int square = chess.getEnPassantSquare();
+    int pawn = white_to_move[game] ? square + 8 : square - 8;
+    bool valid = square != -1 && (white_to_move[game] ? square / 8 == 2 : square / 8 == 5) &&
+                 (pieces[PAWN][game] & colors[!white_to_move[game]][game] & (1ULL << pawn));
+    if(valid)
+    {
+        uint64_t beside = (((1ULL << pawn) << 1) & ~FILE_A) | (((1ULL << pawn) >> 1) & ~FILE_H);
+        valid = (beside & pieces[PAWN][game] & colors[white_to_move[game]][game]) != 0;
+    }
+    en_passant[game] = valid ? square : 64;
+}
+
+/**
+ * @brief      Sets a game to the position of a FEN string (in the format of
+ *             Chess::setFromFEN()).
+ *
+ * @param[in]  game  The game (in [0, getSize()))
+ * @param[in]  fen   The FEN string
+ *
+ * @return     True if the FEN string is valid, False otherwise (the game is not
+ *             changed).
+ */
+bool GameBatch::setFromFEN(size_t game, const char *fen)
+{
+    Chess chess;
+    chess.setHeadless(true);
+    if(!chess.setFromFEN(fen))
+        return false;
+
+    set(game, chess);
+    return true;
+}
+
+/**
+ * @brief      Sets a game to a game of a batch (this one or another one).
+ *
+ * @param[in]  game       The game (in [0, getSize()))
+ * @param[in]  from       The batch of the other game
+ * @param[in]  from_game  The other game (in [0, from.getSize()))
+ */
+void GameBatch::copyGame(size_t game, const GameBatch &from, size_t from_game)
+{
+    for(int type = PAWN; type <= KING; type++)
+        pieces[type][game] = from.pieces[type][from_game];
+    for(int i = 0; i < 10; i++)
+        reservoir[i][game] = from.reservoir[i][from_game];
+
+    colors[0][game] = from.colors[0][from_game];
+    colors[1][game] = from.colors[1][from_game];
+    unmoved[game] = from.unmoved[from_game];
+    en_passant[game] = from.en_passant[from_game];
+    white_to_move[game] = from.white_to_move[from_game];
+    status[game] = from.status[from_game];
+    halfmove[game] = from.halfmove[from_game];
+    num_moves[game] = from.num_moves[from_game];
+}
+
+/**
+ * @brief      Finds if a game is at the same position as a game of a batch
+ *             (this one or another one). The halfmove clock and the number of
+ *             moves are not compared.
+ *
+ * @param[in]  game        The game (in [0, getSize()))
+ * @param[in]  other       The batch of the other game
+ * @param[in]  other_game  The other game (in [0, other.getSize()))
+ *
+ * @return     True if the positions are the same, False otherwise.
+ */
+bool GameBatch::samePosition(size_t game, const GameBatch &other, size_t other_game) const
+{
+    for(int type = PAWN; type <= KING; type++)
+        if(pieces[type][game] != other.pieces[type][other_game])
+            return false;
+    for(int i = 0; i < 10; i++)
+        if(reservoir[i][game] != other.reservoir[i][other_game])
+            return false;
+
+    return colors[0][game] == other.colors[0][other_game] && colors[1][game] == other.colors[1][other_game] &&
+           unmoved[game] == other.unmoved[other_game] && en_passant[game] == other.en_passant[other_game] &&
+           white_to_move[game] == other.white_to_move[other_game];
+}
+
+/**
+ * @brief      (Accessor) Gets the Zobrist hash of the position of a game (the
+ *             same as Chess::getHash() for the same position).
+ *
+ * @param[in]  game  The game (in [0, getSize()))
+ *
+ * @return     The hash.
+ */
+uint64_t GameBatch::getHash(size_t game) const
+{
+    uint64_t hash = 0;
+
+    for(int type = PAWN; type <= KING; type++)
+    {
+        for(int white = 0; white < 2; white++)
+        {
+            for(uint64_t board = pieces[type][game] & colors[white][game]; board != 0; board &= board - 1)
+                hash ^= chessCAMO::zobristKey((type*2 + white)*64 + __builtin_ctzll(board));
+        }
+    }
+
+    if(white_to_move[game])
+        hash ^= chessCAMO::zobristKey(768);
+
+    int rights = getCastlingRights(game);
+    for(int i = 0; i < 4; i++)
+        if(rights & (1 << i))
+            hash ^= chessCAMO::zobristKey(769 + i);
+
+    if(en_passant[game] != 64)
+        hash ^= chessCAMO::zobristKey(773 + en_passant[game] % 8);
+
+    for(int i = 0; i < 10; i++)
+        hash ^= chessCAMO::zobristKey(781 + i*10 + min<int>(reservoir[i][game], 9));
+
+    return hash;
+}
+
+/**
+ * @brief      Packs the position of a game (in the format of
+ *             chessCAMO::packPosition()).
+ *
+ * @param[in]  game      The game (in [0, getSize()))
+ * @param      position  The packed position
+ */
+void GameBatch::pack(size_t game, PackedPosition &position) const
+{
+    memset(&position, 0, sizeof(position));
+
+    for(int type = PAWN; type <= KING; type++)
+    {
+        for(int white = 0; white < 2; white++)
+        {
+            uint64_t board = pieces[type][game] & colors[white][game];
+            while(board)
+            {
+                int square = popSquare(board);
+                position.squares[square / 2] |= ((white ? 1 : 9) + type) << (4 * (square % 2));
+            }
+        }
+    }
+
+    for(int i = 0; i < 10; i++)
+        position.reservoir[i / 2] |= (reservoir[i][game] & 15) << (4 * (i % 2));
+
+    // the castling rights of Chess::getCastlingRights() (K, Q, k, q)
+    int rights = 0, corners[4] = {63, 56, 7, 0};
+    for(int i = 0; i < 4; i++)
+    {
+        uint64_t own = colors[i < 2][game] & unmoved[game];
+        if((pieces[KING][game] & own & (1ULL << (i < 2 ? 60 : 4))) && (pieces[ROOK][game] & own & (1ULL << corners[i])))
+            rights |= 1 << i;
+    }
+
+    position.flags = white_to_move[game] | (rights << 1);
+    position.en_passant = en_passant[game] < 64 ? en_passant[game] : 255;
+    position.halfmove = halfmove[game] < 255 ? halfmove[game] : 255;
+    position.num_moves[0] = num_moves[game] & 255;
+    position.num_moves[1] = (num_moves[game] >> 8) & 255;
+}
+
+/**
+ * @brief      Writes the position of a game as a FEN string (in the format of
+ *             Chess::toFEN()).
+ *
+ * @param[in]  game  The game (in [0, getSize()))
+ * @param      fen   The buffer to write into (FEN_SIZE characters is always
+ *                   enough)
+ * @param[in]  size  The size of the buffer
+ *
+ * @return     The length of the written string, or -1 if the buffer is too
+ *             small.
+ */
+int GameBatch::toFEN(size_t game, char *fen, int size) const
+{
+    PackedPosition position;
+    pack(game, position);
+    return chessCAMO::unpackPosition(position, fen, size);
+}
+
+/**
+ * @brief      Finds the legal moves of every game (none for a game that is
+ *             over).
+ *
+ * @param      moves      The moves of all the games, one game after the other
+ * @param      first      The index of the first move of each game: the moves
+ *                        of game i are moves[first[i]] to moves[first[i+1] - 1]
+ *                        (getSize() + 1 entries)
+ * @param[in]  reservoir  True to include the reservoir moves, False otherwise
+ */
+void GameBatch::generateMoves(vector<Move> &moves, vector<uint32_t> &first, bool reservoir)
+{
+    findAttacks(0, num_games);
+
+    moves.clear();
+    first.resize(num_games + 1);
+
+    Move game_moves[MAX_BATCH_MOVES];
+    for(size_t game = 0; game < num_games; game++)
+    {
+        first[game] = (uint32_t) moves.size();
+        int count = status[game] == BATCH_ONGOING ? listMoves(game, game_moves, reservoir) : 0;
+        moves.insert(moves.end(), game_moves, game_moves + count);
+    }
+
+    first[num_games] = (uint32_t) moves.size();
+}
+
+/**
+ * @brief      Finds the legal moves of a game.
+ *
+ * @param[in]  game       The game (in [0, getSize()))
+ * @param      moves      The moves (MAX_BATCH_MOVES entries is always enough)
+ * @param[in]  reservoir  True to include the reservoir moves, False otherwise
+ *
+ * @return     The number of moves.
+ */
+int GameBatch::gameMoves(size_t game, Move *moves, bool reservoir)
+{
+    if(status[game] != BATCH_ONGOING)
+        return 0;
+
+    findAttacks(game, game + 1);
+    return listMoves(game, moves, reservoir);
+}
+
+/**
+ * @brief      Makes a move in every game.
+ *
+ * @param[in]  moves  The move of each game (a move with a source of -1, or a
+ *                    missing entry, leaves its game as it is)
+ *
+ * @pre        Each move is a legal move of its game (see generateMoves()).
+ */
+void GameBatch::applyMoves(const vector<Move> &moves)
+{
+    for(size_t game = 0; game < num_games && game < moves.size(); game++)
+        if(moves[game].src != -1 && status[game] == BATCH_ONGOING)
+            applyMove(game, moves[game]);
+}
+
+/**
+ * @brief      Makes a move in a game.
+ *
+ * @param[in]  game  The game (in [0, getSize()))
+ * @param[in]  move  The move
+ *
+ * @pre        The move is a legal move of the game (see gameMoves()).
+ */
+void GameBatch::applyMove(size_t game, const Move &move)
+{
+    int white = white_to_move[game];
+    uint64_t &own = colors[white][game], &enemy = colors[!white][game];
+    uint64_t dest = 1ULL << move.dest;
+
+    en_passant[game] = 64;
+    halfmove[game]++;
+    num_moves[game]++;
+    white_to_move[game] = !white;
+
+    // a reservoir piece replaces a piece of the side to move
+    if(move.src > 63)
+    {
+        int type = (int) (strchr(RESERVOIR_CHARS, move.src) - RESERVOIR_CHARS);
+        reservoir[type + (white ? 5 : 0)][game]--;
+
+        for(auto & elem : pieces)
+            elem[game] &= ~dest;
+        pieces[type][game] |= dest;
+        unmoved[game] &= ~dest;
+        return;
+    }
+
+    uint64_t src = 1ULL << move.src;
+    int type = PAWN;
+    while(!(pieces[type][game] & src))
+        type++;
+
+    // castling is the king moving to its rook (see King::canCastle())
+    if(type == KING && (pieces[ROOK][game] & own & dest))
+    {
+        bool king_side = move.dest > move.src;
+        uint64_t king_to = 1ULL << (king_side ? move.src + 2 : move.src - 2);
+        uint64_t rook_to = 1ULL << (king_side ? move.dest - 2 : move.dest + 3);
+
+        pieces[KING][game] ^= src | king_to;
+        pieces[ROOK][game] ^= dest | rook_to;
+        own ^= src | king_to | dest | rook_to;
+        unmoved[game] &= ~(src | dest);
+        return;
+    }
+
+    bool capture = (enemy & dest) != 0;
+    if(capture)
+    {
+        for(auto & elem : pieces)
+            elem[game] &= ~dest;
+        enemy &= ~dest;
+    }
+    else if(type == PAWN && (move.dest - move.src) % 8 != 0)
+    {
+        // en-passant (the captured pawn is behind the destination)
+        uint64_t pawn = white ? dest << 8 : dest >> 8;
+        pieces[PAWN][game] &= ~pawn;
+        enemy &= ~pawn;
+        capture = true;
+    }
+
+    pieces[type][game] ^= src | dest;
+    own ^= src | dest;
+    unmoved[game] &= ~(src | dest);
+
+    if(type == PAWN || capture)
+        halfmove[game] = 0;
+
+    if(type == PAWN && (dest & LAST_RANKS))
+    {
+        pieceType promoted = move.promotion == 'r' ? ROOK : move.promotion == 'b' ? BISHOP :
+                             move.promotion == 'n' ? KNIGHT : QUEEN;
+        pieces[PAWN][game] &= ~dest;
+        pieces[promoted][game] |= dest;
+    }
+
+    // like Pawn::enPassantHandling(), only if a pawn can take it
+    if(type == PAWN && (move.dest - move.src == 16 || move.src - move.dest == 16))
+    {
+        uint64_t beside = ((dest << 1) & ~FILE_A) | ((dest >> 1) & ~FILE_H);
+        if(beside & pieces[PAWN][game] & enemy)
+            en_passant[game] = (uint8_t) ((move.src + move.dest) / 2);
+    }
+}
+
+/**
+ * @brief      Finds which games are over (the side to move has no legal move,
+ *             with the reservoir moves).
+ *
+ * @return     The number of games that are not over.
+ */
+size_t GameBatch::updateStatus()
+{
+    findAttacks(0, num_games);
+
+    size_t ongoing = 0;
+    Move game_moves[MAX_BATCH_MOVES];
+    for(size_t game = 0; game < num_games; game++)
+    {
+        if(status[game] != BATCH_ONGOING)
+            continue;
+
+        if(listMoves(game, game_moves, true) > 0)
+            ongoing++;
+        else
+            status[game] = checkers[game] ? BATCH_CHECKMATE : BATCH_STALEMATE;
+    }
+
+    return ongoing;
+}
+
+/**
+ * @brief      (Accessor) Finds if the side to move of a game is in check.
+ *
+ * @param[in]  game  The game (in [0, getSize()))
+ *
+ * @return     True if it is in check, False otherwise.
+ */
+bool GameBatch::getCheck(size_t game) const
+{
+    uint64_t game_attacked, game_checkers;
+    batchAttacks(KERNEL_SCALAR, getArrays(), game, game + 1, &game_attacked, &game_checkers);
+    return game_checkers != 0;
+}
+
+/**
+ * @brief      (Accessor) Gets the castling rights of a game (in the format of
+ *             Chess::getCastlingRights()).
+ *
+ * @param[in]  game  The game (in [0, getSize()))
+ *
+ * @return     The rights (bit 0 to 3 for K, Q, k and q).
+ */
+int GameBatch::getCastlingRights(size_t game) const
+{
+    // an unmoved king and rook of the same color on their squares
+    int rights = 0, corners[4] = {63, 56, 7, 0};
+    for(int i = 0; i < 4; i++)
+    {
+        int white = i < 2;
+        uint64_t king = 1ULL << (white ? 60 : 4), rook = 1ULL << corners[i];
+        uint64_t own = unmoved[game] & colors[white][game];
+        if((pieces[KING][game] & own & king) && (pieces[ROOK][game] & own & rook))
+            rights |= 1 << i;
+    }
+
+    return rights;
+}
+
+/**
+ * @brief      (Mutator) Sets the version of the kernels (see batch_kernels.h).
+ *
+ * @param[in]  kernel  The version
+ *
+ * @return     True if it was set, False otherwise (the processor does not
+ *             support it).
+ */
+bool GameBatch::setKernel(batchKernel kernel)
+{
+    if(!kernelSupported(kernel))
+        return false;
+
+    this->kernel = kernel;
+    return true;
+}
+
+/**
+ * @brief      Finds the squares attacked by the side not to move and the pieces
+ *             that give check, for every game (see getAttacked() and
+ *             getCheckers()).
+ */
+void GameBatch::updateAttacks()
+{
+    findAttacks(0, num_games);
+}
+
+/**
+ * @brief      Evaluates every game, like Engine::evaluate().
+ *
+ * @param[in]  config  The settings of the evaluation
+ * @param      scores  The score of each game (in centipawns) for the side to
+ *                     move
+ */
+void GameBatch::evaluate(const EngineConfig &config, vector<int> &scores) const
+{
+    scores.resize(num_games);
+    batchEvaluate(kernel, getArrays(), config, 0, num_games, scores.data());
+}
+
+/**
+ * @brief      Finds the squares attacked by the side not to move and the pieces
+ *             that give check, for the games in [begin, end).
+ *
+ * @param[in]  begin  The first game
+ * @param[in]  end    One past the last game
+ */
+void GameBatch::findAttacks(size_t begin, size_t end)
+{
+    batchAttacks(kernel, getArrays(), begin, end, attacked.data() + begin, checkers.data() + begin);
+}
+
+/**
+ * @brief      Gets the arrays of the games that the kernels read.
+ *
+ * @return     The arrays.
+ */
+BatchArrays GameBatch::getArrays() const
+{
+    BatchArrays arrays;
+    for(int type = PAWN; type <= KING; type++)
+        arrays.pieces[type] = pieces[type].data();
+    for(int i = 0; i < 10; i++)
+        arrays.reservoir[i] = reservoir[i].data();
+
+    arrays.colors[0] = colors[0].data();
+    arrays.colors[1] = colors[1].data();
+    arrays.white_to_move = white_to_move.data();
+    return arrays;
+}
+
+/**
+ * @brief      Finds the legal moves of a game from its attacked squares and
+ *             checks (see findAttacks()).
+ *
+ * @param[in]  game       The game
+ * @param      moves      The moves (MAX_BATCH_MOVES entries)
+ * @param[in]  reservoir  True to include the reservoir moves, False otherwise
+ *
+ * @return     The number of moves.
+ */
+int GameBatch::listMoves(size_t game, Move *moves, bool reservoir) const
+{
+    const LineTables &tables = lineTables();
+
+    int white = white_to_move[game], count = 0;
+    uint64_t own = colors[white][game], enemy = colors[!white][game];
+    uint64_t occupied = own | enemy, empty = ~occupied;
+    uint64_t check = checkers[game];
+    uint64_t king = pieces[KING][game] & own;
+    int king_square = __builtin_ctzll(king);
+
+    // -------- king moves -------- //
+    uint64_t targets = kingAttacks(king) & ~own & ~attacked[game];
+    while(targets)
+        moves[count++] = {king_square, popSquare(targets), '\0'};
+
+    // only the king can move out of a double check
+    if(__builtin_popcountll(check) > 1)
+        return count;
+
+    // when in check, the other pieces can only take the attacker or block it
+    // (see Piece::isLegalMove())
+    uint64_t allowed = ALL_SQUARES;
+    if(check)
+        allowed = check | tables.between[king_square][__builtin_ctzll(check)];
+
+    // the pieces that are alone between the king and an enemy bishop, rook or
+    // queen can only move along that line
+    uint64_t pinned = 0;
+    uint64_t snipers = (rookAttacks(king, ALL_SQUARES) & (pieces[ROOK][game] | pieces[QUEEN][game]) & enemy) |
+                       (bishopAttacks(king, ALL_SQUARES) & (pieces[BISHOP][game] | pieces[QUEEN][game]) & enemy);
+    while(snipers)
+    {
+        uint64_t between = tables.between[king_square][popSquare(snipers)] & occupied;
+        if(__builtin_popcountll(between) == 1 && (between & own))
+            pinned |= between;
+    }
+
+    // -------- other pieces -------- //
+    uint64_t others = own & ~king;
+    while(others)
+    {
+        int src = popSquare(others);
+        uint64_t piece = 1ULL << src;
+        uint64_t mask = allowed & ~own;
+        if(pinned & piece)
+            mask &= tables.line[king_square][src];
+
+        if(pieces[PAWN][game] & piece)
+        {
+            uint64_t push = (white ? piece >> 8 : piece << 8) & empty;
+            uint64_t twice = (unmoved[game] & piece) ? (white ? push >> 8 : push << 8) & empty : 0;
+            uint64_t takes = white ? whitePawnAttacks(piece) : blackPawnAttacks(piece);
+            targets = ((push | twice) & mask) | (takes & enemy & mask);
+
+            // cannot en-passant if it has not moved yet (see Pawn::isPossibleMove()),
+            // nor leave the king in check (the two pawns leave the rank)
+            uint64_t passant = en_passant[game] < 64 ? 1ULL << en_passant[game] : 0;
+            if((takes & passant) && !(unmoved[game] & piece) && !check)
+            {
+                uint64_t taken = white ? passant << 8 : passant >> 8;
+                uint64_t after = (occupied & ~piece & ~taken) | passant;
+                uint64_t straight = (pieces[ROOK][game] | pieces[QUEEN][game]) & enemy;
+                uint64_t diagonal = (pieces[BISHOP][game] | pieces[QUEEN][game]) & enemy;
+                if(!(rookAttacks(king, ~after) & straight) && !(bishopAttacks(king, ~after) & diagonal))
+                    targets |= passant;
+            }
+
+            while(targets)
+            {
+                int dest = popSquare(targets);
+                if((1ULL << dest) & LAST_RANKS)
+                    for(char promotion : {'q', 'r', 'b', 'n'})
+                        moves[count++] = {src, dest, promotion};
+                else
+                    moves[count++] = {src, dest, '\0'};
+            }
+            continue;
+        }
+
+        if(pieces[KNIGHT][game] & piece)
+            targets = knightAttacks(piece);
+        else if(pieces[BISHOP][game] & piece)
+            targets = bishopAttacks(piece, empty);
+        else if(pieces[ROOK][game] & piece)
+            targets = rookAttacks(piece, empty);
+        else
+            targets = bishopAttacks(piece, empty) | rookAttacks(piece, empty);
+
+        targets &= mask;
+        while(targets)
+            moves[count++] = {src, popSquare(targets), '\0'};
+    }
+
+    // -------- castling -------- //
+    // the king moves to its rook (see King::canCastle()), which cannot be
+    // attacked either
+    if(!check && (unmoved[game] & king))
+    {
+        uint64_t rooks = pieces[ROOK][game] & own & unmoved[game];
+        for(int rook : {king_square + 3, king_square - 4})
+        {
+            if(rook < 0 || rook > 63 || !(rooks & (1ULL << rook)))
+                continue;
+
+            int step = rook > king_square ? 1 : -1;
+            uint64_t crossed = (1ULL << (king_square + step)) | (1ULL << (king_square + 2*step)) | (1ULL << rook);
+            if(!(tables.between[king_square][rook] & occupied) && !(crossed & attacked[game]))
+                moves[count++] = {king_square, rook, '\0'};
+        }
+    }
+
+    // -------- reservoir -------- //
+    // same conditions as Chess::useReservoirPiece()
+    if(reservoir && !check)
+    {
+        for(int type = PAWN; type <= QUEEN; type++)
+        {
+            if(this->reservoir[type + (white ? 5 : 0)][game] == 0)
+                continue;
+
+            targets = own & ~king & ~pieces[type][game];
+            if(type == PAWN)
+                targets &= ~LAST_RANKS;
+
+            while(targets)
+                moves[count++] = {RESERVOIR_CHARS[type], popSquare(targets), '\0'};
+        }
+    }
+
+    return count;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Gets the line tables (made on the first call).
+     *
+     * @return     The tables.
+     */
+    const LineTables & lineTables()
+    {
+        static const LineTables *tables = []
+        {
+            LineTables *made = new LineTables();
+            for(int a = 0; a < 64; a++)
+            {
+                for(int b = 0; b < 64; b++)
+                {
+                    uint64_t from = 1ULL << a, to = 1ULL << b;
+                    if(a == b)
+                        continue;
+
+                    // the lines of the two squares only meet between them
+                    if(rookAttacks(from, ALL_SQUARES) & to)
+                    {
+                        made->between[a][b] = rookAttacks(from, ~to) & rookAttacks(to, ~from);
+                        made->line[a][b] = (rookAttacks(from, ALL_SQUARES) & rookAttacks(to, ALL_SQUARES)) | from | to;
+                    }
+                    else if(bishopAttacks(from, ALL_SQUARES) & to)
+                    {
+                        made->between[a][b] = bishopAttacks(from, ~to) & bishopAttacks(to, ~from);
+                        made->line[a][b] = (bishopAttacks(from, ALL_SQUARES) & bishopAttacks(to, ALL_SQUARES)) | from | to;
+                    }
+                }
+            }
+            return made;
+        }();
+
+        return *tables;
+    }
+
+    /**
+     * @brief      Finds the square of the lowest set bit (and clears it).
+     *
+     * @param      board  The bitboard (not 0)
+     *
+     * @return     The square.
+     */
+    int popSquare(uint64_t &board)
+    {
+        int square = __builtin_ctzll(board);
+        board &= board - 1;
+        return square;
+    }
+}
@@ -0,0 +1,305 @@
+/**
+ * \page gamestore Saved Games Store Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;game_store.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;game_store.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Packing positions, and saving and finding games in a saved games file (see
+ * game_store.h).
+ */
+
+#include "game_store.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+// included in 'game_store.h' but good to re-state
+using namespace std;
+
+/*************************************************************************************/
+/*                              GAME STORE - MEMBER FUNCTIONS                        */
+/*************************************************************************************/
+/**
+ * @brief      Opens a saved games file, creating it if it does not exist.
+ *
+ * @param[in]  filename  The name of the file
+ *
+ * @post       Any previously opened file is closed first.
+ *
+ * @return     True if the file was opened, False otherwise (e.g. it is not a
+ *             saved games file).
+ */
+bool GameStore::open(const string &filename)
+{
+    close();
+
+    // a new file only holds the magic string
+    if(!ifstream(filename))
+    {
+        ofstream out(filename, ios::binary);
+        out.write(STORE_MAGIC, 8);
+        if(!out)
+            return false;
+    }
+
+    this->filename = filename;
+    if(!load())
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Closes the file (if any).
+ */
+void GameStore::close()
+{
+    file.close();
+    offsets.clear();
+    filename.clear();
+}
+
+/**
+ * @brief      Saves a game at the end of the file.
+ *
+ * @param[in]  positions  The positions of the game (the starting position,
+ *                        then the position after each move)
+ * @param[in]  result     The result (see StoredGame::result)
+ *
+ * @pre        The file is opened
+ *
+ * @return     True if the game was saved, False otherwise.
+ */
+bool GameStore::append(const vector<PackedPosition> &positions, uint32_t result)
+{
+    if(filename.empty() || positions.empty())
+        return false;
+
+    StoredGame game;
+    game.num_positions = (uint32_t) positions.size();
+    game.result = result;
+    game.saved_time = (int64_t) time(nullptr);
+
+    // the mapping is read-only, so the game is written through a stream (after
+    // the last complete game, in case the file ends with a partly written one)
+    // and the file is mapped again
+    uint64_t end = offsets.empty() ? 8 : offsets.back() + sizeof(StoredGame) + getGame(getNumGames() - 1).num_positions * sizeof(PackedPosition);
+    file.close();
+    {
+        fstream out(filename, ios::binary | ios::in | ios::out);
+        out.seekp(end);
+        out.write((const char *) &game, sizeof(game));
+        out.write((const char *) positions.data(), positions.size() * sizeof(PackedPosition));
+        if(!out)
+        {
+            load();
+            return false;
+        }
+    }
+
+    return load();
+}
+
+/**
+ * @brief      (Accessor) Gets the header of a saved game.
+ *
+ * @param[in]  game  The game (in [0, getNumGames()), in the order they were
+ *                   saved)
+ *
+ * @return     The header.
+ */
+StoredGame GameStore::getGame(uint32_t game) const
+{
+    // the headers are not aligned in the file
+    StoredGame header;
+    memcpy(&header, file.getData() + offsets[game], sizeof(header));
+    return header;
+}
+
+/**
+ * @brief      (Accessor) Gets the positions of a saved game (in place, in the
+ *             mapped file).
+ *
+ * @param[in]  game  The game (in [0, getNumGames()))
+ *
+ * @return     The first of getGame(game).num_positions positions.
+ */
+const PackedPosition * GameStore::getPositions(uint32_t game) const
+{
+    return (const PackedPosition *) (file.getData() + offsets[game] + sizeof(StoredGame));
+}
+
+/**
+ * @brief      Maps the file and finds its games.
+ *
+ * @return     True if the file is a saved games file, False otherwise.
+ */
+bool GameStore::load()
+{
+    offsets.clear();
+    if(!file.open(filename) || file.getSize() < 8 || memcmp(file.getData(), STORE_MAGIC, 8) != 0)
+        return false;
+
+    // only the headers are read, so finding the games takes a few page reads
+    // per thousand games
+    uint64_t offset = 8, size = file.getSize();
+    while(offset + sizeof(StoredGame) <= size)
+    {
+        StoredGame header;
+        memcpy(&header, file.getData() + offset, sizeof(header));
+
+        uint64_t end = offset + sizeof(StoredGame) + (uint64_t) header.num_positions * sizeof(PackedPosition);
+        if(header.num_positions == 0 || end > size)
+            break; // partly written
+
+        offsets.push_back(offset);
+        offset = end;
+    }
+
+    return true;
+}
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Packs the current position of a chess object.
+     *
+     * @param[in]  chess     The chess object
+     * @param      position  The packed position
+     */
+    void packPosition(const Chess &chess, PackedPosition &position)
+    {
+        memset(&position, 0, sizeof(position));
+
+        vector<Piece*> board = chess.getBoard();
+        for(int square = 0; square < 64; square++)
+        {
+            Piece *piece = board[square];
+            int code = piece->isEmpty() ? 0 : (piece->isPieceWhite() ? 1 : 9) + piece->getPieceType();
+            position.squares[square / 2] |= code << (4 * (square % 2));
+        }
+
+        vector<pair<int, char>> reservoir = chess.getReservoir();
+        for(int index = 0; index < 10; index++)
+            position.reservoir[index / 2] |= (reservoir[index].first & 15) << (4 * (index % 2));
+
+        int en_passant = chess.getEnPassantSquare();
+        position.flags = (chess.getTurn() == WHITE ? 1 : 0) | (chess.getCastlingRights() << 1);
+        position.en_passant = en_passant == -1 ? 255 : en_passant;
+        position.halfmove = chess.getHalfmoveClock() < 255 ? chess.getHalfmoveClock() : 255;
+        position.num_moves[0] = chess.getNumMoves() & 255;
+        position.num_moves[1] = (chess.getNumMoves() >> 8) & 255;
+    }
+
+    /**
+     * @brief      Writes a packed position as a FEN string (in the format of
+     *             Chess::toFEN()).
+     *
+     * @param[in]  position  The packed position
+     * @param      fen       The buffer to write into (FEN_SIZE characters is
+     *                       always enough)
+     * @param[in]  size      The size of the buffer
+     *
+     * @return     The length of the written string, or -1 if the buffer is
+     *             too small.
+     */
+    int unpackPosition(const PackedPosition &position, char *fen, int size)
+    {
+        const char piece_chars[] = "pnbrqk";
+        char out[FEN_SIZE];
+        int len = 0, empty_count = 0;
+
+        // -------- piece placement -------- //
+        for(int square = 0; square < 64; square++)
+        {
+            int code = (position.squares[square / 2] >> (4 * (square % 2))) & 15;
+            if(code == 0)
+                empty_count++;
+            else
+            {
+                if(empty_count > 0)
+                    out[len++] = '0' + empty_count;
+                empty_count = 0;
+
+                char piece = piece_chars[(code - 1) % 8];
+                out[len++] = code < 9 ? toupper(piece) : piece;
+            }
+
+            if(square % 8 == 7)
+            {
+                if(empty_count > 0)
+                    out[len++] = '0' + empty_count;
+                empty_count = 0;
+
+                if(square != 63)
+                    out[len++] = '/';
+            }
+        }
+
+        // -------- piece reservoir -------- //
+        // white then black, from the most valuable piece to the least valuable
+        // (the reservoir is in the order p, n, b, r, q for black, then white)
+        out[len++] = '[';
+        for(int index : {9, 8, 7, 6, 5, 4, 3, 2, 1, 0})
+        {
+            int count = (position.reservoir[index / 2] >> (4 * (index % 2))) & 15;
+            for(int i = 0; i < count && i < 4; i++)
+                out[len++] = index >= 5 ? toupper("pnbrq"[index % 5]) : "pnbrq"[index % 5];
+        }
+        out[len++] = ']';
+
+        // -------- side to move, castling rights, en-passant square and counters -------- //
+        char castling[5] = "";
+        for(int i = 0, n = 0; i < 4; i++)
+            if(position.flags & (2 << i))
+                castling[n++] = "KQkq"[i];
+
+        char en_passant[3] = "-";
+        if(position.en_passant < 64)
+            snprintf(en_passant, sizeof(en_passant), "%c%c", 'a' + position.en_passant % 8, '8' - position.en_passant / 8);
+
+        int num_moves = position.num_moves[0] | (position.num_moves[1] << 8);
+        len += snprintf(out + len, sizeof(out) - len, " %c %s %s %d %d", position.flags & 1 ? 'w' : 'b',
+                        castling[0] != '\0' ? castling : "-", en_passant, position.halfmove, num_moves / 2 + 1);
+
+        if(len >= size)
+            return -1;
+
+        memcpy(fen, out, len + 1);
+        return len;
+    }
+
+    /**
+     * @brief      Finds the result of a game (see StoredGame::result).
+     *
+     * @param[in]  chess  The chess object
+     *
+     * @return     The result.
+     */
+    uint32_t gameResult(const Chess &chess)
+    {
+        // a checkmated (or resigning) side is the side to move
+        if(chess.getCheckmate())
+            return chess.getTurn() == WHITE ? 2 : 1;
+
+        return chess.getStalemate() ? 3 : 0;
+    }
+}
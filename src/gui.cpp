@@ -22,93 +22,106 @@
  * Simply run <b>mingw32-make all_gui</b> on a Windows machine to make the
  * executable, then navigate to <i>chessCAMO/GUI/chessCAMO.exe</i> to play
  *
- * @note       Currently all standard chess rules are supported, except three
- *             move repetition & 50 move rule.
+ * What the mouse and keys do (picking up a piece, making the move on release,
+ * the reservoir clicks and the S/U/Esc/D/Q/R/B/N/1 keys) is handled by a
+ * GuiState (see gui_state.h), which runs without a window; this file turns
+ * SFML events into its inputs and draws what it holds.
+ *
+ * The interface is event driven: it sleeps until an event arrives and only
+ * redraws the window when what it shows changed. Everything is drawn from a
+ * single texture atlas (the static board, the status and reservoir panels, and
+ * the piece images) as one batch of quads, so a frame takes one draw call (two
+ * with the frame time overlay, toggled with <b>F</b>). Run <i>chessCAMO.exe
+ * --continuous</i> to redraw the window as fast as possible instead.
+ *
+ * Games are kept across sessions in <i>saved_games.dat</i> (see
+ * game_store.h): <b>G</b> saves the game, and an unsaved game is saved when a
+ * new game is started or the window is closed. <b>L</b> lists the saved games
+ * (most recent first) and <b>1</b> to <b>9</b> resume one of them, after which
+ * the <b>Left</b> and <b>Right</b> arrows go through its moves. At start, the
+ * last saved game is resumed if it was not over.
+ *
+ * Pressing <b>A</b> toggles the analysis of the position on a worker thread
+ * (see analysis.h), which restarts after every move and is shown as an
+ * evaluation bar (left of the board) and the principal variation (below the
+ * status). The render loop only polls its lock-free mailbox, so the analysis
+ * never stalls the interface.
+ *
+ * @note       All standard chess rules are supported, including three move
+ *             repetition & 50 move rule.
  */
 
 #include <SFML/Graphics.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <sstream>
 #include <vector>
-#include "chess.h"
+#include "analysis.h"
+#include "archive.h"
+#include "gui_state.h"
 
 using namespace sf;
 using namespace std;
 
+/** The areas of the window that change during a game (drawn in the atlas) */
+const IntRect STATUS_AREA(0, 540, 600, 60), RESERVOIR_AREA(540, 30, 60, 480);
+
+/** The size of the texture atlas */
+const unsigned int ATLAS_WIDTH = 780, ATLAS_HEIGHT = 720;
+
+/** Where the background, the panels and a white patch (for solid colors) are kept in the atlas */
+const IntRect ATLAS_BOARD(0, 0, 600, 600), ATLAS_STATUS(0, 600, 600, 60), ATLAS_RESERVOIR(600, 0, 60, 480), ATLAS_WHITE(661, 1, 2, 2);
+
+/** The row of the atlas where the piece images are kept (60 x 60 each, see ChessGUI::pieceRect()) */
+const int ATLAS_PIECES_Y = 660;
+
 class ChessGUI
 {
 public:
     /**
-     * @brief      Forms the pieces for the current board representation.
+     * @brief      Finds the index of the image (in the piece types) used to
+     *             draw a piece.
      *
-     * @param      pieces     The pieces to draw on the board
-     * @param[in]  pieceType  The piece type from which the drawn piece image is obtained
-     * @param[in]  board      The current board representation
-     */
-    void formPieces(vector<Sprite> &pieces, const vector<Sprite> &pieceType, const vector<Piece*> &board)
-    {
-        for(const auto & elem : board)
-        {
-            int index = &elem - &board[0];
-            if(elem->isRook())
-                pieces[index] = elem->isPieceWhite() ? pieceType[1] : pieceType[7];
-            else if(elem->isKnight())
-                pieces[index] = elem->isPieceWhite() ? pieceType[2] : pieceType[8];
-            else if(elem->isBishop())
-                pieces[index] = elem->isPieceWhite() ? pieceType[3] : pieceType[9];
-            else if(elem->isQueen())
-                pieces[index] = elem->isPieceWhite() ? pieceType[4] : pieceType[10];
-            else if(elem->isKing())
-                pieces[index] = elem->isPieceWhite() ? pieceType[5] : pieceType[11];
-            else if(elem->isPawn())
-                pieces[index] = elem->isPieceWhite() ? pieceType[6] : pieceType[12];
-            else
-                pieces[index] = pieceType[0];
-
-            int piece_width = pieces[index].getGlobalBounds().width, piece_height = pieces[index].getGlobalBounds().height;
-            pieces[index].setPosition(piece_width/2 + piece_width * (index % 8), piece_height/2 + piece_height * (index / 8));
-        }
-    }
-
-    /**
-     * @brief      Forms the piece reservoir.
+     * @param[in]  piece  The piece
      *
-     * @param      reservoir  The piece reservoir
-     * @param[in]  pieceType  The piece type from which the drawn piece image is obtained
+     * @return     The index in [0, 12] (0 is an empty square).
      */
-    void formReservoir(vector<Sprite> &reservoir, const vector<Sprite> &pieceType)
+    int pieceIndex(Piece *piece)
     {
-        reservoir[8] = pieceType[1];  // White Rook
-        reservoir[6] = pieceType[2];  // White Knight
-        reservoir[7] = pieceType[3];  // White Bishop
-        reservoir[9] = pieceType[4];  // White Queen
-        reservoir[5] = pieceType[6];  // White Pawn
-        reservoir[3] = pieceType[7];  // Black Rook
-        reservoir[1] = pieceType[8];  // Black Knight
-        reservoir[2] = pieceType[9];  // Black Bishop
-        reservoir[4] = pieceType[10]; // Black Queen
-        reservoir[0] = pieceType[12]; // Black Pawn
-
-        for(int i = 0; i < 10; i++)
-        {
-            FloatRect shape = reservoir[i].getGlobalBounds();
-            reservoir[i].setPosition(541, shape.height/2 + (shape.height-12) * i);
-            reservoir[i].setScale((shape.width-12)/shape.width, (shape.height-12)/shape.height);
-        } 
+        int offset = piece->isPieceWhite() ? 0 : 6;
+
+        if(piece->isRook())
+            return 1 + offset;
+        else if(piece->isKnight())
+            return 2 + offset;
+        else if(piece->isBishop())
+            return 3 + offset;
+        else if(piece->isQueen())
+            return 4 + offset;
+        else if(piece->isKing())
+            return 5 + offset;
+        else if(piece->isPawn())
+            return 6 + offset;
+        else
+            return 0;
     }
 
     /**
      * @brief      Draws text to the screen according to the provided parameters.
      *
-     * @param      window       The window on which to draw
+     * @param      window       The window (or texture) on which to draw
      * @param      text_object  The text object that is used
      * @param[in]  message      The message to write
      * @param[in]  size         The size of the characters
      * @param[in]  pos_x        The x position on the screen
      * @param[in]  pos_y        The y position on the screen
-     * @param[in]  font         The font to use
+     * @param[in]  font         The font to use (loaded once, the text keeps a pointer to it)
      * @param[in]  color        The color that the text will be
      * @param[in]  style        The text's style
      */
-    void drawText(RenderWindow &window, Text &text_object, string message, int size, unsigned int pos_x, unsigned int pos_y, Font font, Color color, unsigned int style)
+    void drawText(RenderTarget &window, Text &text_object, string message, int size, unsigned int pos_x, unsigned int pos_y, const Font &font, Color color, unsigned int style)
     {
         text_object.setString(message);
         text_object.setCharacterSize(size);
@@ -123,7 +136,7 @@ public:
     /**
      * @brief      Draws a rectangle in the interface window.
      *
-     * @param      window       The window on which to draw
+     * @param      window       The window (or texture) on which to draw
      * @param      rect_object  The rectangle object that is used
      * @param[in]  width       The width of the rectangle
      * @param[in]  height       The height of the rectangle
@@ -133,7 +146,7 @@ public:
      * @param[in]  out_thick    The outline thickness (negative values go toward the center of rectangle)
      * @param[in]  out_color    The outline color
      */
-    void drawRect(RenderWindow &window, RectangleShape &rect_object, float width, float height, unsigned int pos_x, unsigned int pos_y, Color color, int out_thick, Color out_color)
+    void drawRect(RenderTarget &window, RectangleShape &rect_object, float width, float height, unsigned int pos_x, unsigned int pos_y, Color color, int out_thick, Color out_color)
     {
         rect_object.setSize(Vector2f(width, height));
         rect_object.setPosition(pos_x, pos_y);
@@ -145,497 +158,666 @@ public:
     }
 
     /**
-     * @brief      Gets the squares of legal moves.
+     * @brief      Draws the list of saved games (the 9 most recent, most recent
+     *             first) over the board.
      *
-     * @param      legalMoves  The legal moves vector
-     * @param[in]  src         The piece's source square
-     * @param      chess       The chess object
+     * @param      window  The window on which to draw
+     * @param[in]  store   The saved games
+     * @param[in]  font    The font to use
+     */
+    void drawGameList(RenderTarget &window, const GameStore &store, const Font &font)
+    {
+        const char *results[] = {"*", "1-0", "0-1", "1/2-1/2"};
+        string list = "Saved games (1-9 to resume, L to close)\n\n";
+
+        for(uint32_t i = 0; i < 9 && i < store.getNumGames(); i++)
+        {
+            StoredGame game = store.getGame(store.getNumGames() - 1 - i);
+            time_t saved_time = (time_t) game.saved_time;
+            char date[32] = "", line[96];
+            if(const tm *local = localtime(&saved_time))
+                strftime(date, sizeof(date), "%Y-%m-%d %H:%M", local);
+
+            snprintf(line, sizeof(line), "%u.  %s   %u moves   %s\n", i + 1, date, game.num_positions - 1,
+                     results[game.result < 4 ? game.result : 0]);
+            list += line;
+        }
+
+        if(store.getNumGames() == 0)
+            list += "No saved games yet (G saves the game)";
+
+        RectangleShape panel;
+        Text text;
+        drawRect(window, panel, 440, 440, 50, 50, Color(0, 0, 0, 220), 2, Color::White);
+        drawText(window, text, list, 16, 70, 70, font, Color::White, Text::Regular);
+    }
+
+    /**
+     * @brief      Draws the parts of the interface that never change: the
+     *             board squares, the files and ranks, and the reservoir frame.
+     *
+     * @param      target  The texture on which to draw
+     * @param[in]  font    The font to use
+     */
+    void drawBackground(RenderTarget &target, const Font &font)
+    {
+        // board sizes
+        const int numRows = 10;
+        const int numCols = 10;
+        const int distance = 60; //distance between squares
+        Vector2f size_rect(60.0, 60.0); // main squares
+        RectangleShape rect(size_rect);
+        Text text;
+
+        // colors used for board square coloring
+        Color color_dark(211, 211, 211, 255);
+        Color color_yellow(255, 255, 153, 255);
+        Color color_orange(255, 204, 153, 255);
+        Color color_red(255, 204, 204, 255);
+
+        target.clear();
+
+        // -------------- main grid -------------- //
+        for(int i = 0; i < numRows; i++)
+        {
+            for(int j = 0; j < numCols; j++)
+            {
+                // top and bottom rows
+                if((i == 0 || i == 9) && (1 <= j && j <= 8))
+                {
+                    if (i == 0)
+                        drawRect(target, rect, size_rect.x, size_rect.y/2, j * distance - size_rect.x/2, i * distance, (i + j) % 2 != 0 ? color_yellow : color_orange, 0, Color::Transparent);
+                    else
+                        drawRect(target, rect, size_rect.x, size_rect.y/2, j * distance - size_rect.x/2, i * distance - size_rect.y/2, (i + j) % 2 == 0 ? color_yellow : color_orange, 0, Color::Transparent);
+                }
+
+                // left and right columns
+                else if((j == 0 || j == 9) && (1 <= i && i <= 8))
+                {
+                    if (j == 0)
+                        drawRect(target, rect, size_rect.x/2, size_rect.y, j * distance, i * distance - size_rect.y/2, (i + j) % 2 != 0 ? color_yellow : color_orange, 0, Color::Transparent);
+                    else
+                        drawRect(target, rect, size_rect.x/2, size_rect.y, j * distance - size_rect.x/2, i * distance - size_rect.y/2, (i + j) % 2 == 0 ? color_yellow : color_orange, 0, Color::Transparent);
+                }
+
+                // corners
+                else if((i == 0 && j == 0) || (i == 9 && j == 0) || (i == 0 && j == 9) || (i == 9 && j == 9))
+                {
+                    if(i == 0 && j == 0)
+                        drawRect(target, rect, size_rect.x/2, size_rect.y/2, j * distance, i * distance, color_red, 0, Color::Transparent);
+                    else if(i == 0 && j == 9)
+                        drawRect(target, rect, size_rect.x/2, size_rect.y/2, j * distance - size_rect.x/2, i * distance, color_red, 0, Color::Transparent);
+                    else if(i == 9 && j == 0)
+                        drawRect(target, rect, size_rect.x/2, size_rect.y/2, j * distance, i * distance - size_rect.y/2, color_red, 0, Color::Transparent);
+                    else if(i == 9 && j == 9)
+                        drawRect(target, rect, size_rect.x/2, size_rect.y/2, j * distance - size_rect.x/2, i * distance - size_rect.y/2, color_red, 0, Color::Transparent);
+                }
+
+                // middle squares
+                else
+                    drawRect(target, rect, size_rect.x, size_rect.y, j * distance - size_rect.x/2, i * distance - size_rect.y/2, (i + j) % 2 != 0 ? color_dark : Color::White, 0, Color::Transparent);
+            }
+        }
+
+        // main grid text (files and ranks)
+        string piece_file[8] = {"A", "B", "C", "D", "E", "F", "G", "H"};
+        string piece_rank[8] = {"8", "7", "6", "5", "4", "3", "2", "1"};
+
+        // top and bottom rows
+        for(int j = 1; j < numCols-1; j++)
+        {
+            int x = (j * distance) - 8, y1 = 5, y2 = size_rect.y * (numRows - 1) - 25;
+            drawText(target, text, piece_file[j - 1], 20, x, y1, font, Color::Black, Text::Bold);
+            drawText(target, text, piece_file[j - 1], 20, x, y2, font, Color::Black, Text::Bold);
+        }
+
+        // left and right columns
+        for(int i = 1; i < numRows-1; i++)
+        {
+            int y = (i * distance) - 10, x1 = 10, x2 = size_rect.x * (numCols - 1) - 20;
+            drawText(target, text, piece_rank[i - 1], 20, x1, y, font, Color::Black, Text::Bold);
+            drawText(target, text, piece_rank[i - 1], 20, x2, y, font, Color::Black, Text::Bold);
+        }
+
+        // reservoir rects
+        for(int k = 0; k <= 11; k++)
+        {
+            if(k == 0 || k == 11)
+                drawRect(target, rect, size_rect.x, size_rect.y/2, 540, k == 0 ? 0 : 510, Color(204, 255, 204), 0, Color::Transparent);
+            else
+                drawRect(target, rect, size_rect.x, size_rect.y-12, 540, size_rect.x/2 + (k-1) * (distance-12), k > 5 ? Color(255, 255, 255) : Color(224, 224, 224), -1, Color::Black);
+        }
+
+        // reservoir text
+        drawText(target, text, "RSVR", 20, 541, 5, font, Color::Black, Text::Bold);
+        drawText(target, text, "RSVR", 20, 541, 515, font, Color::Black, Text::Bold);
+    }
+
+    /**
+     * @brief      Builds the texture atlas: the background, the panels that
+     *             change and the piece images, so that a frame is drawn from a
+     *             single texture (see ChessGUI::formBatch()).
      *
-     * @pre        None
-     * 
-     * @post       A vector of legal moves squares by reference
+     * @param      atlas       The atlas (ATLAS_WIDTH x ATLAS_HEIGHT)
+     * @param[in]  background  The background (see ChessGUI::drawBackground())
+     * @param[in]  pieceType   The piece images, in the order of ChessGUI::pieceIndex()
      */
-    void getLegalMoves(vector<int> &legalMoves, int src, Chess &chess)
+    void formAtlas(RenderTexture &atlas, const Texture &background, const vector<Texture> &pieceType)
     {
-        vector<Piece*> board = chess.getBoard();
+        RectangleShape rect;
+
+        atlas.clear(Color::Transparent);
+
+        copyArea(atlas, background, IntRect(0, 0, 600, 600), ATLAS_BOARD);
+        copyArea(atlas, background, STATUS_AREA, ATLAS_STATUS);
+        copyArea(atlas, background, RESERVOIR_AREA, ATLAS_RESERVOIR);
+
+        for(unsigned int i = 0; i < pieceType.size(); i++)
+        {
+            Sprite piece(pieceType[i]);
+            piece.setPosition(pieceRect(i).left, pieceRect(i).top);
+            atlas.draw(piece);
+        }
 
-        for(unsigned int dest = 0; dest < board.size(); dest++)
-            if(board[src]->isLegalMove(dest, chess))
-                legalMoves.push_back(dest);
+        // solid colors (highlighting) are drawn from this patch
+        drawRect(atlas, rect, ATLAS_WHITE.width, ATLAS_WHITE.height, ATLAS_WHITE.left, ATLAS_WHITE.top, Color::White, 0, Color::Transparent);
+
+        atlas.display();
     }
 
     /**
-     * @brief      Gets the squares of all pieces that match the turn type
+     * @brief      Finds the area of the atlas that holds a piece image.
      *
-     * @param      sideSquares  The squares of the side whose turn it is
-     *                          currently.
-     * @param      chess        The chess object
+     * @param[in]  index  The index of the image (see ChessGUI::pieceIndex())
      *
-     * @pre        None
+     * @return     The area of the atlas.
+     */
+    IntRect pieceRect(int index)
+    {
+        return IntRect(60 * index, ATLAS_PIECES_Y, 60, 60);
+    }
+
+    /**
+     * @brief      Copies an area of a texture to another place of a target.
      *
-     * @post       A vector of squares corresponding to pieces with same color
-     *             as current turn by reference
+     * @param      target   The target on which to draw
+     * @param[in]  texture  The texture to copy from
+     * @param[in]  from     The area of the texture
+     * @param[in]  to       The area of the target (only its position is used)
      */
-    void getSideToMoveSquares(vector<int> &sideSquares, Chess &chess)
+    void copyArea(RenderTarget &target, const Texture &texture, IntRect from, IntRect to)
     {
-        for(const auto & elem : chess.getBoard())
-            if(elem->getPieceColor() == chess.getTurn())
-                sideSquares.push_back(elem->getPieceSquare());
+        Sprite patch(texture, from);
+        patch.setPosition(to.left, to.top);
+        target.draw(patch);
     }
 
     /**
-     * @brief      Resets the position to the corresponding position indicated
-     *             by 'move_num'
+     * @brief      Redraws the reservoir panel (background and quantities) in
+     *             the atlas. The reservoir pieces are drawn over it by the
+     *             batch.
      *
-     * @param[in]  file_status     The file path for status information
-     * @param[in]  file_promotion  The file path for promotion information
-     * @param[in]  message         The message to use as a warning
-     * @param[in]  move_num        The move number to revert the position to
-     * @param      chess           The chess object
-     * @param      sideSquares     The squares of pieces whose turn it will be (updated by reference)
+     * @param      atlas       The atlas
+     * @param[in]  background  The background (see ChessGUI::drawBackground())
+     * @param[in]  num_left    The number of pieces left of each reservoir piece
+     * @param[in]  font        The font to use
      */
-    void resetPosition(string file_status, string file_promotion, string message, int move_num, Chess &chess, vector<int> &sideSquares)
+    void drawReservoir(RenderTexture &atlas, const Texture &background, const vector<int> &num_left, const Font &font)
     {
-        ofstream messageOut(file_status, ios::trunc);
+        Text text_reservoir;
 
-        // fill up the first 23 lines with junk (status line reads 24th line)
-        for(int i = 0; i < 23; i++)
-            messageOut << "temp" << endl;
+        copyArea(atlas, background, RESERVOIR_AREA, ATLAS_RESERVOIR);
 
-        // send the warning to the output stream, then close the stream
-        messageOut << message << endl;
-        messageOut.close();
+        for(unsigned int i = 0; i < num_left.size(); i++)
+            drawText(atlas, text_reservoir, "x" + to_string(num_left[i]), 12, ATLAS_RESERVOIR.left + 45, ATLAS_RESERVOIR.top + 15 + i*48, font, i > 4 ? Color(0, 102, 0) : Color(204, 0, 0), Text::Regular);
+
+        atlas.display();
+    }
+
+    /**
+     * @brief      Redraws the status panel (below the board) in the atlas.
+     *
+     * @param      atlas           The atlas
+     * @param[in]  background      The background (see ChessGUI::drawBackground())
+     * @param[in]  first_message   The side to move
+     * @param[in]  second_message  The warning or status update (empty for none)
+     * @param[in]  font            The font to use
+     */
+    void drawStatus(RenderTexture &atlas, const Texture &background, const string &first_message, const string &second_message, const Font &font)
+    {
+        Text text_bottom;
+        int y = ATLAS_STATUS.top + 20;
 
-        // set move counter accordingly
-        chess.setNumMoves(move_num);
+        copyArea(atlas, background, STATUS_AREA, ATLAS_STATUS);
 
-        // restore previous object
-        chessCAMO::restoreObject(chess);
+        drawText(atlas, text_bottom, "Status:", 20, 30, y, font, Color::Green, Text::Regular);
+        drawText(atlas, text_bottom, first_message, 20, 120, y, font, Color::Cyan, Text::Regular);
 
-        // update side to move square highlighting
-        sideSquares.clear();
-        getSideToMoveSquares(sideSquares, chess);
+        if(!second_message.empty())
+            drawText(atlas, text_bottom, second_message, 20, 260, y, font, Color::Yellow, Text::Regular);
 
-        // default promotion is Queen (always, even if program ends after another piece is set)
-        streamIO(file_promotion, "q", false, chess);
+        atlas.display();
     }
 
     /**
-     * @brief      Writes data to an output stream (file) and reads in data from
-     *             an input stream (file) as need. Used for promotion and
-     *             warning messages.
+     * @brief      Adds a textured quad to a batch.
      *
-     * @param[in]  file_path       The file path to read/write from
-     * @param[in]  message         The message to write
-     * @param[in]  draw_or_resign  Whether to apply the drawOrResign function
-     * @param      chess           The chess object
+     * @param      batch    The batch (of quads)
+     * @param[in]  area     The area of the window
+     * @param[in]  texture  The area of the atlas
+     * @param[in]  color    The color the texture is multiplied by
      */
-    void streamIO(string file_path, string message, bool draw_or_resign, Chess &chess)
+    void appendQuad(VertexArray &batch, FloatRect area, IntRect texture, Color color)
     {
-        streambuf *coutbuf;
-
-        // open files
-        ofstream messageOut(file_path, ios::trunc);
-        ifstream messageIn(file_path);
-
-        // redirect output stream to the output file
-        coutbuf = cout.rdbuf();
-        cout.rdbuf(messageOut.rdbuf());
-    
-        // send the message to the file (each character is written on new line)
-        for(unsigned int i = 0; i < message.size(); i++)
-            messageOut << message[i] << endl;
-
-        // apply drawOrResign function if needed
-        if(draw_or_resign)
-            chessCAMO::drawOrResign(false, chess, messageIn);
-
-        // redirect output stream back to cout
-        cout.rdbuf(coutbuf);
-
-        // close the opened files
-        messageIn.close();
-        messageOut.close();
+        float left = texture.left, top = texture.top, right = left + texture.width, bottom = top + texture.height;
+
+        batch.append(Vertex(Vector2f(area.left, area.top), color, Vector2f(left, top)));
+        batch.append(Vertex(Vector2f(area.left + area.width, area.top), color, Vector2f(right, top)));
+        batch.append(Vertex(Vector2f(area.left + area.width, area.top + area.height), color, Vector2f(right, bottom)));
+        batch.append(Vertex(Vector2f(area.left, area.top + area.height), color, Vector2f(left, bottom)));
     }
-};
 
-int main()
-{
-    // front end (GUI)
-    ChessGUI chess_gui;
+    /**
+     * @brief      Adds the outline of a square (toward its center) to a batch.
+     *
+     * @param      batch      The batch (of quads)
+     * @param[in]  square     The square in [0, 63]
+     * @param[in]  thickness  The thickness of the outline
+     * @param[in]  color      The color of the outline
+     */
+    void appendOutline(VertexArray &batch, int square, float thickness, Color color)
+    {
+        float x = 30 + 60 * (square % 8), y = 30 + 60 * (square / 8);
 
-    // back end computation
-    Chess chess;
+        appendQuad(batch, FloatRect(x, y, 60, thickness), ATLAS_WHITE, color);
+        appendQuad(batch, FloatRect(x, y + 60 - thickness, 60, thickness), ATLAS_WHITE, color);
+        appendQuad(batch, FloatRect(x, y + thickness, thickness, 60 - 2*thickness), ATLAS_WHITE, color);
+        appendQuad(batch, FloatRect(x + 60 - thickness, y + thickness, thickness, 60 - 2*thickness), ATLAS_WHITE, color);
+    }
 
-    // Create 8x8 default board
-    chess.boardInit();
+    /**
+     * @brief      Forms the batch of quads that draws the whole window (board,
+     *             panels, highlighting, pieces and reservoir pieces) from the
+     *             atlas in a single draw call.
+     *
+     * @param      batch       The batch (of quads)
+     * @param[in]  board       The current board representation
+     * @param[in]  highlights  The highlighting of each square (0 for none, 1
+     *                         for a legal move, 2 for a piece of the side to
+     *                         move)
+     * @param[in]  lifted      The square of the piece being dragged (-1 for none)
+     * @param[in]  drag_pos    The position of the dragged piece's center
+     * @param[in]  white_share The share of the evaluation bar that is white,
+     *                         in [0, 1] (negative to hide the bar)
+     */
+    void formBatch(VertexArray &batch, const vector<Piece*> &board, const vector<int> &highlights, int lifted, Vector2i drag_pos, float white_share)
+    {
+        // images of the reservoir pieces (black then white pawn, knight, bishop, rook, queen)
+        const int reservoir_images[10] = {12, 8, 9, 7, 10, 6, 2, 3, 1, 4};
 
-    // Move & Side highlighting
-    vector<int> legalMoves, sideSquares;
+        batch.clear();
 
-    // The window on which to draw the pieces
-    RenderWindow window(VideoMode(600, 600), "chessCAMO", Style::Titlebar | Style::Close);
+        // board and panels
+        appendQuad(batch, FloatRect(0, 0, 600, 600), ATLAS_BOARD, Color::White);
+        appendQuad(batch, FloatRect(STATUS_AREA), ATLAS_STATUS, Color::White);
+        appendQuad(batch, FloatRect(RESERVOIR_AREA), ATLAS_RESERVOIR, Color::White);
 
-    // Pieces
-    Texture blank, w1, w2, w3, w4, w5, w6, b1, b2, b3, b4, b5, b6;
-    blank.loadFromFile("images/blank.png");
-    w1.loadFromFile("images/wr.png");
-    w2.loadFromFile("images/wn.png");
-    w3.loadFromFile("images/wb.png");
-    w4.loadFromFile("images/wq.png");
-    w5.loadFromFile("images/wk.png");
-    w6.loadFromFile("images/wp.png");
-    b1.loadFromFile("images/br.png");
-    b2.loadFromFile("images/bn.png");
-    b3.loadFromFile("images/bb.png");
-    b4.loadFromFile("images/bq.png");
-    b5.loadFromFile("images/bk.png");
-    b6.loadFromFile("images/bp.png");
-
-    Sprite sBlank(blank), sWr(w1), sWn(w2), sWb(w3), sWq(w4), sWk(w5), sWp(w6), sBr(b1), sBn(b2), sBb(b3), sBq(b4), sBk(b5), sBp(b6);
-
-    // updated continously throughout the program's life-cycle
-    vector<Sprite> pieceType = {sBlank, sWr, sWn, sWb, sWq, sWk, sWp, sBr, sBn, sBb, sBq, sBk, sBp};
-    vector<Sprite> pieces(64);
-    vector<Sprite> reservoir(10);
-
-    chess_gui.formPieces(pieces, pieceType, chess.getBoard());
-    chess_gui.formReservoir(reservoir, pieceType);
-
-    // text related information
-    Text text, text_bottom, text_reservoir;
-    Font font;
+        for(int i = 0; i < 10; i++)
+            appendQuad(batch, FloatRect(541, 30 + 48*i, 48, 48), pieceRect(reservoir_images[i]), Color::White);
 
-    // board sizes
-    const int numRows = 10;
-    const int numCols = 10;
-    const int distance = 60; //distance between squares
-    Vector2f size_rect(60.0, 60.0); // main squares
-    RectangleShape rect(size_rect);
+        // evaluation bar (white fills it from the bottom, on white's side)
+        if(white_share >= 0)
+        {
+            appendQuad(batch, FloatRect(2, 30, 6, 480), ATLAS_WHITE, Color(64, 64, 64));
+            appendQuad(batch, FloatRect(2, 30 + 480 * (1 - white_share), 6, 480 * white_share), ATLAS_WHITE, Color::White);
+        }
 
-    // colors used for board square coloring
-    Color color_dark(211, 211, 211, 255);
-    Color color_yellow(255, 255, 153, 255);
-    Color color_orange(255, 204, 153, 255);
-    Color color_red(255, 204, 204, 255);
+        // highlighting
+        for(int square = 0; square < 64; square++)
+        {
+            if(highlights[square] == 1)
+                appendOutline(batch, square, 2, Color::Cyan);
+            else if(highlights[square] == 2)
+                appendOutline(batch, square, 1, Color(178, 255, 102));
+        }
 
-    // variables for non-event driven behaviour
-    bool clicked = false, draw = false, resign = false, new_game = false;
-    bool enable_side_highlighting = true, enable_move_highlighting = true;
+        // pieces (the dragged piece goes last, so it is on top)
+        for(int square = 0; square < 64; square++)
+        {
+            int index = pieceIndex(board[square]);
+            if(index != 0 && square != lifted)
+                appendQuad(batch, FloatRect(30 + 60 * (square % 8), 30 + 60 * (square / 8), 60, 60), pieceRect(index), Color::White);
+        }
 
-    // files for promotion and status information updates
-    string filename_promotion = "../GUI/object_states/promotion.txt";
-    string filename_status = "../GUI/object_states/status.txt";
+        if(0 <= lifted && lifted <= 63 && pieceIndex(board[lifted]) != 0)
+            appendQuad(batch, FloatRect(drag_pos.x - 30, drag_pos.y - 30, 60, 60), pieceRect(pieceIndex(board[lifted])), Color::White);
+    }
 
-    // clear warning file
-    chess_gui.streamIO(filename_status, " ", false, chess);
+};
 
-    // default promotion is Queen (always, even if program ends after another piece is set)
-    chess_gui.streamIO(filename_promotion, "q", false, chess);
+int main(int argc, char *argv[])
+{
+    // front end (GUI)
+    ChessGUI chess_gui;
+
+    // back end computation (what the mouse and keys do, see gui_state.h)
+    GuiState state;
+    Chess &chess = state.getChess();
 
-    // at game start highlight white pieces
-    chess_gui.getSideToMoveSquares(sideSquares, chess); 
+    // redraw everything as fast as possible (the old behaviour) if asked
+    bool continuous = argc > 1 && strcmp(argv[1], "--continuous") == 0;
+
+    // saved games (the last one is resumed where it was left, unless it was over)
+    GameStore store;
+    bool show_games = false;
+    if(!store.open("saved_games.dat"))
+        cout << "failed to open the saved games" << endl;
+    else if(store.getNumGames() > 0 && store.getGame(store.getNumGames() - 1).result == 0)
+        state.resume(store, store.getNumGames() - 1, store.getGame(store.getNumGames() - 1).num_positions - 1);
+
+    // The window on which to draw the pieces
+    RenderWindow window(VideoMode(600, 600), "chessCAMO", Style::Titlebar | Style::Close);
+
+    // Pieces (in the order of ChessGUI::pieceIndex(), only needed to build the atlas)
+    string images[] = {"blank", "wr", "wn", "wb", "wq", "wk", "wp", "br", "bn", "bb", "bq", "bk", "bp"};
+    vector<Texture> pieceType(13);
+    for(unsigned int i = 0; i < pieceType.size(); i++)
+        pieceType[i].loadFromFile("images/" + images[i] + ".png");
+
+    // the font is loaded once (texts keep a pointer to it)
+    Font font;
+    if(!font.loadFromFile("font/arial.ttf"))
+        cout << "failed to load font file" << endl;
+
+    // the static parts of the interface are drawn once, then everything that is
+    // drawn comes from the atlas
+    RenderTexture background, atlas;
+    background.create(600, 600);
+    atlas.create(ATLAS_WIDTH, ATLAS_HEIGHT);
+
+    chess_gui.drawBackground(background, font);
+    background.display();
+    chess_gui.formAtlas(atlas, background.getTexture(), pieceType);
+
+    VertexArray batch(Quads);
+
+    // what the panels of the atlas showed when last drawn (NEUTRAL, not
+    // drawn yet)
+    vector<int> num_left(10), drawn_reservoir;
+    pieceColor drawn_turn = NEUTRAL;
+    string drawn_message;
+
+    // the cursors are made once and only set when the cursor enters/leaves
+    // the clickable area
+    Cursor hand_cursor, not_allowed_cursor;
+    hand_cursor.loadFromSystem(Cursor::Hand);
+    not_allowed_cursor.loadFromSystem(Cursor::NotAllowed);
+    int cursor_state = -1;
+
+    // frame time overlay (toggled with 'F')
+    Text overlay;
+    overlay.setOutlineColor(Color::Black);
+    overlay.setOutlineThickness(1);
+    bool show_overlay = false;
+    double frame_ms = 0;
+    Clock clock;
+
+    // background analysis (toggled with 'A')
+    Analysis analysis;
+    AnalysisInfo analysis_info;
+    Text analysis_text;
+    bool analysing = false, analysis_done = true, analysis_restart = false;
+    unsigned int analysed_position = 0;
+    uint64_t analysed_hash = 0;
+
+    // the position of the mouse (for dragging)
+    Vector2i pos;
+
+    // the first frame is drawn without waiting for an event
+    bool first_frame = true;
 
     while(window.isOpen())
     {
-        Vector2i pos = Mouse::getPosition(window);
-        int src, dest;
-        vector<Sprite>::const_iterator iter;
-
         Event e;
-        bool x_cursor = (30 < pos.x && pos.x < 510) || (540 < pos.x && pos.x < 600);
-        bool y_cursor = 30 < pos.y && pos.y < 510;
-        Cursor cursor;
-        if( ( (x_cursor && y_cursor) || (540 < pos.x && pos.y < 0) ) && cursor.loadFromSystem(sf::Cursor::Hand) )
-            window.setMouseCursor(cursor);
-        else if(cursor.loadFromSystem(sf::Cursor::NotAllowed))
-            window.setMouseCursor(cursor);
-
-        while(window.pollEvent(e))
+
+        // sleep until something happens (continuous mode polls instead, and a
+        // running analysis is checked for new results every 10 ms)
+        bool has_event;
+        if(continuous || first_frame)
+            has_event = window.pollEvent(e);
+        else if(analysing && !analysis_done)
+        {
+            has_event = window.pollEvent(e);
+            if(!has_event)
+                sf::sleep(milliseconds(10));
+        }
+        else
+            has_event = window.waitEvent(e);
+
+        bool repaint = first_frame || continuous;
+
+        for(; has_event; has_event = window.pollEvent(e))
         {
             if(e.type == Event::Closed)
+            {
+                if(state.getUnsaved())
+                    state.save(store);
                 window.close();
+                break;
+            }
 
-            if(e.type == Event::KeyPressed)
-            {
-                // reset the game
-                if(e.key.code == Keyboard::S) 
-                {
-                    chess_gui.resetPosition(filename_status, filename_promotion, "New game started, good luck!", 0, chess, sideSquares);
+            // the window may have been covered, and any key or button may
+            // change what is shown
+            if( e.type == Event::GainedFocus || e.type == Event::Resized || e.type == Event::KeyPressed ||
+                e.type == Event::MouseButtonPressed || e.type == Event::MouseButtonReleased )
+                repaint = true;
 
-                    // form the pieces for the new board representation
-                    chess_gui.formPieces(pieces, pieceType, chess.getBoard());
+            if(e.type == Event::MouseMoved)
+            {
+                pos = Vector2i(e.mouseMove.x, e.mouseMove.y);
 
-                    new_game = true;
-                    resign = false;
-                }
-                 
-                // undo move
-                else if(e.key.code == Keyboard::U && !resign) 
-                {   
-                    chess_gui.resetPosition(filename_status, filename_promotion, "Undo move applied", chess.getNumMoves()-1, chess, sideSquares);
-
-                    // form the pieces for the new board representation
-                    chess_gui.formPieces(pieces, pieceType, chess.getBoard());
+                int hover = GuiState::isClickable(pos.x, pos.y) ? 1 : 0;
+                if(hover != cursor_state)
+                {
+                    window.setMouseCursor(hover == 1 ? hand_cursor : not_allowed_cursor);
+                    cursor_state = hover;
                 }
-            }
 
-            if(!chess.getCheckmate() && !chess.getStalemate())
+                // piece drag & drop functionality
+                if(state.moveMouse(pos.x, pos.y))
+                    repaint = true;
+            }
+            else if(e.type == Event::MouseButtonPressed && e.mouseButton.button == Mouse::Left)
+            {
+                pos = Vector2i(e.mouseButton.x, e.mouseButton.y);
+                state.press(pos.x, pos.y);
+            }
+            else if(e.type == Event::MouseButtonReleased && e.mouseButton.button == Mouse::Left)
             {
-                if(e.type == Event::KeyPressed)
+                pos = Vector2i(e.mouseButton.x, e.mouseButton.y);
+                state.release(pos.x, pos.y);
+            }
+            // resume one of the listed games (at its last move)
+            else if(e.type == Event::KeyPressed && show_games && Keyboard::Num1 <= e.key.code && e.key.code <= Keyboard::Num9)
+            {
+                uint32_t listed = e.key.code - Keyboard::Num1;
+                if(listed < store.getNumGames())
                 {
-                    // resign
-                    if(e.key.code == Keyboard::Escape)
-                    {
-                        chess_gui.streamIO(filename_status, "r", true, chess);
-                        resign = true;
-                        new_game = false;
-                    }
-
-                    // draw
-                    else if(e.key.code == Keyboard::D)
-                    {
-                        chess_gui.streamIO(filename_status, "dn", true, chess);
-                        draw = true;
-                        new_game = false;
-                    }
-
-                    // promotion handling
-                    else if(e.key.code == Keyboard::R)
-                        chess_gui.streamIO(filename_promotion, "r", false, chess);
-                    else if(e.key.code == Keyboard::B)
-                        chess_gui.streamIO(filename_promotion, "b", false, chess);
-                    else if(e.key.code == Keyboard::N)
-                        chess_gui.streamIO(filename_promotion, "n", false, chess);
-                    else if(e.key.code == Keyboard::Q)
-                        chess_gui.streamIO(filename_promotion, "q", false, chess);
-                    
-                    // move & side highlighting
-                    else if(e.key.code == Keyboard::Num1)
-                        enable_side_highlighting = !enable_side_highlighting; // toggle on/off
-                    else if(e.key.code == Keyboard::Numpad1)
-                        enable_move_highlighting = !enable_move_highlighting; // toggle on/off
+                    uint32_t game = store.getNumGames() - 1 - listed;
+                    state.resume(store, game, store.getGame(game).num_positions - 1);
+                    show_games = false;
                 }
-
-                if(e.type == Event::MouseButtonPressed)
+            }
+            else if(e.type == Event::KeyPressed)
+            {
+                switch(e.key.code)
                 {
-                    // allow click only on the board or reservoir pieces
-                    bool x_cursor = (30 < pos.x && pos.x < 510) || (540 < pos.x && pos.x < 600);
-                    bool y_cursor = 30 < pos.y && pos.y < 510;
-                    if(e.mouseButton.button == Mouse::Left && x_cursor && y_cursor)
-                    {
-                        clicked = true;
-                        draw = false;
-
-                        for(iter = pieces.begin(); iter != pieces.end(); iter++)
-                            if(iter->getGlobalBounds().contains(pos.x, pos.y))
-                                src = iter - pieces.begin();
-
-                        // reservoir piece to 'src' square converting
-                        if( (540 <= pos.x && pos.x <= 600) && ( (30 <= pos.y && pos.y < 78) || (270 <= pos.y && pos.y < 318) ) ) { src = (int) 'p'; }
-                        else if( (540 <= pos.x && pos.x <= 600) && ( (78 <= pos.y && pos.y < 126) || (318 <= pos.y && pos.y < 366) ) ) { src = (int) 'n'; }
-                        else if( (540 <= pos.x && pos.x <= 600) && ( (126 <= pos.y && pos.y < 174) || (366 <= pos.y && pos.y < 414) ) ) { src = (int) 'o'; } // bishop
-                        else if( (540 <= pos.x && pos.x <= 600) && ( (174 <= pos.y && pos.y < 222) || (414 <= pos.y && pos.y < 462) ) ) { src = (int) 'r'; }
-                        else if( (540 <= pos.x && pos.x <= 600) && ( (222 <= pos.y && pos.y < 270) || (462 <= pos.y && pos.y <= 510) ) ) { src = (int) 'q'; }
-
-                        // if clicked on main board piece, get its legal moves and remove side to move higlighting
-                        if(0 <= src && src <= 63)
-                        {
-                            chess_gui.getLegalMoves(legalMoves, src, chess); // updates legalMoves by reference
-                            sideSquares.clear();
-                        }
-                    }
+                    // reset the game (saving it first)
+                    case Keyboard::S:
+                        if(state.getUnsaved())
+                            state.save(store);
+                        state.pressKey(KEY_NEW_GAME);
+                        break;
+
+                    case Keyboard::U:       state.pressKey(KEY_UNDO); break;               // undo move
+                    case Keyboard::Escape:  state.pressKey(KEY_RESIGN); break;             // resign
+                    case Keyboard::D:       state.pressKey(KEY_DRAW); break;               // draw
+                    case Keyboard::Q:       state.pressKey(KEY_QUEEN); break;              // promotion handling
+                    case Keyboard::R:       state.pressKey(KEY_ROOK); break;
+                    case Keyboard::B:       state.pressKey(KEY_BISHOP); break;
+                    case Keyboard::N:       state.pressKey(KEY_KNIGHT); break;
+                    case Keyboard::Num1:    state.pressKey(KEY_SIDE_HIGHLIGHTING); break;  // move & side highlighting
+                    case Keyboard::Numpad1: state.pressKey(KEY_MOVE_HIGHLIGHTING); break;
+
+                    // saved games
+                    case Keyboard::G:
+                        state.save(store);
+                        break;
+                    case Keyboard::L:
+                        show_games = !show_games; // toggle on/off
+                        break;
+
+                    // go through the moves of a resumed game
+                    case Keyboard::Left:
+                    case Keyboard::Right:
+                        if(state.getResumedGame() >= 0 && (e.key.code == Keyboard::Right || state.getPly() > 0))
+                            state.resume(store, state.getResumedGame(), state.getPly() + (e.key.code == Keyboard::Right ? 1 : -1));
+                        break;
+
+                    // frame time overlay
+                    case Keyboard::F:
+                        show_overlay = !show_overlay; // toggle on/off
+                        break;
+
+                    // background analysis
+                    case Keyboard::A:
+                        analysing = !analysing; // toggle on/off
+                        analysis_restart = analysing;
+                        analysis_done = true;
+                        analysis_info = AnalysisInfo();
+                        if(!analysing)
+                            analysis.stop();
+                        break;
+
+                    default:
+                        break;
                 }
+            }
+        }
 
-                if(e.type == Event::MouseButtonReleased)
-                {
-                    if(e.mouseButton.button == Mouse::Left)
-                    {
-                        clicked = false;
-                        dest = int((pos.x / size_rect.x) - 0.5) + 8 * int((pos.y / size_rect.y) - 0.5);
-
-                        // make the move and output messages to the correct output stream. 
-                        // input stream is needed in case of promotion
-                        ofstream messageOut(filename_status, ios::trunc);
-                        streambuf *coutbuf = cout.rdbuf();
-                        cout.rdbuf(messageOut.rdbuf());
-
-                        ifstream in(filename_promotion);
-                        chess.makeMove(src, dest, in);
-                        in.close();
-
-                        cout.rdbuf(coutbuf);
-                        messageOut.close();
-
-                        // reform the pieces on the board based on the new move made
-                        chess_gui.formPieces(pieces, pieceType, chess.getBoard());
-
-                        // clear all legal moves for next cycle and change the side to move highighting
-                        if(0 <= src && src <= 63)
-                        {
-                            legalMoves.clear();
-                            chess_gui.getSideToMoveSquares(sideSquares, chess); // updates sideSquares by reference
-                        }
-                    }
-                }
+        if(!window.isOpen())
+            break;
 
-                // piece drag & drop functionality (only applied to main board pieces - not reservoir pieces)
-                if(clicked)
-                {
-                    if(0 <= src && src <= 63)
-                        pieces[src].setPosition(pos.x - size_rect.x / 2, pos.y - size_rect.y / 2);
-                }
-            }  
+        // -------- background analysis -------- //
+        // restart it when the position changed, and show its latest result
+        if(analysing && (analysis_restart || chess.getHash() != analysed_hash))
+        {
+            analysed_position = analysis.start(chess);
+            analysed_hash = chess.getHash();
+            analysis_restart = false;
+            analysis_done = false;
+            analysis_info = AnalysisInfo();
+            repaint = true;
         }
 
-        window.clear();
+        AnalysisInfo latest;
+        if(analysing && analysis.poll(latest) && latest.position == analysed_position)
+        {
+            analysis_info = latest;
+            analysis_done = latest.done;
+            repaint = true;
+        }
+
+        clock.restart();
+
+        // -------- redraw the panels of the atlas that changed -------- //
+        for(unsigned int i = 0; i < num_left.size(); i++)
+            num_left[i] = chess.getReservoirCount(i);
 
-        // -------- User Interface Drawing -------- //
-        if(font.loadFromFile("font/arial.ttf"))
+        if(num_left != drawn_reservoir)
         {
-            // -------- Status Panel -------- //
-            chess_gui.drawText(window, text_bottom, "Status:", 20, 30, 560, font, Color::Green, Text::Regular);
-
-            string first_message = chess.getTurn() == WHITE ? "White's move" : "Black's move", second_message;
-            chess_gui.drawText(window, text_bottom, first_message, 20, 120, 560, font, Color::Cyan, Text::Regular);
-
-            // warning and status update messages are always on line 24 (or line 26 for resign / line 50 for draw)
-            ifstream messageIn(filename_status);
-            int line_num;
-            if(draw && !new_game) { line_num = 50; }
-            else if(resign && !new_game) { line_num = 26; }
-            else { line_num = 24; }
-
-            for(int i = 0; i < line_num; i++)
-               getline(messageIn, second_message, '\n');
-            messageIn.close();
-
-            // only print warning if it is one of the following
-            string possible_warnings[] = {"White won by Checkmate!", "Black won by Checkmate!",
-                                          "White has no moves -> Game is Drawn!", "Black has no moves -> Game is Drawn!", 
-                                          "Game drawn by agreement", "Draw rejected. Game continues...",
-                                          "Check!", "Double Check!", "You must move your king!", 
-                                          "Invalid move! Try again...", "Undo move applied", "New game started, good luck!",
-                                          "White resigned => Black wins", "Black resigned => White wins"};
-            for(auto warning : possible_warnings)
-                if(warning == second_message)
-                    chess_gui.drawText(window, text_bottom, second_message, 20, 260, 560, font, Color::Yellow, Text::Regular);       
-
-            // -------------- main grid -------------- //
-            for(int i = 0; i < numRows; i++)
-            {
-                for(int j = 0; j < numCols; j++)
-                {
-                    // top and bottom rows
-                    if((i == 0 || i == 9) && (1 <= j && j <= 8))
-                    {
-                        if (i == 0)
-                            chess_gui.drawRect(window, rect, size_rect.x, size_rect.y/2, j * distance - size_rect.x/2, i * distance, (i + j) % 2 != 0 ? color_yellow : color_orange, 0, Color::Transparent);
-                        else
-                            chess_gui.drawRect(window, rect, size_rect.x, size_rect.y/2, j * distance - size_rect.x/2, i * distance - size_rect.y/2, (i + j) % 2 == 0 ? color_yellow : color_orange, 0, Color::Transparent);
-                    }
-
-                    // left and right columns
-                    else if((j == 0 || j == 9) && (1 <= i && i <= 8))
-                    {
-                        if (j == 0)
-                            chess_gui.drawRect(window, rect, size_rect.x/2, size_rect.y, j * distance, i * distance - size_rect.y/2, (i + j) % 2 != 0 ? color_yellow : color_orange, 0, Color::Transparent);
-                        else
-                            chess_gui.drawRect(window, rect, size_rect.x/2, size_rect.y, j * distance - size_rect.x/2, i * distance - size_rect.y/2, (i + j) % 2 == 0 ? color_yellow : color_orange, 0, Color::Transparent);
-                    }
-
-                    // corners
-                    else if((i == 0 && j == 0) || (i == 9 && j == 0) || (i == 0 && j == 9) || (i == 9 && j == 9))
-                    {
-                        if(i == 0 && j == 0)
-                            chess_gui.drawRect(window, rect, size_rect.x/2, size_rect.y/2, j * distance, i * distance, color_red, 0, Color::Transparent);
-                        else if(i == 0 && j == 9)
-                            chess_gui.drawRect(window, rect, size_rect.x/2, size_rect.y/2, j * distance - size_rect.x/2, i * distance, color_red, 0, Color::Transparent);
-                        else if(i == 9 && j == 0)
-                            chess_gui.drawRect(window, rect, size_rect.x/2, size_rect.y/2, j * distance, i * distance - size_rect.y/2, color_red, 0, Color::Transparent);
-                        else if(i == 9 && j == 9)
-                            chess_gui.drawRect(window, rect, size_rect.x/2, size_rect.y/2, j * distance - size_rect.x/2, i * distance - size_rect.y/2, color_red, 0, Color::Transparent);
-                    }
-
-                    // middle squares
-                    else
-                        chess_gui.drawRect(window, rect, size_rect.x, size_rect.y, j * distance - size_rect.x/2, i * distance - size_rect.y/2, (i + j) % 2 != 0 ? color_dark : Color::White, 0, Color::Transparent);
-
-                    // legal move highlighting
-                    if(!legalMoves.empty() && enable_move_highlighting)
-                    {
-                        auto found = std::find(legalMoves.begin(), legalMoves.end(), (i-1) * 8 + (j-1));
-                        if(found != legalMoves.end() && chess.getBoard()[src]->getPieceColor() == chess.getTurn() && i != 0 && j != 0 && i != 9 && j != 9)
-                            chess_gui.drawRect(window, rect, rect.getSize().x, rect.getSize().y, rect.getPosition().x, rect.getPosition().y, rect.getFillColor(), -2, Color::Cyan);
-                        else { chess_gui.drawRect(window, rect, rect.getSize().x, rect.getSize().y, rect.getPosition().x, rect.getPosition().y, rect.getFillColor(), 0, Color::Transparent); }
-                    }
-
-                    if(!sideSquares.empty() && enable_side_highlighting)
-                    {
-                        auto found = std::find(sideSquares.begin(), sideSquares.end(), (i-1) * 8 + (j-1));
-                        if(found != sideSquares.end() && i != 0 && j != 0 && i != 9 && j != 9)
-                            chess_gui.drawRect(window, rect, rect.getSize().x, rect.getSize().y, rect.getPosition().x, rect.getPosition().y, rect.getFillColor(), -1, Color(178, 255, 102));
-                        else { chess_gui.drawRect(window, rect, rect.getSize().x, rect.getSize().y, rect.getPosition().x, rect.getPosition().y, rect.getFillColor(), 0, Color::Transparent); }
-                    }
-                }
-            }
+            chess_gui.drawReservoir(atlas, background.getTexture(), num_left, font);
+            drawn_reservoir = num_left;
+            repaint = true;
+        }
 
-            // main grid text (files and ranks)
-            string piece_file[8] = {"A", "B", "C", "D", "E", "F", "G", "H"};
-            string piece_rank[8] = {"8", "7", "6", "5", "4", "3", "2", "1"};
+        const string &second_message = state.getMessage();
+        if(chess.getTurn() != drawn_turn || second_message != drawn_message)
+        {
+            string first_message = chess.getTurn() == WHITE ? "White's move" : "Black's move";
+            chess_gui.drawStatus(atlas, background.getTexture(), first_message, second_message, font);
+            drawn_turn = chess.getTurn();
+            drawn_message = second_message;
+            repaint = true;
+        }
 
-            // top and bottom rows
-            for(int j = 1; j < numCols-1; j++)
-            {
-                int x = (j * distance) - 8, y1 = 5, y2 = size_rect.y * (numRows - 1) - 25;     
-                chess_gui.drawText(window, text, piece_file[j - 1], 20, x, y1, font, Color::Black, Text::Bold);
-                chess_gui.drawText(window, text, piece_file[j - 1], 20, x, y2, font, Color::Black, Text::Bold);
-            }
+        // nothing to show (e.g. the mouse moved without dragging a piece)
+        if(!repaint)
+            continue;
 
-            // left and right columns
-            for(int i = 1; i < numRows-1; i++)
-            {     
-                int y = (i * distance) - 10, x1 = 10, x2 = size_rect.x * (numCols - 1) - 20;
-                chess_gui.drawText(window, text, piece_rank[i - 1], 20, x1, y, font, Color::Black, Text::Bold);
-                chess_gui.drawText(window, text, piece_rank[i - 1], 20, x2, y, font, Color::Black, Text::Bold);
-            }
+        first_frame = false;
 
-            // reservoir rects
-            for(int k = 0; k <= 11; k++)
-            {
-                if(k == 0 || k == 11)
-                    chess_gui.drawRect(window, rect, size_rect.x, size_rect.y/2, 540, k == 0 ? 0 : 510, Color(204, 255, 204), 0, Color::Transparent);
-                else 
-                    chess_gui.drawRect(window, rect, size_rect.x, size_rect.y-12, 540, size_rect.x/2 + (k-1) * (distance-12), k > 5 ? Color(255, 255, 255) : Color(224, 224, 224), -1, Color::Black);
-            }
+        // -------- draw the window from the atlas -------- //
+        const vector<Piece*> &board = chess.getBoard();
+        vector<int> highlights;
+        state.getHighlights(highlights);
+
+        // the analysis score (in centipawns) from white's point of view
+        bool show_analysis = analysing && analysis_info.search.depth > 0;
+        int white_score = chess.getTurn() == WHITE ? analysis_info.search.score : -analysis_info.search.score;
+        float white_share = -1;
+        if(show_analysis)
+        {
+            if(std::abs(white_score) >= MATE_SCORE - 1000)
+                white_share = white_score > 0 ? 1 : 0;
+            else
+                white_share = 1 / (1 + pow(10, -white_score / 400.0));
+        }
 
-            // reservoir text
-            chess_gui.drawText(window, text_reservoir, "RSVR", 20, 541, 5, font, Color::Black, Text::Bold);
+        chess_gui.formBatch(batch, board, highlights, state.getSource(), pos, white_share);
 
-            vector<pair<int, char>> current_resevoir = chess.getReservoir();
-            vector<int> num_left(10);
-            for(unsigned int i = 0; i < num_left.size(); i++)
-                num_left[i] = current_resevoir[i].first;
+        window.clear();
+        window.draw(batch, &atlas.getTexture());
+        int draw_calls = 1;
 
-            for(unsigned int i = 0; i < num_left.size(); i++)
-                chess_gui.drawText(window, text_reservoir, "x" + to_string(num_left[i]), 12, 585, 45 + i*48, font, i > 4 ? Color(0, 102, 0) : Color(204, 0, 0), Text::Regular);
+        if(show_analysis)
+        {
+            char score[16];
+            if(std::abs(white_score) >= MATE_SCORE - 1000)
+                snprintf(score, sizeof(score), "%sM%d", white_score > 0 ? "" : "-", (MATE_SCORE - std::abs(white_score) + 1) / 2);
+            else
+                snprintf(score, sizeof(score), "%+.2f", white_score / 100.0);
 
-            chess_gui.drawText(window, text_reservoir, "RSVR", 20, 541, 515, font, Color::Black, Text::Bold);
+            string line = "depth " + to_string(analysis_info.search.depth) + "  " + score + " ";
+            for(unsigned int i = 0; i < analysis_info.search.pv.size() && i < 6; i++)
+            {
+                const Move &move = analysis_info.search.pv[i];
+                line += " " + chessCAMO::formatMove(move.src, move.dest, move.promotion);
+            }
+
+            chess_gui.drawText(window, analysis_text, line, 12, 30, 584, font, Color::White, Text::Regular);
+            draw_calls++;
         }
-        else { cout << "failed to load font file" << endl; }
 
-        // Display the pieces on the window of the GUI pieces
-        for(const auto &piece : pieces)
-            window.draw(piece);
+        if(show_games)
+        {
+            chess_gui.drawGameList(window, store, font);
+            draw_calls += 2;
+        }
 
-        // reservoir
-        for(const auto &piece : reservoir)
-            window.draw(piece);
+        // the time of the previous frame, since this one is not done yet
+        if(show_overlay)
+        {
+            char message[64];
+            snprintf(message, sizeof(message), "frame %.3f ms (%d draw calls)", frame_ms, draw_calls + 1);
+            chess_gui.drawText(window, overlay, message, 12, 400, 584, font, Color::White, Text::Regular);
+        }
 
         window.display();
+        frame_ms = clock.getElapsedTime().asMicroseconds() / 1000.0;
     }
 
     cout.clear();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,690 @@
+/**
+ * \page guistate GUI State Machine Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;gui_state.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;gui_state.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * The state of the GUI without a window, and scripts of inputs to test and
+ * time it (see gui_state.h).
+ */
+
+#include "gui_state.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+// included in 'gui_state.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /** The names of the keys in a script (in the order of guiKey) */
+    const char *KEY_NAMES[] = {"new", "undo", "resign", "draw", "queen", "rook", "bishop", "knight", "side", "moves"};
+
+    /** The names of the mouse inputs in a script (in the order of guiInputType) */
+    const char *INPUT_NAMES[] = {"press", "move", "release"};
+
+    /**
+     * @brief      Handles an input and adds it to a script.
+     *
+     * @param      state   The state of the GUI
+     * @param      script  The inputs
+     * @param[in]  type    The kind of input
+     * @param[in]  x       The x position of the mouse
+     * @param[in]  y       The y position of the mouse
+     * @param[in]  key     The key (only for INPUT_KEY)
+     */
+    void addInput(GuiState &state, vector<GuiInput> &script, guiInputType type, int x, int y, guiKey key = KEY_NEW_GAME);
+
+    /**
+     * @brief      Drags the mouse from one position to another (press, a few
+     *             moves, release) and adds the inputs to a script.
+     *
+     * @param      state   The state of the GUI
+     * @param      script  The inputs
+     * @param[in]  from_x  The x position of the press
+     * @param[in]  from_y  The y position of the press
+     * @param[in]  to_x    The x position of the release
+     * @param[in]  to_y    The y position of the release
+     */
+    void addDrag(GuiState &state, vector<GuiInput> &script, int from_x, int from_y, int to_x, int to_y);
+
+    /**
+     * @brief      Finds the position of a source (the center of its board
+     *             square or reservoir piece).
+     *
+     * @param[in]  src    The board square, or the ASCII value of the reservoir
+     *                    piece in [110, 114]
+     * @param[in]  white  True for white's reservoir, False for black's
+     * @param      x      The x position
+     * @param      y      The y position
+     */
+    void sourceCenter(int src, bool white, int &x, int &y);
+} // unnamed namespace (makes these functions local to this implementation file)
+
+/*************************************************************************************/
+/*                              GUI STATE CLASS - MEMBER FUNCTIONS                   */
+/*************************************************************************************/
+/**
+ * @brief      Constructs a new instance (a new game, with a headless chess
+ *             object).
+ */
+GuiState::GuiState()
+    : src{-1}, mouse_x{0}, mouse_y{0}, holding{false}, resigned{false}, side_highlighting{true},
+      move_highlighting{true}, promotion{'q'}, moves_made{0}, base{0}, resumed_game{-1}, unsaved{false}
+{
+    // the object keeps its saved states (for undo) in memory and reports to the
+    // GUI through its listener, so nothing is printed or written to files
+    chess.setHeadless(true);
+
+    ChessListener listener;
+    listener.on_status = [this](const string &status) { message = status; };
+    listener.on_promotion = [this]() { return promotion; };
+    chess.setListener(listener);
+
+    // Create 8x8 default board
+    chess.boardInit();
+
+    line.resize(1);
+    packPosition(chess, line[0]);
+}
+
+/**
+ * @brief      Handles an input.
+ *
+ * @param[in]  input  The input
+ *
+ * @return     True if what is shown may have changed, False otherwise.
+ */
+bool GuiState::apply(const GuiInput &input)
+{
+    switch(input.type)
+    {
+        case INPUT_PRESS:   return press(input.x, input.y);
+        case INPUT_MOVE:    return moveMouse(input.x, input.y);
+        case INPUT_RELEASE: return release(input.x, input.y);
+        default:            return pressKey(input.key);
+    }
+}
+
+/**
+ * @brief      Handles a press of the left mouse button, which picks up a board
+ *             or reservoir piece.
+ *
+ * @param[in]  x     The x position of the mouse
+ * @param[in]  y     The y position of the mouse
+ *
+ * @return     True if what is shown may have changed, False otherwise.
+ */
+bool GuiState::press(int x, int y)
+{
+    mouse_x = x;
+    mouse_y = y;
+
+    // allow click only on the board or reservoir pieces
+    if(chess.getCheckmate() || chess.getStalemate() || !isClickable(x, y))
+        return true;
+
+    holding = true;
+    src = sourceAt(x, y);
+
+    // the upper half of the reservoir is black's, which can only be used on black's move
+    if(src > 63 && (y < 270) != (chess.getTurn() == BLACK))
+        src = -1;
+
+    return true;
+}
+
+/**
+ * @brief      Handles a move of the mouse (which drags the held board piece).
+ *
+ * @param[in]  x     The x position of the mouse
+ * @param[in]  y     The y position of the mouse
+ *
+ * @return     True if what is shown may have changed, False otherwise.
+ */
+bool GuiState::moveMouse(int x, int y)
+{
+    mouse_x = x;
+    mouse_y = y;
+
+    // piece drag & drop functionality (only applied to main board pieces - not reservoir pieces)
+    return holding && 0 <= src && src <= 63;
+}
+
+/**
+ * @brief      Handles a release of the left mouse button, which makes the move
+ *             of the held piece to the square under the mouse (if it is
+ *             legal).
+ *
+ * @param[in]  x     The x position of the mouse
+ * @param[in]  y     The y position of the mouse
+ *
+ * @return     True if what is shown may have changed, False otherwise.
+ */
+bool GuiState::release(int x, int y)
+{
+    mouse_x = x;
+    mouse_y = y;
+
+    if(!holding)
+        return true;
+
+    holding = false;
+    if(chess.getCheckmate() || chess.getStalemate())
+        return true;
+
+    int dest = squareAt(x, y);
+
+    // make the move (the listener updates the status message and gives the
+    // promotion piece, so the input stream is not read). A move that is not in
+    // the legal moves is rejected right away
+    istringstream in;
+    if(move_cache.get(chess).isLegal(src, dest))
+    {
+        message.clear();
+        chess.makeMove(src, dest, in);
+        moves_made++;
+
+        line.emplace_back();
+        packPosition(chess, line.back());
+        resumed_game = -1;
+        unsaved = true;
+    }
+    else
+        message = chess.getDoubleCheck() ? "You must move your king!" : "Invalid move! Try again...";
+
+    return true;
+}
+
+/**
+ * @brief      Handles a key press.
+ *
+ * @param[in]  key   The key
+ *
+ * @return     True if what is shown may have changed, False otherwise.
+ */
+bool GuiState::pressKey(guiKey key)
+{
+    // reset the game
+    if(key == KEY_NEW_GAME)
+    {
+        resetPosition(0);
+        message = "New game started, good luck!";
+        promotion = 'q';
+        resigned = false;
+        holding = false;
+
+        line.resize(1);
+        packPosition(chess, line[0]);
+        base = 0;
+        resumed_game = -1;
+        unsaved = false;
+    }
+
+    // undo move (the positions before a resumed ply are not in the chess
+    // object's saved states, so they are set from the line)
+    else if(key == KEY_UNDO && !resigned)
+    {
+        if(line.size() - 1 > base)
+        {
+            resetPosition(chess.getNumMoves()-1);
+            line.pop_back();
+        }
+        else if(line.size() > 1)
+        {
+            line.pop_back();
+            base = line.size() - 1;
+            setFromLine();
+        }
+
+        message = "Undo move applied";
+        promotion = 'q';
+        holding = false;
+        resumed_game = -1;
+        unsaved = true;
+    }
+
+    if(chess.getCheckmate() || chess.getStalemate())
+        return true;
+
+    // resign
+    if(key == KEY_RESIGN)
+    {
+        istringstream in("r");
+        chessCAMO::drawOrResign(false, chess, in);
+        resigned = true;
+    }
+
+    // draw
+    else if(key == KEY_DRAW)
+    {
+        istringstream in("dn");
+        chessCAMO::drawOrResign(false, chess, in);
+    }
+
+    // promotion handling
+    else if(key == KEY_QUEEN)
+        promotion = 'q';
+    else if(key == KEY_ROOK)
+        promotion = 'r';
+    else if(key == KEY_BISHOP)
+        promotion = 'b';
+    else if(key == KEY_KNIGHT)
+        promotion = 'n';
+
+    // move & side highlighting
+    else if(key == KEY_SIDE_HIGHLIGHTING)
+        side_highlighting = !side_highlighting; // toggle on/off
+    else if(key == KEY_MOVE_HIGHLIGHTING)
+        move_highlighting = !move_highlighting; // toggle on/off
+
+    return true;
+}
+
+/**
+ * @brief      Gets the highlighting of each square: the legal moves of the held
+ *             piece, or else the pieces of the side to move.
+ *
+ * @param      highlights  The highlighting of each square (0 for none, 1 for a
+ *                         legal move, 2 for a piece of the side to move)
+ */
+void GuiState::getHighlights(vector<int> &highlights)
+{
+    const MoveTable &moves = move_cache.get(chess);
+
+    uint64_t targets = holding ? (move_highlighting ? moves.destinations(src) : 0)
+                               : (side_highlighting ? moves.side : 0);
+
+    highlights.assign(64, 0);
+    for(int square = 0; square < 64; square++)
+        if(targets >> square & 1)
+            highlights[square] = holding ? 1 : 2;
+}
+
+/**
+ * @brief      Saves the game (from its starting position to the current one).
+ *
+ * @param      store  The saved games
+ *
+ * @return     True if the game was saved, False otherwise.
+ */
+bool GuiState::save(GameStore &store)
+{
+    if(!store.append(line, gameResult(chess)))
+    {
+        message = "Could not save the game";
+        return false;
+    }
+
+    message = "Game saved (#" + to_string(store.getNumGames()) + ")";
+    unsaved = false;
+    return true;
+}
+
+/**
+ * @brief      Resumes a saved game at a ply, by setting its position (the moves
+ *             are not replayed). Moves before that ply can still be undone.
+ *
+ * @param[in]  store  The saved games
+ * @param[in]  game   The game (in [0, store.getNumGames()))
+ * @param[in]  ply    The number of moves of the game to resume after
+ *
+ * @return     True if the game was resumed, False otherwise (e.g. there is no
+ *             such ply).
+ */
+bool GuiState::resume(const GameStore &store, uint32_t game, uint32_t ply)
+{
+    if(game >= store.getNumGames() || ply >= store.getGame(game).num_positions)
+        return false;
+
+    // the line is copied from the mapped file, so the game survives the store
+    // being appended to (and re-mapped)
+    vector<PackedPosition> saved = line;
+    const PackedPosition *positions = store.getPositions(game);
+    line.assign(positions, positions + ply + 1);
+    if(!setFromLine())
+    {
+        line.swap(saved);
+        return false;
+    }
+
+    message = "Resumed game #" + to_string(game + 1) + " at move " + to_string(ply);
+    promotion = 'q';
+    resigned = false;
+    holding = false;
+    base = ply;
+    resumed_game = game;
+    unsaved = false;
+    return true;
+}
+
+/**
+ * @brief      Finds if a position can be clicked (a board square or the
+ *             reservoir).
+ *
+ * @param[in]  x     The x position of the mouse
+ * @param[in]  y     The y position of the mouse
+ *
+ * @return     True if it can be clicked, False otherwise.
+ */
+bool GuiState::isClickable(int x, int y)
+{
+    bool x_cursor = (30 < x && x < 510) || (540 < x && x < 600);
+    bool y_cursor = 30 < y && y < 510;
+    return x_cursor && y_cursor;
+}
+
+/**
+ * @brief      Finds what a click picks up.
+ *
+ * @param[in]  x     The x position of the mouse
+ * @param[in]  y     The y position of the mouse
+ *
+ * @return     The board square, the ASCII value of the reservoir piece in [110,
+ *             114], or -1 if the position is not on either.
+ */
+int GuiState::sourceAt(int x, int y)
+{
+    if(!isClickable(x, y))
+        return -1;
+
+    // main board square (the squares start at 30, 30 and are 60 x 60)
+    if(x < 510)
+        return squareAt(x, y);
+
+    // reservoir piece (each half has the pieces in the order of RESERVOIR_PIECES, 48 pixels apart)
+    return (int) RESERVOIR_PIECES[((y - 30) % 240) / 48];
+}
+
+/**
+ * @brief      Finds the board square under a position.
+ *
+ * @param[in]  x     The x position of the mouse
+ * @param[in]  y     The y position of the mouse
+ *
+ * @return     The square, or -1 if the position is not on the board.
+ */
+int GuiState::squareAt(int x, int y)
+{
+    return 30 <= x && x < 510 && 30 <= y && y < 510 ? (x - 30) / 60 + 8 * ((y - 30) / 60) : -1;
+}
+
+/**
+ * @brief      Resets the position to the corresponding position indicated by
+ *             'move_num'
+ *
+ * @param[in]  move_num  The move number to revert the position to
+ */
+void GuiState::resetPosition(int move_num)
+{
+    // set move counter accordingly
+    chess.setNumMoves(move_num);
+
+    // restore previous object
+    chessCAMO::restoreObject(chess);
+}
+
+/**
+ * @brief      Sets the position of the chess object from the last position of
+ *             the line.
+ *
+ * @return     True if the position was set, False otherwise.
+ */
+bool GuiState::setFromLine()
+{
+    char fen[FEN_SIZE];
+    return unpackPosition(line.back(), fen, FEN_SIZE) != -1 && chess.setFromFEN(fen);
+}
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Makes a script of a session: games of random legal moves
+     *             (dragged across the board, or from the reservoir), with
+     *             invalid drops, undos, promotion and highlighting keys mixed
+     *             in.
+     *
+     * @param[in]  interactions  The number of inputs
+     * @param[in]  seed          The seed of the random choices (the same seed
+     *                           gives the same script)
+     *
+     * @return     The inputs.
+     */
+    vector<GuiInput> scriptSession(int interactions, unsigned int seed)
+    {
+        vector<GuiInput> script;
+        GuiState state;
+        mt19937 rng(seed);
+
+        while((int) script.size() < interactions)
+        {
+            Chess &chess = state.getChess();
+            int roll = rng() % 100;
+
+            // long games are abandoned, so that the script has many openings
+            if(chess.getCheckmate() || chess.getStalemate() || chess.getNumMoves() >= 150)
+            {
+                addInput(state, script, INPUT_KEY, 0, 0, KEY_NEW_GAME);
+                continue;
+            }
+
+            vector<Move> moves = legalMoves(chess);
+            if(roll < 4 && chess.getNumMoves() > 0)
+                addInput(state, script, INPUT_KEY, 0, 0, KEY_UNDO);
+            else if(roll < 7)
+                addInput(state, script, INPUT_KEY, 0, 0, (guiKey) (KEY_QUEEN + rng() % 4));
+            else if(roll < 8)
+                addInput(state, script, INPUT_KEY, 0, 0, rng() % 2 == 0 ? KEY_SIDE_HIGHLIGHTING : KEY_MOVE_HIGHLIGHTING);
+            else if(roll < 9)
+                addInput(state, script, INPUT_KEY, 0, 0, rng() % 50 == 0 ? KEY_RESIGN : KEY_DRAW);
+            else if(roll < 18 || moves.empty())
+                addDrag(state, script, rng() % 600, rng() % 600, rng() % 600, rng() % 600);
+            else
+            {
+                const Move &move = moves[rng() % moves.size()];
+                int from_x, from_y, to_x, to_y;
+                sourceCenter(move.src, chess.getTurn() == WHITE, from_x, from_y);
+                sourceCenter(move.dest, chess.getTurn() == WHITE, to_x, to_y);
+                addDrag(state, script, from_x, from_y, to_x, to_y);
+            }
+        }
+
+        script.resize(interactions);
+        return script;
+    }
+
+    /**
+     * @brief      Reads a script of inputs (see gui_state.h).
+     *
+     * @param      in      The input stream
+     * @param      script  The inputs
+     *
+     * @return     True if every line is a valid input, False otherwise.
+     */
+    bool readScript(istream &in, vector<GuiInput> &script)
+    {
+        string line;
+        while(getline(in, line))
+        {
+            istringstream fields(line);
+            string type, extra;
+            if(!(fields >> type) || type[0] == '#')
+                continue;
+
+            GuiInput input;
+            if(type == "key")
+            {
+                string name;
+                fields >> name;
+
+                input.type = INPUT_KEY;
+                auto found = find(begin(KEY_NAMES), end(KEY_NAMES), name);
+                if(found == end(KEY_NAMES))
+                    return false;
+                input.key = (guiKey) (found - begin(KEY_NAMES));
+            }
+            else
+            {
+                auto found = find(begin(INPUT_NAMES), end(INPUT_NAMES), type);
+                if(found == end(INPUT_NAMES) || !(fields >> input.x >> input.y))
+                    return false;
+                input.type = (guiInputType) (found - begin(INPUT_NAMES));
+            }
+
+            if(fields >> extra)
+                return false;
+
+            script.push_back(input);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief      Writes a script of inputs (see gui_state.h).
+     *
+     * @param      out     The output stream
+     * @param[in]  script  The inputs
+     */
+    void writeScript(ostream &out, const vector<GuiInput> &script)
+    {
+        for(const auto & input : script)
+        {
+            if(input.type == INPUT_KEY)
+                out << "key " << KEY_NAMES[input.key] << "\n";
+            else
+                out << INPUT_NAMES[input.type] << " " << input.x << " " << input.y << "\n";
+        }
+    }
+
+    /**
+     * @brief      Plays a script on a new GuiState and times every input.
+     *
+     * @param[in]  script  The inputs
+     *
+     * @return     The latencies of the inputs.
+     */
+    GuiBenchStats benchScript(const vector<GuiInput> &script)
+    {
+        GuiBenchStats stats;
+        GuiState state;
+        vector<int> highlights(64);
+        vector<double> latencies;
+        latencies.reserve(script.size());
+
+        for(const auto & input : script)
+        {
+            // what a frame needs: the input is handled and the squares to
+            // highlight are found (drawing is left out)
+            auto start = chrono::steady_clock::now();
+            state.apply(input);
+            state.getHighlights(highlights);
+            latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        }
+
+        stats.interactions = script.size();
+        stats.moves = state.getMovesMade();
+        if(latencies.empty())
+            return stats;
+
+        for(const auto & latency : latencies)
+            stats.mean_us += latency / latencies.size();
+
+        sort(latencies.begin(), latencies.end());
+        stats.p50_us = latencies[latencies.size() / 2];
+        stats.p99_us = latencies[latencies.size() * 99 / 100];
+        stats.max_us = latencies.back();
+        return stats;
+    }
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Handles an input and adds it to a script.
+     *
+     * @param      state   The state of the GUI
+     * @param      script  The inputs
+     * @param[in]  type    The kind of input
+     * @param[in]  x       The x position of the mouse
+     * @param[in]  y       The y position of the mouse
+     * @param[in]  key     The key (only for INPUT_KEY)
+     */
+    void addInput(GuiState &state, vector<GuiInput> &script, guiInputType type, int x, int y, guiKey key)
+    {
+        GuiInput input;
+        input.type = type;
+        input.x = x;
+        input.y = y;
+        input.key = key;
+
+        state.apply(input);
+        script.push_back(input);
+    }
+
+    /**
+     * @brief      Drags the mouse from one position to another (press, a few
+     *             moves, release) and adds the inputs to a script.
+     *
+     * @param      state   The state of the GUI
+     * @param      script  The inputs
+     * @param[in]  from_x  The x position of the press
+     * @param[in]  from_y  The y position of the press
+     * @param[in]  to_x    The x position of the release
+     * @param[in]  to_y    The y position of the release
+     */
+    void addDrag(GuiState &state, vector<GuiInput> &script, int from_x, int from_y, int to_x, int to_y)
+    {
+        addInput(state, script, INPUT_PRESS, from_x, from_y);
+        for(int step = 1; step <= 3; step++)
+            addInput(state, script, INPUT_MOVE, from_x + (to_x - from_x) * step / 4, from_y + (to_y - from_y) * step / 4);
+        addInput(state, script, INPUT_RELEASE, to_x, to_y);
+    }
+
+    /**
+     * @brief      Finds the position of a source (the center of its board
+     *             square or reservoir piece).
+     *
+     * @param[in]  src    The board square, or the ASCII value of the reservoir
+     *                    piece in [110, 114]
+     * @param[in]  white  True for white's reservoir, False for black's
+     * @param      x      The x position
+     * @param      y      The y position
+     */
+    void sourceCenter(int src, bool white, int &x, int &y)
+    {
+        if(0 <= src && src <= 63)
+        {
+            x = 60 + 60 * (src % 8);
+            y = 60 + 60 * (src / 8);
+        }
+        else
+        {
+            x = 570;
+            y = 54 + (white ? 240 : 0) + 48 * (strchr(RESERVOIR_PIECES, src) - RESERVOIR_PIECES);
+        }
+    }
+}
@@ -0,0 +1,243 @@
+/**
+ * \page guibench GUI Benchmark Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;guibench.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;gui_state.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Replays thousands of GUI interactions (clicks, drags, drops and keys) on the
+ * state of the GUI without a window, and reports the latency of each one, so
+ * that the interface can be timed on a machine without a display. It can also
+ * time the frames of a render loop that polls background analyses (see
+ * analysis.h) while they search.
+ *
+ * Simply run <b>mingw32-make all_guibench</b> and then <b>guibench
+ * [options]</b>, where the options are:
+ * - <b>--interactions N</b>: the number of inputs of the generated script
+ *   (10000);
+ * - <b>--seed N</b>: the seed of the generated script (1);
+ * - <b>--script file</b>: replays the inputs of a file instead (see
+ *   gui_state.h for the format);
+ * - <b>--save file</b>: writes the script that is replayed;
+ * - <b>--max-p99 US</b>: fails (exit code 2) if the 99th percentile of the
+ *   latency is above US microseconds;
+ * - <b>--analysis-frames N</b>: also times N frames of a render loop that
+ *   polls an analysis on every other core (0, none);
+ * - <b>--max-frame-p99 US</b>: fails (exit code 2) if the 99th percentile of
+ *   the polling time of those frames is above US microseconds.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+#include "gui_state.h"
+#include "analysis.h"
+#include "archive.h"
+
+// included in 'gui_state.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+
+    /**
+     * @brief      Times the frames of a render loop that polls an analysis on
+     *             every other core each frame, and restarts one of them every
+     *             100 frames (as a move would), while they search.
+     *
+     * @param[in]  frames  The number of frames
+     *
+     * @return     The time of polling in each frame (its interactions are the
+     *             frames and its moves the restarts).
+     */
+    GuiBenchStats benchAnalysis(int frames);
+}
+
+/**
+ * @brief      Replays a script of GUI inputs and reports their latency.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if the script was replayed (in time), 1 for invalid usage,
+ *             2 if the latency (or the frame time) is above the limit.
+ */
+int main(int argc, char *argv[])
+{
+    int interactions = 10000, analysis_frames = 0;
+    unsigned int seed = 1;
+    double max_p99 = 0, max_frame_p99 = 0;
+    string script_file, save_file;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(i + 1 >= argc)
+            return usage();
+        else if(strcmp(argv[i], "--interactions") == 0)
+            interactions = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0)
+            seed = strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--script") == 0)
+            script_file = argv[++i];
+        else if(strcmp(argv[i], "--save") == 0)
+            save_file = argv[++i];
+        else if(strcmp(argv[i], "--max-p99") == 0)
+            max_p99 = atof(argv[++i]);
+        else if(strcmp(argv[i], "--analysis-frames") == 0)
+            analysis_frames = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--max-frame-p99") == 0)
+            max_frame_p99 = atof(argv[++i]);
+        else
+            return usage();
+    }
+
+    vector<GuiInput> script;
+    if(!script_file.empty())
+    {
+        ifstream in(script_file);
+        if(!in || !readScript(in, script))
+        {
+            printf("Could not read the script '%s'\n", script_file.c_str());
+            return 1;
+        }
+    }
+    else
+        script = scriptSession(interactions, seed);
+
+    if(!save_file.empty())
+    {
+        ofstream out(save_file, ios::trunc);
+        if(!out)
+        {
+            printf("Could not write to '%s'\n", save_file.c_str());
+            return 1;
+        }
+        writeScript(out, script);
+    }
+
+    GuiBenchStats stats = benchScript(script);
+    printf("Interactions %llu (%llu moves)  latency mean %.1f us  p50 %.1f us  p99 %.1f us  max %.1f us\n",
+           (unsigned long long) stats.interactions, (unsigned long long) stats.moves, stats.mean_us, stats.p50_us,
+           stats.p99_us, stats.max_us);
+
+    int result = 0;
+    if(max_p99 > 0 && stats.p99_us > max_p99)
+    {
+        printf("p99 latency is above %.1f us\n", max_p99);
+        result = 2;
+    }
+
+    if(analysis_frames > 0)
+    {
+        GuiBenchStats frames = benchAnalysis(analysis_frames);
+        printf("Analysis frames %llu (%llu restarts)  poll mean %.1f us  p50 %.1f us  p99 %.1f us  max %.1f us\n",
+               (unsigned long long) frames.interactions, (unsigned long long) frames.moves, frames.mean_us,
+               frames.p50_us, frames.p99_us, frames.max_us);
+
+        if(max_frame_p99 > 0 && frames.p99_us > max_frame_p99)
+        {
+            printf("p99 frame time is above %.1f us\n", max_frame_p99);
+            result = 2;
+        }
+    }
+
+    return result;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage: guibench [--interactions N] [--seed N] [--script file] [--save file] [--max-p99 US] "
+               "[--analysis-frames N] [--max-frame-p99 US]\n");
+        return 1;
+    }
+
+    /**
+     * @brief      Times the frames of a render loop that polls an analysis on
+     *             every other core each frame, and restarts one of them every
+     *             100 frames (as a move would), while they search.
+     *
+     * @param[in]  frames  The number of frames
+     *
+     * @return     The time of polling in each frame (its interactions are the
+     *             frames and its moves the restarts).
+     */
+    GuiBenchStats benchAnalysis(int frames)
+    {
+        // the reservoir makes the start position expensive to search, so the
+        // analyses do not end
+        unsigned int cores = max(2u, thread::hardware_concurrency());
+        vector<unique_ptr<Analysis>> analyses;
+        vector<double> latencies;
+        AnalysisInfo info;
+        Chess chess;
+        chess.setHeadless(true);
+        chess.setFromFEN(START_FEN);
+
+        for(unsigned int i = 0; i + 1 < cores; i++)
+        {
+            analyses.emplace_back(new Analysis(EngineConfig(), 64));
+            analyses.back()->start(chess);
+        }
+
+        GuiBenchStats stats;
+        for(int frame = 0; frame < frames; frame++)
+        {
+            auto start = chrono::steady_clock::now();
+
+            if(frame % 100 == 0)
+            {
+                analyses[0]->start(chess);
+                stats.moves++;
+            }
+            for(auto & elem : analyses)
+                elem->poll(info);
+
+            latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+            stats.mean_us += latencies.back();
+            this_thread::sleep_for(chrono::microseconds(500));
+        }
+
+        sort(latencies.begin(), latencies.end());
+        stats.interactions = latencies.size();
+        stats.mean_us /= latencies.size();
+        stats.p50_us = latencies[latencies.size() / 2];
+        stats.p99_us = latencies[latencies.size() * 99 / 100];
+        stats.max_us = latencies.back();
+
+        return stats;
+    }
+}
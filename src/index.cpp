@@ -0,0 +1,304 @@
+/**
+ * \page index Position Index Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;index.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;index.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Building and querying the position index (see index.h for the file layout).
+ */
+
+#include "index.h"
+#include "archive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <thread>
+
+// included in 'index.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /** The number of games a thread takes from the archive at a time */
+    const size_t GAME_BATCH = 64;
+
+    /** The number of postings written to the index file at a time */
+    const size_t WRITE_BATCH = 1 << 16;
+
+    /**
+     * @brief      Merges the sorted postings of the threads and writes them to
+     *             the index file.
+     *
+     * @param      out      The index file
+     * @param[in]  sorted   The sorted postings of each thread
+     *
+     * @return     True if all postings were written, False otherwise.
+     */
+    bool writeMerged(ofstream &out, const vector<vector<Posting>> &sorted);
+} // unnamed namespace (makes these functions local to this implementation file)
+
+/*************************************************************************************/
+/*                              POSITION INDEX - MEMBER FUNCTIONS                    */
+/*************************************************************************************/
+/**
+ * @brief      Default constructor - Constructs a new instance with no index
+ *             opened.
+ */
+PositionIndex::PositionIndex()
+    : postings{nullptr}, offsets{nullptr}, num_postings{0}, num_games{0}, num_invalid{0}
+{
+}
+
+/**
+ * @brief      Builds the index of an archive. Games are replayed on
+ *             'num_threads' threads (each with its own headless Chess object)
+ *             and the postings of the threads are merged into the file in
+ *             sorted order.
+ *
+ * @param[in]  archive_file  The game archive (see archive.h)
+ * @param[in]  index_file    The index file to write
+ * @param[in]  num_threads   The number of threads (0 uses all cores)
+ * @param      stats         The outcome of the build (can be nullptr)
+ *
+ * @return     True if the index was written, False if the archive could not
+ *             be read or the index could not be written.
+ */
+bool PositionIndex::build(const string &archive_file, const string &index_file, int num_threads, IndexStats *stats)
+{
+    auto start = chrono::steady_clock::now();
+
+    MappedFile archive;
+    if(!archive.open(archive_file))
+        return false;
+
+    const char *data = archive.getData();
+    size_t size = archive.getSize();
+    vector<uint64_t> games = findGames(data, size);
+
+    if(num_threads <= 0)
+        num_threads = max(1u, thread::hardware_concurrency());
+
+    // each thread replays batches of games and keeps its own postings, so
+    // nothing is shared but the counter of the next batch
+    atomic<size_t> next_game{0};
+    vector<vector<Posting>> sorted(num_threads);
+    vector<uint64_t> invalid(num_threads, 0);
+    vector<thread> threads;
+
+    for(int t = 0; t < num_threads; t++)
+    {
+        threads.emplace_back([&, t]()
+        {
+            Chess chess;
+            chess.setHeadless(true);
+
+            GameRecord game;
+            vector<Posting> &postings = sorted[t];
+
+            for(size_t first = next_game.fetch_add(GAME_BATCH); first < games.size(); first = next_game.fetch_add(GAME_BATCH))
+            {
+                for(size_t g = first; g < min(first + GAME_BATCH, games.size()); g++)
+                {
+                    const char *line = data + games[g];
+                    const char *end = (const char *) memchr(line, '\n', size - games[g]);
+                    string text(line, end == nullptr ? data + size : end);
+
+                    if(!parseGame(text, game))
+                    {
+                        invalid[t]++;
+                        continue;
+                    }
+
+                    int moves = replayGame(chess, game, [&](const Chess &position, int ply)
+                    {
+                        postings.push_back({position.getHash(), (uint32_t) g, (uint32_t) ply});
+                    });
+
+                    if(moves != (int) game.moves.size())
+                        invalid[t]++;
+                }
+            }
+
+            sort(postings.begin(), postings.end());
+        });
+    }
+
+    for(auto & elem : threads)
+        elem.join();
+
+    // -------- write the index file -------- //
+    IndexHeader header;
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.num_postings = 0;
+    header.num_games = games.size();
+    header.num_invalid = 0;
+
+    for(int t = 0; t < num_threads; t++)
+    {
+        header.num_postings += sorted[t].size();
+        header.num_invalid += invalid[t];
+    }
+
+    ofstream out(index_file, ios::binary | ios::trunc);
+    out.write((const char *) &header, sizeof(header));
+    bool ok = out && writeMerged(out, sorted);
+    out.write((const char *) games.data(), games.size() * sizeof(uint64_t));
+    ok = ok && out;
+    out.close();
+
+    if(stats != nullptr)
+    {
+        stats->games = header.num_games;
+        stats->invalid = header.num_invalid;
+        stats->postings = header.num_postings;
+        stats->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    return ok;
+}
+
+/**
+ * @brief      Opens (memory maps) an index file.
+ *
+ * @param[in]  index_file  The index file
+ *
+ * @return     True if the file is a valid index, False otherwise.
+ */
+bool PositionIndex::open(const string &index_file)
+{
+    close();
+
+    if(!file.open(index_file) || file.getSize() < sizeof(IndexHeader))
+    {
+        close();
+        return false;
+    }
+
+    const IndexHeader *header = (const IndexHeader *) file.getData();
+    if( memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        file.getSize() != sizeof(IndexHeader) + header->num_postings*sizeof(Posting) + header->num_games*sizeof(uint64_t) )
+    {
+        close();
+        return false;
+    }
+
+    num_postings = header->num_postings;
+    num_games = header->num_games;
+    num_invalid = header->num_invalid;
+    postings = (const Posting *) (file.getData() + sizeof(IndexHeader));
+    offsets = (const uint64_t *) (postings + num_postings);
+
+    return true;
+}
+
+/**
+ * @brief      Closes the index file.
+ */
+void PositionIndex::close()
+{
+    file.close();
+    postings = nullptr;
+    offsets = nullptr;
+    num_postings = num_games = num_invalid = 0;
+}
+
+/**
+ * @brief      Finds the postings of a position (without copying them).
+ *
+ * @param[in]  hash   The hash of the position (Chess::getHash())
+ * @param      first  The first posting of the position (if any)
+ *
+ * @return     The number of postings of the position, which are stored one
+ *             after the other starting at 'first'.
+ */
+size_t PositionIndex::find(uint64_t hash, const Posting *&first) const
+{
+    const Posting *end = postings + num_postings;
+
+    first = lower_bound(postings, end, hash, [](const Posting &posting, uint64_t value) {return posting.hash < value;});
+    const Posting *last = upper_bound(first, end, hash, [](uint64_t value, const Posting &posting) {return value < posting.hash;});
+
+    return last - first;
+}
+
+/**
+ * @brief      Finds the postings of a position.
+ *
+ * @param[in]  hash   The hash of the position (Chess::getHash())
+ * @param[in]  limit  The maximum number of postings to return
+ *
+ * @return     The postings of the position, ordered by game and ply.
+ */
+vector<Posting> PositionIndex::query(uint64_t hash, size_t limit) const
+{
+    const Posting *first;
+    size_t count = min(find(hash, first), limit);
+
+    return vector<Posting>(first, first + count);
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Merges the sorted postings of the threads and writes them to
+     *             the index file.
+     *
+     * @param      out      The index file
+     * @param[in]  sorted   The sorted postings of each thread
+     *
+     * @return     True if all postings were written, False otherwise.
+     */
+    bool writeMerged(ofstream &out, const vector<vector<Posting>> &sorted)
+    {
+        // (next posting, thread) pairs with the smallest posting on top
+        typedef pair<Posting, size_t> Head;
+        auto later = [](const Head &a, const Head &b) {return b.first < a.first;};
+        priority_queue<Head, vector<Head>, decltype(later)> heads(later);
+        vector<size_t> positions(sorted.size(), 0);
+
+        for(size_t t = 0; t < sorted.size(); t++)
+            if(!sorted[t].empty())
+                heads.push({sorted[t][0], t});
+
+        vector<Posting> buffer;
+        buffer.reserve(WRITE_BATCH);
+
+        while(!heads.empty())
+        {
+            Head head = heads.top();
+            heads.pop();
+            buffer.push_back(head.first);
+
+            if(++positions[head.second] < sorted[head.second].size())
+                heads.push({sorted[head.second][positions[head.second]], head.second});
+
+            if(buffer.size() == WRITE_BATCH || heads.empty())
+            {
+                out.write((const char *) buffer.data(), buffer.size() * sizeof(Posting));
+                buffer.clear();
+            }
+        }
+
+        return (bool) out;
+    }
+}
@@ -0,0 +1,200 @@
+/**
+ * \page indexer Position Index Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;indexer.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;index.h, archive.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Builds and queries the position index of a game archive.
+ *
+ * Simply run <b>mingw32-make all_index</b> on a Windows machine and then:
+ * - <b>indexer build games.txt games.idx [threads]</b> to index every position
+ *   of every game in <i>games.txt</i> (all cores are used by default);
+ * - <b>indexer query games.idx "FEN" [--limit N] [--archive games.txt]</b> to
+ *   list the games (and plies) that reached the position. With the archive,
+ *   the games' lines are printed as well.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "chess.h"
+#include "index.h"
+
+// included in 'chess.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Builds the index of an archive and prints the statistics.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the index was built, 1 otherwise.
+     */
+    int buildCommand(int argc, char *argv[]);
+
+    /**
+     * @brief      Queries the index for a position and prints the matches.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the query was made, 1 otherwise.
+     */
+    int queryCommand(int argc, char *argv[]);
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+}
+
+/**
+ * @brief      Builds or queries a position index depending on the first
+ *             argument.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if program exited successfully
+ */
+int main(int argc, char *argv[])
+{
+    if(argc >= 4 && strcmp(argv[1], "build") == 0)
+        return buildCommand(argc, argv);
+    else if(argc >= 4 && strcmp(argv[1], "query") == 0)
+        return queryCommand(argc, argv);
+    else
+        return usage();
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Builds the index of an archive and prints the statistics.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the index was built, 1 otherwise.
+     */
+    int buildCommand(int argc, char *argv[])
+    {
+        int num_threads = argc >= 5 ? atoi(argv[4]) : 0;
+        IndexStats stats;
+
+        if(!PositionIndex::build(argv[2], argv[3], num_threads, &stats))
+        {
+            printf("Could not build the index of '%s' into '%s'\n", argv[2], argv[3]);
+            return 1;
+        }
+
+        printf("Games:     %llu (%llu invalid)\n", (unsigned long long) stats.games, (unsigned long long) stats.invalid);
+        printf("Positions: %llu\n", (unsigned long long) stats.postings);
+        printf("Time:      %.3f s (%.0f games/s)\n", stats.seconds, stats.seconds > 0 ? stats.games / stats.seconds : 0.0);
+        return 0;
+    }
+
+    /**
+     * @brief      Queries the index for a position and prints the matches.
+     *
+     * @param[in]  argc  The number of command line arguments
+     * @param      argv  The command line arguments
+     *
+     * @return     0 if the query was made, 1 otherwise.
+     */
+    int queryCommand(int argc, char *argv[])
+    {
+        size_t limit = 20;
+        const char *archive_file = nullptr;
+
+        for(int i = 4; i + 1 < argc; i += 2)
+        {
+            if(strcmp(argv[i], "--limit") == 0)
+                limit = strtoull(argv[i+1], nullptr, 10);
+            else if(strcmp(argv[i], "--archive") == 0)
+                archive_file = argv[i+1];
+            else
+                return usage();
+        }
+
+        PositionIndex index;
+        if(!index.open(argv[2]))
+        {
+            printf("'%s' is not a position index\n", argv[2]);
+            return 1;
+        }
+
+        Chess chess;
+        chess.setHeadless(true);
+        if(!chess.setFromFEN(argv[3]))
+        {
+            printf("Invalid FEN: %s\n", argv[3]);
+            return 1;
+        }
+
+        auto start = chrono::steady_clock::now();
+        const Posting *first;
+        size_t count = index.find(chess.getHash(), first);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        printf("%zu positions found in %.3f ms\n", count, ms);
+
+        MappedFile archive;
+        if(archive_file != nullptr && !archive.open(archive_file))
+            printf("Could not open the archive '%s'\n", archive_file);
+
+        for(size_t i = 0; i < min(count, limit); i++)
+        {
+            printf("game %u ply %u", first[i].game, first[i].ply);
+
+            // print the game's line (the index stores where it starts)
+            if(archive.getData() != nullptr && index.getGameOffset(first[i].game) < archive.getSize())
+            {
+                const char *line = archive.getData() + index.getGameOffset(first[i].game);
+                const char *end = (const char *) memchr(line, '\n', archive.getSize() - index.getGameOffset(first[i].game));
+                printf(": %.*s", (int) ((end == nullptr ? archive.getData() + archive.getSize() : end) - line), line);
+            }
+            printf("\n");
+        }
+
+        if(count > limit)
+            printf("... %zu more\n", count - limit);
+
+        return 0;
+    }
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage:\n"
+               "  indexer build <archive> <index> [threads]\n"
+               "  indexer query <index> <FEN> [--limit N] [--archive <archive>]\n");
+        return 1;
+    }
+}
@@ -6,7 +6,7 @@
  * \author Lior Bragilevsky<br>
  * 
  * <b>Related</b><br>
- * <span>&emsp;&emsp;&emsp;chess.h</span><br> 
+ * <span>&emsp;&emsp;&emsp;chess.h, bench.h</span><br> 
  * 
  * <b>Project</b><br>
  * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
@@ -20,17 +20,44 @@
  *
  * Simply run <b>mingw32-make all_main && main</b> on a Windows machine to start the game.
  *
+ * Run <b>main bench [depth]</b> instead to search the positions of the benchmark (see bench.h) and
+ * print the number of positions searched (the signature of the build), the time and the nodes per
+ * second. At the default depth (and the quick depth of the unit tests), the program exits with 1 if
+ * the signature is not the expected one (BENCH_SIGNATURE or BENCH_QUICK_SIGNATURE).
+ *
  * \note
- *   - Currently all standard chess rules are supported, except three move repetition & 50 move rule.
+ *   - All standard chess rules are supported, including three move repetition & 50 move rule.
  *   - You can choose to input PGN notation ('e2 E4') rather than coordinates ('52 36'), or a mix of both ('e2 36').   
 */
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
 #include "chess.h"
+#include "bench.h"
 
 // included in 'chess.h' but good to re-state
 using namespace std;
 using namespace chessCAMO; 
 
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Runs the benchmark and prints its signature, time and nodes
+     *             per second.
+     *
+     * @param[in]  depth  The depth of the searches (in plies)
+     *
+     * @return     1 if the signature of BENCH_DEPTH or BENCH_QUICK_DEPTH is
+     *             not the expected one, 0 otherwise.
+     */
+    int benchCommand(int depth);
+}
+
 /**
  * @brief      Simulates a chess game between two players.
  *             At any point, the player whose turn it is, can decide whether they want to
@@ -42,11 +69,19 @@ using namespace chessCAMO;
  *             refreshes after a valid move is made and the board position is updated and
  *             printed to illustrate the current position. Relevant warning messages are 
  *             displayed and the game ends when the engine detects that the game is over.
+ *             With the 'bench' argument, the benchmark is run instead.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
  *
  * @return     0 if program exited successfully
  */
-int main()
+int main(int argc, char *argv[])
 {
+    if(argc >= 2 && strcmp(argv[1], "bench") == 0)
+        return benchCommand(argc >= 3 ? atoi(argv[2]) : BENCH_DEPTH);
+
+
     // 'src' -> coordinate of to-be-moved piece, 'dest' -> coordinate of it's final location
     // Coordinates are in [A1, H8] -> A1 is bottom left, H8 is top right
     string src, dest;
@@ -84,4 +119,48 @@ int main()
     }
 
     return 0;
-}       
\ No newline at end of file
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Runs the benchmark and prints its signature, time and nodes
+     *             per second.
+     *
+     * @param[in]  depth  The depth of the searches (in plies)
+     *
+     * @return     1 if the signature of BENCH_DEPTH or BENCH_QUICK_DEPTH is
+     *             not the expected one, 0 otherwise.
+     */
+    int benchCommand(int depth)
+    {
+        if(depth <= 0)
+        {
+            printf("Usage:\n  main bench [depth]\n");
+            return 1;
+        }
+
+        BenchResult result;
+        runBench(depth, result, [](const BenchPosition &position, int index)
+        {
+            printf("Position %2d: %10llu nodes %8.0f ms  %s\n", index + 1, (unsigned long long) position.nodes,
+                   position.seconds * 1000, position.fen.c_str());
+        });
+
+        printf("\nNodes:     %llu\n", (unsigned long long) result.nodes);
+        printf("Time:      %.0f ms\n", result.seconds * 1000);
+        printf("Nodes/s:   %.0f\n", result.seconds > 0 ? result.nodes / result.seconds : 0.0);
+
+        // the signature is only known at the default and quick depths
+        if(depth != BENCH_DEPTH && depth != BENCH_QUICK_DEPTH)
+            return 0;
+
+        uint64_t expected = depth == BENCH_DEPTH ? BENCH_SIGNATURE : BENCH_QUICK_SIGNATURE;
+        bool matches = result.nodes == expected;
+        printf("Signature: %s (expected %llu)\n", matches ? "matches" : "CHANGED", (unsigned long long) expected);
+        return matches ? 0 : 1;
+    }
+}
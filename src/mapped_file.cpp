@@ -0,0 +1,138 @@
+/**
+ * \page mappedfile Memory Mapped File Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;mapped_file.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;mapped_file.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Uses CreateFileMapping/MapViewOfFile on Windows and mmap everywhere else.
+ */
+
+#include "mapped_file.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*************************************************************************************/
+/*                              MAPPED FILE - MEMBER FUNCTIONS                       */
+/*************************************************************************************/
+/**
+ * @brief      Default constructor - Constructs a new instance with no file
+ *             mapped.
+ */
+MappedFile::MappedFile()
+    : data{nullptr}, size{0}
+#ifdef _WIN32
+    , file{INVALID_HANDLE_VALUE}, mapping{nullptr}
+#endif
+{
+}
+
+/**
+ * @brief      Destroys the object and releases the mapping.
+ */
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+/**
+ * @brief      Maps a file into memory (read-only).
+ *
+ * @param[in]  filename  The name of the file
+ *
+ * @post       Any previously mapped file is released first.
+ *
+ * @return     True if the file was mapped, False otherwise.
+ */
+bool MappedFile::open(const string &filename)
+{
+    close();
+
+#ifdef _WIN32
+    file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(file, &file_size))
+    {
+        close();
+        return false;
+    }
+
+    size = (size_t) file_size.QuadPart;
+    if(size == 0)
+        return true; // an empty file cannot be mapped, but is still valid
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping != nullptr)
+        data = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd == -1)
+        return false;
+
+    struct stat file_info;
+    if(fstat(fd, &file_info) == 0)
+    {
+        size = (size_t) file_info.st_size;
+        if(size == 0)
+        {
+            ::close(fd);
+            return true; // an empty file cannot be mapped, but is still valid
+        }
+
+        void *view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if(view != MAP_FAILED)
+            data = (const char *) view;
+    }
+
+    // the mapping stays valid after the file descriptor is closed
+    ::close(fd);
+#endif
+
+    if(data == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Releases the mapping (if any).
+ */
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if(data != nullptr)
+        UnmapViewOfFile(data);
+    if(mapping != nullptr)
+        CloseHandle(mapping);
+    if(file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if(data != nullptr)
+        munmap((void *) data, size);
+#endif
+
+    data = nullptr;
+    size = 0;
+}
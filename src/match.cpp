@@ -0,0 +1,357 @@
+/**
+ * \page match Engine Match Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;match.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;match.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Playing engine-vs-engine games and matches, and the statistics of their
+ * results (see match.h).
+ */
+
+#include "match.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <thread>
+
+// included in 'match.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Converts an expected score into an Elo difference.
+     *
+     * @param[in]  score  The expected score in (0, 1)
+     *
+     * @return     The Elo difference.
+     */
+    double scoreToElo(double score);
+
+    /**
+     * @brief      Converts an Elo difference into an expected score.
+     *
+     * @param[in]  elo   The Elo difference
+     *
+     * @return     The expected score in (0, 1).
+     */
+    double eloToScore(double elo);
+
+    /**
+     * @brief      Computes the mean and variance of the score of a game.
+     *
+     * @param[in]  stats     The results
+     * @param      mean      The mean score
+     * @param      variance  The variance of the score of a game
+     */
+    void scoreMoments(const MatchStats &stats, double &mean, double &variance);
+} // unnamed namespace (makes these functions local to this implementation file)
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Plays a game between two engines.
+     *
+     * @param      white  The engine playing white
+     * @param      black  The engine playing black
+     * @param      chess  The chess object (should be headless), which holds the
+     *                    starting position
+     * @param[in]  rules  When the game is ended early
+     * @param      game   The moves and result are appended to it
+     * @param[in]  visit  Called with each position an engine moved from and the
+     *                    score of its search (for the side to move), before the
+     *                    move is made (can be nullptr)
+     *
+     * @return     True if the game was ended by adjudication, False if it ended
+     *             by checkmate or stalemate.
+     */
+    bool playGame(Engine &white, Engine &black, Chess &chess, const Adjudication &rules, GameRecord &game,
+                  const function<void(const Chess &, int)> &visit)
+    {
+        int ply = 0, resign_count = 0, draw_count = 0, last_sign = 0;
+        bool adjudicated = false;
+
+        game.result = "1/2-1/2";
+
+        while(!chess.getCheckmate() && !chess.getStalemate())
+        {
+            if( (rules.max_plies > 0 && ply >= rules.max_plies) ||
+                (rules.fifty_moves && chess.getHalfmoveClock() >= 100) )
+            {
+                adjudicated = true;
+                break;
+            }
+
+            int score;
+            Move move = (chess.getTurn() == WHITE ? white : black).search(chess, score);
+
+            // the rules did not end the game, but there is no move to make
+            if(move.src == -1)
+            {
+                if(chess.getCheck() || chess.getDoubleCheck())
+                    game.result = chess.getTurn() == WHITE ? "0-1" : "1-0";
+                break;
+            }
+
+            // -------- adjudication (from white's point of view) -------- //
+            int white_score = chess.getTurn() == WHITE ? score : -score;
+            int sign = white_score >= rules.resign_score ? 1 : white_score <= -rules.resign_score ? -1 : 0;
+
+            resign_count = sign != 0 && sign == last_sign ? resign_count + 1 : (sign != 0 ? 1 : 0);
+            last_sign = sign;
+            draw_count = ply >= rules.draw_start && std::abs(white_score) <= rules.draw_score ? draw_count + 1 : 0;
+
+            if(rules.resign_plies > 0 && resign_count >= rules.resign_plies)
+            {
+                game.result = sign > 0 ? "1-0" : "0-1";
+                adjudicated = true;
+                break;
+            }
+            if(rules.draw_plies > 0 && draw_count >= rules.draw_plies)
+            {
+                adjudicated = true;
+                break;
+            }
+
+            if(visit)
+                visit(chess, score);
+
+            if(!playMove(chess, move))
+                break; // GCOV_EXCL_LINE (the engine only finds legal moves)
+
+            game.moves.push_back(formatMove(move.src, move.dest, move.promotion));
+            ply++;
+        }
+
+        // the turn is switched after the checkmating move
+        if(chess.getCheckmate())
+            game.result = chess.getTurn() == WHITE ? "0-1" : "1-0";
+
+        game.final_fen = chess.toFEN();
+        return adjudicated;
+    }
+
+    /**
+     * @brief      Plays a match between two engine configurations on a pool of
+     *             threads.
+     *
+     * @param[in]  config   The settings of the match
+     * @param      stats    The results of the match
+     * @param[in]  on_game  Called after every game with the game, its number and
+     *                      the results so far (one call at a time, so it can
+     *                      write to a file without locking)
+     *
+     * @return     True if the match was played, False if an opening is not a
+     *             valid FEN.
+     */
+    bool runMatch(const MatchConfig &config, MatchStats &stats,
+                  const function<void(const GameRecord &, int, const MatchStats &)> &on_game)
+    {
+        vector<string> openings = config.openings;
+        if(openings.empty())
+            openings.push_back(START_FEN);
+
+        Chess validate;
+        validate.setHeadless(true);
+        for(const auto & fen : openings)
+            if(!validate.setFromFEN(fen))
+                return false;
+
+        int num_threads = config.threads > 0 ? config.threads : max(1u, thread::hardware_concurrency());
+        double lower = log(config.beta / (1 - config.alpha)), upper = log((1 - config.beta) / config.alpha);
+
+        // each thread takes the next game until none are left (or the SPRT is
+        // decided), so slow games do not hold back the other threads
+        atomic<int> next_game{0};
+        atomic<bool> stop{false};
+        mutex results;
+        vector<thread> threads;
+
+        stats = MatchStats();
+        auto start = chrono::steady_clock::now();
+
+        for(int t = 0; t < num_threads; t++)
+        {
+            threads.emplace_back([&]()
+            {
+                Engine engines[2] = {Engine(config.engines[0]), Engine(config.engines[1])};
+                Chess chess;
+                chess.setHeadless(true);
+
+                for(int g = next_game++; g < config.games && !stop; g = next_game++)
+                {
+                    // both games of an opening start from the same position,
+                    // with the colors swapped
+                    int pair = g / 2;
+                    bool first_white = g % 2 == 0;
+
+                    chess.setFromFEN(openings[pair % openings.size()]);
+
+                    mt19937 random(config.seed + pair);
+                    for(int i = 0; i < config.random_plies; i++)
+                    {
+                        vector<Move> moves = legalMoves(chess);
+                        if(moves.empty())
+                            break;
+                        playMove(chess, moves[random() % moves.size()]);
+                    }
+
+                    GameRecord game;
+                    game.fen = chess.toFEN();
+
+                    uint64_t nodes = engines[0].getNodes() + engines[1].getNodes();
+                    bool adjudicated = playGame(engines[first_white ? 0 : 1], engines[first_white ? 1 : 0], chess, config.adjudication, game);
+                    nodes = engines[0].getNodes() + engines[1].getNodes() - nodes;
+
+                    lock_guard<mutex> lock(results);
+
+                    if(game.result == "1/2-1/2")
+                        stats.draws++;
+                    else if((game.result == "1-0") == first_white)
+                        stats.wins++;
+                    else
+                        stats.losses++;
+
+                    stats.adjudicated += adjudicated;
+                    stats.plies += game.moves.size();
+                    stats.nodes += nodes;
+                    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                    stats.llr = sprtLLR(stats, config.elo0, config.elo1);
+
+                    if(stats.sprt == 0 && (stats.llr >= upper || stats.llr <= lower))
+                    {
+                        stats.sprt = stats.llr >= upper ? 1 : -1;
+                        stop = true;
+                    }
+
+                    if(on_game)
+                        on_game(game, g, stats);
+                }
+            });
+        }
+
+        for(auto & elem : threads)
+            elem.join();
+
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    /**
+     * @brief      Computes the log-likelihood ratio of the SPRT, using the
+     *             normal approximation of the trinomial (win, draw, loss)
+     *             results.
+     *
+     * @param[in]  stats  The results
+     * @param[in]  elo0   The Elo difference of H0
+     * @param[in]  elo1   The Elo difference of H1
+     *
+     * @return     The log-likelihood ratio (0 if the results do not vary yet).
+     */
+    double sprtLLR(const MatchStats &stats, double elo0, double elo1)
+    {
+        double mean, variance;
+        scoreMoments(stats, mean, variance);
+
+        if(variance <= 0)
+            return 0;
+
+        double games = stats.wins + stats.draws + stats.losses;
+        double score0 = eloToScore(elo0), score1 = eloToScore(elo1);
+
+        return games * (score1 - score0) * (2 * mean - score0 - score1) / (2 * variance);
+    }
+
+    /**
+     * @brief      Estimates the Elo difference from the results.
+     *
+     * @param[in]  stats   The results
+     * @param      margin  The 95% error margin of the estimate
+     *
+     * @return     The Elo difference (positive if engines[0] is stronger).
+     */
+    double eloDifference(const MatchStats &stats, double &margin)
+    {
+        double mean, variance;
+        scoreMoments(stats, mean, variance);
+
+        double games = stats.wins + stats.draws + stats.losses;
+        double error = games > 0 ? 1.959964 * sqrt(variance / games) : 0;
+
+        margin = (scoreToElo(mean + error) - scoreToElo(mean - error)) / 2;
+        return scoreToElo(mean);
+    }
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Converts an expected score into an Elo difference.
+     *
+     * @param[in]  score  The expected score in (0, 1)
+     *
+     * @return     The Elo difference.
+     */
+    double scoreToElo(double score)
+    {
+        // a perfect score has an infinite difference, so keep it finite
+        score = min(max(score, 0.001), 0.999);
+        return -400 * log10(1 / score - 1);
+    }
+
+    /**
+     * @brief      Converts an Elo difference into an expected score.
+     *
+     * @param[in]  elo   The Elo difference
+     *
+     * @return     The expected score in (0, 1).
+     */
+    double eloToScore(double elo)
+    {
+        return 1 / (1 + pow(10, -elo / 400));
+    }
+
+    /**
+     * @brief      Computes the mean and variance of the score of a game.
+     *
+     * @param[in]  stats     The results
+     * @param      mean      The mean score
+     * @param      variance  The variance of the score of a game
+     */
+    void scoreMoments(const MatchStats &stats, double &mean, double &variance)
+    {
+        double games = stats.wins + stats.draws + stats.losses;
+        if(games == 0)
+        {
+            mean = 0.5;
+            variance = 0;
+            return;
+        }
+
+        mean = (stats.wins + 0.5 * stats.draws) / games;
+        variance = ( stats.wins * (1 - mean) * (1 - mean) + stats.draws * (0.5 - mean) * (0.5 - mean) +
+                     stats.losses * mean * mean ) / games;
+    }
+}
@@ -0,0 +1,577 @@
+/**
+ * \page mcts Monte Carlo Tree Search Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;mcts.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;mcts.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * The tree, its playouts and its threads (see mcts.h).
+ */
+
+#include "mcts.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+
+// included in 'mcts.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /** The result of a win, a draw and a loss (see MctsNode::value) */
+    const unsigned int WIN = 1000, DRAW = 500;
+
+    /** The number of visits of a node before its children are added (a
+     *  chessCAMO position has about a hundred moves with the reservoir, so a
+     *  node that is expanded takes a hundred nodes of the pool) */
+    const uint32_t EXPAND_VISITS = 8;
+
+    /** The average result of a move that was not visited yet (a bit less than
+     *  a draw, so that the moves that did well are visited again first) */
+    const double FIRST_PLAY = 0.45;
+
+    /**
+     * @brief      Plays a random game from a position for a few moves, and
+     *             finds its result (from the evaluation if it is not over).
+     *
+     * @param      game    The position (game 0, it is changed)
+     * @param      moves   A buffer of MAX_BATCH_MOVES moves
+     * @param      scores  A buffer for the evaluation
+     * @param      rng     The random numbers
+     * @param[in]  config  The settings of the search
+     *
+     * @return     The result for the side to move of the position (0 to WIN).
+     */
+    unsigned int playout(GameBatch &game, Move *moves, vector<int> &scores, mt19937 &rng, const EngineConfig &config);
+
+    /**
+     * @brief      Finds the squares of the pieces of the side not to move.
+     *
+     * @param[in]  game  The position (game 0)
+     *
+     * @return     The bitboard.
+     */
+    uint64_t enemyPieces(const GameBatch &game);
+
+    /**
+     * @brief      Converts an average result into a score.
+     *
+     * @param[in]  result  The average result (0 to 1)
+     *
+     * @return     The score (in centipawns), the inverse of the logistic
+     *             function used by playout().
+     */
+    int resultToScore(double result);
+}
+
+/*************************************************************************************/
+/*                              MCTS TREE - MEMBER FUNCTIONS                         */
+/*************************************************************************************/
+/**
+ * @brief      Constructs a new instance.
+ *
+ * @param[in]  config  The settings of the search
+ */
+MctsTree::MctsTree(const EngineConfig &config)
+    : current(0), used{0}, root(1)
+{
+    setConfig(config);
+}
+
+/**
+ * @brief      (Mutator) Sets the settings of the search (the tree is kept
+ *             unless the number of nodes changed).
+ *
+ * @param[in]  config  The settings
+ */
+void MctsTree::setConfig(const EngineConfig &config)
+{
+    unsigned int tree_nodes = max(config.tree_nodes, 2u);
+    bool resize = !pool[0] || tree_nodes != this->config.tree_nodes;
+    this->config = config;
+    this->config.tree_nodes = tree_nodes;
+
+    if(resize)
+    {
+        pool[0].reset(new MctsNode[this->config.tree_nodes]);
+        pool[1].reset(new MctsNode[this->config.tree_nodes]);
+        current = 0;
+        clear();
+    }
+}
+
+/**
+ * @brief      Sets the position to search. If it is the root of the tree or
+ *             follows from it by one or two moves, the subtree of the position
+ *             is kept, otherwise the tree is cleared.
+ *
+ * @param[in]  chess  The chess object
+ *
+ * @return     True if a subtree was kept, False otherwise.
+ */
+bool MctsTree::setRoot(const Chess &chess)
+{
+    GameBatch games(3);
+    games.set(0, chess);
+
+    const MctsNode *nodes = pool[current].get();
+    uint32_t found = 0;
+    bool kept = nodes[0].visits > 0 && games.samePosition(0, root, 0);
+
+    // the children (the engine's move) and grandchildren (the reply) of the
+    // root
+    for(uint32_t child = nodes[0].first_child; !kept && nodes[0].state == NODE_EXPANDED &&
+        child < nodes[0].first_child + nodes[0].num_children; child++)
+    {
+        games.copyGame(1, root, 0);
+        games.applyMove(1, nodes[child].move);
+        if(games.samePosition(0, games, 1))
+        {
+            found = child;
+            kept = true;
+        }
+
+        for(uint32_t reply = nodes[child].first_child; !kept && nodes[child].state == NODE_EXPANDED &&
+            reply < nodes[child].first_child + nodes[child].num_children; reply++)
+        {
+            games.copyGame(2, games, 1);
+            games.applyMove(2, nodes[reply].move);
+            if(games.samePosition(0, games, 2))
+            {
+                found = reply;
+                kept = true;
+            }
+        }
+    }
+
+    root.copyGame(0, games, 0);
+
+    // the positions of the game, for the repetitions in the tree
+    history = chess.getHistory();
+    if(history.hashes.empty())
+        history.reset(chess.getNumMoves(), root.getHash(0));
+
+    if(!kept)
+        clear();
+    else if(found != 0)
+        keepSubtree(found);
+
+    stats.reused = kept ? (uint32_t) pool[current][0].visits : 0;
+    return kept;
+}
+
+/**
+ * @brief      Runs playouts from the root (on EngineConfig::search_threads
+ *             threads).
+ *
+ * @param[in]  playouts  The number of playouts
+ * @param[in]  stop      Set (ex. by another thread) to stop as soon as
+ *                       possible (nullptr if it cannot be stopped)
+ *
+ * @return     The number of playouts that were run.
+ */
+uint64_t MctsTree::run(uint64_t playouts, const atomic<bool> *stop)
+{
+    atomic<uint64_t> next{0};
+    auto start = chrono::steady_clock::now();
+    uint32_t visits = pool[current][0].visits;
+
+    int num_threads = max(config.search_threads, 1);
+    vector<thread> threads;
+    for(int i = 1; i < num_threads; i++)
+        threads.emplace_back(&MctsTree::worker, this, playouts, ref(next), stop, (unsigned int) i);
+    worker(playouts, next, stop, 0);
+
+    for(auto & elem : threads)
+        elem.join();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    stats.playouts = pool[current][0].visits - visits;
+    stats.playouts_per_second = seconds > 0 ? stats.playouts / seconds : 0;
+    stats.nodes = min(used.load(), config.tree_nodes);
+
+    return stats.playouts;
+}
+
+/**
+ * @brief      Gets the best move of the root (the most visited one).
+ *
+ * @param      score  The score of the move (in centipawns) for the side to
+ *                    move, from its average result
+ * @param      pv     The most visited line from the root (nullptr if it is not
+ *                    needed)
+ *
+ * @return     The best move, or a move with 'src' = -1 if there is none (or no
+ *             playout was run).
+ */
+Move MctsTree::best(int &score, vector<Move> *pv) const
+{
+    const MctsNode *nodes = pool[current].get();
+    Move best_move = {-1, -1, '\0'};
+    score = 0;
+
+    if(pv != nullptr)
+        pv->clear();
+
+    for(uint32_t node = 0; nodes[node].state == NODE_EXPANDED;)
+    {
+        uint32_t most = nodes[node].first_child;
+        for(uint32_t child = most + 1; child < nodes[node].first_child + nodes[node].num_children; child++)
+            if(nodes[child].visits > nodes[most].visits)
+                most = child;
+
+        if(nodes[most].visits == 0)
+            break;
+
+        if(node == 0)
+        {
+            best_move = nodes[most].move;
+            score = resultToScore((double) nodes[most].value / nodes[most].visits / WIN);
+        }
+
+        if(pv == nullptr)
+            break;
+
+        pv->push_back(nodes[most].move);
+        node = most;
+    }
+
+    return best_move;
+}
+
+/**
+ * @brief      Clears the tree (only the root is left).
+ */
+void MctsTree::clear()
+{
+    MctsNode &node = pool[current][0];
+    node.move = {-1, -1, '\0'};
+    node.prior = 1;
+    node.visits = 0;
+    node.value = 0;
+    node.first_child = node.num_children = node.outcome = 0;
+    node.state = NODE_LEAF;
+
+    used = 1;
+}
+
+/**
+ * @brief      Makes a node the root of the tree, with its subtree (copied to
+ *             the front of the other pool, which becomes the pool of the
+ *             tree).
+ *
+ * @param[in]  node  The node
+ */
+void MctsTree::keepSubtree(uint32_t node)
+{
+    const MctsNode *from = pool[current].get();
+    MctsNode *to = pool[1 - current].get();
+
+    // breadth first, so that the children of a node stay next to each other
+    vector<pair<uint32_t, uint32_t>> queue = {{node, 0}};
+    uint32_t size = 1;
+    for(size_t i = 0; i < queue.size(); i++)
+    {
+        const MctsNode &old_node = from[queue[i].first];
+        MctsNode &new_node = to[queue[i].second];
+
+        new_node.move = old_node.move;
+        new_node.prior = old_node.prior;
+        new_node.visits = old_node.visits.load();
+        new_node.value = old_node.value.load();
+        new_node.outcome = old_node.outcome;
+        // there is room in the new pool for the children of a full node
+        new_node.state = old_node.state == NODE_FULL ? (uint8_t) NODE_LEAF : old_node.state.load();
+        new_node.first_child = size;
+        new_node.num_children = new_node.state == NODE_EXPANDED ? old_node.num_children : 0;
+
+        for(uint32_t child = 0; child < new_node.num_children; child++)
+            queue.emplace_back(old_node.first_child + child, size + child);
+        size += new_node.num_children;
+    }
+
+    current = 1 - current;
+    used = size;
+}
+
+/**
+ * @brief      Runs playouts until 'next' reaches 'playouts' (one thread).
+ *
+ * @param[in]  playouts  The number of playouts
+ * @param      next      The number of playouts started (by all threads)
+ * @param[in]  stop      Stops the playouts when set (can be nullptr)
+ * @param[in]  seed      The seed of the random moves
+ */
+void MctsTree::worker(uint64_t playouts, atomic<uint64_t> &next, const atomic<bool> *stop, unsigned int seed)
+{
+    MctsNode *nodes = pool[current].get();
+    GameBatch game(1);
+    Move moves[MAX_BATCH_MOVES];
+    vector<int> scores;
+    vector<uint32_t> path;
+    mt19937 rng(seed + pool[current][0].visits);
+
+    // the history of the line being searched (each thread has its own)
+    PositionHistory line = history;
+    int root_ply = history.first_ply + (int) history.hashes.size() - 1;
+
+    while(next.fetch_add(1) < playouts && (stop == nullptr || !stop->load(memory_order_relaxed)))
+    {
+        game.copyGame(0, root, 0);
+        path.assign(1, 0);
+        nodes[0].visits++;
+
+        // down the tree: each visit counts at once, as a loss until the
+        // playout is done (virtual loss)
+        unsigned int result;
+        for(int ply = root_ply;;)
+        {
+            uint32_t node = path.back();
+            uint8_t state = nodes[node].state.load(memory_order_acquire);
+            if(state == NODE_LEAF && (node == 0 || nodes[node].visits >= EXPAND_VISITS))
+            {
+                uint8_t leaf = NODE_LEAF;
+                if(nodes[node].state.compare_exchange_strong(leaf, NODE_EXPANDING))
+                {
+                    expand(node, game, moves);
+                    state = nodes[node].state.load(memory_order_acquire);
+                }
+            }
+
+            if(state == NODE_TERMINAL)
+            {
+                result = nodes[node].outcome;
+                break;
+            }
+            else if(state != NODE_EXPANDED)
+            {
+                // a leaf visited for the first time, one being expanded by
+                // another thread or one the pool had no room for
+                result = playout(game, moves, scores, rng, config);
+                break;
+            }
+
+            uint32_t child = select(node);
+            nodes[child].visits++;
+            int rights = game.getCastlingRights(0);
+            game.applyMove(0, nodes[child].move);
+            path.push_back(child);
+
+            // a repetition or the 50 move rule is a draw (as in the alpha-beta
+            // search), and the children of the node are never added
+            bool irreversible = nodes[child].move.src > 63 || game.getHalfmoveClock(0) == 0 ||
+                                game.getCastlingRights(0) != rights;
+            line.record(++ply, game.getHash(0), irreversible);
+            if(line.repetitions(ply) > 0 || game.getHalfmoveClock(0) >= 100)
+            {
+                result = DRAW;
+                break;
+            }
+        }
+
+        // back up the tree, for the side that made each move
+        for(auto it = path.rbegin(); it != path.rend(); ++it)
+        {
+            result = WIN - result;
+            nodes[*it].value += result;
+        }
+    }
+}
+
+/**
+ * @brief      Adds the children (legal moves) of a node.
+ *
+ * @param[in]  node   The node (in the state NODE_EXPANDING)
+ * @param      game   The position of the node (game 0)
+ * @param      moves  A buffer of MAX_BATCH_MOVES moves
+ */
+void MctsTree::expand(uint32_t node, GameBatch &game, Move *moves)
+{
+    MctsNode *nodes = pool[current].get();
+    int count = game.gameMoves(0, moves, config.reservoir_moves);
+    if(count == 0)
+    {
+        nodes[node].outcome = game.getCheck(0) ? 0 : DRAW;
+        nodes[node].state.store(NODE_TERMINAL, memory_order_release);
+        return;
+    }
+
+    uint32_t first = used.fetch_add(count);
+    if(first + count > config.tree_nodes)
+    {
+        nodes[node].state.store(NODE_FULL, memory_order_release);
+        return;
+    }
+
+    // captures and promotions first, then the other board moves, then the
+    // reservoir moves
+    uint64_t enemy = enemyPieces(game);
+    float total = 0;
+    for(int i = 0; i < count; i++)
+    {
+        MctsNode &child = nodes[first + i];
+        child.move = moves[i];
+        child.visits = 0;
+        child.value = 0;
+        child.first_child = child.num_children = child.outcome = 0;
+        child.state = NODE_LEAF;
+
+        if(moves[i].src >= 64)
+            child.prior = config.reservoir_prior / 100.0f;
+        else if((enemy >> moves[i].dest & 1) || moves[i].promotion != '\0')
+            child.prior = 3;
+        else
+            child.prior = 1;
+        total += child.prior;
+    }
+
+    for(int i = 0; i < count; i++)
+        nodes[first + i].prior /= total > 0 ? total : 1;
+
+    nodes[node].first_child = first;
+    nodes[node].num_children = (uint16_t) count;
+    nodes[node].state.store(NODE_EXPANDED, memory_order_release);
+}
+
+/**
+ * @brief      Selects the child of a node to visit (PUCT or UCT).
+ *
+ * @param[in]  node  The node (in the state NODE_EXPANDED)
+ *
+ * @return     The index of the child in the pool.
+ */
+uint32_t MctsTree::select(uint32_t node) const
+{
+    const MctsNode *nodes = pool[current].get();
+    double parent_visits = max<uint32_t>(nodes[node].visits.load(memory_order_relaxed), 1);
+    double explore = config.puct ? config.exploration * sqrt(parent_visits) : 0;
+    double log_visits = config.puct ? 0 : log(parent_visits);
+
+    uint32_t best_child = nodes[node].first_child;
+    double best_value = -1;
+    for(uint32_t child = nodes[node].first_child; child < nodes[node].first_child + nodes[node].num_children;
+        child++)
+    {
+        uint32_t visits = nodes[child].visits.load(memory_order_relaxed);
+        double result = visits > 0 ? (double) nodes[child].value.load(memory_order_relaxed) / visits / WIN
+                                   : FIRST_PLAY;
+
+        double value;
+        if(config.puct)
+            value = result + explore * nodes[child].prior / (1 + visits);
+        else if(visits == 0)
+            return child;
+        else
+            value = result + config.exploration * sqrt(log_visits / visits);
+
+        if(value > best_value)
+        {
+            best_value = value;
+            best_child = child;
+        }
+    }
+
+    return best_child;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Plays a random game from a position for a few moves, and
+     *             finds its result (from the evaluation if it is not over).
+     *
+     * @param      game    The position (game 0, it is changed)
+     * @param      moves   A buffer of MAX_BATCH_MOVES moves
+     * @param      scores  A buffer for the evaluation
+     * @param      rng     The random numbers
+     * @param[in]  config  The settings of the search
+     *
+     * @return     The result for the side to move of the position (0 to WIN).
+     */
+    unsigned int playout(GameBatch &game, Move *moves, vector<int> &scores, mt19937 &rng, const EngineConfig &config)
+    {
+        for(int ply = 0; ply < config.playout_plies; ply++)
+        {
+            int count = game.gameMoves(0, moves, config.reservoir_moves);
+            if(count == 0)
+            {
+                // the side to move now is the side of the position after an
+                // even number of moves
+                unsigned int result = game.getCheck(0) ? 0 : DRAW;
+                return ply % 2 == 0 ? result : WIN - result;
+            }
+            else if(game.getHalfmoveClock(0) >= 100)
+                return DRAW;
+
+            int choice = rng() % count;
+            if(config.light_playouts && rng() % 2 == 0)
+            {
+                // a random capture, if there is one
+                uint64_t enemy = enemyPieces(game);
+                int captures = 0;
+                for(int i = 0; i < count; i++)
+                    if(moves[i].src < 64 && (enemy >> moves[i].dest & 1))
+                        moves[captures++] = moves[i];
+                if(captures > 0)
+                    choice = rng() % captures;
+            }
+
+            game.applyMove(0, moves[choice]);
+        }
+
+        // the evaluation as a probability of winning (400 centipawns make the
+        // odds ten times better)
+        game.evaluate(config, scores);
+        double result = WIN / (1 + pow(10.0, -scores[0] / 400.0));
+        unsigned int rounded = (unsigned int) lround(result);
+        return config.playout_plies % 2 == 0 ? rounded : WIN - rounded;
+    }
+
+    /**
+     * @brief      Finds the squares of the pieces of the side not to move.
+     *
+     * @param[in]  game  The position (game 0)
+     *
+     * @return     The bitboard.
+     */
+    uint64_t enemyPieces(const GameBatch &game)
+    {
+        pieceColor enemy = game.getTurn(0) == WHITE ? BLACK : WHITE;
+        uint64_t pieces = 0;
+        for(int type = PAWN; type <= KING; type++)
+            pieces |= game.getPieces(0, (pieceType) type, enemy);
+
+        return pieces;
+    }
+
+    /**
+     * @brief      Converts an average result into a score.
+     *
+     * @param[in]  result  The average result (0 to 1)
+     *
+     * @return     The score (in centipawns), the inverse of the logistic
+     *             function used by playout().
+     */
+    int resultToScore(double result)
+    {
+        result = min(max(result, 0.001), 0.999);
+        return (int) lround(-400 * log10(1 / result - 1));
+    }
+}
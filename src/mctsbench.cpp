@@ -0,0 +1,145 @@
+/**
+ * \page mctsbench Monte Carlo Tree Search Benchmark Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;mctsbench.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;mcts.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Searches a position with the Monte Carlo tree search on 1, 2, 4, ... threads
+ * and reports the playouts per second of each and the speedup over one thread.
+ * Then plays the best move and a reply, and reports how much of the tree the
+ * next search keeps.
+ *
+ * Simply run <b>mingw32-make all_mctsbench</b> and then <b>mctsbench
+ * [options]</b>, where the options are:
+ * - <b>--fen FEN</b>: the position (the starting position);
+ * - <b>--playouts N</b>: the playouts of each search (20000);
+ * - <b>--max-threads N</b>: the most threads (all cores);
+ * - <b>--uct</b>: selects the moves with UCT instead of PUCT.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "mcts.h"
+#include "archive.h"
+
+// included in 'mcts.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+}
+
+/**
+ * @brief      Times the Monte Carlo tree search on an increasing number of
+ *             threads.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if the position was searched, 1 for invalid usage or
+ *             position.
+ */
+int main(int argc, char *argv[])
+{
+    EngineConfig config;
+    config.search = SEARCH_MCTS;
+    config.playouts = 20000;
+    int max_threads = max((int) thread::hardware_concurrency(), 1);
+    string fen = START_FEN;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--uct") == 0)
+            config.puct = false;
+        else if(i + 1 >= argc)
+            return usage();
+        else if(strcmp(argv[i], "--fen") == 0)
+            fen = argv[++i];
+        else if(strcmp(argv[i], "--playouts") == 0)
+            config.playouts = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--max-threads") == 0)
+            max_threads = atoi(argv[++i]);
+        else
+            return usage();
+    }
+
+    Chess chess;
+    chess.setHeadless(true);
+    if(!chess.setFromFEN(fen.c_str()) || config.playouts <= 0 || max_threads <= 0)
+        return usage();
+
+    double single = 0;
+    for(int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        config.search_threads = threads;
+        MctsTree tree(config);
+        tree.setRoot(chess);
+        tree.run(config.playouts);
+
+        int score;
+        Move best = tree.best(score);
+        MctsStats stats = tree.getStats();
+        single = threads == 1 ? stats.playouts_per_second : single;
+
+        printf("Threads %2d  playouts %llu  %.0f playouts/s  speedup %.2fx  nodes %u  best %d-%d (%+d)\n", threads,
+               (unsigned long long) stats.playouts, stats.playouts_per_second, stats.playouts_per_second / single,
+               stats.nodes, best.src, best.dest, score);
+    }
+
+    // the tree kept after the best move and the most visited reply
+    config.search_threads = 1;
+    MctsTree tree(config);
+    tree.setRoot(chess);
+    tree.run(config.playouts);
+
+    int score;
+    vector<Move> pv;
+    tree.best(score, &pv);
+    for(size_t i = 0; i < pv.size() && i < 2; i++)
+        playMove(chess, pv[i]);
+
+    bool kept = pv.size() >= 2 && tree.setRoot(chess);
+    printf("Reuse after %d moves: %s (%u of %u visits)\n", (int) min<size_t>(pv.size(), 2), kept ? "kept" : "cleared",
+           tree.getStats().reused, (unsigned int) config.playouts);
+
+    return 0;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage: mctsbench [--fen FEN] [--playouts N] [--max-threads N] [--uct]\n");
+        return 1;
+    }
+}
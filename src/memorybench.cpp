@@ -0,0 +1,302 @@
+/**
+ * \page memorybench Resident Games Memory Benchmark Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;memorybench.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;resident_games.h, chess.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Plays random games for a few moves, then reports the memory of each live
+ * game kept as a Chess object and as a resident game (ResidentGames), in bytes
+ * per game and in total for a million games. The resident games are copies of
+ * the played ones. Also times loading a resident game into a chess object and
+ * storing it back.
+ *
+ * The memory is counted by replacing the global operator new and delete, so
+ * it is the memory that was asked for (the allocator adds a few bytes to each
+ * allocation).
+ *
+ * Simply run <b>mingw32-make all_memorybench</b> and then <b>memorybench
+ * [options]</b>, where the options are:
+ * - <b>--games N</b>: the number of resident games (1000000);
+ * - <b>--chess-games N</b>: the number of games played as Chess objects (200);
+ * - <b>--plies N</b>: the number of random moves of each game (40);
+ * - <b>--seed N</b>: the seed of the random moves (1).
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+
+#include "resident_games.h"
+#include "archive.h"
+#include "engine.h"
+
+// included in 'resident_games.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /** The bytes that were allocated and not freed yet */
+    size_t heap_bytes = 0;
+
+    /** The allocations that were not freed yet */
+    size_t heap_blocks = 0;
+
+    /** The room in front of each allocation for its size (keeps the alignment
+     *  of the allocator) */
+    const size_t HEADER = 16;
+
+    /**
+     * @brief      Allocates a counted block.
+     *
+     * @param[in]  size  The number of bytes
+     *
+     * @return     The block, or nullptr if there is no memory.
+     */
+    void * countedAlloc(size_t size);
+
+    /**
+     * @brief      Frees a counted block.
+     *
+     * @param      block  The block (can be nullptr)
+     */
+    void countedFree(void *block);
+
+    /**
+     * @brief      Prints the memory of some live games.
+     *
+     * @param[in]  name       The name of the representation
+     * @param[in]  num_games  The number of games
+     * @param[in]  bytes      The bytes they take
+     * @param[in]  blocks     The allocations they take
+     */
+    void report(const char *name, size_t num_games, size_t bytes, size_t blocks);
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+}
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+/**
+ * @brief      Allocates memory (counted).
+ *
+ * @param[in]  size  The number of bytes
+ *
+ * @return     The memory.
+ */
+void * operator new(size_t size)
+{
+    void *block = countedAlloc(size);
+    if(block == nullptr)
+        throw bad_alloc();
+    return block;
+}
+
+/**
+ * @brief      Allocates memory (counted), without throwing.
+ *
+ * @param[in]  size  The number of bytes
+ *
+ * @return     The memory, or nullptr if there is none.
+ */
+void * operator new(size_t size, const nothrow_t &) noexcept
+{
+    return countedAlloc(size);
+}
+
+/**
+ * @brief      Frees memory (counted).
+ *
+ * @param      block  The memory
+ */
+void operator delete(void *block) noexcept
+{
+    countedFree(block);
+}
+
+/**
+ * @brief      Frees memory (counted), when its size is known.
+ *
+ * @param      block  The memory
+ */
+void operator delete(void *block, size_t) noexcept
+{
+    countedFree(block);
+}
+
+/**
+ * @brief      Frees memory (counted) allocated without throwing.
+ *
+ * @param      block  The memory
+ */
+void operator delete(void *block, const nothrow_t &) noexcept
+{
+    countedFree(block);
+}
+
+/**
+ * @brief      Reports the memory of live games as Chess objects and as
+ *             resident games.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if the games were measured, 1 for invalid usage.
+ */
+int main(int argc, char *argv[])
+{
+    int num_games = 1000000, chess_games = 200, plies = 40;
+    unsigned int seed = 1;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(i + 1 >= argc)
+            return usage();
+        else if(strcmp(argv[i], "--games") == 0)
+            num_games = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--chess-games") == 0)
+            chess_games = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--plies") == 0)
+            plies = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0)
+            seed = strtoul(argv[++i], nullptr, 10);
+        else
+            return usage();
+    }
+
+    if(num_games <= 0 || chess_games <= 0 || plies < 0)
+        return usage();
+
+    // the games as Chess objects (with the saved state of each move, for undo)
+    mt19937 rng(seed);
+    size_t bytes = heap_bytes, blocks = heap_blocks;
+    vector<Chess> played(chess_games);
+    for(auto & chess : played)
+    {
+        chess.setHeadless(true);
+        chess.setFromFEN(START_FEN);
+        for(int ply = 0; ply < plies && !chess.getCheckmate() && !chess.getStalemate(); ply++)
+        {
+            vector<Move> moves = legalMoves(chess);
+            if(moves.empty())
+                break;
+            playMove(chess, moves[rng() % moves.size()]);
+        }
+    }
+
+    report("Chess", chess_games, heap_bytes - bytes, heap_blocks - blocks);
+
+    bytes = heap_bytes;
+    blocks = heap_blocks;
+    ResidentGames resident;
+    for(int game = 0; game < num_games; game++)
+        resident.add(played[game % chess_games]);
+    report("Resident", num_games, heap_bytes - bytes, heap_blocks - blocks);
+    printf("ResidentGame %u bytes, memoryUsage() %.1f bytes/game\n", (unsigned int) sizeof(ResidentGame),
+           (double) resident.memoryUsage() / num_games);
+
+    // a move of a resident game loads it and stores it back
+    Chess chess;
+    chess.setHeadless(true);
+    int timed = min(num_games, 10000);
+    auto start = chrono::steady_clock::now();
+    for(int game = 0; game < timed; game++)
+    {
+        resident.load(game, chess);
+        resident.store(game, chess);
+    }
+    printf("Load + store %.2f us/game\n",
+           chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / timed);
+
+    return 0;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Allocates a counted block.
+     *
+     * @param[in]  size  The number of bytes
+     *
+     * @return     The block, or nullptr if there is no memory.
+     */
+    void * countedAlloc(size_t size)
+    {
+        char *block = (char *) malloc(size + HEADER);
+        if(block == nullptr)
+            return nullptr;
+
+        memcpy(block, &size, sizeof(size));
+        heap_bytes += size;
+        heap_blocks++;
+        return block + HEADER;
+    }
+
+    /**
+     * @brief      Frees a counted block.
+     *
+     * @param      block  The block (can be nullptr)
+     */
+    void countedFree(void *block)
+    {
+        if(block == nullptr)
+            return;
+
+        char *start = (char *) block - HEADER;
+        size_t size;
+        memcpy(&size, start, sizeof(size));
+        heap_bytes -= size;
+        heap_blocks--;
+        free(start);
+    }
+
+    /**
+     * @brief      Prints the memory of some live games.
+     *
+     * @param[in]  name       The name of the representation
+     * @param[in]  num_games  The number of games
+     * @param[in]  bytes      The bytes they take
+     * @param[in]  blocks     The allocations they take
+     */
+    void report(const char *name, size_t num_games, size_t bytes, size_t blocks)
+    {
+        double per_game = (double) bytes / num_games;
+        printf("%-8s %8zu games  %9.1f bytes/game  %6.1f allocations/game  %8.1f MB per 1M games\n", name,
+               num_games, per_game, (double) blocks / num_games, per_game * 1e6 / (1024 * 1024));
+    }
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage: memorybench [--games N] [--chess-games N] [--plies N] [--seed N]\n");
+        return 1;
+    }
+}
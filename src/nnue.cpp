@@ -0,0 +1,700 @@
+/**
+ * \page nnue Neural Network Evaluation Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;nnue.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;nnue.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * The features, accumulators and layers of the NNUE evaluation, their scalar
+ * and AVX2 kernels, and the embedded default network (see nnue.h).
+ */
+
+#include "nnue.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/** The AVX2 kernels are built (on x86) */
+#define NNUE_SIMD
+#endif
+
+// included in 'nnue.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /** The piece code of an empty square (see NnueAccumulator::pieces) */
+    const int8_t NO_PIECE = 12;
+
+    /** The most features of a position of one perspective (every square and
+     *  every reservoir level) */
+    const int MAX_FEATURES = 64 + 2 * 5 * NNUE_RESERVOIR_LEVELS;
+
+    /** The output layer's weights of the default network (every hidden unit
+     *  is then worth 4 centipawns, see Nnue::setEvaluation()) */
+    const int DEFAULT_OUTPUT_WEIGHT = 64, DEFAULT_OUTPUT_DIVISOR = 16, DEFAULT_UNIT = 4;
+
+    /**
+     * @brief      Reads the pieces and the reservoir of a position.
+     *
+     * @param[in]  chess      The chess object
+     * @param      pieces     The piece code of each square
+     * @param      reservoir  The number of reservoir pieces, in the order of
+     *                        Chess::getReservoir()
+     */
+    void readPosition(const Chess &chess, int8_t pieces[64], uint8_t reservoir[10]);
+
+    /**
+     * @brief      Finds the piece code of a square (see
+     *             NnueAccumulator::pieces).
+     *
+     * @param[in]  chess   The chess object
+     * @param[in]  square  The square
+     *
+     * @return     The piece code, NO_PIECE if the square is empty.
+     */
+    int8_t pieceCode(const Chess &chess, int square);
+
+    /**
+     * @brief      Finds the feature of a piece for a perspective.
+     *
+     * @param[in]  perspective  The perspective (0 for black, 1 for white)
+     * @param[in]  code         The piece code (not NO_PIECE)
+     * @param[in]  square       The square of the piece
+     *
+     * @return     The feature, in [0, NNUE_PIECE_INPUTS).
+     */
+    int pieceFeature(int perspective, int code, int square);
+
+    /**
+     * @brief      Finds the feature of a reservoir level for a perspective.
+     *
+     * @param[in]  perspective  The perspective (0 for black, 1 for white)
+     * @param[in]  slot         The slot of the reservoir piece (in the order
+     *                          of Chess::getReservoir())
+     * @param[in]  level        The level (the number of pieces - 1)
+     *
+     * @return     The feature, in [NNUE_PIECE_INPUTS, NNUE_INPUTS).
+     */
+    int reservoirFeature(int perspective, int slot, int level);
+
+    /**
+     * @brief      Adds and subtracts the weights of features from the hidden
+     *             neurons of a perspective (scalar kernel).
+     *
+     * @param[in]  from         The neurons before the change
+     * @param      to           The neurons after the change (can be 'from')
+     * @param[in]  weights      The feature weights of the network
+     * @param[in]  added        The features added
+     * @param[in]  num_added    The number of features added
+     * @param[in]  removed      The features removed
+     * @param[in]  num_removed  The number of features removed
+     */
+    void changeScalar(const int16_t *from, int16_t *to, const int16_t *weights,
+                      const int *added, int num_added, const int *removed, int num_removed);
+
+    /**
+     * @brief      Computes the output layer's sum (without its bias) of the
+     *             hidden neurons of both perspectives (scalar kernel).
+     *
+     * @param[in]  us       The neurons of the side to move
+     * @param[in]  them     The neurons of the other side
+     * @param[in]  weights  The output weights of the network
+     *
+     * @return     The sum.
+     */
+    int32_t outputScalar(const int16_t *us, const int16_t *them, const int8_t *weights);
+
+#ifdef NNUE_SIMD
+    /**
+     * @brief      The AVX2 kernel of changeScalar() (16 neurons per register).
+     */
+    void changeAVX2(const int16_t *from, int16_t *to, const int16_t *weights,
+                    const int *added, int num_added, const int *removed, int num_removed);
+
+    /**
+     * @brief      The AVX2 kernel of outputScalar() (32 neurons per register).
+     */
+    int32_t outputAVX2(const int16_t *us, const int16_t *them, const int8_t *weights);
+#endif
+} // unnamed namespace (makes these functions local to this implementation file)
+
+/*************************************************************************************/
+/*                              NNUE - MEMBER FUNCTIONS                              */
+/*************************************************************************************/
+/**
+ * @brief      Default constructor - Constructs a new instance with the embedded
+ *             default network.
+ */
+Nnue::Nnue()
+    : feature_weights(NNUE_INPUTS * NNUE_HIDDEN, 0), feature_biases(NNUE_HIDDEN, 0), output_weights(2 * NNUE_HIDDEN, 0),
+      output_bias{0}, output_divisor{1}, kernel{KERNEL_SCALAR}
+{
+    setKernel(bestKernel());
+    setEvaluation(EngineConfig());
+}
+
+/**
+ * @brief      (Mutator) Sets the network to the hand-crafted evaluation of an
+ *             engine (see Engine::evaluate()), written as a network.
+ *
+ * @param[in]  config  The settings of the evaluation (the material, center
+ *                     bonus and reservoir percentage)
+ *
+ * @note       The values are rounded to 4 centipawns, and a neuron can
+ *             saturate with many pieces of a type (ex. five queens).
+ */
+void Nnue::setEvaluation(const EngineConfig &config)
+{
+    fill(feature_weights.begin(), feature_weights.end(), 0);
+    fill(feature_biases.begin(), feature_biases.end(), 0);
+    fill(output_weights.begin(), output_weights.end(), 0);
+
+    // the evaluation is the value of the side to move's pieces minus the
+    // other side's, so each perspective only adds up the value of its own
+    // pieces (relative color 0), in units of DEFAULT_UNIT centipawns. The
+    // value of a type is spread over enough neurons to hold this many pieces
+    // (and reservoir levels) without reaching NNUE_ACTIVATION_MAX
+    const int expected[5] = {12, 6, 6, 4, 4};
+    int next = 0;
+
+    auto spread = [&](int feature, int value, int neurons, int first)
+    {
+        for(int k = 0; k < neurons; k++)
+            feature_weights[feature * NNUE_HIDDEN + first + k] = (int16_t) (value / neurons + (k < value % neurons));
+    };
+
+    for(int type = PAWN; type <= QUEEN && next < NNUE_HIDDEN; type++)
+    {
+        int values[64], largest = 0;
+        for(int square = 0; square < 64; square++)
+        {
+            int file = square % 8, rank = square / 8;
+            int distance = max(3 - file, file - 4) + max(3 - rank, rank - 4);
+
+            int value = config.material[type];
+            if(type == PAWN || type == KNIGHT || type == BISHOP)
+                value += (6 - distance) * config.center_bonus;
+
+            values[square] = max(0, (value + DEFAULT_UNIT / 2) / DEFAULT_UNIT);
+            largest = max(largest, values[square]);
+        }
+
+        int neurons = min((expected[type] * largest + NNUE_ACTIVATION_MAX - 1) / NNUE_ACTIVATION_MAX, NNUE_HIDDEN - next);
+        for(int square = 0; square < 64; square++)
+            spread(pieceFeature(1, type, square), values[square], max(neurons, 1), next);
+        next += neurons;
+    }
+
+    for(int type = PAWN; type <= QUEEN && next < NNUE_HIDDEN; type++)
+    {
+        int value = max(0, (config.material[type] * config.reservoir_percent / 100 + DEFAULT_UNIT / 2) / DEFAULT_UNIT);
+        int neurons = min((NNUE_RESERVOIR_LEVELS * value + NNUE_ACTIVATION_MAX - 1) / NNUE_ACTIVATION_MAX, NNUE_HIDDEN - next);
+
+        for(int level = 0; level < NNUE_RESERVOIR_LEVELS; level++)
+            spread(reservoirFeature(1, 5 + type, level), value, max(neurons, 1), next);
+        next += neurons;
+    }
+
+    // white's view of its own pieces is black's view of its own (flipped)
+    // pieces, since the features are relative to the perspective
+    for(int i = 0; i < min(next, NNUE_HIDDEN); i++)
+    {
+        output_weights[i] = DEFAULT_OUTPUT_WEIGHT;
+        output_weights[NNUE_HIDDEN + i] = -DEFAULT_OUTPUT_WEIGHT;
+    }
+
+    output_bias = 0;
+    output_divisor = DEFAULT_OUTPUT_DIVISOR;
+}
+
+/**
+ * @brief      Loads a network file.
+ *
+ * @param[in]  filename  The network file
+ *
+ * @return     True if the network was loaded, False if the file is not a
+ *             network of this shape (the network is not changed).
+ */
+bool Nnue::load(const string &filename)
+{
+    MappedFile file;
+    size_t weights_size = feature_weights.size() * sizeof(int16_t), biases_size = feature_biases.size() * sizeof(int16_t);
+
+    if(!file.open(filename) || file.getSize() != sizeof(NnueHeader) + weights_size + biases_size + output_weights.size())
+        return false;
+
+    const NnueHeader *header = (const NnueHeader *) file.getData();
+    if( memcmp(header->magic, NNUE_MAGIC, sizeof(header->magic)) != 0 || header->inputs != NNUE_INPUTS ||
+        header->hidden != NNUE_HIDDEN || header->output_divisor <= 0 )
+    {
+        return false;
+    }
+
+    const char *data = file.getData() + sizeof(NnueHeader);
+    memcpy(feature_weights.data(), data, weights_size);
+    memcpy(feature_biases.data(), data + weights_size, biases_size);
+    memcpy(output_weights.data(), data + weights_size + biases_size, output_weights.size());
+    output_bias = header->output_bias;
+    output_divisor = header->output_divisor;
+
+    return true;
+}
+
+/**
+ * @brief      Writes the network to a file.
+ *
+ * @param[in]  filename  The network file
+ *
+ * @return     True if the file was written, False otherwise.
+ */
+bool Nnue::save(const string &filename) const
+{
+    NnueHeader header;
+    memcpy(header.magic, NNUE_MAGIC, sizeof(header.magic));
+    header.inputs = NNUE_INPUTS;
+    header.hidden = NNUE_HIDDEN;
+    header.output_bias = output_bias;
+    header.output_divisor = output_divisor;
+
+    ofstream out(filename, ios::binary | ios::trunc);
+    out.write((const char *) &header, sizeof(header));
+    out.write((const char *) feature_weights.data(), feature_weights.size() * sizeof(int16_t));
+    out.write((const char *) feature_biases.data(), feature_biases.size() * sizeof(int16_t));
+    out.write((const char *) output_weights.data(), output_weights.size());
+
+    return (bool) out;
+}
+
+/**
+ * @brief      (Mutator) Sets the version of the kernels used by the layers (an
+ *             unsupported version uses the scalar one).
+ *
+ * @param[in]  kernel  The version (KERNEL_SSE42 uses the scalar kernels)
+ */
+void Nnue::setKernel(batchKernel kernel)
+{
+    this->kernel = kernel == KERNEL_AVX2 && kernelSupported(KERNEL_AVX2) ? KERNEL_AVX2 : KERNEL_SCALAR;
+}
+
+/**
+ * @brief      Computes the accumulator of a position from all of its features.
+ *
+ * @param[in]  chess  The chess object
+ * @param      acc    The accumulator
+ */
+void Nnue::refresh(const Chess &chess, NnueAccumulator &acc) const
+{
+    readPosition(chess, acc.pieces, acc.reservoir);
+
+    for(int perspective = 0; perspective < 2; perspective++)
+    {
+        int features[MAX_FEATURES], count = 0;
+
+        for(int square = 0; square < 64; square++)
+            if(acc.pieces[square] != NO_PIECE)
+                features[count++] = pieceFeature(perspective, acc.pieces[square], square);
+
+        for(int slot = 0; slot < 10; slot++)
+            for(int level = 0; level < min((int) acc.reservoir[slot], NNUE_RESERVOIR_LEVELS); level++)
+                features[count++] = reservoirFeature(perspective, slot, level);
+
+#ifdef NNUE_SIMD
+        if(kernel == KERNEL_AVX2)
+        {
+            changeAVX2(feature_biases.data(), acc.values[perspective], feature_weights.data(), features, count, nullptr, 0);
+            continue;
+        }
+#endif
+        changeScalar(feature_biases.data(), acc.values[perspective], feature_weights.data(), features, count, nullptr, 0);
+    }
+}
+
+/**
+ * @brief      Computes the accumulator of a position from the one of another
+ *             position (usually its parent), with only the features that
+ *             differ.
+ *
+ * @param[in]  chess   The chess object
+ * @param[in]  parent  The accumulator of the other position
+ * @param      acc     The accumulator of the position (can be 'parent')
+ */
+void Nnue::update(const Chess &chess, const NnueAccumulator &parent, NnueAccumulator &acc) const
+{
+    int squares[64];
+    for(int square = 0; square < 64; square++)
+        squares[square] = square;
+
+    updateSquares(chess, parent, acc, squares, 64);
+}
+
+/**
+ * @brief      Computes the accumulator of a position from the one of its
+ *             parent, reading only the squares changed by the move that was
+ *             played.
+ *
+ * @param[in]  chess   The chess object (after the move)
+ * @param[in]  parent  The accumulator of the parent position
+ * @param      acc     The accumulator of the position (can be 'parent')
+ * @param[in]  move    The move played from the parent position
+ */
+void Nnue::update(const Chess &chess, const NnueAccumulator &parent, NnueAccumulator &acc, const Move &move) const
+{
+    int squares[6] = {move.dest}, num_squares = 1;
+
+    // a reservoir move only replaces the piece on its destination
+    if(move.src >= 0 && move.src < 64)
+    {
+        squares[num_squares++] = move.src;
+
+        int code = parent.pieces[move.src] % 6, from_file = move.src % 8, to_file = move.dest % 8;
+        if(code == KING && abs(to_file - from_file) > 1)
+        {
+            // a castling is the king's move onto its rook, and both end up on
+            // the c and d or f and g files
+            int rank = move.src / 8 * 8;
+            for(int file : {2, 3, 5, 6})
+                squares[num_squares++] = rank + file;
+        }
+        else if(code == PAWN && from_file != to_file && parent.pieces[move.dest] == NO_PIECE)
+            squares[num_squares++] = move.src / 8 * 8 + to_file; // the pawn taken en-passant
+    }
+
+    updateSquares(chess, parent, acc, squares, num_squares);
+}
+
+/**
+ * @brief      Computes the accumulator of a position from the one of another
+ *             position, with the features of some squares and of the
+ *             reservoir (the other squares are the same in both positions).
+ *
+ * @param[in]  chess        The chess object
+ * @param[in]  parent       The accumulator of the other position
+ * @param      acc          The accumulator of the position (can be 'parent')
+ * @param[in]  squares      The squares that can differ
+ * @param[in]  num_squares  The number of squares
+ */
+void Nnue::updateSquares(const Chess &chess, const NnueAccumulator &parent, NnueAccumulator &acc,
+                         const int *squares, int num_squares) const
+{
+    int8_t pieces[64];
+    uint8_t reservoir[10];
+
+    // the squares and reservoir slots that changed (a move changes a few)
+    int added[2][NNUE_MAX_CHANGES], removed[2][NNUE_MAX_CHANGES], num_added = 0, num_removed = 0;
+    bool too_many = false;
+
+    for(int i = 0; i < num_squares && !too_many; i++)
+    {
+        int square = squares[i];
+        pieces[square] = pieceCode(chess, square);
+        if(pieces[square] == parent.pieces[square])
+            continue;
+
+        if(parent.pieces[square] != NO_PIECE)
+        {
+            too_many = too_many || num_removed == NNUE_MAX_CHANGES;
+            for(int perspective = 0; perspective < 2 && !too_many; perspective++)
+                removed[perspective][num_removed] = pieceFeature(perspective, parent.pieces[square], square);
+            num_removed++;
+        }
+
+        if(pieces[square] != NO_PIECE)
+        {
+            too_many = too_many || num_added == NNUE_MAX_CHANGES;
+            for(int perspective = 0; perspective < 2 && !too_many; perspective++)
+                added[perspective][num_added] = pieceFeature(perspective, pieces[square], square);
+            num_added++;
+        }
+    }
+
+    for(int slot = 0; slot < 10 && !too_many; slot++)
+    {
+        reservoir[slot] = (uint8_t) max(0, chess.getReservoirCount(slot));
+        int before = min((int) parent.reservoir[slot], NNUE_RESERVOIR_LEVELS), after = min((int) reservoir[slot], NNUE_RESERVOIR_LEVELS);
+
+        for(int level = min(before, after); level < max(before, after) && !too_many; level++)
+        {
+            int &count = after > before ? num_added : num_removed;
+            too_many = count == NNUE_MAX_CHANGES;
+            for(int perspective = 0; perspective < 2 && !too_many; perspective++)
+                (after > before ? added : removed)[perspective][count] = reservoirFeature(perspective, slot, level);
+            count++;
+        }
+    }
+
+    // a position far from the other one is computed from scratch
+    if(too_many)
+    {
+        refresh(chess, acc);
+        return;
+    }
+
+    for(int perspective = 0; perspective < 2; perspective++)
+    {
+#ifdef NNUE_SIMD
+        if(kernel == KERNEL_AVX2)
+        {
+            changeAVX2(parent.values[perspective], acc.values[perspective], feature_weights.data(),
+                       added[perspective], num_added, removed[perspective], num_removed);
+            continue;
+        }
+#endif
+        changeScalar(parent.values[perspective], acc.values[perspective], feature_weights.data(),
+                     added[perspective], num_added, removed[perspective], num_removed);
+    }
+
+    if(&acc != &parent)
+        memcpy(acc.pieces, parent.pieces, sizeof(acc.pieces));
+    for(int i = 0; i < num_squares; i++)
+        acc.pieces[squares[i]] = pieces[squares[i]];
+    memcpy(acc.reservoir, reservoir, sizeof(reservoir));
+}
+
+/**
+ * @brief      Evaluates a position from its accumulator.
+ *
+ * @param[in]  acc   The accumulator
+ * @param[in]  turn  The side to move
+ *
+ * @return     The score of the position (in centipawns) for the side to move.
+ */
+int Nnue::evaluate(const NnueAccumulator &acc, pieceColor turn) const
+{
+    const int16_t *us = acc.values[turn == WHITE], *them = acc.values[turn != WHITE];
+
+#ifdef NNUE_SIMD
+    if(kernel == KERNEL_AVX2)
+        return (outputAVX2(us, them, output_weights.data()) + output_bias) / output_divisor;
+#endif
+
+    return (outputScalar(us, them, output_weights.data()) + output_bias) / output_divisor;
+}
+
+/**
+ * @brief      Evaluates a position (its accumulator is computed from all of
+ *             its features).
+ *
+ * @param[in]  chess  The chess object
+ *
+ * @return     The score of the position (in centipawns) for the side to move.
+ */
+int Nnue::evaluate(const Chess &chess) const
+{
+    NnueAccumulator acc;
+    refresh(chess, acc);
+
+    return evaluate(acc, chess.getTurn());
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Reads the pieces and the reservoir of a position.
+     *
+     * @param[in]  chess      The chess object
+     * @param      pieces     The piece code of each square
+     * @param      reservoir  The number of reservoir pieces, in the order of
+     *                        Chess::getReservoir()
+     */
+    void readPosition(const Chess &chess, int8_t pieces[64], uint8_t reservoir[10])
+    {
+        for(int square = 0; square < 64; square++)
+            pieces[square] = pieceCode(chess, square);
+
+        for(int slot = 0; slot < 10; slot++)
+            reservoir[slot] = (uint8_t) max(0, chess.getReservoirCount(slot));
+    }
+
+    /**
+     * @brief      Finds the piece code of a square (see
+     *             NnueAccumulator::pieces).
+     *
+     * @param[in]  chess   The chess object
+     * @param[in]  square  The square
+     *
+     * @return     The piece code, NO_PIECE if the square is empty.
+     */
+    int8_t pieceCode(const Chess &chess, int square)
+    {
+        const Piece *piece = chess.getPiece(square);
+        pieceType type = piece->getPieceType();
+        return type == EMPTY ? NO_PIECE : (int8_t) (type + (piece->getPieceColor() == BLACK ? 6 : 0));
+    }
+
+    /**
+     * @brief      Finds the feature of a piece for a perspective.
+     *
+     * @param[in]  perspective  The perspective (0 for black, 1 for white)
+     * @param[in]  code         The piece code (not NO_PIECE)
+     * @param[in]  square       The square of the piece
+     *
+     * @return     The feature, in [0, NNUE_PIECE_INPUTS).
+     */
+    int pieceFeature(int perspective, int code, int square)
+    {
+        // square 0 is a8, so white's 1st rank is already at the bottom
+        int relative = (code >= 6) == (perspective == 1);
+        return (relative * 6 + code % 6) * 64 + (perspective == 1 ? square : square ^ 56);
+    }
+
+    /**
+     * @brief      Finds the feature of a reservoir level for a perspective.
+     *
+     * @param[in]  perspective  The perspective (0 for black, 1 for white)
+     * @param[in]  slot         The slot of the reservoir piece (in the order of
+     *                          Chess::getReservoir())
+     * @param[in]  level        The level (the number of pieces - 1)
+     *
+     * @return     The feature, in [NNUE_PIECE_INPUTS, NNUE_INPUTS).
+     */
+    int reservoirFeature(int perspective, int slot, int level)
+    {
+        // slots 0 to 4 are black's p, n, b, r, q and 5 to 9 white's
+        int relative = (slot < 5) == (perspective == 1);
+        return NNUE_PIECE_INPUTS + (relative * 5 + slot % 5) * NNUE_RESERVOIR_LEVELS + level;
+    }
+
+    /**
+     * @brief      Adds and subtracts the weights of features from the hidden
+     *             neurons of a perspective (scalar kernel).
+     *
+     * @param[in]  from         The neurons before the change
+     * @param      to           The neurons after the change (can be 'from')
+     * @param[in]  weights      The feature weights of the network
+     * @param[in]  added        The features added
+     * @param[in]  num_added    The number of features added
+     * @param[in]  removed      The features removed
+     * @param[in]  num_removed  The number of features removed
+     */
+    void changeScalar(const int16_t *from, int16_t *to, const int16_t *weights,
+                      const int *added, int num_added, const int *removed, int num_removed)
+    {
+        // the sums wrap around like the 16 bit lanes of the AVX2 kernel
+        int16_t values[NNUE_HIDDEN];
+        memcpy(values, from, sizeof(values));
+
+        for(int i = 0; i < num_added; i++)
+            for(int j = 0; j < NNUE_HIDDEN; j++)
+                values[j] = (int16_t) (values[j] + weights[added[i] * NNUE_HIDDEN + j]);
+
+        for(int i = 0; i < num_removed; i++)
+            for(int j = 0; j < NNUE_HIDDEN; j++)
+                values[j] = (int16_t) (values[j] - weights[removed[i] * NNUE_HIDDEN + j]);
+
+        memcpy(to, values, sizeof(values));
+    }
+
+    /**
+     * @brief      Computes the output layer's sum (without its bias) of the
+     *             hidden neurons of both perspectives (scalar kernel).
+     *
+     * @param[in]  us       The neurons of the side to move
+     * @param[in]  them     The neurons of the other side
+     * @param[in]  weights  The output weights of the network
+     *
+     * @return     The sum.
+     */
+    int32_t outputScalar(const int16_t *us, const int16_t *them, const int8_t *weights)
+    {
+        int32_t sum = 0;
+        for(int j = 0; j < NNUE_HIDDEN; j++)
+        {
+            sum += min(max((int) us[j], 0), NNUE_ACTIVATION_MAX) * weights[j];
+            sum += min(max((int) them[j], 0), NNUE_ACTIVATION_MAX) * weights[NNUE_HIDDEN + j];
+        }
+
+        return sum;
+    }
+
+#ifdef NNUE_SIMD
+    /**
+     * @brief      The AVX2 kernel of changeScalar() (16 neurons per register).
+     */
+    __attribute__((target("avx2")))
+    void changeAVX2(const int16_t *from, int16_t *to, const int16_t *weights,
+                    const int *added, int num_added, const int *removed, int num_removed)
+    {
+        // 64 neurons at a time, so every weight row is read once per change
+        for(int j = 0; j < NNUE_HIDDEN; j += 64)
+        {
+            __m256i sums[4];
+            for(int k = 0; k < 4; k++)
+                sums[k] = _mm256_loadu_si256((const __m256i *) (from + j + 16*k));
+
+            for(int i = 0; i < num_added; i++)
+            {
+                const int16_t *row = weights + added[i] * NNUE_HIDDEN + j;
+                for(int k = 0; k < 4; k++)
+                    sums[k] = _mm256_add_epi16(sums[k], _mm256_loadu_si256((const __m256i *) (row + 16*k)));
+            }
+
+            for(int i = 0; i < num_removed; i++)
+            {
+                const int16_t *row = weights + removed[i] * NNUE_HIDDEN + j;
+                for(int k = 0; k < 4; k++)
+                    sums[k] = _mm256_sub_epi16(sums[k], _mm256_loadu_si256((const __m256i *) (row + 16*k)));
+            }
+
+            for(int k = 0; k < 4; k++)
+                _mm256_storeu_si256((__m256i *) (to + j + 16*k), sums[k]);
+        }
+    }
+
+    /**
+     * @brief      The AVX2 kernel of outputScalar() (32 neurons per register).
+     */
+    __attribute__((target("avx2")))
+    int32_t outputAVX2(const int16_t *us, const int16_t *them, const int8_t *weights)
+    {
+        const __m256i zero = _mm256_setzero_si256(), top = _mm256_set1_epi16(NNUE_ACTIVATION_MAX), ones = _mm256_set1_epi16(1);
+        const int16_t *halves[2] = {us, them};
+        __m256i sum = zero;
+
+        for(int half = 0; half < 2; half++)
+        {
+            for(int j = 0; j < NNUE_HIDDEN; j += 32)
+            {
+                __m256i low = _mm256_loadu_si256((const __m256i *) (halves[half] + j));
+                __m256i high = _mm256_loadu_si256((const __m256i *) (halves[half] + j + 16));
+                low = _mm256_min_epi16(_mm256_max_epi16(low, zero), top);
+                high = _mm256_min_epi16(_mm256_max_epi16(high, zero), top);
+
+                // packing works within each 128 bit half, so the 64 bit
+                // blocks are put back in order
+                __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+                __m256i w = _mm256_loadu_si256((const __m256i *) (weights + half * NNUE_HIDDEN + j));
+
+                // u8 x i8 products summed in pairs (at most 2 * 127 * 127, no
+                // saturation), then in fours as 32 bit sums
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, w), ones));
+            }
+        }
+
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4E));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xB1));
+        return _mm_cvtsi128_si32(total);
+    }
+#endif
+}
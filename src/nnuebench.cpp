@@ -0,0 +1,291 @@
+/**
+ * \page nnuebench Neural Network Evaluation Benchmark Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;nnuebench.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;nnue.h, engine.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Compares the evaluations per second of the hand-crafted evaluation and of
+ * the NNUE evaluation (computed from scratch, updated from the position before
+ * it with or without the move played, and from an accumulator alone) with each version of the kernels, on the
+ * positions of random games. The positions are then searched with each
+ * evaluation, and the nodes per second are reported.
+ *
+ * Simply run <b>mingw32-make all_nnuebench</b> and then <b>nnuebench
+ * [options]</b>, where the options are:
+ * - <b>--games N</b>: the number of random games (20);
+ * - <b>--plies N</b>: the number of plies of each game (50);
+ * - <b>--rounds N</b>: the number of times each position is evaluated (100);
+ * - <b>--depth N</b>: the depth of the searches (3);
+ * - <b>--network FILE</b>: evaluates with a network file instead of the
+ *   embedded one;
+ * - <b>--save FILE</b>: writes the network to a file.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+
+#include "archive.h"
+#include "nnue.h"
+
+// included in 'nnue.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Times a number of evaluations.
+     *
+     * @param[in]  evals     The number of evaluations
+     * @param[in]  evaluate  Makes every evaluation and returns a checksum
+     *
+     * @return     The evaluations per second.
+     */
+    double evalsPerSecond(uint64_t evals, const function<int64_t()> &evaluate);
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+}
+
+/**
+ * @brief      Times the hand-crafted and NNUE evaluations.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if the evaluations were timed, 1 for invalid usage, 2 if the
+ *             network could not be loaded or saved.
+ */
+int main(int argc, char *argv[])
+{
+    int num_games = 20, plies = 50, rounds = 100, depth = 3;
+    string network_file, save_file;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(i + 1 >= argc)
+            return usage();
+        else if(strcmp(argv[i], "--games") == 0)
+            num_games = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--plies") == 0)
+            plies = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--rounds") == 0)
+            rounds = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--depth") == 0)
+            depth = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--network") == 0)
+            network_file = argv[++i];
+        else if(strcmp(argv[i], "--save") == 0)
+            save_file = argv[++i];
+        else
+            return usage();
+    }
+
+    if(num_games <= 0 || plies <= 0 || rounds <= 0 || depth <= 0)
+        return usage();
+
+    Nnue network;
+    if(!network_file.empty() && !network.load(network_file))
+    {
+        printf("'%s' is not a network file\n", network_file.c_str());
+        return 2;
+    }
+
+    if(!save_file.empty() && !network.save(save_file))
+    {
+        printf("Could not write the network to '%s'\n", save_file.c_str());
+        return 2;
+    }
+
+    // -------- the positions of random games (each one after the other) -------- //
+    vector<vector<unique_ptr<Chess>>> games(num_games);
+    vector<vector<Move>> played(num_games);
+    mt19937 rng(7);
+    size_t num_positions = 0;
+
+    for(int g = 0; g < num_games; g++)
+    {
+        auto &game = games[g];
+        game.emplace_back(new Chess);
+        game.back()->setHeadless(true);
+        game.back()->setFromFEN(START_FEN);
+
+        for(int ply = 0; ply < plies; ply++)
+        {
+            vector<Move> moves = legalMoves(*game.back());
+            if(moves.empty())
+                break;
+
+            unique_ptr<Chess> next(new Chess(*game.back()));
+            next->setHeadless(true);
+            Move chosen = moves[rng() % moves.size()];
+            if(playMove(*next, chosen))
+            {
+                game.push_back(move(next));
+                played[g].push_back(chosen);
+            }
+        }
+
+        num_positions += game.size();
+    }
+
+    uint64_t evals = (uint64_t) num_positions * rounds;
+    printf("Positions %zu  rounds %d  (%llu evaluations per test)\n", num_positions, rounds, (unsigned long long) evals);
+
+    Engine engine;
+    double hand = evalsPerSecond(evals, [&]()
+    {
+        int64_t checksum = 0;
+        for(int round = 0; round < rounds; round++)
+            for(const auto & game : games)
+                for(const auto & position : game)
+                    checksum += engine.evaluate(*position);
+        return checksum;
+    });
+    printf("%-26s %12.0f evals/s\n", "hand-crafted", hand);
+
+    // the default network is the hand-crafted evaluation (up to rounding)
+    int largest = 0;
+    for(const auto & game : games)
+        for(const auto & position : game)
+            largest = max(largest, abs(network.evaluate(*position) - engine.evaluate(*position)));
+    printf("%-26s %12d cp\n", "largest difference", largest);
+
+    vector<NnueAccumulator> accumulators(plies + 1);
+    for(batchKernel kernel : {KERNEL_SCALAR, KERNEL_AVX2})
+    {
+        if(!kernelSupported(kernel))
+            continue;
+        network.setKernel(kernel);
+
+        double full = evalsPerSecond(evals, [&]()
+        {
+            int64_t checksum = 0;
+            for(int round = 0; round < rounds; round++)
+                for(const auto & game : games)
+                    for(const auto & position : game)
+                        checksum += network.evaluate(*position);
+            return checksum;
+        });
+
+        // each position's accumulator is updated from the one before it, by
+        // comparing every square or only the squares of the move played (as
+        // the search does)
+        double incremental[2];
+        for(int with_move = 0; with_move < 2; with_move++)
+        {
+            incremental[with_move] = evalsPerSecond(evals, [&]()
+            {
+                int64_t checksum = 0;
+                for(int round = 0; round < rounds; round++)
+                {
+                    for(int g = 0; g < num_games; g++)
+                    {
+                        const auto &game = games[g];
+                        network.refresh(*game[0], accumulators[0]);
+                        checksum += network.evaluate(accumulators[0], game[0]->getTurn());
+                        for(size_t ply = 1; ply < game.size(); ply++)
+                        {
+                            if(with_move)
+                                network.update(*game[ply], accumulators[ply - 1], accumulators[ply], played[g][ply - 1]);
+                            else
+                                network.update(*game[ply], accumulators[ply - 1], accumulators[ply]);
+                            checksum += network.evaluate(accumulators[ply], game[ply]->getTurn());
+                        }
+                    }
+                }
+                return checksum;
+            });
+        }
+
+        double output = evalsPerSecond(evals, [&]()
+        {
+            int64_t checksum = 0;
+            for(int round = 0; round < rounds; round++)
+                for(size_t ply = 0; ply < num_positions; ply++)
+                    checksum += network.evaluate(accumulators[ply % (plies + 1)], ply % 2 ? BLACK : WHITE);
+            return checksum;
+        });
+
+        printf("nnue %-7s %-16s %12.0f evals/s (%.2fx)\n", kernelName(kernel), "full", full, full / hand);
+        printf("nnue %-7s %-16s %12.0f evals/s (%.2fx)\n", kernelName(kernel), "incremental", incremental[0], incremental[0] / hand);
+        printf("nnue %-7s %-16s %12.0f evals/s (%.2fx)\n", kernelName(kernel), "incremental+move", incremental[1], incremental[1] / hand);
+        printf("nnue %-7s %-16s %12.0f evals/s (%.2fx)\n", kernelName(kernel), "output layer", output, output / hand);
+    }
+
+    // -------- searches with each evaluation -------- //
+    network.setKernel(bestKernel());
+    for(int with_network = 0; with_network < 2; with_network++)
+    {
+        EngineConfig config;
+        config.depth = depth;
+        Engine searcher(config);
+        searcher.setNetwork(with_network ? &network : nullptr);
+
+        int score;
+        auto start = chrono::steady_clock::now();
+        for(const auto & game : games)
+            searcher.search(*game[game.size() / 2], score);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        printf("search depth %d %-12s %10llu nodes  %.2f s  %.0f nodes/s\n", depth, with_network ? "nnue" : "hand-crafted",
+               (unsigned long long) searcher.getNodes(), seconds, seconds > 0 ? searcher.getNodes() / seconds : 0.0);
+    }
+
+    return 0;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Times a number of evaluations.
+     *
+     * @param[in]  evals     The number of evaluations
+     * @param[in]  evaluate  Makes every evaluation and returns a checksum
+     *
+     * @return     The evaluations per second.
+     */
+    double evalsPerSecond(uint64_t evals, const function<int64_t()> &evaluate)
+    {
+        auto start = chrono::steady_clock::now();
+        volatile int64_t checksum = evaluate();
+        (void) checksum;
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        return seconds > 0 ? evals / seconds : 0;
+    }
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage: nnuebench [--games N] [--plies N] [--rounds N] [--depth N] [--network FILE] [--save FILE]\n");
+        return 1;
+    }
+}
@@ -0,0 +1,204 @@
+/**
+ * \page prunebench Search Pruning Benchmark Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;prunebench.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;engine.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Measures the pruning of the alpha-beta search (see EngineConfig): searches a
+ * set of tactical positions to a fixed depth without any pruning, with each
+ * kind of pruning alone, and with all of them, and reports the time and nodes
+ * to reach the depth and the number of positions whose best move was found.
+ *
+ * Simply run <b>mingw32-make all_prunebench</b> and then <b>prunebench
+ * [options]</b>, where the options are:
+ * - <b>--depth N</b>: the depth of every search (5);
+ * - <b>--fen FEN MOVE</b>: searches this position instead, where MOVE is the
+ *   expected best move as "src-dest" (in the values of Chess::makeMove()),
+ *   and can be repeated.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "engine.h"
+
+// included in 'engine.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      This struct describes a tactical position.
+     */
+    struct Puzzle
+    {
+        /** The position */
+        string fen;
+
+        /** The best move */
+        Move best;
+    };
+
+    /**
+     * @brief      Turns off every kind of pruning.
+     *
+     * @param      config  The settings
+     */
+    void disablePruning(EngineConfig &config);
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+}
+
+/**
+ * @brief      Searches the tactical positions with each kind of pruning.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if the positions were searched, 1 for invalid usage or
+ *             position.
+ */
+int main(int argc, char *argv[])
+{
+    int depth = 5;
+    vector<Puzzle> puzzles;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(i + 1 >= argc)
+            return usage();
+        else if(strcmp(argv[i], "--depth") == 0)
+            depth = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--fen") == 0 && i + 2 < argc)
+        {
+            Puzzle puzzle;
+            puzzle.fen = argv[++i];
+            puzzle.best.promotion = '\0';
+            if(sscanf(argv[++i], "%d-%d", &puzzle.best.src, &puzzle.best.dest) != 2)
+                return usage();
+            puzzles.push_back(puzzle);
+        }
+        else
+            return usage();
+    }
+
+    if(depth <= 0)
+        return usage();
+
+    // checkmates, forks and promotions, with and without the reservoir
+    if(puzzles.empty())
+    {
+        puzzles = {
+            {"r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR[QRBBNNPPPPqrbbnnpppp] w KQkq - 4 4", {45, 13, '\0'}},
+            {"6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", {56, 0, '\0'}},
+            {"4N2k/6pp/8/8/8/8/8/6K1[Q] w - - 0 1", {'q', 4, '\0'}},
+            {"r3k3/8/8/1N6/8/8/8/6K1 w - - 0 1", {25, 10, '\0'}},
+            {"8/4P3/8/8/8/8/k7/4K3 w - - 0 1", {12, 4, 'q'}},
+            {"4k3/8/8/3q4/8/8/3R4/3K4[Pp] w - - 0 1", {51, 27, '\0'}},
+        };
+    }
+
+    struct Variant
+    {
+        const char *name;
+        void (*enable)(EngineConfig &config);
+    };
+
+    const Variant variants[] = {
+        {"none",             [](EngineConfig &config) {}},
+        {"null move",        [](EngineConfig &config) {config.null_move = true;}},
+        {"late moves",       [](EngineConfig &config) {config.late_move_reductions = true;}},
+        {"futility",         [](EngineConfig &config) {config.futility = true;}},
+        {"reverse futility", [](EngineConfig &config) {config.reverse_futility = true;}},
+        {"razoring",         [](EngineConfig &config) {config.razoring = true;}},
+        {"all",              [](EngineConfig &config) {config = EngineConfig();}},
+    };
+
+    printf("Positions %d  depth %d\n", (int) puzzles.size(), depth);
+    for(const auto & variant : variants)
+    {
+        EngineConfig config;
+        disablePruning(config);
+        variant.enable(config);
+
+        int solved = 0;
+        uint64_t nodes = 0;
+        double seconds = 0;
+        for(const auto & puzzle : puzzles)
+        {
+            Chess chess;
+            chess.setHeadless(true);
+            if(!chess.setFromFEN(puzzle.fen.c_str()))
+            {
+                printf("Invalid position: %s\n", puzzle.fen.c_str());
+                return 1;
+            }
+
+            Engine engine(config);
+            atomic<bool> stop(false);
+            auto start = chrono::steady_clock::now();
+            Move best = engine.analyze(chess, depth, stop);
+            seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            nodes += engine.getNodes();
+
+            solved += best.src == puzzle.best.src && best.dest == puzzle.best.dest &&
+                      (puzzle.best.promotion == '\0' || best.promotion == puzzle.best.promotion);
+        }
+
+        printf("%-16s time %8.3f s  nodes %10llu  solved %d/%d\n", variant.name, seconds,
+               (unsigned long long) nodes, solved, (int) puzzles.size());
+    }
+
+    return 0;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Turns off every kind of pruning.
+     *
+     * @param      config  The settings
+     */
+    void disablePruning(EngineConfig &config)
+    {
+        config.null_move = false;
+        config.late_move_reductions = false;
+        config.futility = false;
+        config.reverse_futility = false;
+        config.razoring = false;
+    }
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage: prunebench [--depth N] [--fen FEN src-dest]...\n");
+        return 1;
+    }
+}
@@ -0,0 +1,291 @@
+/**
+ * \page replay Batch Replay Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;replay.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;archive.h, chess.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Re-validates recorded games after the rules engine changes. Every game is
+ * replayed through a headless Chess object (nothing is printed and no
+ * object_states files are written) on a pool of threads, each with its own
+ * object, and the final positions are compared with the expected ones.
+ *
+ * Simply run <b>mingw32-make all_replay</b> on a Windows machine and then
+ * <b>replay [--threads N] path...</b>, where each path is either:
+ * - a game archive (see archive.h). A game diverges if one of its moves is
+ *   illegal, or if its final FEN field differs from the replayed position;
+ * - a test case script or a directory of them (e.g. <i>tests/</i>). A script
+ *   diverges if the FEN on its first line differs from the replayed position.
+ *
+ * The divergences are listed, followed by the number of games replayed per
+ * second and the utilization (busy time over wall time) of each thread. The
+ * exit code is 1 if any game diverged.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+
+#include "archive.h"
+#include "mapped_file.h"
+
+// included in 'chess.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      This struct describes a game to replay, which is either a
+     *             line of an archive or a test case script.
+     */
+    struct Job
+    {
+        /** Where the game comes from (file name and line number) */
+        string source;
+
+        /** The archive line or the script */
+        string text;
+
+        /** True for test case scripts, False for archive lines */
+        bool script;
+
+        /** The reason the game diverged (empty if it did not) */
+        string divergence;
+    };
+
+    /**
+     * @brief      Adds the games of a path (archive, script or directory of
+     *             scripts) to the jobs.
+     *
+     * @param[in]  path  The path
+     * @param      jobs  The jobs
+     *
+     * @return     True if the path could be read, False otherwise.
+     */
+    bool addJobs(const string &path, vector<Job> &jobs);
+
+    /**
+     * @brief      Replays a single game and records whether it diverged.
+     *
+     * @param      chess  The (headless) chess object of the thread
+     * @param      job    The game
+     */
+    void runJob(Chess &chess, Job &job);
+
+    /**
+     * @brief      Decides whether a file is a test case script rather than an
+     *             archive (archive lines contain the '|' separator).
+     *
+     * @param[in]  text  The contents of the file
+     *
+     * @return     True if the file is a test case script, False otherwise.
+     */
+    bool isScript(const string &text);
+}
+
+/**
+ * @brief      Replays the games of the given paths on a pool of threads and
+ *             prints the divergences and throughput.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if no game diverged, 1 otherwise (or on invalid usage)
+ */
+int main(int argc, char *argv[])
+{
+    int num_threads = max(1u, thread::hardware_concurrency());
+    vector<Job> jobs;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            num_threads = max(1, atoi(argv[++i]));
+        else if(!addJobs(argv[i], jobs))
+        {
+            printf("Could not read '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if(jobs.empty())
+    {
+        printf("Usage: replay [--threads N] <archive | script | directory>...\n");
+        return 1;
+    }
+
+    // each thread takes the next game until none are left, so slow games do
+    // not hold back the other threads
+    atomic<size_t> next_job{0};
+    vector<size_t> games(num_threads, 0);
+    vector<double> busy(num_threads, 0);
+    vector<thread> threads;
+
+    auto start = chrono::steady_clock::now();
+
+    for(int t = 0; t < num_threads; t++)
+    {
+        threads.emplace_back([&, t]()
+        {
+            Chess chess;
+            chess.setHeadless(true);
+
+            for(size_t j = next_job++; j < jobs.size(); j = next_job++)
+            {
+                auto job_start = chrono::steady_clock::now();
+                runJob(chess, jobs[j]);
+                busy[t] += chrono::duration<double>(chrono::steady_clock::now() - job_start).count();
+                games[t]++;
+            }
+        });
+    }
+
+    for(auto & elem : threads)
+        elem.join();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // -------- report -------- //
+    size_t divergences = 0;
+    for(const auto & job : jobs)
+    {
+        if(!job.divergence.empty())
+        {
+            printf("DIVERGED %s: %s\n", job.source.c_str(), job.divergence.c_str());
+            divergences++;
+        }
+    }
+
+    printf("%zu games, %zu diverged, %.3f s (%.1f games/s) on %d threads\n",
+           jobs.size(), divergences, seconds, seconds > 0 ? jobs.size() / seconds : 0.0, num_threads);
+
+    for(int t = 0; t < num_threads; t++)
+        printf("  thread %d: %zu games, %.1f%% utilization\n", t, games[t], seconds > 0 ? 100 * busy[t] / seconds : 0.0);
+
+    return divergences == 0 ? 0 : 1;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Adds the games of a path (archive, script or directory of
+     *             scripts) to the jobs.
+     *
+     * @param[in]  path  The path
+     * @param      jobs  The jobs
+     *
+     * @return     True if the path could be read, False otherwise.
+     */
+    bool addJobs(const string &path, vector<Job> &jobs)
+    {
+        std::error_code error;
+
+        // a directory of test case scripts (in name order, like the unit tests)
+        if(filesystem::is_directory(path, error))
+        {
+            vector<string> files;
+            for(const auto & entry : filesystem::directory_iterator(path, error))
+                if(entry.is_regular_file() && entry.path().extension() == ".txt")
+                    files.push_back(entry.path().string());
+
+            sort(files.begin(), files.end());
+            for(const auto & file : files)
+                if(!addJobs(file, jobs))
+                    return false;
+
+            return !error;
+        }
+
+        MappedFile file;
+        if(!file.open(path))
+            return false;
+
+        string text(file.getData() == nullptr ? "" : string(file.getData(), file.getSize()));
+        if(isScript(text))
+        {
+            jobs.push_back({path, text, true, ""});
+            return true;
+        }
+
+        size_t line = 1, counted = 0;
+        for(uint64_t offset : findGames(text.data(), text.size()))
+        {
+            // line numbers make the divergences easy to find in the archive
+            line += count(text.begin() + counted, text.begin() + offset, '\n');
+            counted = offset;
+
+            size_t end = text.find('\n', offset);
+            jobs.push_back({path + ":" + to_string(line), text.substr(offset, end == string::npos ? string::npos : end - offset), false, ""});
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief      Replays a single game and records whether it diverged.
+     *
+     * @param      chess  The (headless) chess object of the thread
+     * @param      job    The game
+     */
+    void runJob(Chess &chess, Job &job)
+    {
+        if(job.script)
+        {
+            istringstream in(job.text);
+            string expected;
+
+            replayScript(chess, in, expected);
+            if(!matchesFEN(expected, chess.toFEN()))
+                job.divergence = "expected '" + expected + "', got '" + chess.toFEN() + "'";
+            return;
+        }
+
+        GameRecord game;
+        if(!parseGame(job.text, game))
+        {
+            job.divergence = "malformed line";
+            return;
+        }
+
+        int moves = replayGame(chess, game);
+        if(moves == -1)
+            job.divergence = "invalid start FEN '" + game.fen + "'";
+        else if(moves != (int) game.moves.size())
+            job.divergence = "move " + to_string(moves + 1) + " (" + game.moves[moves] + ") could not be played in '" + chess.toFEN() + "'";
+        else if(!game.final_fen.empty() && !matchesFEN(game.final_fen, chess.toFEN()))
+            job.divergence = "expected '" + game.final_fen + "', got '" + chess.toFEN() + "'";
+    }
+
+    /**
+     * @brief      Decides whether a file is a test case script rather than an
+     *             archive (archive lines contain the '|' separator).
+     *
+     * @param[in]  text  The contents of the file
+     *
+     * @return     True if the file is a test case script, False otherwise.
+     */
+    bool isScript(const string &text)
+    {
+        return !text.empty() && text.find('|') == string::npos;
+    }
+}
@@ -0,0 +1,154 @@
+/**
+ * \page residentgames Resident Games Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;resident_games.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;resident_games.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Storing live games in their compact form, and loading them into chess
+ * objects (see resident_games.h).
+ */
+
+#include "resident_games.h"
+
+// included in 'resident_games.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              RESIDENT GAMES - MEMBER FUNCTIONS                    */
+/*************************************************************************************/
+/**
+ * @brief      Adds a game.
+ *
+ * @param[in]  chess  The chess object of the game
+ *
+ * @return     The index of the game.
+ */
+uint32_t ResidentGames::add(const Chess &chess)
+{
+    uint32_t game;
+    if(!erased.empty())
+    {
+        game = erased.back();
+        erased.pop_back();
+    }
+    else
+    {
+        game = (uint32_t) games.size();
+        games.emplace_back();
+        windows.emplace_back();
+    }
+
+    games[game].live = 1;
+    num_live++;
+    store(game, chess);
+
+    return game;
+}
+
+/**
+ * @brief      Stores a game (ex. after a move was made on the chess object it
+ *             was loaded into).
+ *
+ * @param[in]  game   The index of the game
+ * @param[in]  chess  The chess object of the game
+ */
+void ResidentGames::store(uint32_t game, const Chess &chess)
+{
+    if(game >= games.size() || !games[game].live)
+        return;
+
+    ResidentGame &resident = games[game];
+    packPosition(chess, resident.position);
+    resident.checkmate = chess.getCheckmate();
+    resident.drawn = chess.getStalemate();
+
+    // an earlier position cannot repeat after an irreversible move, so only
+    // the positions since the last one are kept
+    const PositionHistory &history = chess.getHistory();
+    vector<uint64_t> &window = windows[game];
+    int index = chess.getNumMoves() - history.first_ply;
+    if(0 <= index && index < (int) history.hashes.size())
+        window.assign(history.hashes.begin() + (index - history.reversible[index]), history.hashes.begin() + index + 1);
+    else
+        window.assign(1, chess.getHash());
+}
+
+/**
+ * @brief      Loads a game into a chess object (as Chess::setFromFEN() does,
+ *             with the game over flags and the repetition history).
+ *
+ * @param[in]  game   The index of the game
+ * @param      chess  The chess object
+ *
+ * @return     True if the game was loaded, False if there is no such game.
+ */
+bool ResidentGames::load(uint32_t game, Chess &chess) const
+{
+    if(game >= games.size() || !games[game].live)
+        return false;
+
+    char fen[FEN_SIZE];
+    if(unpackPosition(games[game].position, fen, FEN_SIZE) == -1 || !chess.setFromFEN(fen))
+        return false;
+
+    // the first position of the window follows an irreversible move
+    const vector<uint64_t> &window = windows[game];
+    PositionHistory history;
+    history.first_ply = chess.getNumMoves() - ((int) window.size() - 1);
+    history.hashes = window;
+    history.reversible.resize(window.size());
+    for(size_t i = 0; i < window.size(); i++)
+        history.reversible[i] = (int) i;
+    chess.setHistory(history);
+
+    chess.setCheckmate(games[game].checkmate);
+    chess.setStalemate(games[game].drawn);
+
+    // saved again with the game over flags, which makeMove() and undo restore
+    saveObject(chess);
+
+    return true;
+}
+
+/**
+ * @brief      Erases a game (its index is re-used).
+ *
+ * @param[in]  game  The index of the game
+ */
+void ResidentGames::erase(uint32_t game)
+{
+    if(game >= games.size() || !games[game].live)
+        return;
+
+    games[game].live = 0;
+    vector<uint64_t>().swap(windows[game]);
+    erased.push_back(game);
+    num_live--;
+}
+
+/**
+ * @brief      Finds the memory held by the games (the object and the memory it
+ *             allocated).
+ *
+ * @return     The number of bytes.
+ */
+size_t ResidentGames::memoryUsage() const
+{
+    size_t bytes = sizeof(*this) + games.capacity() * sizeof(ResidentGame) +
+                   windows.capacity() * sizeof(vector<uint64_t>) + erased.capacity() * sizeof(uint32_t);
+
+    for(const auto & window : windows)
+        bytes += window.capacity() * sizeof(uint64_t);
+
+    return bytes;
+}
@@ -0,0 +1,373 @@
+/**
+ * \page selfplay Self-Play Training Data Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;selfplay.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;selfplay.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Packing the samples, playing the self-play games that write them, and
+ * streaming them back (see selfplay.h for the file layout).
+ */
+
+#include "selfplay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+// included in 'selfplay.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /** The largest score of a sample (mates are clipped to it) */
+    const int MAX_SAMPLE_SCORE = 32000;
+} // unnamed namespace (makes these functions local to this implementation file)
+
+/*************************************************************************************/
+/*                              SAMPLE READER - MEMBER FUNCTIONS                     */
+/*************************************************************************************/
+/**
+ * @brief      Default constructor - Constructs a new instance with no file
+ *             opened.
+ */
+SampleReader::SampleReader()
+    : samples{nullptr}, num_samples{0}, shuffled{false}, next_chunk{0}, next_sample{0}
+{
+}
+
+/**
+ * @brief      Opens (memory maps) a training data file, and starts streaming
+ *             its samples in order.
+ *
+ * @param[in]  filename  The training data file
+ *
+ * @return     True if the file is valid training data, False otherwise.
+ */
+bool SampleReader::open(const string &filename)
+{
+    close();
+
+    if(!file.open(filename) || file.getSize() < sizeof(SampleHeader))
+    {
+        file.close();
+        return false;
+    }
+
+    // the count of the header is only written once the samples are, so a
+    // file whose writing was cut short is not read
+    const SampleHeader *header = (const SampleHeader *) file.getData();
+    if( memcmp(header->magic, SAMPLE_MAGIC, sizeof(header->magic)) != 0 ||
+        file.getSize() != sizeof(SampleHeader) + header->num_samples * sizeof(TrainingSample) )
+    {
+        file.close();
+        return false;
+    }
+
+    samples = (const TrainingSample *) (file.getData() + sizeof(SampleHeader));
+    num_samples = header->num_samples;
+    rewind(false);
+    return true;
+}
+
+/**
+ * @brief      Closes the file.
+ */
+void SampleReader::close()
+{
+    file.close();
+    samples = nullptr;
+    num_samples = 0;
+    chunks.clear();
+    window.clear();
+    next_chunk = next_sample = 0;
+}
+
+/**
+ * @brief      Starts streaming the samples again (a new epoch).
+ *
+ * @param[in]  shuffle  True to stream them shuffled, False in order
+ * @param[in]  seed     The seed of the shuffle
+ */
+void SampleReader::rewind(bool shuffle, uint64_t seed)
+{
+    shuffled = shuffle;
+    next_chunk = next_sample = 0;
+    window.clear();
+
+    if(!shuffled)
+        return;
+
+    rng.seed(seed);
+    chunks.resize((num_samples + SAMPLE_CHUNK - 1) / SAMPLE_CHUNK);
+    for(size_t i = 0; i < chunks.size(); i++)
+        chunks[i] = (uint32_t) i;
+    std::shuffle(chunks.begin(), chunks.end(), rng);
+}
+
+/**
+ * @brief      Streams the next samples of the epoch.
+ *
+ * @param      out    The samples read
+ * @param[in]  count  The most samples read
+ *
+ * @return     The number of samples read (less than 'count' at the end of the
+ *             epoch, and 0 after it).
+ */
+size_t SampleReader::read(TrainingSample *out, size_t count)
+{
+    size_t done = 0;
+
+    // in order, the samples are copied straight from the mapped file
+    if(!shuffled)
+    {
+        done = (size_t) min((uint64_t) count, num_samples - next_sample);
+        memcpy(out, samples + next_sample, done * sizeof(TrainingSample));
+        next_sample += done;
+        return done;
+    }
+
+    while(done < count)
+    {
+        if(next_sample == window.size())
+        {
+            fillWindow();
+            if(window.empty())
+                break;
+        }
+
+        size_t taken = min(count - done, window.size() - next_sample);
+        memcpy(out + done, window.data() + next_sample, taken * sizeof(TrainingSample));
+        next_sample += taken;
+        done += taken;
+    }
+
+    return done;
+}
+
+/**
+ * @brief      Copies and shuffles the next window of chunks.
+ */
+void SampleReader::fillWindow()
+{
+    window.clear();
+    next_sample = 0;
+
+    for(int i = 0; i < SAMPLE_WINDOW && next_chunk < chunks.size(); i++, next_chunk++)
+    {
+        uint64_t first = (uint64_t) chunks[next_chunk] * SAMPLE_CHUNK;
+        window.insert(window.end(), samples + first, samples + min(first + SAMPLE_CHUNK, num_samples));
+    }
+
+    std::shuffle(window.begin(), window.end(), rng);
+}
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Packs a position and its labels into a sample.
+     *
+     * @param[in]  chess   The chess object
+     * @param[in]  score   The score of the position for the side to move
+     * @param[in]  result  The result of the game for the side to move (0 for a
+     *                     loss, 1 for a draw, 2 for a win)
+     * @param      sample  The sample
+     *
+     * @return     True if the position was packed, False if it has more than
+     *             32 pieces (only possible from a custom FEN).
+     */
+    bool packSample(const Chess &chess, int score, int result, TrainingSample &sample)
+    {
+        PackedPosition position;
+        packPosition(chess, position);
+        memset(&sample, 0, sizeof(sample));
+
+        int count = 0;
+        for(int square = 0; square < 64; square++)
+        {
+            int code = (position.squares[square / 2] >> (4 * (square % 2))) & 15;
+            if(code == 0)
+                continue;
+            if(count == 32)
+                return false;
+
+            sample.occupied |= 1ULL << square;
+            sample.pieces[count / 2] |= code << (4 * (count % 2));
+            count++;
+        }
+
+        memcpy(sample.reservoir, position.reservoir, sizeof(sample.reservoir));
+        sample.flags = (position.flags & 31) | (result << 5);
+        sample.score = (int16_t) max(-MAX_SAMPLE_SCORE, min(MAX_SAMPLE_SCORE, score));
+        return true;
+    }
+
+    /**
+     * @brief      Unpacks the position of a sample (without an en-passant
+     *             square, at move 1).
+     *
+     * @param[in]  sample    The sample
+     * @param      position  The packed position
+     */
+    void unpackSample(const TrainingSample &sample, PackedPosition &position)
+    {
+        memset(&position, 0, sizeof(position));
+
+        int count = 0;
+        for(int square = 0; square < 64; square++)
+        {
+            if((sample.occupied >> square & 1) == 0)
+                continue;
+
+            int code = (sample.pieces[count / 2] >> (4 * (count % 2))) & 15;
+            position.squares[square / 2] |= code << (4 * (square % 2));
+            count++;
+        }
+
+        memcpy(position.reservoir, sample.reservoir, sizeof(position.reservoir));
+        position.flags = sample.flags & 31;
+        position.en_passant = 255;
+        position.num_moves[0] = 1;
+    }
+
+    /**
+     * @brief      Plays self-play games on a pool of threads and writes the
+     *             samples of their positions to a training data file.
+     *
+     * @param[in]  filename  The training data file (it is replaced)
+     * @param[in]  config    The settings of the games
+     * @param      stats     The outcome of the games
+     *
+     * @return     True if every sample was written, False otherwise.
+     */
+    bool generateSamples(const string &filename, const SelfPlayConfig &config, SelfPlayStats &stats)
+    {
+        ofstream out(filename, ios::binary | ios::trunc);
+        if(!out)
+            return false;
+
+        // the count is written again once the samples are
+        SampleHeader header;
+        memcpy(header.magic, SAMPLE_MAGIC, sizeof(header.magic));
+        header.num_samples = 0;
+        out.write((const char *) &header, sizeof(header));
+
+        int num_threads = config.threads > 0 ? config.threads : max(1u, thread::hardware_concurrency());
+        atomic<int> next_game{0};
+        mutex shared;
+        vector<thread> threads;
+
+        stats = SelfPlayStats();
+        stats.threads = num_threads;
+        auto start = chrono::steady_clock::now();
+
+        for(int t = 0; t < num_threads; t++)
+        {
+            threads.emplace_back([&]()
+            {
+                Engine engine(config.engine);
+                Chess chess;
+                chess.setHeadless(true);
+
+                vector<TrainingSample> buffer, game_samples;
+                buffer.reserve(config.buffer_samples);
+                SelfPlayStats own;
+
+                // the buffer is written (and the counts added) under the lock
+                // of the file, so the threads only wait for each other then
+                auto flush = [&]()
+                {
+                    lock_guard<mutex> lock(shared);
+                    out.write((const char *) buffer.data(), buffer.size() * sizeof(TrainingSample));
+
+                    stats.games += own.games;
+                    stats.white_wins += own.white_wins;
+                    stats.draws += own.draws;
+                    stats.black_wins += own.black_wins;
+                    stats.samples += buffer.size();
+                    stats.nodes += own.nodes;
+
+                    own = SelfPlayStats();
+                    buffer.clear();
+                };
+
+                for(int g = next_game++; g < config.games; g = next_game++)
+                {
+                    chess.setFromFEN(START_FEN);
+
+                    mt19937 random(config.seed + g);
+                    for(int i = 0; i < config.random_plies; i++)
+                    {
+                        vector<Move> moves = legalMoves(chess);
+                        if(moves.empty())
+                            break;
+                        playMove(chess, moves[random() % moves.size()]);
+                    }
+
+                    // the results are only known at the end of the game, so
+                    // the samples keep the side to move until then
+                    GameRecord game;
+                    game_samples.clear();
+                    uint64_t nodes = engine.getNodes();
+
+                    playGame(engine, engine, chess, config.adjudication, game, [&](const Chess &position, int score)
+                    {
+                        TrainingSample sample;
+                        if(packSample(position, score, 0, sample))
+                            game_samples.push_back(sample);
+                    });
+
+                    int white_result = game.result == "1-0" ? 2 : game.result == "0-1" ? 0 : 1;
+                    for(auto & sample : game_samples)
+                    {
+                        int result = (sample.flags & 1) ? white_result : 2 - white_result;
+                        sample.flags |= result << 5;
+                    }
+
+                    buffer.insert(buffer.end(), game_samples.begin(), game_samples.end());
+                    own.games++;
+                    own.white_wins += white_result == 2;
+                    own.draws += white_result == 1;
+                    own.black_wins += white_result == 0;
+                    own.nodes += engine.getNodes() - nodes;
+
+                    if(buffer.size() >= config.buffer_samples)
+                        flush();
+                }
+
+                flush();
+            });
+        }
+
+        for(auto & elem : threads)
+            elem.join();
+
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        header.num_samples = stats.samples;
+        out.seekp(0);
+        out.write((const char *) &header, sizeof(header));
+        out.close();
+
+        return !out.fail();
+    }
+}
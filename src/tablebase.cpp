@@ -0,0 +1,1085 @@
+/**
+ * \page tablebase Endgame Tablebase Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;tablebase.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;tablebase.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Solving, writing and probing the endgame tables (see tablebase.h for the
+ * index and the file layout).
+ */
+
+#include "tablebase.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+// included in 'tablebase.h' but good to re-state
+using namespace std;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /** The value (in memory) of a position that is not solved (yet), which is
+     *  a draw once every pass is done */
+    const uint8_t UNSOLVED = 0;
+
+    /** The value (in memory) of an illegal position */
+    const uint8_t ILLEGAL = 255;
+
+    /** The child of a move that captures the piece (a draw) */
+    const uint64_t CAPTURE = UINT64_MAX;
+
+    /** The most reservoir pieces of a table (so that its name fits in
+     *  TablebaseHeader::material) */
+    const int MAX_RESERVOIR_PIECES = 10;
+
+    /** The pieces of a table's name, by type (PAWN to QUEEN) */
+    const char PIECE_NAMES[] = "PNBRQ";
+
+    /** The reservoir pieces of Chess::getReservoir(), by type ('o' is a
+     *  bishop) */
+    const char RESERVOIR_NAMES[] = "pnorq";
+
+    /**
+     * @brief      This struct describes a position of a table, as the parts of
+     *             its index.
+     */
+    struct TbPosition
+    {
+        /** The reservoir part of the index */
+        uint64_t reservoir;
+
+        /** The slot of the type of the piece (TablebaseLayout::types) */
+        int slot;
+
+        /** 0 if the side with the piece is to move, 1 if the lone king is */
+        int side;
+
+        /** The squares of the king of the side with the piece (always white),
+         *  of the lone king and of the piece */
+        int king, lone, piece;
+    };
+
+    /**
+     * @brief      This struct describes the squares attacked by a king and by a
+     *             knight from every square.
+     */
+    struct AttackTables
+    {
+        /** The squares attacked from each square */
+        uint64_t king[64], knight[64];
+
+        /**
+         * @brief      Default constructor - Fills the tables.
+         */
+        AttackTables();
+    };
+
+    /**
+     * @brief      Gets the attack tables (filled on the first call).
+     *
+     * @return     The attack tables.
+     */
+    const AttackTables & attackTables();
+
+    /**
+     * @brief      Finds the squares attacked by a white piece.
+     *
+     * @param[in]  type      The type of the piece (PAWN to QUEEN)
+     * @param[in]  square    The square of the piece
+     * @param[in]  occupied  The occupied squares (that block the sliding
+     *                       pieces)
+     *
+     * @return     The attacked squares (bit i is square i).
+     */
+    uint64_t pieceAttacks(int type, int square, uint64_t occupied);
+
+    /**
+     * @brief      Finds the index of a position.
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  position  The position
+     *
+     * @return     The index.
+     */
+    uint64_t encode(const TablebaseLayout &layout, const TbPosition &position);
+
+    /**
+     * @brief      Finds the position of an index.
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  index     The index
+     * @param      position  The position
+     */
+    void decode(const TablebaseLayout &layout, uint64_t index, TbPosition &position);
+
+    /**
+     * @brief      Finds if a position is legal: the three pieces on different
+     *             squares, the kings apart, no pawn on the first or last rank,
+     *             and the side not to move not in check.
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  position  The position
+     *
+     * @return     True if the position is legal, False otherwise.
+     */
+    bool isLegal(const TablebaseLayout &layout, const TbPosition &position);
+
+    /**
+     * @brief      Finds if the lone king is in check (only the side with the
+     *             piece can give check).
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  position  The position
+     *
+     * @return     True if the lone king is to move and in check, False
+     *             otherwise.
+     */
+    bool inCheck(const TablebaseLayout &layout, const TbPosition &position);
+
+    /**
+     * @brief      Visits the position after each legal move of a position
+     *             (board moves, promotions and reservoir moves).
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  position  The position (legal)
+     * @param[in]  visit     Called with the index of each child (CAPTURE if the
+     *                       move captures the piece), returns False to stop
+     *
+     * @tparam     Visit     bool(uint64_t)
+     *
+     * @return     The number of children visited.
+     */
+    template <typename Visit>
+    int forEachChild(const TablebaseLayout &layout, const TbPosition &position, Visit visit);
+
+    /**
+     * @brief      Visits the positions that may lead to a position by one move
+     *             (a move back of the side not to move, a promotion or a
+     *             reservoir piece taken back). Some of them are illegal, or
+     *             their move is not legal, which the caller finds out by
+     *             looking at their moves.
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  position  The position
+     * @param[in]  visit     Called with the index of each parent
+     *
+     * @tparam     Visit     void(uint64_t)
+     */
+    template <typename Visit>
+    void forEachParent(const TablebaseLayout &layout, const TbPosition &position, Visit visit);
+
+    /**
+     * @brief      Runs a pass over a part of the index: the first pass (0)
+     *             marks the illegal positions and the checkmates, pass n finds
+     *             the positions won or lost in n plies among the parents of
+     *             the positions of the part solved in pass n - 1.
+     *
+     * @param[in]  layout  The layout of the table
+     * @param      values  The values of the positions
+     * @param[in]  pass    The pass
+     * @param[in]  begin   The first index of the part
+     * @param[in]  end     One past the last index of the part
+     *
+     * @return     The number of positions solved.
+     */
+    uint64_t solvePart(const TablebaseLayout &layout, atomic<uint8_t> *values, int pass, uint64_t begin, uint64_t end);
+
+    /**
+     * @brief      Compresses values into a tablebase file.
+     *
+     * @param[in]  filename  The file
+     * @param[in]  magic     TB_WDL_MAGIC or TB_DTM_MAGIC
+     * @param[in]  material  The name of the table
+     * @param[in]  values    The value of every position
+     *
+     * @return     The size of the file (in bytes), or 0 if it could not be
+     *             written.
+     */
+    uint64_t writeFile(const string &filename, const char *magic, const string &material, const vector<uint8_t> &values);
+
+    /**
+     * @brief      Maps a tablebase file and checks its header.
+     *
+     * @param      file      The file
+     * @param[in]  filename  The name of the file
+     * @param[in]  magic     TB_WDL_MAGIC or TB_DTM_MAGIC
+     * @param[in]  layout    The layout of the table
+     *
+     * @return     True if the file is a valid file of the table, False
+     *             otherwise.
+     */
+    bool openFile(MappedFile &file, const string &filename, const char *magic, const TablebaseLayout &layout);
+} // unnamed namespace (makes these functions local to this implementation file)
+
+/*************************************************************************************/
+/*                              TABLEBASE - MEMBER FUNCTIONS                         */
+/*************************************************************************************/
+/**
+ * @brief      Default constructor - Constructs a new instance with no table
+ *             opened.
+ */
+Tablebase::Tablebase()
+{
+    close();
+}
+
+/**
+ * @brief      Solves a table and writes its files ('material'.wdl and
+ *             'material'.dtm in 'directory').
+ *
+ * @param[in]  material     The name of the table (ex. "KRvK" or "KBvK+q")
+ * @param[in]  directory    The directory of the files
+ * @param[in]  num_threads  The number of threads (0 uses all cores)
+ * @param      stats        The outcome of the generation (can be nullptr)
+ *
+ * @return     True if the files were written, False if the name is invalid,
+ *             the table has a distance to the checkmate longer than TB_MAX_DTM
+ *             or the files could not be written.
+ */
+bool Tablebase::generate(const string &material, const string &directory, int num_threads, TablebaseStats *stats)
+{
+    auto start = chrono::steady_clock::now();
+
+    TablebaseLayout layout;
+    if(!parseMaterial(material, layout))
+        return false;
+
+    if(num_threads <= 0)
+        num_threads = max((int) thread::hardware_concurrency(), 1);
+
+    // -------- solve the table, one part of the index per thread -------- //
+    unique_ptr<atomic<uint8_t>[]> values(new atomic<uint8_t>[layout.positions]);
+
+    int pass = 0;
+    for(uint64_t solved = 1; solved > 0; pass++)
+    {
+        if(pass > TB_MAX_DTM)
+            return false;
+
+        vector<uint64_t> part_solved(num_threads, 0);
+        vector<thread> threads;
+        for(int t = 0; t < num_threads; t++)
+        {
+            uint64_t begin = layout.positions * t / num_threads, end = layout.positions * (t + 1) / num_threads;
+            threads.emplace_back([&, t, begin, end]()
+            {
+                part_solved[t] = solvePart(layout, values.get(), pass, begin, end);
+            });
+        }
+
+        for(auto & elem : threads)
+            elem.join();
+
+        // the first pass always goes on (there may be no checkmate, but there
+        // are wins by a move that captures nothing)
+        solved = pass == 0 ? 1 : 0;
+        for(const auto & elem : part_solved)
+            solved += elem;
+    }
+
+    // -------- the values of the files (an illegal position repeats the last legal one) -------- //
+    TablebaseStats counts = {};
+    counts.positions = layout.positions;
+    counts.passes = pass - 2;
+
+    vector<uint8_t> wdl(layout.positions), dtm(layout.positions);
+    uint8_t last_wdl = 0, last_dtm = 0;
+    for(uint64_t index = 0; index < layout.positions; index++)
+    {
+        uint8_t value = values[index].load(memory_order_relaxed);
+        if(value != ILLEGAL)
+        {
+            counts.legal++;
+            last_dtm = value;
+            last_wdl = value == UNSOLVED ? TB_DRAW : (value - 1) % 2 == 1 ? TB_WIN : TB_LOSS;
+
+            if(last_wdl == TB_DRAW)
+                counts.draws++;
+            else
+            {
+                (last_wdl == TB_WIN ? counts.wins : counts.losses)++;
+                counts.longest = max(counts.longest, value - 1);
+            }
+        }
+
+        wdl[index] = last_wdl;
+        dtm[index] = last_dtm;
+    }
+
+    values.reset();
+
+    string prefix = directory + "/" + layout.material;
+    counts.wdl_bytes = writeFile(prefix + ".wdl", TB_WDL_MAGIC, layout.material, wdl);
+    counts.dtm_bytes = writeFile(prefix + ".dtm", TB_DTM_MAGIC, layout.material, dtm);
+    counts.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if(stats != nullptr)
+        *stats = counts;
+
+    return counts.wdl_bytes > 0 && counts.dtm_bytes > 0;
+}
+
+/**
+ * @brief      Finds the layout of the index of a table.
+ *
+ * @param[in]  material  The name of the table
+ * @param      layout    The layout
+ *
+ * @return     True if the name is valid, False otherwise.
+ */
+bool Tablebase::parseMaterial(const string &material, TablebaseLayout &layout)
+{
+    // "K" piece "vK", then optionally "+" and the reservoir pieces
+    const char *piece = material.size() >= 4 ? strchr(PIECE_NAMES, material[1]) : nullptr;
+    if( piece == nullptr || *piece == '\0' || material[0] != 'K' || material.compare(2, 2, "vK") != 0 ||
+        (material.size() > 4 && material[4] != '+') || material.size() == 5 )
+        return false;
+
+    int counts[5] = {}, total = 0;
+    for(size_t i = 5; i < material.size(); i++)
+    {
+        const char *type = strchr(PIECE_NAMES, std::toupper(material[i]));
+        if(type == nullptr || *type == '\0' || !std::islower(material[i]) || ++total > MAX_RESERVOIR_PIECES)
+            return false;
+
+        counts[type - PIECE_NAMES]++;
+    }
+
+    // every type the piece can become, and the reservoir pieces in order
+    bool present[6] = {};
+    present[piece - PIECE_NAMES] = true;
+    layout.material = string("K") + *piece + "vK";
+    for(int type = PAWN; type <= QUEEN; type++)
+    {
+        present[type] = present[type] || counts[type] > 0;
+        layout.material.append(counts[type], (char) std::tolower(PIECE_NAMES[type]));
+    }
+
+    if(total > 0)
+        layout.material.insert(4, "+");
+
+    if(present[PAWN])
+        present[KNIGHT] = present[BISHOP] = present[ROOK] = present[QUEEN] = true;
+
+    layout.types.clear();
+    for(int type = PAWN; type <= KING; type++)
+    {
+        layout.slot[type] = present[type] ? (int) layout.types.size() : -1;
+        if(present[type])
+            layout.types.push_back(type);
+    }
+
+    layout.reservoirs = 1;
+    for(int type = PAWN; type <= QUEEN; type++)
+    {
+        layout.reservoir[type] = counts[type];
+        layout.stride[type] = layout.reservoirs;
+        layout.reservoirs *= counts[type] + 1;
+    }
+
+    layout.positions = layout.reservoirs * layout.types.size() * 2 * 64 * 64 * 64;
+    return true;
+}
+
+/**
+ * @brief      Opens (memory maps) the files of a table.
+ *
+ * @param[in]  directory  The directory of the files
+ * @param[in]  material   The name of the table
+ *
+ * @return     True if both files are valid files of the table, False
+ *             otherwise.
+ */
+bool Tablebase::open(const string &directory, const string &material)
+{
+    close();
+
+    TablebaseLayout opened;
+    if(!parseMaterial(material, opened))
+        return false;
+
+    string prefix = directory + "/" + opened.material;
+    if( !openFile(wdl_file, prefix + ".wdl", TB_WDL_MAGIC, opened) ||
+        !openFile(dtm_file, prefix + ".dtm", TB_DTM_MAGIC, opened) )
+    {
+        close();
+        return false;
+    }
+
+    layout = opened;
+    return true;
+}
+
+/**
+ * @brief      Closes the files of the table.
+ */
+void Tablebase::close()
+{
+    wdl_file.close();
+    dtm_file.close();
+
+    layout = TablebaseLayout();
+    layout.reservoirs = layout.positions = 0;
+}
+
+/**
+ * @brief      Probes a position.
+ *
+ * @param[in]  chess   The chess object
+ * @param      result  The result of the position
+ * @param[in]  dtm     True to also find the distance to the checkmate (from the
+ *                     DTM file), False for the result only
+ *
+ * @return     True if the position is in the table, False otherwise (no table
+ *             is opened, other material, too many reservoir pieces, a castling
+ *             right, or a pawn that cannot move as the table assumes).
+ */
+bool Tablebase::probe(const Chess &chess, TablebaseProbe &result, bool dtm) const
+{
+    uint64_t index;
+    if(!findIndex(chess, index))
+        return false;
+
+    probeIndex(index, result, dtm);
+    return true;
+}
+
+/**
+ * @brief      Probes a position by its index.
+ *
+ * @param[in]  index   The index of the position (in [0, getSize()))
+ * @param      result  The result of the position (meaningless for an illegal
+ *                     position)
+ * @param[in]  dtm     True to also find the distance to the checkmate, False
+ *                     for the result only
+ */
+void Tablebase::probeIndex(uint64_t index, TablebaseProbe &result, bool dtm) const
+{
+    result.wdl = (tbResult) readValue(wdl_file, index);
+    result.dtm = 0;
+
+    if(dtm && result.wdl != TB_DRAW)
+        result.dtm = readValue(dtm_file, index) - 1;
+}
+
+/**
+ * @brief      Finds the index of a position.
+ *
+ * @param[in]  chess  The chess object
+ * @param      index  The index of the position
+ *
+ * @return     True if the position is in the table, False otherwise.
+ */
+bool Tablebase::findIndex(const Chess &chess, uint64_t &index) const
+{
+    if(layout.positions == 0 || chess.getCastlingRights() != 0)
+        return false;
+
+    // two kings and one piece
+    int kings[2] = {-1, -1}, piece = -1, type = EMPTY, others = 0;
+    pieceColor owner = NEUTRAL;
+    bool moved = false;
+    for(const auto & elem : chess.getBoard())
+    {
+        if(elem->isEmpty())
+            continue;
+        else if(elem->isKing())
+            kings[elem->isPieceWhite()] = elem->getPieceSquare();
+        else if(++others > 1)
+            return false;
+        else
+        {
+            piece = elem->getPieceSquare();
+            type = elem->getPieceType();
+            owner = elem->getPieceColor();
+            moved = elem->getPieceMoveInfo();
+        }
+    }
+
+    if(others != 1 || kings[0] == -1 || kings[1] == -1 || layout.slot[type] == -1)
+        return false;
+
+    // the side with the piece is white in the table
+    int flip = owner == WHITE ? 0 : 56;
+    TbPosition position;
+    position.slot = layout.slot[type];
+    position.side = chess.getTurn() == owner ? 0 : 1;
+    position.king = kings[owner == WHITE] ^ flip;
+    position.lone = kings[owner != WHITE] ^ flip;
+    position.piece = piece ^ flip;
+
+    // a pawn placed on its second rank from the reservoir cannot move two
+    // squares
+    if(type == PAWN && position.piece / 8 == 6 && moved)
+        return false;
+
+    position.reservoir = 0;
+    for(const auto & elem : chess.getReservoir())
+    {
+        if((std::isupper(elem.second) != 0) != (owner == WHITE) || elem.first == 0)
+            continue;
+
+        const char *reservoir_type = strchr(RESERVOIR_NAMES, std::tolower(elem.second));
+        if(reservoir_type == nullptr || elem.first > layout.reservoir[reservoir_type - RESERVOIR_NAMES])
+            return false;
+
+        position.reservoir += elem.first * layout.stride[reservoir_type - RESERVOIR_NAMES];
+    }
+
+    if(!isLegal(layout, position))
+        return false;
+
+    index = encode(layout, position);
+    return true;
+}
+
+/**
+ * @brief      Decodes the value of a position from a file.
+ *
+ * @param[in]  file   The file (already checked by open())
+ * @param[in]  index  The index of the position
+ *
+ * @return     The value.
+ */
+uint8_t Tablebase::readValue(const MappedFile &file, uint64_t index)
+{
+    const TablebaseHeader *header = (const TablebaseHeader *) file.getData();
+    const uint64_t *offsets = (const uint64_t *) (file.getData() + sizeof(TablebaseHeader));
+    const uint8_t *blocks = (const uint8_t *) (offsets + header->num_blocks + 1);
+
+    uint64_t block = index / header->block_size, skip = index % header->block_size;
+    const uint8_t *run = blocks + offsets[block], *end = blocks + offsets[block + 1];
+    while(run < end)
+    {
+        uint8_t value = *run++;
+
+        uint64_t length = 0;
+        for(int shift = 0; run < end; shift += 7)
+        {
+            length |= (uint64_t) (*run & 127) << shift;
+            if(!(*run++ & 128))
+                break;
+        }
+
+        if(skip < length)
+            return value;
+        skip -= length;
+    }
+
+    return 0; // GCOV_EXCL_LINE (the blocks cover every index)
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Default constructor - Fills the tables.
+     */
+    AttackTables::AttackTables()
+    {
+        const int king_steps[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}};
+        const int knight_steps[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+
+        for(int square = 0; square < 64; square++)
+        {
+            king[square] = knight[square] = 0;
+            for(int i = 0; i < 8; i++)
+            {
+                int row = square / 8 + king_steps[i][0], col = square % 8 + king_steps[i][1];
+                if(0 <= row && row < 8 && 0 <= col && col < 8)
+                    king[square] |= 1ULL << (row * 8 + col);
+
+                row = square / 8 + knight_steps[i][0], col = square % 8 + knight_steps[i][1];
+                if(0 <= row && row < 8 && 0 <= col && col < 8)
+                    knight[square] |= 1ULL << (row * 8 + col);
+            }
+        }
+    }
+
+    /**
+     * @brief      Gets the attack tables (filled on the first call).
+     *
+     * @return     The attack tables.
+     */
+    const AttackTables & attackTables()
+    {
+        static const AttackTables tables;
+        return tables;
+    }
+
+    /**
+     * @brief      Finds the squares attacked by a white piece.
+     *
+     * @param[in]  type      The type of the piece (PAWN to QUEEN)
+     * @param[in]  square    The square of the piece
+     * @param[in]  occupied  The occupied squares (that block the sliding
+     *                       pieces)
+     *
+     * @return     The attacked squares (bit i is square i).
+     */
+    uint64_t pieceAttacks(int type, int square, uint64_t occupied)
+    {
+        int row = square / 8, col = square % 8;
+
+        // white pawns move towards row 0 (the eighth rank)
+        if(type == PAWN)
+            return row == 0 ? 0 : (col > 0 ? 1ULL << (square - 9) : 0) | (col < 7 ? 1ULL << (square - 7) : 0);
+        else if(type == KNIGHT)
+            return attackTables().knight[square];
+
+        const int directions[8][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+        int first = type == BISHOP ? 4 : 0, last = type == ROOK ? 4 : 8;
+
+        uint64_t attacks = 0;
+        for(int i = first; i < last; i++)
+        {
+            for(int r = row + directions[i][0], c = col + directions[i][1]; 0 <= r && r < 8 && 0 <= c && c < 8;
+                r += directions[i][0], c += directions[i][1])
+            {
+                attacks |= 1ULL << (r * 8 + c);
+                if(occupied & (1ULL << (r * 8 + c)))
+                    break;
+            }
+        }
+
+        return attacks;
+    }
+
+    /**
+     * @brief      Finds the index of a position.
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  position  The position
+     *
+     * @return     The index.
+     */
+    uint64_t encode(const TablebaseLayout &layout, const TbPosition &position)
+    {
+        uint64_t index = (position.reservoir * layout.types.size() + position.slot) * 2 + position.side;
+        return ((index * 64 + position.king) * 64 + position.lone) * 64 + position.piece;
+    }
+
+    /**
+     * @brief      Finds the position of an index.
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  index     The index
+     * @param      position  The position
+     */
+    void decode(const TablebaseLayout &layout, uint64_t index, TbPosition &position)
+    {
+        position.piece = index % 64;
+        position.lone = (index / 64) % 64;
+        position.king = (index / 4096) % 64;
+        index /= 262144;
+
+        position.side = index % 2;
+        position.slot = (index / 2) % layout.types.size();
+        position.reservoir = index / 2 / layout.types.size();
+    }
+
+    /**
+     * @brief      Finds if a position is legal: the three pieces on different
+     *             squares, the kings apart, no pawn on the first or last rank,
+     *             and the side not to move not in check.
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  position  The position
+     *
+     * @return     True if the position is legal, False otherwise.
+     */
+    bool isLegal(const TablebaseLayout &layout, const TbPosition &position)
+    {
+        int type = layout.types[position.slot];
+        if( position.king == position.lone || position.king == position.piece || position.lone == position.piece ||
+            (attackTables().king[position.king] & (1ULL << position.lone)) ||
+            (type == PAWN && (position.piece / 8 == 0 || position.piece / 8 == 7)) )
+            return false;
+
+        uint64_t occupied = (1ULL << position.king) | (1ULL << position.lone);
+        return position.side == 1 || !(pieceAttacks(type, position.piece, occupied) & (1ULL << position.lone));
+    }
+
+    /**
+     * @brief      Finds if the lone king is in check (only the side with the
+     *             piece can give check).
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  position  The position
+     *
+     * @return     True if the lone king is to move and in check, False
+     *             otherwise.
+     */
+    bool inCheck(const TablebaseLayout &layout, const TbPosition &position)
+    {
+        uint64_t occupied = (1ULL << position.king) | (1ULL << position.lone);
+        return position.side == 1 &&
+               (pieceAttacks(layout.types[position.slot], position.piece, occupied) & (1ULL << position.lone));
+    }
+
+    /**
+     * @brief      Visits the position after each legal move of a position
+     *             (board moves, promotions and reservoir moves).
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  position  The position (legal)
+     * @param[in]  visit     Called with the index of each child (CAPTURE if the
+     *                       move captures the piece), returns False to stop
+     *
+     * @tparam     Visit     bool(uint64_t)
+     *
+     * @return     The number of children visited.
+     */
+    template <typename Visit>
+    int forEachChild(const TablebaseLayout &layout, const TbPosition &position, Visit visit)
+    {
+        const AttackTables &tables = attackTables();
+        int type = layout.types[position.slot], count = 0;
+        TbPosition child = position;
+        child.side = !position.side;
+
+        // the lone king moves away from the king, and out of the piece's
+        // attacks (which go through the square it leaves)
+        if(position.side == 1)
+        {
+            uint64_t targets = tables.king[position.lone] & ~tables.king[position.king];
+            while(targets)
+            {
+                int square = __builtin_ctzll(targets);
+                targets &= targets - 1;
+
+                if(square != position.piece)
+                {
+                    uint64_t occupied = (1ULL << position.king) | (1ULL << square);
+                    if(pieceAttacks(type, position.piece, occupied) & (1ULL << square))
+                        continue;
+                }
+
+                child.lone = square;
+                count++;
+                if(!visit(square == position.piece ? CAPTURE : encode(layout, child)))
+                    return count;
+            }
+
+            return count;
+        }
+
+        // the king (its only attacker is the lone king)
+        uint64_t occupied = (1ULL << position.king) | (1ULL << position.lone) | (1ULL << position.piece);
+        uint64_t targets = tables.king[position.king] & ~tables.king[position.lone] & ~occupied;
+        while(targets)
+        {
+            child.king = __builtin_ctzll(targets);
+            targets &= targets - 1;
+
+            count++;
+            if(!visit(encode(layout, child)))
+                return count;
+        }
+        child.king = position.king;
+
+        // the piece (a pawn cannot capture, since the lone king is never
+        // attacked on its turn), and the promotions of a pawn
+        if(type == PAWN)
+        {
+            targets = ~occupied & (1ULL << (position.piece - 8));
+            if(targets && position.piece / 8 == 6)
+                targets |= ~occupied & (1ULL << (position.piece - 16));
+        }
+        else
+            targets = pieceAttacks(type, position.piece, occupied) & ~occupied;
+
+        while(targets)
+        {
+            child.piece = __builtin_ctzll(targets);
+            targets &= targets - 1;
+
+            for(int promotion = KNIGHT; promotion <= QUEEN; promotion++)
+            {
+                bool promotes = type == PAWN && child.piece / 8 == 0;
+                child.slot = layout.slot[promotes ? promotion : type];
+
+                count++;
+                if(!visit(encode(layout, child)))
+                    return count;
+
+                if(!promotes)
+                    break;
+            }
+        }
+        child.piece = position.piece;
+
+        // the reservoir pieces replace the piece (the side with the piece is
+        // never in check)
+        for(int reservoir = PAWN; reservoir <= QUEEN; reservoir++)
+        {
+            if( reservoir == type || (position.reservoir / layout.stride[reservoir]) % (layout.reservoir[reservoir] + 1) == 0 ||
+                (reservoir == PAWN && (position.piece / 8 == 0 || position.piece / 8 == 7)) )
+                continue;
+
+            child.reservoir = position.reservoir - layout.stride[reservoir];
+            child.slot = layout.slot[reservoir];
+
+            count++;
+            if(!visit(encode(layout, child)))
+                return count;
+        }
+
+        return count;
+    }
+
+    /**
+     * @brief      Visits the positions that may lead to a position by one move
+     *             (a move back of the side not to move, a promotion or a
+     *             reservoir piece taken back). Some of them are illegal, or
+     *             their move is not legal, which the caller finds out by
+     *             looking at their moves.
+     *
+     * @param[in]  layout    The layout of the table
+     * @param[in]  position  The position
+     * @param[in]  visit     Called with the index of each parent
+     *
+     * @tparam     Visit     void(uint64_t)
+     */
+    template <typename Visit>
+    void forEachParent(const TablebaseLayout &layout, const TbPosition &position, Visit visit)
+    {
+        const AttackTables &tables = attackTables();
+        int type = layout.types[position.slot];
+        TbPosition parent = position;
+        parent.side = !position.side;
+
+        // the lone king moved (a capture leaves the table)
+        if(position.side == 0)
+        {
+            for(uint64_t sources = tables.king[position.lone]; sources; sources &= sources - 1)
+            {
+                parent.lone = __builtin_ctzll(sources);
+                visit(encode(layout, parent));
+            }
+
+            return;
+        }
+
+        // the king
+        for(uint64_t sources = tables.king[position.king]; sources; sources &= sources - 1)
+        {
+            parent.king = __builtin_ctzll(sources);
+            visit(encode(layout, parent));
+        }
+        parent.king = position.king;
+
+        // the piece, or the pawn it was promoted from
+        uint64_t occupied = (1ULL << position.king) | (1ULL << position.lone) | (1ULL << position.piece);
+        uint64_t sources = 0;
+        if(type == PAWN)
+            sources = (1ULL << (position.piece + 8)) | (position.piece / 8 == 4 ? 1ULL << (position.piece + 16) : 0);
+        else
+            sources = pieceAttacks(type, position.piece, occupied);
+
+        for(sources &= ~occupied; sources; sources &= sources - 1)
+        {
+            parent.piece = __builtin_ctzll(sources);
+            visit(encode(layout, parent));
+        }
+
+        if(type != PAWN && layout.slot[PAWN] != -1 && position.piece / 8 == 0 && !(occupied & (1ULL << (position.piece + 8))))
+        {
+            parent.piece = position.piece + 8;
+            parent.slot = layout.slot[PAWN];
+            visit(encode(layout, parent));
+        }
+        parent.piece = position.piece;
+
+        // the piece replaced another one from the reservoir
+        if((position.reservoir / layout.stride[type]) % (layout.reservoir[type] + 1) < (uint64_t) layout.reservoir[type])
+        {
+            parent.reservoir = position.reservoir + layout.stride[type];
+            for(int slot = 0; slot < (int) layout.types.size(); slot++)
+            {
+                parent.slot = slot;
+                if(slot != position.slot)
+                    visit(encode(layout, parent));
+            }
+        }
+    }
+
+    /**
+     * @brief      Runs a pass over a part of the index: the first pass (0)
+     *             marks the illegal positions and the checkmates, pass n finds
+     *             the positions won or lost in n plies among the parents of
+     *             the positions of the part solved in pass n - 1.
+     *
+     * @param[in]  layout  The layout of the table
+     * @param      values  The values of the positions
+     * @param[in]  pass    The pass
+     * @param[in]  begin   The first index of the part
+     * @param[in]  end     One past the last index of the part
+     *
+     * @return     The number of positions solved.
+     */
+    uint64_t solvePart(const TablebaseLayout &layout, atomic<uint8_t> *values, int pass, uint64_t begin, uint64_t end)
+    {
+        uint64_t solved = 0;
+        TbPosition position, parent_position;
+
+        for(uint64_t index = begin; index < end; index++)
+        {
+            if(pass == 0)
+            {
+                decode(layout, index, position);
+
+                uint8_t value = ILLEGAL;
+                if(isLegal(layout, position))
+                {
+                    bool mated = inCheck(layout, position) && forEachChild(layout, position, [](uint64_t) {return false;}) == 0;
+                    value = mated ? 1 : UNSOLVED;
+                    solved += mated;
+                }
+
+                values[index].store(value, memory_order_relaxed);
+                continue;
+            }
+
+            if(values[index].load(memory_order_relaxed) != pass)
+                continue;
+
+            // only a parent of a position solved in the last pass can be
+            // solved in this one: it is won if it has a move to a position
+            // lost in pass - 1 plies, and lost if every move leads to a
+            // position won in fewer plies. The positions solved by the other
+            // threads in this pass are too far (pass plies or more) to count
+            decode(layout, index, position);
+            forEachParent(layout, position, [&](uint64_t parent)
+            {
+                if(values[parent].load(memory_order_relaxed) != UNSOLVED)
+                    return;
+
+                decode(layout, parent, parent_position);
+
+                bool won = false, lost = true;
+                int moves = forEachChild(layout, parent_position, [&](uint64_t child)
+                {
+                    uint8_t value = child == CAPTURE ? UNSOLVED : values[child].load(memory_order_relaxed);
+                    if(value == UNSOLVED || value > pass || (value - 1) % 2 == 0)
+                        lost = false;
+                    if(value == pass && (value - 1) % 2 == 0)
+                        won = true;
+
+                    return !won;
+                });
+
+                // another thread may solve it at the same time (the same way)
+                uint8_t expected = UNSOLVED;
+                if( (won || (lost && moves > 0)) &&
+                    values[parent].compare_exchange_strong(expected, (uint8_t) (pass + 1), memory_order_relaxed) )
+                    solved++;
+            });
+        }
+
+        return solved;
+    }
+
+    /**
+     * @brief      Compresses values into a tablebase file.
+     *
+     * @param[in]  filename  The file
+     * @param[in]  magic     TB_WDL_MAGIC or TB_DTM_MAGIC
+     * @param[in]  material  The name of the table
+     * @param[in]  values    The value of every position
+     *
+     * @return     The size of the file (in bytes), or 0 if it could not be
+     *             written.
+     */
+    uint64_t writeFile(const string &filename, const char *magic, const string &material, const vector<uint8_t> &values)
+    {
+        TablebaseHeader header = {};
+        memcpy(header.magic, magic, sizeof(header.magic));
+        strncpy(header.material, material.c_str(), sizeof(header.material) - 1);
+        header.num_positions = values.size();
+        header.block_size = TB_BLOCK_SIZE;
+        header.num_blocks = (uint32_t) ((values.size() + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE);
+
+        // runs of (value, varint length) that do not cross the blocks
+        vector<uint64_t> offsets;
+        vector<uint8_t> blocks;
+        for(uint64_t index = 0; index < values.size(); )
+        {
+            if(index % TB_BLOCK_SIZE == 0)
+                offsets.push_back(blocks.size());
+
+            uint64_t block_end = min<uint64_t>((index / TB_BLOCK_SIZE + 1) * TB_BLOCK_SIZE, values.size());
+            uint64_t run_end = index + 1;
+            while(run_end < block_end && values[run_end] == values[index])
+                run_end++;
+
+            blocks.push_back(values[index]);
+            for(uint64_t length = run_end - index; ; length >>= 7)
+            {
+                blocks.push_back((uint8_t) ((length & 127) | (length >= 128 ? 128 : 0)));
+                if(length < 128)
+                    break;
+            }
+
+            index = run_end;
+        }
+        offsets.push_back(blocks.size());
+
+        ofstream out(filename, ios::binary | ios::trunc);
+        out.write((const char *) &header, sizeof(header));
+        out.write((const char *) offsets.data(), offsets.size() * sizeof(uint64_t));
+        out.write((const char *) blocks.data(), blocks.size());
+        out.close();
+
+        return out ? sizeof(header) + offsets.size() * sizeof(uint64_t) + blocks.size() : 0;
+    }
+
+    /**
+     * @brief      Maps a tablebase file and checks its header.
+     *
+     * @param      file      The file
+     * @param[in]  filename  The name of the file
+     * @param[in]  magic     TB_WDL_MAGIC or TB_DTM_MAGIC
+     * @param[in]  layout    The layout of the table
+     *
+     * @return     True if the file is a valid file of the table, False
+     *             otherwise.
+     */
+    bool openFile(MappedFile &file, const string &filename, const char *magic, const TablebaseLayout &layout)
+    {
+        if(!file.open(filename) || file.getSize() < sizeof(TablebaseHeader))
+            return false;
+
+        const TablebaseHeader *header = (const TablebaseHeader *) file.getData();
+        uint64_t blocks = (layout.positions + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE;
+        uint64_t start = sizeof(TablebaseHeader) + (blocks + 1) * sizeof(uint64_t);
+        if( memcmp(header->magic, magic, sizeof(header->magic)) != 0 ||
+            strncmp(header->material, layout.material.c_str(), sizeof(header->material)) != 0 ||
+            header->num_positions != layout.positions || header->block_size != TB_BLOCK_SIZE ||
+            header->num_blocks != blocks || file.getSize() < start )
+            return false;
+
+        const uint64_t *offsets = (const uint64_t *) (file.getData() + sizeof(TablebaseHeader));
+        return offsets[blocks] == file.getSize() - start;
+    }
+}
@@ -0,0 +1,224 @@
+/**
+ * \page tbgen Endgame Tablebase Generator Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;tbgen.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;tablebase.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Solves endgame tables and writes their WDL and DTM files, then times random
+ * probes of each table (memory mapped, as the engine probes them). A position
+ * can also be probed in the tables.
+ *
+ * Simply run <b>mingw32-make all_tbgen</b> and then <b>tbgen [options]
+ * MATERIAL...</b>, where MATERIAL is the name of a table (ex. KQvK, KRvK, KPvK
+ * or KBvK+q, see tablebase.h) and the options are:
+ * - <b>--dir DIR</b>: the directory of the files (., created if it does not
+ *   exist);
+ * - <b>--threads N</b>: the number of threads of the generation (all cores);
+ * - <b>--probes N</b>: the number of probes timed per table, and of the
+ *   position (1000000);
+ * - <b>--fen FEN</b>: a position to probe in the tables;
+ * - <b>--no-generate</b>: opens the files of the tables instead of solving
+ *   them.
+ *
+ * The exit code is 2 if a table could not be solved, written or opened.
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+
+#include "tablebase.h"
+
+// included in 'tablebase.h' but good to re-state
+using namespace std;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+}
+
+/**
+ * @brief      Solves (or opens) endgame tables and times their probes.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if every table is ready, 1 for invalid usage, 2 otherwise.
+ */
+int main(int argc, char *argv[])
+{
+    string directory = ".", fen;
+    int num_threads = 0, probes = 1000000;
+    bool generate = true;
+    vector<string> materials;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--no-generate") == 0)
+            generate = false;
+        else if(argv[i][0] != '-')
+            materials.push_back(argv[i]);
+        else if(i + 1 >= argc)
+            return usage();
+        else if(strcmp(argv[i], "--dir") == 0)
+            directory = argv[++i];
+        else if(strcmp(argv[i], "--threads") == 0)
+            num_threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--probes") == 0)
+            probes = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--fen") == 0)
+            fen = argv[++i];
+        else
+            return usage();
+    }
+
+    TablebaseLayout layout;
+    for(const auto & elem : materials)
+        if(!Tablebase::parseMaterial(elem, layout))
+            return usage();
+
+    if(materials.empty() || num_threads < 0 || probes <= 0)
+        return usage();
+
+    std::error_code error;
+    if(generate && !filesystem::is_directory(directory, error) && !filesystem::create_directories(directory, error))
+    {
+        printf("Could not create the directory '%s': %s\n", directory.c_str(), error.message().c_str());
+        return 2;
+    }
+
+    vector<unique_ptr<Tablebase>> tables;
+    for(const auto & elem : materials)
+    {
+        if(generate)
+        {
+            // the statistics are only set once the files were written (or not)
+            TablebaseStats stats = {};
+            errno = 0;
+            if(!Tablebase::generate(elem, directory, num_threads, &stats))
+            {
+                Tablebase::parseMaterial(elem, layout);
+                if(stats.positions == 0)
+                    printf("%s could not be solved\n", elem.c_str());
+                else
+                    printf("Could not write '%s/%s.%s': %s\n", directory.c_str(), layout.material.c_str(),
+                           stats.wdl_bytes == 0 ? "wdl" : "dtm", errno != 0 ? strerror(errno) : "write error");
+                return 2;
+            }
+
+            printf("%-10s positions %llu  legal %llu  wins %llu  losses %llu  draws %llu  longest %d plies  %.2f s\n",
+                   elem.c_str(), (unsigned long long) stats.positions, (unsigned long long) stats.legal,
+                   (unsigned long long) stats.wins, (unsigned long long) stats.losses, (unsigned long long) stats.draws,
+                   stats.longest, stats.seconds);
+            printf("%-10s WDL %llu bytes (%.3f bits/position)  DTM %llu bytes (%.3f bits/position)\n", "",
+                   (unsigned long long) stats.wdl_bytes, 8.0 * stats.wdl_bytes / stats.positions,
+                   (unsigned long long) stats.dtm_bytes, 8.0 * stats.dtm_bytes / stats.positions);
+        }
+
+        tables.emplace_back(new Tablebase);
+        if(!tables.back()->open(directory, elem))
+        {
+            printf("%s could not be opened in %s\n", elem.c_str(), directory.c_str());
+            return 2;
+        }
+
+        // random positions (the illegal ones cost the same)
+        Tablebase &table = *tables.back();
+        mt19937_64 rng(1);
+        vector<uint64_t> indices(probes);
+        for(auto & index : indices)
+            index = rng() % table.getSize();
+
+        TablebaseProbe probe;
+        uint64_t checksum = 0;
+        auto start = chrono::steady_clock::now();
+        for(const auto & index : indices)
+        {
+            table.probeIndex(index, probe, false);
+            checksum += probe.wdl;
+        }
+        double wdl_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / probes;
+
+        start = chrono::steady_clock::now();
+        for(const auto & index : indices)
+        {
+            table.probeIndex(index, probe, true);
+            checksum += probe.dtm;
+        }
+        double dtm_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / probes;
+
+        printf("%-10s probe WDL %.1f ns  WDL+DTM %.1f ns  (checksum %llu)\n", table.getMaterial().c_str(), wdl_ns,
+               dtm_ns, (unsigned long long) checksum);
+    }
+
+    if(!fen.empty())
+    {
+        Chess chess;
+        chess.setHeadless(true);
+        if(!chess.setFromFEN(fen.c_str()))
+            return usage();
+
+        for(const auto & elem : tables)
+        {
+            TablebaseProbe probe;
+            if(!elem->probe(chess, probe))
+                continue;
+
+            // a probe of a position also finds its index on the board
+            auto start = chrono::steady_clock::now();
+            for(int i = 0; i < probes; i++)
+                elem->probe(chess, probe);
+            double probe_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / probes;
+
+            const char *results[3] = {"draw", "win", "loss"};
+            printf("%s: %s for the side to move", elem->getMaterial().c_str(), results[probe.wdl]);
+            if(probe.wdl != TB_DRAW)
+                printf(", checkmate in %d plies", probe.dtm);
+            printf(" (%.1f ns per probe)\n", probe_ns);
+            return 0;
+        }
+
+        printf("The position is not in the tables\n");
+    }
+
+    return 0;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage: tbgen [--dir DIR] [--threads N] [--probes N] [--fen FEN] [--no-generate] MATERIAL...\n");
+        return 1;
+    }
+}
@@ -0,0 +1,184 @@
+/**
+ * \page tuner Evaluation Tuning Command Line Tool
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;tuner.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;tuning.h, engine.h, archive.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Tunes the parameters of the hand-crafted evaluation (material, center bonus
+ * and reservoir percentage) to the results of the games of an archive, and
+ * writes them to a file that arena reads with <b>--eval</b>.
+ *
+ * Simply run <b>mingw32-make all_tuner</b> on a Windows machine and then
+ * <b>tuner games.txt tuned.txt [options]</b>, where the options are:
+ * - <b>--threads N</b>: the number of threads (all cores);
+ * - <b>--iterations N</b>: the number of iterations of the gradient descent
+ *   (200);
+ * - <b>--rate X</b>: the step of each iteration, in units of each parameter
+ *   (2);
+ * - <b>--scale K</b>: the scale of the win probability (fitted to the
+ *   positions if not given);
+ * - <b>--skip-plies N</b>: the first plies of each game that are skipped (8);
+ * - <b>--max-positions N</b>: the most positions loaded (all);
+ * - <b>--start FILE</b>: the parameters to start from (the engine's default
+ *   ones otherwise).
+ *
+ * The loss and the positions per second of every 10th iteration are printed.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "tuning.h"
+
+// included in 'tuning.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DECLARATIONS                          */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Prints the parameters of an evaluation.
+     *
+     * @param[in]  label   The label of the parameters
+     * @param[in]  config  The evaluation
+     */
+    void printParameters(const char *label, const EngineConfig &config);
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage();
+}
+
+/**
+ * @brief      Tunes the evaluation to the games of an archive.
+ *
+ * @param[in]  argc  The number of command line arguments
+ * @param      argv  The command line arguments
+ *
+ * @return     0 if the parameters were written, 1 for invalid usage, 2 if a
+ *             file could not be read or written.
+ */
+int main(int argc, char *argv[])
+{
+    if(argc < 3)
+        return usage();
+
+    int num_threads = 0;
+    string start_file;
+    TuningOptions options;
+
+    for(int i = 3; i < argc; i++)
+    {
+        if(i + 1 >= argc)
+            return usage();
+        else if(strcmp(argv[i], "--threads") == 0)
+            num_threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--iterations") == 0)
+            options.iterations = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--rate") == 0)
+            options.learning_rate = atof(argv[++i]);
+        else if(strcmp(argv[i], "--scale") == 0)
+            options.scale = atof(argv[++i]);
+        else if(strcmp(argv[i], "--skip-plies") == 0)
+            options.skip_plies = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--max-positions") == 0)
+            options.max_positions = strtoull(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--start") == 0)
+            start_file = argv[++i];
+        else
+            return usage();
+    }
+
+    EngineConfig config;
+    if(!start_file.empty() && !readEvaluation(start_file, config))
+    {
+        printf("'%s' is not an evaluation file\n", start_file.c_str());
+        return 2;
+    }
+
+    EvalTuner tuner(num_threads);
+    TuningStats stats;
+    if(!tuner.load(argv[1], options, &stats))
+    {
+        printf("Could not read the archive '%s'\n", argv[1]);
+        return 2;
+    }
+
+    printf("Games:      %llu (%llu invalid, %llu unfinished)\n", (unsigned long long) stats.games,
+           (unsigned long long) stats.invalid, (unsigned long long) stats.unfinished);
+    printf("Positions:  %llu in %.1f MB, loaded in %.3f s (%.0f positions/s)\n", (unsigned long long) stats.positions,
+           stats.positions * sizeof(TuningPosition) / 1e6, stats.seconds, stats.seconds > 0 ? stats.positions / stats.seconds : 0.0);
+    if(stats.positions == 0)
+        return 2;
+
+    double parameters[TUNING_PARAMETERS];
+    EvalTuner::toParameters(config, parameters);
+    if(options.scale <= 0)
+        options.scale = tuner.fitScale(parameters);
+    printf("Scale K:    %.4f\n", options.scale);
+    printParameters("Start:", config);
+
+    double total_rate = 0;
+    tuner.tune(config, options, [&](const TuningIteration &state)
+    {
+        total_rate += state.positions_per_second;
+        if(state.iteration % 10 == 0 || state.iteration == options.iterations)
+            printf("Iteration %4d  loss %.6f  %12.0f positions/s\n", state.iteration, state.loss, state.positions_per_second);
+    });
+    printf("Average:    %.0f positions/s per iteration\n", total_rate / (options.iterations + 1));
+    printParameters("Tuned:", config);
+
+    if(!writeEvaluation(argv[2], config))
+    {
+        printf("Could not write the parameters to '%s'\n", argv[2]);
+        return 2;
+    }
+
+    return 0;
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTION DEFINITIONS                           */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Prints the parameters of an evaluation.
+     *
+     * @param[in]  label   The label of the parameters
+     * @param[in]  config  The evaluation
+     */
+    void printParameters(const char *label, const EngineConfig &config)
+    {
+        printf("%-11s material %d %d %d %d %d  center_bonus %d  reservoir_percent %d\n", label, config.material[0], config.material[1],
+               config.material[2], config.material[3], config.material[4], config.center_bonus, config.reservoir_percent);
+    }
+
+    /**
+     * @brief      Prints how to use the tool.
+     *
+     * @return     1 (the exit code for invalid usage)
+     */
+    int usage()
+    {
+        printf("Usage: tuner <archive> <output> [--threads N] [--iterations N] [--rate X] [--scale K]\n"
+               "             [--skip-plies N] [--max-positions N] [--start FILE]\n");
+        return 1;
+    }
+}
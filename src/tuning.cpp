@@ -0,0 +1,548 @@
+/**
+ * \page tuning Evaluation Tuning Implementation File
+ *
+ * <b>Title</b><br>
+ * <span>&emsp;&emsp;&emsp;tuning.cpp </span>
+ * \author Lior Bragilevsky<br>
+ *
+ * <b>Related</b><br>
+ * <span>&emsp;&emsp;&emsp;tuning.h</span><br>
+ *
+ * <b>Project</b><br>
+ * <span>&emsp;&emsp;&emsp;chessCAMO</span><br>
+ * \version \version_num
+ * \date \today
+ *
+ * Loading the labeled positions of an archive, the loss and gradient of the
+ * evaluation over them, and the gradient descent (see tuning.h).
+ */
+
+#include "tuning.h"
+#include "archive.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+// included in 'tuning.h' but good to re-state
+using namespace std;
+using namespace chessCAMO;
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /** The number of games a thread takes from the archive at a time */
+    const size_t GAME_BATCH = 64;
+
+    /** The index of the center bonus and of the reservoir percentage in the
+     *  parameters (after the material of each piece type) */
+    const int CENTER_PARAMETER = 5, RESERVOIR_PARAMETER = 6;
+
+    /**
+     * @brief      Adds the loss and gradient of some positions.
+     *
+     * @param[in]  positions   The positions
+     * @param[in]  begin       The first position
+     * @param[in]  end         The position after the last one
+     * @param[in]  parameters  The parameters
+     * @param[in]  scale       The scale K of the win probability
+     * @param      gradient    The gradient, added to (can be nullptr)
+     *
+     * @return     The sum of the squared errors of the positions.
+     */
+    double sumLoss(const vector<TuningPosition> &positions, size_t begin, size_t end,
+                   const double parameters[TUNING_PARAMETERS], double scale, double gradient[TUNING_PARAMETERS]);
+} // unnamed namespace (makes these functions local to this implementation file)
+
+/*************************************************************************************/
+/*                              EVALUATION TUNER - MEMBER FUNCTIONS                  */
+/*************************************************************************************/
+/**
+ * @brief      Constructs a new instance with no positions.
+ *
+ * @param[in]  num_threads  The number of threads of the loss and gradient
+ *                          computation (0 uses all cores)
+ */
+EvalTuner::EvalTuner(int num_threads)
+    : num_threads{num_threads > 0 ? num_threads : (int) max(1u, thread::hardware_concurrency())}
+{
+}
+
+/**
+ * @brief      Loads the positions of the finished games of an archive. Games
+ *             are replayed on the threads of the tuner (each with its own
+ *             headless Chess object) into their own positions, which are
+ *             appended to the positions already loaded.
+ *
+ * @param[in]  archive_file  The game archive (see archive.h)
+ * @param[in]  options       The settings of loading (skip_plies and
+ *                           max_positions)
+ * @param      stats         The outcome of loading (can be nullptr)
+ *
+ * @return     True if the archive was read, False otherwise.
+ */
+bool EvalTuner::load(const string &archive_file, const TuningOptions &options, TuningStats *stats)
+{
+    auto start = chrono::steady_clock::now();
+
+    MappedFile archive;
+    if(!archive.open(archive_file))
+        return false;
+
+    const char *data = archive.getData();
+    size_t size = archive.getSize();
+    vector<uint64_t> games = findGames(data, size);
+
+    // each batch of games has its own positions, and the batches are taken in
+    // order, so the positions are in the order of the archive once they are
+    // put together (and a limit keeps the first ones)
+    vector<vector<TuningPosition>> batches((games.size() + GAME_BATCH - 1) / GAME_BATCH);
+    atomic<size_t> next_game{0};
+    atomic<uint64_t> loaded{0};
+    vector<uint64_t> invalid(num_threads, 0), unfinished(num_threads, 0);
+    vector<thread> threads;
+
+    for(int t = 0; t < num_threads; t++)
+    {
+        threads.emplace_back([&, t]()
+        {
+            Chess chess;
+            chess.setHeadless(true);
+
+            GameRecord game;
+            EvalTuner batch_tuner(1);
+
+            for(size_t first = next_game.fetch_add(GAME_BATCH); first < games.size(); first = next_game.fetch_add(GAME_BATCH))
+            {
+                if(options.max_positions > 0 && loaded >= options.max_positions)
+                    break;
+
+                for(size_t g = first; g < min(first + GAME_BATCH, games.size()); g++)
+                {
+                    const char *line = data + games[g];
+                    const char *end = (const char *) memchr(line, '\n', size - games[g]);
+                    string text(line, end == nullptr ? data + size : end);
+
+                    if(!parseGame(text, game))
+                    {
+                        invalid[t]++;
+                        continue;
+                    }
+
+                    int result = game.result == "1-0" ? 2 : game.result == "0-1" ? 0 : game.result == "1/2-1/2" ? 1 : -1;
+                    if(result < 0)
+                    {
+                        unfinished[t]++;
+                        continue;
+                    }
+
+                    // the positions in check are skipped, since their score
+                    // depends on the reply more than on the material
+                    int replayed = replayGame(chess, game, [&](const Chess &position, int ply)
+                    {
+                        if(ply >= options.skip_plies && !position.getCheck())
+                            batch_tuner.addPosition(position, result);
+                    });
+
+                    if(replayed != (int) game.moves.size())
+                        invalid[t]++;
+                }
+
+                loaded += batch_tuner.positions.size();
+                batches[first / GAME_BATCH].swap(batch_tuner.positions);
+                batch_tuner.positions.clear();
+            }
+        });
+    }
+
+    for(auto & elem : threads)
+        elem.join();
+
+    size_t before = positions.size();
+    for(const auto & batch : batches)
+        positions.insert(positions.end(), batch.begin(), batch.end());
+
+    if(options.max_positions > 0 && positions.size() - before > options.max_positions)
+        positions.resize(before + options.max_positions);
+    positions.shrink_to_fit();
+
+    if(stats != nullptr)
+    {
+        stats->games = games.size();
+        stats->invalid = stats->unfinished = 0;
+        for(int t = 0; t < num_threads; t++)
+        {
+            stats->invalid += invalid[t];
+            stats->unfinished += unfinished[t];
+        }
+        stats->positions = positions.size() - before;
+        stats->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Adds a labeled position.
+ *
+ * @param[in]  chess   The chess object
+ * @param[in]  result  The result of its game for white, in half points (2 for
+ *                     a win, 1 for a draw, 0 for a loss)
+ */
+void EvalTuner::addPosition(const Chess &chess, int result)
+{
+    TuningPosition position = {};
+    position.result = (uint8_t) result;
+
+    for(int square = 0; square < 64; square++)
+    {
+        const Piece *piece = chess.getPiece(square);
+        pieceType type = piece->getPieceType();
+        if(type == EMPTY || type == KING)
+            continue;
+
+        int sign = piece->getPieceColor() == WHITE ? 1 : -1;
+        position.board[type] += sign;
+
+        // 6 steps from the corners in the four center squares (see
+        // Engine::evaluate())
+        int file = square % 8, rank = square / 8;
+        if(type == PAWN || type == KNIGHT || type == BISHOP)
+            position.center += sign * (6 - max(3 - file, file - 4) - max(3 - rank, rank - 4));
+    }
+
+    // slots 0 to 4 are black's p, n, b, r, q and 5 to 9 white's
+    for(int slot = 0; slot < 10; slot++)
+        position.reservoir[slot % 5] += (slot < 5 ? -1 : 1) * chess.getReservoirCount(slot);
+
+    positions.push_back(position);
+}
+
+/**
+ * @brief      Computes the score of a position for white (as the engine does,
+ *             without its rounding).
+ *
+ * @param[in]  position    The position
+ * @param[in]  parameters  The parameters (see toParameters())
+ *
+ * @return     The score in centipawns.
+ */
+double EvalTuner::evaluate(const TuningPosition &position, const double parameters[TUNING_PARAMETERS])
+{
+    double score = parameters[CENTER_PARAMETER] * position.center;
+    for(int type = PAWN; type <= QUEEN; type++)
+        score += parameters[type] * (position.board[type] + position.reservoir[type] * parameters[RESERVOIR_PARAMETER] / 100);
+
+    return score;
+}
+
+/**
+ * @brief      Computes the mean squared error of the parameters over all
+ *             positions, and its gradient, on the threads of the tuner.
+ *
+ * @param[in]  parameters  The parameters
+ * @param[in]  scale       The scale K of the win probability
+ * @param      gradient    The gradient of the error (can be nullptr)
+ *
+ * @return     The mean squared error (0 without positions).
+ */
+double EvalTuner::loss(const double parameters[TUNING_PARAMETERS], double scale, double gradient[TUNING_PARAMETERS]) const
+{
+    if(gradient != nullptr)
+        fill(gradient, gradient + TUNING_PARAMETERS, 0.0);
+    if(positions.empty())
+        return 0;
+
+    // each thread sums its own share into its own gradient, and the sums are
+    // added in thread order (the same for every call)
+    int threads_used = (int) min((size_t) num_threads, positions.size());
+    vector<double> sums(threads_used, 0.0);
+    vector<array<double, TUNING_PARAMETERS>> gradients(threads_used);
+    vector<thread> threads;
+
+    auto work = [&](int t)
+    {
+        size_t begin = positions.size() * t / threads_used, end = positions.size() * (t + 1) / threads_used;
+        gradients[t].fill(0.0);
+        sums[t] = sumLoss(positions, begin, end, parameters, scale, gradient != nullptr ? gradients[t].data() : nullptr);
+    };
+
+    for(int t = 1; t < threads_used; t++)
+        threads.emplace_back(work, t);
+    work(0);
+
+    for(auto & elem : threads)
+        elem.join();
+
+    double total = 0;
+    for(int t = 0; t < threads_used; t++)
+    {
+        total += sums[t];
+        for(int i = 0; i < TUNING_PARAMETERS && gradient != nullptr; i++)
+            gradient[i] += gradients[t][i];
+    }
+
+    for(int i = 0; i < TUNING_PARAMETERS && gradient != nullptr; i++)
+        gradient[i] /= positions.size();
+
+    return total / positions.size();
+}
+
+/**
+ * @brief      Finds the scale K of the win probability with the smallest error
+ *             for some parameters.
+ *
+ * @param[in]  parameters  The parameters
+ *
+ * @return     The scale (in [0.1, 5]).
+ */
+double EvalTuner::fitScale(const double parameters[TUNING_PARAMETERS]) const
+{
+    // golden section search (the error has a single minimum in K)
+    const double ratio = (sqrt(5.0) - 1) / 2;
+    double low = 0.1, high = 5.0;
+    double a = high - ratio * (high - low), b = low + ratio * (high - low);
+    double loss_a = loss(parameters, a), loss_b = loss(parameters, b);
+
+    for(int step = 0; step < 40; step++)
+    {
+        if(loss_a < loss_b)
+        {
+            high = b;
+            b = a;
+            loss_b = loss_a;
+            a = high - ratio * (high - low);
+            loss_a = loss(parameters, a);
+        }
+        else
+        {
+            low = a;
+            a = b;
+            loss_a = loss_b;
+            b = low + ratio * (high - low);
+            loss_b = loss(parameters, b);
+        }
+    }
+
+    return (low + high) / 2;
+}
+
+/**
+ * @brief      Tunes the parameters of an evaluation with a gradient descent
+ *             (Adam) over all positions.
+ *
+ * @param      config    The evaluation, whose parameters are tuned (rounded to
+ *                       whole values)
+ * @param[in]  options   The settings of tuning (iterations, learning_rate and
+ *                       scale)
+ * @param[in]  progress  Called after each iteration (can be nullptr)
+ *
+ * @return     The mean squared error of the tuned parameters.
+ */
+double EvalTuner::tune(EngineConfig &config, const TuningOptions &options,
+                       const function<void(const TuningIteration &)> &progress) const
+{
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+
+    TuningIteration state;
+    toParameters(config, state.parameters);
+    double scale = options.scale > 0 ? options.scale : fitScale(state.parameters);
+
+    // Adam: each parameter moves about 'learning_rate' per iteration in the
+    // direction of its averaged gradient, whatever the size of its terms
+    double gradient[TUNING_PARAMETERS], moment[TUNING_PARAMETERS] = {}, second[TUNING_PARAMETERS] = {};
+
+    for(state.iteration = 0; ; state.iteration++)
+    {
+        auto start = chrono::steady_clock::now();
+        state.loss = loss(state.parameters, scale, gradient);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        state.positions_per_second = seconds > 0 ? positions.size() / seconds : 0;
+
+        if(progress)
+            progress(state);
+        if(state.iteration >= options.iterations)
+            break;
+
+        int step = state.iteration + 1;
+        for(int i = 0; i < TUNING_PARAMETERS; i++)
+        {
+            moment[i] = beta1 * moment[i] + (1 - beta1) * gradient[i];
+            second[i] = beta2 * second[i] + (1 - beta2) * gradient[i] * gradient[i];
+
+            double corrected = moment[i] / (1 - pow(beta1, step)), spread = second[i] / (1 - pow(beta2, step));
+            state.parameters[i] -= options.learning_rate * corrected / (sqrt(spread) + epsilon);
+        }
+    }
+
+    fromParameters(state.parameters, config);
+    return state.loss;
+}
+
+/**
+ * @brief      Reads the parameters of an evaluation.
+ *
+ * @param[in]  config      The evaluation
+ * @param      parameters  The parameters: the material of each piece type,
+ *                         the center bonus and the reservoir percentage
+ */
+void EvalTuner::toParameters(const EngineConfig &config, double parameters[TUNING_PARAMETERS])
+{
+    for(int type = PAWN; type <= QUEEN; type++)
+        parameters[type] = config.material[type];
+
+    parameters[CENTER_PARAMETER] = config.center_bonus;
+    parameters[RESERVOIR_PARAMETER] = config.reservoir_percent;
+}
+
+/**
+ * @brief      Sets the parameters of an evaluation (rounded to whole values).
+ *
+ * @param[in]  parameters  The parameters (see toParameters())
+ * @param      config      The evaluation
+ */
+void EvalTuner::fromParameters(const double parameters[TUNING_PARAMETERS], EngineConfig &config)
+{
+    for(int type = PAWN; type <= QUEEN; type++)
+        config.material[type] = (int) lround(parameters[type]);
+
+    config.center_bonus = (int) lround(parameters[CENTER_PARAMETER]);
+    config.reservoir_percent = (int) lround(parameters[RESERVOIR_PARAMETER]);
+}
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+namespace chessCAMO
+{
+    /**
+     * @brief      Writes the parameters of an evaluation to a text file, one
+     *             "name values" line per parameter (ex. "material 100 320 330
+     *             500 900").
+     *
+     * @param[in]  filename  The file
+     * @param[in]  config    The evaluation
+     *
+     * @return     True if the file was written, False otherwise.
+     */
+    bool writeEvaluation(const string &filename, const EngineConfig &config)
+    {
+        ofstream out(filename, ios::trunc);
+        out << "# chessCAMO evaluation (pawn, knight, bishop, rook and queen values in centipawns)\n";
+        out << "material";
+        for(int type = PAWN; type <= QUEEN; type++)
+            out << " " << config.material[type];
+        out << "\ncenter_bonus " << config.center_bonus
+            << "\nreservoir_percent " << config.reservoir_percent << "\n";
+
+        return (bool) out;
+    }
+
+    /**
+     * @brief      Reads the parameters of an evaluation from a text file (see
+     *             writeEvaluation()). Lines starting with '#' are comments,
+     *             and the parameters missing from the file are not changed.
+     *
+     * @param[in]  filename  The file
+     * @param      config    The evaluation
+     *
+     * @return     True if the file was read, False if it could not be opened
+     *             or has an unknown or malformed line (the evaluation is then
+     *             not changed).
+     */
+    bool readEvaluation(const string &filename, EngineConfig &config)
+    {
+        ifstream in(filename);
+        if(!in)
+            return false;
+
+        EngineConfig read = config;
+        string line, name, rest;
+        while(getline(in, line))
+        {
+            istringstream fields(line);
+            if(!(fields >> name) || name[0] == '#')
+                continue;
+
+            bool valid;
+            if(name == "material")
+            {
+                valid = true;
+                for(int type = PAWN; type <= QUEEN; type++)
+                    valid = valid && (fields >> read.material[type]);
+            }
+            else if(name == "center_bonus")
+                valid = (bool) (fields >> read.center_bonus);
+            else if(name == "reservoir_percent")
+                valid = (bool) (fields >> read.reservoir_percent);
+            else
+                valid = false;
+
+            if(!valid || (fields >> rest))
+                return false;
+        }
+
+        config = read;
+        return true;
+    }
+}
+
+/*************************************************************************************/
+/*                              LOCAL FUNCTIONS / OBJECTS                            */
+/*************************************************************************************/
+namespace
+{
+    /**
+     * @brief      Adds the loss and gradient of some positions.
+     *
+     * @param[in]  positions   The positions
+     * @param[in]  begin       The first position
+     * @param[in]  end         The position after the last one
+     * @param[in]  parameters  The parameters
+     * @param[in]  scale       The scale K of the win probability
+     * @param      gradient    The gradient, added to (can be nullptr)
+     *
+     * @return     The sum of the squared errors of the positions.
+     */
+    double sumLoss(const vector<TuningPosition> &positions, size_t begin, size_t end,
+                   const double parameters[TUNING_PARAMETERS], double scale, double gradient[TUNING_PARAMETERS])
+    {
+        // the win probability is 1 / (1 + e^(-k * score)) with k = K ln(10) / 400
+        const double k = scale * log(10.0) / 400;
+        double sum = 0;
+
+        for(size_t i = begin; i < end; i++)
+        {
+            const TuningPosition &position = positions[i];
+            double probability = 1 / (1 + exp(-k * EvalTuner::evaluate(position, parameters)));
+            double error = probability - position.result / 2.0;
+            sum += error * error;
+
+            if(gradient == nullptr)
+                continue;
+
+            // the derivative of the squared error with respect to the score,
+            // then to each parameter
+            double slope = 2 * error * probability * (1 - probability) * k, reservoir_value = 0;
+            for(int type = PAWN; type <= QUEEN; type++)
+            {
+                gradient[type] += slope * (position.board[type] + position.reservoir[type] * parameters[RESERVOIR_PARAMETER] / 100);
+                reservoir_value += position.reservoir[type] * parameters[type] / 100;
+            }
+
+            gradient[CENTER_PARAMETER] += slope * position.center;
+            gradient[RESERVOIR_PARAMETER] += slope * reservoir_value;
+        }
+
+        return sum;
+    }
+}
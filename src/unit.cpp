@@ -35,7 +35,10 @@
  *        Make sure to not end on a blank line to avoid unnecessary warnings from the algorithm;
  *     5. Name the file a meaningful name according to what is being tested.
  *        E.g. to check if a given piece (Queen) delivers a checkmate <span>&rarr;</span> <i>queenCheckmate.txt</i>;
- *     6. Place test case files in a folder named <b>./tests/</b> (used by the algorithm).
+ *     6. Place test case files in a folder named <b>./tests/</b> (used by the algorithm). Every file of
+ *        this folder is picked up by the <i>ScriptTest</i> suite (one test per file, named after it),
+ *        so no code has to be added. The files are replayed concurrently, each on its own headless
+ *        Chess object, and the replay time of each file is printed at the end of the suite.
 
  * \note
  *     - There is no draw or resign functionality here since this is meant for quick testing.
@@ -46,9 +49,34 @@
 */
 
 #include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <new>
+#include <random>
+#include <thread>
 #include <gtest/gtest.h>
 
 #include "chess.h"
+#include "archive.h"
+#include "index.h"
+#include "match.h"
+#include "analysis.h"
+#include "game_store.h"
+#include "gui_state.h"
+#include "game_batch.h"
+#include "mcts.h"
+#include "resident_games.h"
+#include "tablebase.h"
+#include "book.h"
+#include "nnue.h"
+#include "tuning.h"
+#include "selfplay.h"
+#include "bench.h"
 
 // included in 'chess.h' but good to re-state
 using namespace std;
@@ -63,9 +91,10 @@ class ChessTest;
 namespace
 {
     /**
-     * @brief      Converts a given board position into a <a
+     * @brief      Converts a given board position into the <a
      *             href="https://en.wikipedia.org/wiki/Forsyth%E2%80%93Edwards_Notation"
-     *             target="__blank">FEN</a> string representation
+     *             target="__blank">FEN</a> string representation used at the
+     *             top of the test case files
      *
      * @param      chess  The chess object
      *
@@ -73,27 +102,151 @@ namespace
      *
      * @post       None
      *
-     * @return     The FEN string based on piece type and common FEN making rules
+     * @return     The piece placement, turn and castling fields of
+     *             Chess::toFEN() (without the piece reservoir)
      */
     string boardFenConverter(Chess &chess);
 
     /**
-     * @brief      Decides what type of character to append to the formed FEN string
+     * @brief      Finds the test case files in the <b>./tests/</b> folder.
      *
-     * @param      fen          The FEN string that characters will be appended to
-     *                          (can be empty)
-     * @param      empty_count  The number of empty squares found in the current row
-     * @param[in]  next_char    The next character to append to 'fen', must be one
-     *                          of P, N, B, Q, K (upper case)
-     * @param[in]  isWhite      True if the passed piece is white, False otherwise.
-     *                          Used to determine piece's letter case in 'fen'.
+     * @return     The paths of the files, in name order.
+     */
+    vector<string> discoverScripts();
+
+    /**
+     * @brief      Converts a test case file into a test name (e.g.
+     *             tests/04-castleKingSide.txt becomes 04_castleKingSide).
+     *
+     * @param[in]  info  The parameter (path) of the test
+     *
+     * @return     The test name.
+     */
+    string scriptName(const ::testing::TestParamInfo<string> &info);
+
+    /** The number of allocations made by the calling thread (see operator
+     *  new), so a test can count its own */
+    thread_local size_t heap_allocations = 0;
+
+    /**
+     * @brief      Allocates a counted block.
+     *
+     * @param[in]  size  The number of bytes
      *
-     * @pre        An empty 'fen' string
+     * @return     The block, or nullptr if there is no memory.
+     *
+     * @note       This and countedFree() are not inlined, so the compiler does
+     *             not take their malloc() and free() for a mismatch of the
+     *             operator new and delete inlined in the library code.
+     */
+    __attribute__((noinline)) void * countedAlloc(size_t size);
+
+    /**
+     * @brief      Frees a counted block.
      *
-     * @post       Appends 'next_char' to 'fen' and returns updated variables by
-     *             reference
+     * @param      block  The block (can be nullptr)
+     */
+    __attribute__((noinline)) void countedFree(void *block);
+
+    /**
+     * @brief      This struct describes a value of a Mailbox whose copy can be
+     *             held up, to stop either side of the mailbox in the middle
+     *             of a post or a take.
      */
-    void appendFEN(string & fen, int & empty_count, char next_char, bool isWhite);
+    struct HeldValue
+    {
+        /** The value */
+        int value = 0;
+
+        /** Copying the value waits while it is set (never if nullptr) */
+        const atomic<bool> *hold = nullptr;
+
+        /** Set when a copy starts waiting */
+        atomic<bool> *waiting = nullptr;
+
+        /**
+         * @brief      Copies a value, waiting while its hold flag is set.
+         *
+         * @param[in]  other  The value
+         *
+         * @return     The value.
+         */
+        HeldValue & operator=(const HeldValue &other)
+        {
+            value = other.value;
+            hold = other.hold;
+            waiting = other.waiting;
+
+            if(hold && hold->load())
+            {
+                *waiting = true;
+                while(hold->load())
+                    this_thread::yield();
+            }
+
+            return *this;
+        }
+    };
+}
+
+/*************************************************************************************/
+/*                              GLOBAL FUNCTIONS / OBJECTS                           */
+/*************************************************************************************/
+/**
+ * @brief      Allocates memory (counted per thread).
+ *
+ * @param[in]  size  The number of bytes
+ *
+ * @return     The memory.
+ */
+void * operator new(size_t size)
+{
+    void *block = countedAlloc(size);
+    if(block == nullptr)
+        throw bad_alloc();
+    return block;
+}
+
+/**
+ * @brief      Allocates memory (counted per thread), without throwing.
+ *
+ * @param[in]  size  The number of bytes
+ *
+ * @return     The memory, or nullptr if there is none.
+ */
+void * operator new(size_t size, const nothrow_t &) noexcept
+{
+    return countedAlloc(size);
+}
+
+/**
+ * @brief      Frees memory.
+ *
+ * @param      block  The memory
+ */
+void operator delete(void *block) noexcept
+{
+    countedFree(block);
+}
+
+/**
+ * @brief      Frees memory, when its size is known.
+ *
+ * @param      block  The memory
+ */
+void operator delete(void *block, size_t) noexcept
+{
+    countedFree(block);
+}
+
+/**
+ * @brief      Frees memory allocated without throwing.
+ *
+ * @param      block  The memory
+ */
+void operator delete(void *block, const nothrow_t &) noexcept
+{
+    countedFree(block);
 }
 
 /*************************************************************************************/
@@ -189,6 +342,95 @@ protected:
     void TearDown() override { cout.clear(); } // enable output again
 };
 
+/**
+ * @brief      This class describes a data-driven test for the files in the
+ *             <b>./tests/</b> folder (one test per file). Before the first
+ *             test, every file is replayed concurrently on its own headless
+ *             Chess object, so that the tests only compare the results.
+ */
+class ScriptTest : public ::testing::TestWithParam<string>
+{
+protected:
+    /**
+     * @brief      The outcome of replaying a test case file.
+     */
+    struct Result
+    {
+        /// Expected FEN string (first line of the file)
+        string fen_expected;
+
+        /// Obtained FEN string after the moves of the file are made
+        string fen_obtained;
+
+        /// The time it took to replay the file (in milliseconds)
+        double ms;
+    };
+
+    /// The outcome of each test case file (by path)
+    static map<string, Result> results;
+
+    /// The time it took to replay all the files (in milliseconds)
+    static double total_ms;
+
+    /**
+     * @brief      Replays every test case file on a pool of threads, each
+     *             with its own headless chess object.
+     */
+    static void SetUpTestSuite()
+    {
+        vector<string> scripts = discoverScripts();
+        vector<Result> replayed(scripts.size());
+        atomic<size_t> next_script{0};
+        vector<thread> threads;
+
+        auto start = chrono::steady_clock::now();
+        for(unsigned int t = 0; t < max(1u, thread::hardware_concurrency()); t++)
+        {
+            threads.emplace_back([&]()
+            {
+                Chess chess;
+                chess.setHeadless(true);
+
+                for(size_t i = next_script++; i < scripts.size(); i = next_script++)
+                {
+                    auto script_start = chrono::steady_clock::now();
+                    ifstream script(scripts[i]);
+
+                    replayScript(chess, script, replayed[i].fen_expected);
+                    replayed[i].fen_obtained = chess.toFEN();
+                    replayed[i].ms = chrono::duration<double, milli>(chrono::steady_clock::now() - script_start).count();
+                }
+            });
+        }
+
+        for(auto & elem : threads)
+            elem.join();
+        total_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        for(size_t i = 0; i < scripts.size(); i++)
+            results[scripts[i]] = replayed[i];
+    }
+
+    /**
+     * @brief      Prints the replay time of each test case file.
+     */
+    static void TearDownTestSuite()
+    {
+        double sum_ms = 0;
+        for(const auto & elem : results)
+        {
+            printf("[   TIME   ] %-50s %8.3f ms\n", elem.first.c_str(), elem.second.ms);
+            sum_ms += elem.second.ms;
+        }
+
+        printf("[   TIME   ] %zu files replayed in %.3f ms (%.3f ms of replay time)\n", results.size(), total_ms, sum_ms);
+        results.clear();
+    }
+};
+
+map<string, ScriptTest::Result> ScriptTest::results;
+double ScriptTest::total_ms = 0;
+
 
 /*************************************************************************************/
 /*                                       TESTS                                       */
@@ -230,860 +472,1802 @@ TEST_F(ChessTest, stringInputsNDrawFeaturesForCoverage)
     EXPECT_EQ(fen_expected, fen_obtained);
 }
 
-TEST_F(ChessTest, castleAfterKingMoved)
+TEST_F(ChessTest, pieceReservoirForCoverage)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/01-castleAfterKingMoved.txt");
+    ifstream myfile("tests/56-pieceReservoirForCoverage.txt");
     SetUp(myfile);
 
-    // -------------------- Act --------------------
+    // -------------------- Act -------------------- 
     fen_obtained = boardFenConverter(chess);
 
     // ------------------- Assert ------------------
     EXPECT_EQ(fen_expected, fen_obtained);
 }
 
-TEST_F(ChessTest, castleAfterKingSideRookMoved)
+TEST_P(ScriptTest, reachesExpectedPosition)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/02-castleAfterKingSideRookMoved.txt");
-    SetUp(myfile);
-
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    const Result &result = results.at(GetParam());
+    RecordProperty("replay_us", (int) (result.ms * 1000));
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(matchesFEN(result.fen_expected, result.fen_obtained)) << "expected: " << result.fen_expected << "\n"
+                                                                      << "obtained: " << result.fen_obtained;
 }
 
-TEST_F(ChessTest, castleAfterQueenSideRookMoved)
+INSTANTIATE_TEST_SUITE_P(tests, ScriptTest, ::testing::ValuesIn(discoverScripts()), scriptName);
+
+TEST_F(ChessTest, fenStartPosition)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/03-castleAfterQueenSideRookMoved.txt");
-    SetUp(myfile);
+    cout.setstate(std::ios_base::failbit); // surpress output
+    chess.boardInit();
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    fen_obtained = chess.toFEN();
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(fen_obtained, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR[QRBBNNPPPPqrbbnnpppp] w KQkq - 0 1");
 }
 
-TEST_F(ChessTest, castleKingSide)
+TEST_F(ChessTest, fenRoundTrip)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/04-castleKingSide.txt");
-    SetUp(myfile);
+    fen_expected = "r3k2r/ppp2ppp/2n5/3pP3/8/8/PPP2PPP/R3K2R[QNPPqp] w Kq d6 12 40";
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    bool loaded = chess.setFromFEN(fen_expected);
+    fen_obtained = chess.toFEN();
 
     // ------------------- Assert ------------------
+    EXPECT_TRUE(loaded);
     EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(chess.getTurn(), WHITE);
+    EXPECT_EQ(chess.getNumMoves(), 78);
+    EXPECT_EQ(chess.getHalfmoveClock(), 12);
+    EXPECT_EQ(chess.getReservoir()[5].first, 2); // white pawns
+    EXPECT_EQ(chess.getReservoir()[6].first, 1); // white knights
+    EXPECT_EQ(chess.getReservoir()[4].first, 1); // black queens
+    EXPECT_EQ(chess.getReservoir()[3].first, 0); // black rooks
 }
 
-TEST_F(ChessTest, castleQueenSide)
+TEST_F(ChessTest, fenWithoutOptionalFields)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/05-castleQueenSide.txt");
-    SetUp(myfile);
+    fen_expected = "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq";
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    bool loaded = chess.setFromFEN(fen_expected);
+    fen_obtained = chess.toFEN();
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(loaded);
+    EXPECT_EQ(fen_obtained, "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR[QRBBNNPPPPqrbbnnpppp] w KQkq - 0 1");
 }
 
-TEST_F(ChessTest, kingMoveIntoCheck)
+TEST_F(ChessTest, fenContinueGameWithEnPassant)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/06-kingMoveIntoCheck.txt");
-    SetUp(myfile);
+    cout.setstate(std::ios_base::failbit); // surpress output
+    istringstream promotion("q");
+    chess.setFromFEN("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR[QRBBNNPPPPqrbbnnpppp] w KQkq f6 0 3");
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    bool moved = chess.makeMove(chessCAMO::preProcessInput(string("e5")), chessCAMO::preProcessInput(string("f6")), promotion);
+    fen_obtained = chess.toFEN();
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(moved);
+    EXPECT_EQ(fen_obtained, "rnbqkbnr/ppp1p1pp/5P2/3p4/8/8/PPPP1PPP/RNBQKBNR[QRBBNNPPPPqrbbnnpppp] b KQkq - 0 3");
 }
 
-TEST_F(ChessTest, queenMate)
+TEST_F(ChessTest, fenCheckInformation)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/07-queenMate.txt");
-    SetUp(myfile);
+    // white king on e1 is attacked by the queen on b4 and the knight on d3
+    string single_check = "4k3/8/8/8/1q6/8/8/4K3 w - - 0 1";
+    string double_check = "4k3/8/8/8/1q6/3n4/8/4K3 w - - 0 1";
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    chess.setFromFEN(single_check);
+    bool check = chess.getCheck() && !chess.getDoubleCheck();
+    chess.setFromFEN(double_check);
+    bool double_checked = chess.getDoubleCheck();
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(check);
+    EXPECT_TRUE(double_checked);
 }
 
-TEST_F(ChessTest, queenCheckKingMoves)
+TEST_F(ChessTest, fenInvalidStrings)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/08-queenCheckKingMoves.txt");
-    SetUp(myfile);
+    string invalid[] = {"", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq",               // missing ranks
+                        "rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq",            // too many squares
+                        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQQBNR w KQkq",            // missing white king
+                        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR[QX] w KQkq",        // unknown reservoir piece
+                        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq",            // unknown side to move
+                        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e4 0 1",     // wrong en-passant rank
+                        "rnbqkbnP/pppppppp/8/8/8/8/PPPPPPP1/RNBQKBNR w KQkq"};           // pawn on the last rank
+    chess.setFromFEN("4k3/8/8/8/8/8/8/4K3[Qq] b - - 3 20");
+    fen_expected = chess.toFEN();
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    bool loaded = false;
+    for(const auto & fen : invalid)
+        loaded = loaded || chess.setFromFEN(fen);
+    fen_obtained = chess.toFEN();
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_FALSE(loaded);
+    EXPECT_EQ(fen_expected, fen_obtained); // object is left unchanged
 }
 
-TEST_F(ChessTest, queenCheckPieceDefends)
+TEST_F(ChessTest, fenLoadingNeitherAllocatesNorSaves)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/09-queenCheckPieceDefends.txt");
-    SetUp(myfile);
+    const char *fen = "r3k2r/pppq1ppp/2n2n2/3pP3/8/2N2N2/PPPQ1PPP/R3K2R[PPNbq] w KQkq d6 0 250";
+    const char *state_files[] = {"GUI/object_states/move498.txt", "GUI/object_states/move499.txt"};
+    remove(state_files[0]);
+
+    chess.setFromFEN(fen); // creates the piece objects
+    fen_expected = chess.toFEN();
+    istringstream promotion("q");
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    size_t before = heap_allocations;
+    bool loaded = true;
+    for(int i = 0; i < 1000; i++)
+        loaded = chess.setFromFEN(fen) && loaded;
+    size_t allocations = heap_allocations - before;
+    bool saved = ifstream(state_files[0]).good();
+
+    // the position is saved by its first move, which undo goes back to
+    bool moved = chess.makeMove(preProcessInput(string("e5")), preProcessInput(string("d6")), promotion);
+    chess.setNumMoves(chess.getNumMoves() - 1);
+    restoreObject(chess);
+    fen_obtained = chess.toFEN();
+
+    for(const auto & state_file : state_files)
+        remove(state_file);
 
     // ------------------- Assert ------------------
+    EXPECT_TRUE(loaded);
+    EXPECT_EQ(allocations, 0u);
+    EXPECT_FALSE(saved);
+    EXPECT_TRUE(moved);
     EXPECT_EQ(fen_expected, fen_obtained);
 }
 
-TEST_F(ChessTest, pawnPromotionRookWhite)
+TEST_F(ChessTest, hashOfTransposition)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/11-pawnPromotionRookWhite.txt");
-    SetUp(myfile);
+    Chess other;
+    chess.setHeadless(true);
+    other.setHeadless(true);
+    GameRecord first, second;
+    parseGame("startpos | e2e4 e7e5 g1f3 | *", first);
+    parseGame("startpos | g1f3 e7e5 e2e4 | *", second);
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    replayGame(chess, first);
+    replayGame(other, second);
+    uint64_t after_moves = chess.getHash();
+    other.setFromFEN(chess.toFEN());
+    uint64_t from_fen = other.getHash();
+    other.setTurn(WHITE);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(after_moves, from_fen);
+    EXPECT_NE(after_moves, other.getHash()); // side to move is part of the hash
 }
 
-TEST_F(ChessTest, pawnPromotionRookBlack)
+TEST_F(ChessTest, archiveGameRoundTrip)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/11-pawnPromotionRookBlack.txt");
-    SetUp(myfile);
+    string line = "startpos | e2e4 N@e4 e7e8q e1h1 | 1-0 | 4k3/8/8/8/8/8/8/4K3 w - - 0 1";
+    GameRecord game;
+    int src, dest;
+    char promotion;
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    bool parsed = parseGame(line, game);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(parsed);
+    EXPECT_EQ(game.fen, START_FEN);
+    EXPECT_EQ(game.moves.size(), 4u);
+    EXPECT_EQ(game.result, "1-0");
+    EXPECT_EQ(formatGame(game), line);
+    EXPECT_FALSE(parseGame("# a comment | e2e4 | *", game));
+    EXPECT_TRUE(parseMove("N@e4", src, dest, promotion));
+    EXPECT_EQ(src, 'n');
+    EXPECT_EQ(dest, 36);
+    EXPECT_TRUE(parseMove("e7e8q", src, dest, promotion));
+    EXPECT_EQ(formatMove(src, dest, promotion), "e7e8q");
+    EXPECT_EQ(formatMove('o', 36), "B@e4");
+    EXPECT_FALSE(parseMove("e7e9", src, dest, promotion));
 }
 
-TEST_F(ChessTest, pawnPromotionQueenWhite)
+TEST_F(ChessTest, positionIndexBuildAndQuery)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/12-pawnPromotionQueenWhite.txt");
-    SetUp(myfile);
+    const char *archive_file = "positionIndexBuildAndQuery.txt", *index_file = "positionIndexBuildAndQuery.idx";
+    ofstream archive(archive_file);
+    archive << "# two move orders reaching the same position, and an illegal game\n"
+            << "startpos | e2e4 e7e5 g1f3 b8c6 | *\n"
+            << "\n"
+            << "startpos | g1f3 e7e5 e2e4 | 1/2-1/2\n"
+            << "startpos | e2e5 | *\n";
+    archive.close();
+
+    Chess position;
+    position.setHeadless(true);
+    position.setFromFEN("rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2");
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    IndexStats stats;
+    PositionIndex index;
+    bool built = PositionIndex::build(archive_file, index_file, 2, &stats);
+    bool opened = index.open(index_file);
+    vector<Posting> found = index.query(position.getHash());
+    vector<Posting> none = index.query(0);
+    index.close();
+    remove(archive_file);
+    remove(index_file);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(built);
+    EXPECT_TRUE(opened);
+    EXPECT_EQ(stats.games, 3u);
+    EXPECT_EQ(stats.invalid, 1u);
+    EXPECT_EQ(stats.postings, 5u + 4u + 1u);
+    ASSERT_EQ(found.size(), 2u);
+    EXPECT_EQ(found[0].game, 0u);
+    EXPECT_EQ(found[0].ply, 3u);
+    EXPECT_EQ(found[1].game, 1u);
+    EXPECT_EQ(found[1].ply, 3u);
+    EXPECT_TRUE(none.empty());
 }
 
-TEST_F(ChessTest, pawnPromotionQueenBlack)
+TEST_F(ChessTest, replayScriptHeadless)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/12-pawnPromotionQueenBlack.txt");
-    SetUp(myfile);
+    istringstream script("rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq\n"
+                         "E2 E4\ny\nE7 E5\nu\nE7 E5\ny");
+    string expected;
+    chess.setHeadless(true);
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    replayScript(chess, script, expected);
+    fen_obtained = chess.toFEN();
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(matchesFEN(expected, fen_obtained));
+    EXPECT_TRUE(matchesFEN(expected + " - 0 2", fen_obtained));
+    EXPECT_FALSE(matchesFEN("rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR[Qq] w KQkq", fen_obtained));
+    EXPECT_FALSE(matchesFEN("", fen_obtained));
 }
 
-TEST_F(ChessTest, pawnPromotionKnightWhite)
+TEST_F(ChessTest, engineMovesAndMateInOne)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/13-pawnPromotionKnightWhite.txt");
-    SetUp(myfile);
+    Engine engine;
+    Chess mate;
+    int score;
+    chess.setHeadless(true);
+    mate.setHeadless(true);
+    chess.setFromFEN(START_FEN);
+    mate.setFromFEN("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 4 4");
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    vector<Move> all_moves = legalMoves(chess);
+    vector<Move> board_moves = legalMoves(chess, false);
+    Move best = engine.search(mate, score);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(board_moves.size(), 20);
+    EXPECT_EQ(all_moves.size(), 73); // 13 knight, bishop and rook replacements, 14 queen replacements
+    EXPECT_EQ(formatMove(best.src, best.dest, best.promotion), "f3f7");
+    EXPECT_EQ(score, MATE_SCORE - 1);
+    EXPECT_EQ(chess.toFEN(), START_FEN); // the positions are not changed
 }
 
-TEST_F(ChessTest, pawnPromotionKnightBlack)
+TEST_F(ChessTest, matchGamesAreReplayable)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/13-pawnPromotionKnightBlack.txt");
-    SetUp(myfile);
+    MatchConfig config;
+    MatchStats stats;
+    vector<GameRecord> games;
+    config.games = 4;
+    config.threads = 2;
+    config.adjudication.max_plies = 16;
+    chess.setHeadless(true);
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    bool played = runMatch(config, stats, [&](const GameRecord &game, int, const MatchStats &) {games.push_back(game);});
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(played);
+    EXPECT_EQ(stats.wins + stats.draws + stats.losses, 4);
+    ASSERT_EQ(games.size(), 4);
+    for(const auto & game : games)
+    {
+        GameRecord parsed;
+        ASSERT_TRUE(parseGame(formatGame(game), parsed));
+        EXPECT_EQ(replayGame(chess, parsed), (int) game.moves.size());
+        EXPECT_TRUE(matchesFEN(game.final_fen, chess.toFEN()));
+    }
+
+    config.openings.push_back("not a fen");
+    EXPECT_FALSE(runMatch(config, stats));
 }
 
-TEST_F(ChessTest, pawnPromotionBishopWhite)
+TEST_F(ChessTest, matchStatistics)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/14-pawnPromotionBishopWhite.txt");
-    SetUp(myfile);
-
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    MatchStats even, ahead;
+    double margin;
+    even.wins = even.losses = 40;
+    even.draws = 20;
+    ahead.wins = 60;
+    ahead.draws = 20;
+    ahead.losses = 20;
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_NEAR(eloDifference(even, margin), 0, 1e-9);
+    EXPECT_GT(margin, 0);
+    EXPECT_NEAR(eloDifference(ahead, margin), 147.2, 0.1); // a 70% score
+    EXPECT_LT(sprtLLR(even, 0, 10), 0);
+    EXPECT_GT(sprtLLR(ahead, 0, 10), 0);
+    EXPECT_EQ(sprtLLR(MatchStats(), 0, 10), 0);
 }
 
-TEST_F(ChessTest, pawnPromotionBishopBlack)
+TEST_F(ChessTest, engineAnalyzeDeepensAndStops)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/14-pawnPromotionBishopBlack.txt");
-    SetUp(myfile);
+    EngineConfig config;
+    config.depth = 2;
+    config.reservoir_moves = false;
+    Engine engine(config), fixed_depth(config);
+    Chess mate;
+    atomic<bool> stop{false}, stopped{true};
+    vector<SearchInfo> infos;
+    int score;
+    chess.setHeadless(true);
+    mate.setHeadless(true);
+    chess.setFromFEN(START_FEN);
+    mate.setFromFEN("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 4 4");
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    Move best = engine.analyze(chess, 2, stop, [&](const SearchInfo &info) {infos.push_back(info);});
+    Move expected = fixed_depth.search(chess, score);
+    Move mate_move = engine.analyze(mate, 5, stop, [&](const SearchInfo &info) {infos.push_back(info);});
+    Move none = engine.analyze(chess, 5, stopped);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    ASSERT_EQ(infos.size(), 3); // depths 1 and 2, then the checkmate at depth 1
+    EXPECT_EQ(infos[0].depth, 1);
+    EXPECT_EQ(infos[1].depth, 2);
+    EXPECT_EQ(infos[1].pv.size(), 2);
+    EXPECT_EQ(infos[1].score, score);
+    EXPECT_EQ(formatMove(best.src, best.dest, best.promotion), formatMove(expected.src, expected.dest, expected.promotion));
+    EXPECT_EQ(formatMove(infos[1].pv[0].src, infos[1].pv[0].dest, infos[1].pv[0].promotion), formatMove(best.src, best.dest, best.promotion));
+    EXPECT_EQ(formatMove(mate_move.src, mate_move.dest, mate_move.promotion), "f3f7");
+    EXPECT_EQ(infos[2].score, MATE_SCORE - 1);
+    EXPECT_EQ(none.src, -1);
 }
 
-TEST_F(ChessTest, trickyCastle)
+TEST_F(ChessTest, analysisNeverStallsRenderLoop)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/15-trickyCastle.txt");
-    SetUp(myfile);
+    // a mailbox with a complete value, and a value whose copy is held up
+    Mailbox<HeldValue> mailbox;
+    atomic<bool> hold{true}, waiting{false};
+    HeldValue first, held, taken;
+    first.value = 1;
+    held.value = 2;
+    held.hold = &hold;
+    held.waiting = &waiting;
+    mailbox.post(first);
+
+    // every other core runs an analysis that does not end (the reservoir
+    // makes the start position expensive to search)
+    unsigned int cores = max(2u, thread::hardware_concurrency());
+    vector<unique_ptr<Analysis>> analyses;
+    AnalysisInfo info;
+    unsigned int position = 0;
+    chess.setHeadless(true);
+    chess.setFromFEN(START_FEN);
+
+    for(unsigned int i = 0; i + 1 < cores; i++)
+    {
+        analyses.emplace_back(new Analysis(EngineConfig(), 64));
+        analyses.back()->start(chess);
+    }
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    // the writer stops in the middle of a post: the reader takes the last
+    // complete value, and then finds nothing new without waiting for it
+    thread writer([&]() {mailbox.post(held);});
+    while(!waiting)
+        this_thread::yield();
+
+    bool took_first = mailbox.take(taken) && taken.value == 1;
+    bool took_again = mailbox.take(taken);
+    hold = false;
+    writer.join();
+    bool took_held = mailbox.take(taken) && taken.value == 2;
+
+    // the reader stops in the middle of a take: the writer keeps posting, and
+    // the latest value is taken next
+    held.value = 3;
+    mailbox.post(held);
+    hold = true;
+    waiting = false;
+    HeldValue stuck, newer;
+    thread reader([&]() {mailbox.take(stuck);});
+    while(!waiting)
+        this_thread::yield();
+
+    for(newer.value = 4; newer.value <= 6; newer.value++)
+        mailbox.post(newer);
+    hold = false;
+    reader.join();
+    bool took_latest = mailbox.take(taken) && taken.value == 6;
+
+    // a render loop that polls every analysis each frame and restarts one of
+    // them every 100 frames (as a move would); the time of its frames is
+    // measured by guibench --analysis-frames
+    for(int frame = 0; frame < 1000; frame++)
+    {
+        if(frame % 100 == 0)
+            position = analyses[0]->start(chess);
+        for(auto & elem : analyses)
+            elem->poll(info);
+
+        this_thread::sleep_for(chrono::microseconds(500));
+    }
+
+    // the restarted analysis reports on the last position
+    bool reported = false;
+    for(int i = 0; i < 2000 && !reported; i++)
+    {
+        reported = analyses[0]->poll(info) && info.position == position && info.search.depth >= 1;
+        this_thread::sleep_for(chrono::milliseconds(5));
+    }
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(took_first);
+    EXPECT_FALSE(took_again);
+    EXPECT_TRUE(took_held);
+    EXPECT_EQ(stuck.value, 3);
+    EXPECT_TRUE(took_latest);
+    EXPECT_TRUE(reported);
 }
 
-TEST_F(ChessTest, castleWhenInCheck)
+TEST_F(ChessTest, listenerReportsMovesStatusAndPromotion)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/16-castleWhenInCheck.txt");
-    SetUp(myfile);
+    vector<string> messages;
+    vector<bool> moves_made;
+    istringstream in("n"); // ignored, since the listener chooses the piece
+    ChessListener listener;
+    listener.on_move = [&](int, int, bool made) { moves_made.push_back(made); };
+    listener.on_status = [&](const string &message) { messages.push_back(message); };
+    listener.on_promotion = []() { return 'r'; };
+    chess.setHeadless(true);
+    chess.setListener(listener);
+    chess.setFromFEN("1k6/4P3/8/8/8/8/8/K7 w - - 0 1");
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    bool invalid = chess.makeMove(chessCAMO::preProcessInput(string("e7")), chessCAMO::preProcessInput(string("e5")), in);
+    bool promoted = chess.makeMove(chessCAMO::preProcessInput(string("e7")), chessCAMO::preProcessInput(string("e8")), in);
+    fen_obtained = chess.toFEN();
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_FALSE(invalid);
+    EXPECT_TRUE(promoted);
+    EXPECT_EQ(fen_obtained, "1k2R3/8/8/8/8/8/8/K7[QRBBNNPPPPqrbbnnpppp] b - - 0 1");
+    EXPECT_EQ(messages, vector<string>({"Invalid move! Try again...", "Check!"}));
+    EXPECT_EQ(moves_made, vector<bool>({false, true}));
 }
 
-TEST_F(ChessTest, castleThroughCheck)
+// -lgtest_main does this for you automatically to avoid writing main
+// int main(int argc, char **argv)
+// {
+//  ::testing::InitGoogleTest(&argc, argv);
+//  return RUN_ALL_TESTS();
+// }
+#endif /* DOXYGEN_SHOULD_SKIP_THIS */
+
+/*************************************************************************************/
+/*                       LOCAL FUNCTION DEFINITIONS                                  */
+/*************************************************************************************/
+namespace
 {
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/17-castleThroughCheck.txt");
-    SetUp(myfile);
+    /**
+     * @brief      Converts a given board position into the <a
+     *             href="https://en.wikipedia.org/wiki/Forsyth%E2%80%93Edwards_Notation"
+     *             target="__blank">FEN</a> string representation used at the
+     *             top of the test case files
+     *
+     * @param      chess  The chess object
+     *
+     * @pre        Start with an initialized board vector
+     *
+     * @post       None
+     *
+     * @return     The piece placement, turn and castling fields of
+     *             Chess::toFEN() (without the piece reservoir)
+     */   
+    string boardFenConverter(Chess &chess)
+    {
+        string fen = chess.toFEN();
 
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+        // remove the piece reservoir and keep only the first 3 fields
+        fen.erase(fen.find('['), fen.find(']') - fen.find('[') + 1);
+        return fen.substr(0, fen.find(' ', fen.find(' ', fen.find(' ') + 1) + 1));
+    }
 
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
+    /**
+     * @brief      Finds the test case files in the <b>./tests/</b> folder.
+     *
+     * @return     The paths of the files, in name order.
+     */
+    vector<string> discoverScripts()
+    {
+        vector<string> scripts;
+        std::error_code error;
 
-TEST_F(ChessTest, castleIntoCheck)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/18-castleIntoCheck.txt");
-    SetUp(myfile);
+        for(const auto & entry : filesystem::directory_iterator("tests", error))
+            if(entry.is_regular_file() && entry.path().extension() == ".txt")
+                scripts.push_back(entry.path().generic_string());
 
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+        sort(scripts.begin(), scripts.end());
+        return scripts;
+    }
 
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    /**
+     * @brief      Converts a test case file into a test name (e.g.
+     *             tests/04-castleKingSide.txt becomes 04_castleKingSide).
+     *
+     * @param[in]  info  The parameter (path) of the test
+     *
+     * @return     The test name.
+     */
+    string scriptName(const ::testing::TestParamInfo<string> &info)
+    {
+        string name = filesystem::path(info.param).stem().string();
+        for(auto & c : name)
+            if(!std::isalnum((unsigned char) c))
+                c = '_';
+
+        return name;
+    }
+
+    /**
+     * @brief      Allocates a counted block.
+     *
+     * @param[in]  size  The number of bytes
+     *
+     * @return     The block, or nullptr if there is no memory.
+     *
+     * @note       This and countedFree() are not inlined, so the compiler does
+     *             not take their malloc() and free() for a mismatch of the
+     *             operator new and delete inlined in the library code.
+     */
+    void * countedAlloc(size_t size)
+    {
+        heap_allocations++;
+        return malloc(size > 0 ? size : 1);
+    }
+
+    /**
+     * @brief      Frees a counted block.
+     *
+     * @param      block  The block (can be nullptr)
+     */
+    void countedFree(void *block)
+    {
+        free(block);
+    }
 }
 
-TEST_F(ChessTest, enPassantTakeRight)
+TEST_F(ChessTest, moveCacheLooksUpLegalMoves)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/19-enPassantTakeRight.txt");
-    SetUp(myfile);
+    MoveCache cache;
+    Chess mate;
+    istringstream in;
+    chess.setHeadless(true);
+    mate.setHeadless(true);
+    chess.setFromFEN(START_FEN);
+    mate.setFromFEN("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 4 4");
+    mate.makeMove(45, 13, in); // Qxf7#
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    const MoveTable &start = cache.get(chess);
+    const MoveTable &again = cache.get(chess);
+    const MoveTable &none = cache.get(mate);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(&start, &again);
+    EXPECT_EQ(cache.getHits(), 1);
+    EXPECT_EQ(cache.getMisses(), 1);
+    EXPECT_EQ(__builtin_popcountll(start.side), 16);
+    EXPECT_EQ(start.destinations(52), (1ULL << 44) | (1ULL << 36)); // e2-e3, e2-e4
+    EXPECT_EQ(start.destinations(57), (1ULL << 40) | (1ULL << 42)); // Nb1-a3, Nb1-c3
+    EXPECT_EQ(start.destinations(60), 0);                           // the king is blocked
+    EXPECT_EQ(start.destinations(12), 0);                           // black's pawn
+    EXPECT_FALSE(start.isLegal((int) 'q', 60));                     // the king is never replaced
+    EXPECT_TRUE(start.isLegal((int) 'n', 61));                      // knight for bishop
+    EXPECT_FALSE(start.isLegal((int) 'n', 62));                     // not for the same piece
+    EXPECT_FALSE(start.isLegal((int) 'z', 61));
+    EXPECT_FALSE(start.isLegal(52, -1));
+    EXPECT_TRUE(mate.getCheckmate());
+    EXPECT_EQ(none.side, 0);
+    EXPECT_EQ(none.destinations(8), 0);
 }
 
-TEST_F(ChessTest, enPassantTakeLeft)
+TEST_F(ChessTest, guiStateMakesMovesFromClicks)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/19-enPassantTakeLeft.txt");
-    SetUp(myfile);
+    GuiState state;
+    Chess &game = state.getChess();
+    vector<int> held, side, reservoir;
+    ostringstream written, again;
+    vector<GuiInput> parsed, invalid;
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    state.press(300, 420);                           // e2
+    state.getHighlights(held);
+    bool dragging = state.moveMouse(300, 360);
+    state.release(300, 300);                         // e4
+    state.getHighlights(side);
+
+    state.press(570, 294);                           // white's reservoir on black's move
+    int wrong_side = state.getSource();
+    state.release(300, 300);
+    string rejected = state.getMessage();
+
+    state.press(570, 102);                           // black's knight
+    int knight = state.getSource();
+    state.getHighlights(reservoir);
+    state.release(360, 60);                          // replaces the bishop on f8
+    pieceType replaced = game.getBoard()[5]->getPieceType();
+    int knights_left = game.getReservoir()[1].first;
+    state.pressKey(KEY_UNDO);
+
+    writeScript(written, scriptSession(200, 7));
+    writeScript(again, scriptSession(200, 7));
+    istringstream in(written.str()), bad("press 1 2\njump 3 4\n");
+    bool read = readScript(in, parsed);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(held[44], 1);
+    EXPECT_EQ(held[36], 1);
+    EXPECT_EQ(held[52], 0);
+    EXPECT_TRUE(dragging);
+    EXPECT_EQ(side[0], 2);                           // black's pieces
+    EXPECT_EQ(side[36], 0);
+    EXPECT_EQ(wrong_side, -1);
+    EXPECT_EQ(rejected, "Invalid move! Try again...");
+    EXPECT_EQ(knight, (int) 'n');
+    EXPECT_EQ(reservoir[5], 1);
+    EXPECT_EQ(reservoir[6], 0);                      // not for the same piece
+    EXPECT_EQ(replaced, KNIGHT);
+    EXPECT_EQ(knights_left, 1);
+    EXPECT_EQ(state.getMessage(), "Undo move applied");
+    EXPECT_EQ(game.getBoard()[5]->getPieceType(), BISHOP);
+    EXPECT_EQ(game.getTurn(), BLACK);
+    EXPECT_EQ(state.getMovesMade(), 2);
+    EXPECT_EQ(written.str(), again.str());
+    EXPECT_TRUE(read);
+    EXPECT_EQ(parsed.size(), 200);
+    EXPECT_FALSE(readScript(bad, invalid));
 }
 
-TEST_F(ChessTest, enPassantWithoutCapture)
+TEST_F(ChessTest, guiScriptedInteractionLatency)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/20-enPassantWithoutCapture.txt");
-    SetUp(myfile);
+    vector<GuiInput> script = scriptSession(3000, 1);
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    GuiBenchStats stats = benchScript(script);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(stats.interactions, 3000);
+    EXPECT_GT(stats.moves, 100);
+    EXPECT_LE(stats.p50_us, stats.p99_us);
+    EXPECT_LE(stats.p99_us, stats.max_us);
+    printf("[   TIME   ] %llu interactions (%llu moves): p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           (unsigned long long) stats.interactions, (unsigned long long) stats.moves, stats.p50_us, stats.p99_us, stats.max_us);
 }
 
-TEST_F(ChessTest, knightCheck)
+TEST_F(ChessTest, gameStoreResumesAtAnyPly)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/21-knightCheck.txt");
-    SetUp(myfile);
+    const char *store_file = "gameStoreResumesAtAnyPly.dat";
+    remove(store_file);
+    GuiState played, resumed;
+    GameStore store, reopened;
+    vector<string> fens;
+    bool packs_exactly = true;
+    PackedPosition packed;
+    char fen[FEN_SIZE];
+
+    // e2e4, e7e5 then a reservoir knight replacing the bishop on f1
+    fens.push_back(played.getChess().toFEN());
+    played.press(300, 420);
+    played.release(300, 300);
+    fens.push_back(played.getChess().toFEN());
+    played.press(300, 120);
+    played.release(300, 240);
+    fens.push_back(played.getChess().toFEN());
+    played.press(570, 342);
+    played.release(360, 480);
+    fens.push_back(played.getChess().toFEN());
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    for(const auto & position : fens)
+    {
+        Chess chess;
+        chess.setHeadless(true);
+        chess.setFromFEN(position);
+        packPosition(chess, packed);
+        packs_exactly = packs_exactly && unpackPosition(packed, fen, FEN_SIZE) != -1 && position == fen;
+    }
+
+    bool opened = store.open(store_file);
+    bool saved = played.save(store);
+    bool unsaved_after_save = played.getUnsaved();
+    store.close();
+
+    // a new session, with a partly written game at the end of the file
+    ofstream(store_file, ios::binary | ios::app) << "partly written";
+    bool reopened_ok = reopened.open(store_file);
+    uint32_t games_on_open = reopened.getNumGames();
+    StoredGame header = reopened.getGame(0);
+    bool resumed_ok = resumed.resume(reopened, 0, 2);
+    string at_ply_2 = resumed.getChess().toFEN();
+    resumed.pressKey(KEY_UNDO);
+    string after_undo = resumed.getChess().toFEN();
+    resumed.pressKey(KEY_UNDO);
+    string after_second_undo = resumed.getChess().toFEN();
+    bool resumed_end = resumed.resume(reopened, 0, 3);
+    string at_end = resumed.getChess().toFEN();
+    bool past_end = resumed.resume(reopened, 0, 4);
+    bool no_game = resumed.resume(reopened, 1, 0);
+
+    resumed.pressKey(KEY_UNDO);
+    resumed.press(240, 420);                         // d2d4 instead of the knight
+    resumed.release(240, 300);
+    bool saved_branch = resumed.save(reopened);
+    uint32_t num_games = reopened.getNumGames();
+    reopened.close();
+    remove(store_file);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(packs_exactly);
+    EXPECT_EQ(sizeof(PackedPosition), 42u);
+    EXPECT_TRUE(opened);
+    EXPECT_TRUE(saved);
+    EXPECT_FALSE(unsaved_after_save);
+    EXPECT_TRUE(reopened_ok);
+    EXPECT_EQ(games_on_open, 1u);                    // the partly written game is ignored
+    EXPECT_EQ(header.num_positions, 4u);
+    EXPECT_EQ(header.result, 0u);
+    EXPECT_TRUE(resumed_ok);
+    EXPECT_EQ(at_ply_2, fens[2]);
+    EXPECT_EQ(after_undo, fens[1]);
+    EXPECT_EQ(after_second_undo, fens[0]);
+    EXPECT_TRUE(resumed_end);
+    EXPECT_EQ(at_end, fens[3]);
+    EXPECT_FALSE(past_end);
+    EXPECT_FALSE(no_game);
+    EXPECT_TRUE(saved_branch);
+    EXPECT_EQ(num_games, 2u);                        // the partly written game is overwritten
+    EXPECT_EQ(resumed.getPly(), 3);
+    EXPECT_EQ(resumed.getResumedGame(), -1);
 }
 
-TEST_F(ChessTest, knightCheckKingMoves)
+TEST_F(ChessTest, gameBatchMatchesLegalMoves)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/22-knightCheckKingMoves.txt");
-    SetUp(myfile);
+    const int num_games = 16, num_plies = 30;
+    GameBatch batch(num_games);
+    vector<unique_ptr<Chess>> games;
+    for(int game = 0; game < num_games; game++)
+    {
+        games.emplace_back(new Chess);
+        games.back()->setHeadless(true);
+        games.back()->setFromFEN(START_FEN);
+    }
+
+    mt19937 rng(38);
+    vector<Move> moves, chosen(num_games);
+    vector<uint32_t> first;
+    int compared = 0, different_moves = 0, different_fens = 0, different_hashes = 0;
+    auto key = [](const Move &move) {return make_tuple(move.src, move.dest, move.promotion);};
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    // random games, played both ways (these ones do not run into the cases
+    // where the two differ, see game_batch.h)
+    for(int ply = 0; ply < num_plies; ply++)
+    {
+        batch.generateMoves(moves, first);
+        for(int game = 0; game < num_games; game++)
+        {
+            vector<tuple<int, int, char>> expected, found;
+            for(const auto & move : legalMoves(*games[game]))
+                expected.push_back(key(move));
+            for(uint32_t i = first[game]; i < first[game + 1]; i++)
+                found.push_back(key(moves[i]));
+            sort(expected.begin(), expected.end());
+            sort(found.begin(), found.end());
+
+            char fen[FEN_SIZE];
+            batch.toFEN(game, fen, FEN_SIZE);
+            different_fens += games[game]->toFEN() != fen;
+            different_hashes += games[game]->getHash() != batch.getHash(game);
+            different_moves += expected != found;
+            compared++;
+
+            chosen[game] = {-1, -1, '\0'};
+            if(first[game + 1] > first[game])
+            {
+                chosen[game] = moves[first[game] + rng() % (first[game + 1] - first[game])];
+                playMove(*games[game], chosen[game]);
+            }
+        }
+        batch.applyMoves(chosen);
+        batch.updateStatus();
+    }
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(compared, num_games * num_plies);
+    EXPECT_EQ(different_moves, 0);
+    EXPECT_EQ(different_fens, 0);
+    EXPECT_EQ(different_hashes, 0);
 }
 
-TEST_F(ChessTest, knightMate)
+TEST_F(ChessTest, gameBatchFindsGameOverAndRunsInLockstep)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/23-knightMate.txt");
-    SetUp(myfile);
+    GameBatch batch(4);
+    Chess castle;
+    castle.setHeadless(true);
+    castle.setFromFEN("4k3/8/8/8/8/8/6r1/4K2R w K - 0 1");
+    batch.setFromFEN(0, "r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 4 4");
+    batch.setFromFEN(1, "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1");
+    batch.set(2, castle);
+    for(const auto & move : vector<Move>{{52, 36, '\0'}, {8, 16, '\0'}, {36, 28, '\0'}, {11, 27, '\0'}})
+        batch.applyMove(3, move); // e2e4 a7a6 e4e5 d7d5
+
+    Move moves[MAX_BATCH_MOVES];
+    auto has = [&moves](int count, int src, int dest)
+    {
+        return any_of(moves, moves + count, [=](const Move &move) {return move.src == src && move.dest == dest;});
+    };
+
+    const int num_games = 256, num_plies = 40;
+    GameBatch lockstep(num_games);
+    vector<Move> batch_moves, chosen(num_games);
+    vector<uint32_t> first;
+    mt19937 rng(38);
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    batch.applyMove(0, {45, 13, '\0'});           // Qxf7#
+    size_t ongoing = batch.updateStatus();
+    bool castles_into_check = has(batch.gameMoves(2, moves), 60, 63);
+    bool legacy_castles = false;
+    for(const auto & move : legalMoves(castle))
+        legacy_castles = legacy_castles || (move.src == 60 && move.dest == 63);
+
+    bool en_passant = has(batch.gameMoves(3, moves), 28, 19);
+    batch.applyMove(3, {62, 45, '\0'});           // Nf3
+    batch.applyMove(3, {6, 21, '\0'});            // Nf6
+    bool en_passant_later = has(batch.gameMoves(3, moves), 28, 19);
+    char fen[FEN_SIZE];
+    batch.toFEN(3, fen, FEN_SIZE);
+
+    // random games in lockstep (their speed against chess objects is timed by
+    // batchbench)
+    uint64_t batch_plies = 0;
+    for(int ply = 0; ply < num_plies && lockstep.updateStatus() > 0; ply++)
+    {
+        lockstep.generateMoves(batch_moves, first);
+        for(int game = 0; game < num_games; game++)
+        {
+            uint32_t count = first[game + 1] - first[game];
+            chosen[game] = count > 0 ? batch_moves[first[game] + rng() % count] : Move{-1, -1, '\0'};
+            batch_plies += count > 0;
+        }
+        lockstep.applyMoves(chosen);
+    }
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(ongoing, 2u);
+    EXPECT_EQ(batch.getStatus(0), BATCH_CHECKMATE);
+    EXPECT_EQ(batch.getStatus(1), BATCH_STALEMATE);
+    EXPECT_EQ(batch.gameMoves(0, moves), 0);
+    EXPECT_TRUE(legacy_castles);                   // the Chess class castles into the rook's check
+    EXPECT_FALSE(castles_into_check);
+    EXPECT_TRUE(en_passant);
+    EXPECT_FALSE(en_passant_later);
+    EXPECT_STREQ(fen, "rnbqkb1r/1pp1pppp/p4n2/3pP3/8/5N2/PPPP1PPP/RNBQKB1R[QRBBNNPPPPqrbbnnpppp] w KQkq - 2 4");
+    EXPECT_GT(batch_plies, (uint64_t) num_games * num_plies / 2);
 }
 
-TEST_F(ChessTest, pinnedPieceBishop)
+TEST_F(ChessTest, batchKernelsAgreeWithScalar)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/24-pinnedPieceBishop.txt");
-    SetUp(myfile);
-
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
-
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
+    // an odd number of games, so that the vector kernels leave a few to the
+    // scalar one
+    const int num_games = 67, num_plies = 24;
+    GameBatch batch(num_games);
+    vector<Move> moves, chosen(num_games);
+    vector<uint32_t> first;
+    mt19937 rng(39);
+    for(int ply = 0; ply < num_plies; ply++)
+    {
+        batch.generateMoves(moves, first);
+        for(int game = 0; game < num_games; game++)
+        {
+            uint32_t count = first[game + 1] - first[game];
+            chosen[game] = count > 0 ? moves[first[game] + rng() % count] : Move{-1, -1, '\0'};
+        }
+        batch.applyMoves(chosen);
+    }
 
-TEST_F(ChessTest, pinnedPieceQueen)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/25-pinnedPieceQueen.txt");
-    SetUp(myfile);
+    EngineConfig config;
+    Engine engine(config);
+    vector<uint64_t> attacked(num_games), checkers(num_games);
+    vector<int> expected_scores, scores;
+    int different_attacks = 0, different_scores = 0, different_engine = 0, kernels = 0;
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
-
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
+    batch.setKernel(KERNEL_SCALAR);
+    batch.updateAttacks();
+    batch.evaluate(config, expected_scores);
+    for(int game = 0; game < num_games; game++)
+    {
+        attacked[game] = batch.getAttacked(game);
+        checkers[game] = batch.getCheckers(game);
+
+        char fen[FEN_SIZE];
+        batch.toFEN(game, fen, FEN_SIZE);
+        Chess chess;
+        chess.setHeadless(true);
+        chess.setFromFEN(fen);
+        different_engine += engine.evaluate(chess) != expected_scores[game];
+    }
 
-TEST_F(ChessTest, pinnedPiecePawnCanCapture)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/26-pinnedPiecePawnCanCapture.txt");
-    SetUp(myfile);
+    for(batchKernel kernel : {KERNEL_SSE42, KERNEL_AVX2})
+    {
+        if(!batch.setKernel(kernel))
+            continue;
 
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+        batch.updateAttacks();
+        batch.evaluate(config, scores);
+        for(int game = 0; game < num_games; game++)
+        {
+            different_attacks += batch.getAttacked(game) != attacked[game] || batch.getCheckers(game) != checkers[game];
+            different_scores += scores[game] != expected_scores[game];
+        }
+        kernels++;
+    }
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(different_engine, 0);
+    EXPECT_EQ(different_attacks, 0);
+    EXPECT_EQ(different_scores, 0);
+    EXPECT_EQ(batch.setKernel(bestKernel()), true);
+    EXPECT_EQ(kernels, (int) kernelSupported(KERNEL_SSE42) + (int) kernelSupported(KERNEL_AVX2));
 }
 
-TEST_F(ChessTest, moveIntoKnightCheck)
+TEST_F(ChessTest, mctsFindsMateAndKeepsTree)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/27-moveIntoKnightCheck.txt");
-    SetUp(myfile);
+    EngineConfig config;
+    config.search = SEARCH_MCTS;
+    config.playouts = 3000;
+    config.search_threads = 2;
+
+    Chess mate_in_one, start;
+    mate_in_one.setHeadless(true);
+    mate_in_one.setFromFEN("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 4 4");
+    start.setHeadless(true);
+    start.setFromFEN(START_FEN);
+
+    MctsTree tree(config);
+    Engine engine(config);
+    int mate_score, score;
+    vector<Move> pv;
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    Move mate = engine.search(mate_in_one, mate_score);
+    uint64_t mate_nodes = engine.getNodes();
+
+    tree.setRoot(start);
+    uint64_t playouts = tree.run(config.playouts);
+    uint32_t root_visits = tree.getRootVisits();
+    Move best = tree.best(score, &pv);
+    vector<Move> legal = legalMoves(start);
+    bool is_legal = any_of(legal.begin(), legal.end(), [&best](const Move &move)
+    {
+        return move.src == best.src && move.dest == best.dest && move.promotion == best.promotion;
+    });
 
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
-
-TEST_F(ChessTest, moveIntoPawnCheck)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/28-moveIntoPawnCheck.txt");
-    SetUp(myfile);
-
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    // the engine's move and the most visited reply
+    for(size_t i = 0; i < 2 && i < pv.size(); i++)
+        playMove(start, pv[i]);
+    bool kept = tree.setRoot(start);
+    uint32_t reused = tree.getStats().reused;
+    bool kept_unrelated = tree.setRoot(mate_in_one);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(mate.src, 45);                       // Qxf7#
+    EXPECT_EQ(mate.dest, 13);
+    EXPECT_GT(mate_score, 500);
+    EXPECT_EQ(mate_nodes, (uint64_t) config.playouts);
+    EXPECT_EQ(playouts, (uint64_t) config.playouts);
+    EXPECT_EQ(root_visits, (uint32_t) config.playouts);
+    EXPECT_TRUE(is_legal);
+    EXPECT_GE(pv.size(), 2u);
+    EXPECT_TRUE(kept);
+    EXPECT_GT(reused, 0u);
+    EXPECT_EQ(tree.getRootVisits(), 0u);
+    EXPECT_FALSE(kept_unrelated);
 }
 
-TEST_F(ChessTest, stalemate)
+TEST_F(ChessTest, threefoldRepetitionAndFiftyMoveRule)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/29-stalemate.txt");
-    SetUp(myfile);
+    Chess repeated, fifty, losing;
+    repeated.setHeadless(true);
+    repeated.setFromFEN(START_FEN);
+    fifty.setHeadless(true);
+    fifty.setFromFEN("4k3/8/8/8/8/8/8/R3K3 w - - 99 60");
+    losing.setHeadless(true);
+    losing.setFromFEN("4k3/8/8/8/8/8/8/R3K3 w - - 0 1");
+
+    // the knights go out and back twice (Nf3 Nf6 Ng1 Ng8)
+    const Move knights[4] = {{62, 45, '\0'}, {6, 21, '\0'}, {45, 62, '\0'}, {21, 6, '\0'}};
+
+    EngineConfig config;
+    config.depth = 1;
+    Engine engine(config);
+    int score;
+
+    PositionHistory history;
+    history.reset(0, 1);
+    history.record(1, 2, true);
+    history.record(2, 1, false);
+    int across_irreversible = history.repetitions(2);
+    history.record(1, 2, false);                    // replaces the entry of ply 1
+    history.record(2, 1, false);
+    int reversible = history.repetitions(2);
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    int repetitions_once;
+    bool drawn_early = false;
+    for(int i = 0; i < 8; i++)
+    {
+        playMove(repeated, knights[i % 4]);
+        drawn_early = drawn_early || (i < 7 && repeated.getStalemate());
+        if(i == 3)
+            repetitions_once = repeated.getRepetitions();
+    }
+    int repetitions_twice = repeated.getRepetitions();
+    bool drawn = repeated.getStalemate();
 
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
+    // undo the last move
+    repeated.setNumMoves(repeated.getNumMoves() - 1);
+    restoreObject(repeated);
+    int repetitions_undone = repeated.getRepetitions();
+    bool drawn_undone = repeated.getStalemate();
 
-TEST_F(ChessTest, doubleCheckWithKnight)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/30-doubleCheckWithKnight.txt");
-    SetUp(myfile);
+    playMove(fifty, {56, 48, '\0'});                // Ra2 (the 100th reversible ply)
 
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    // Ra2 Kd8 Ra1, where Ke8 repeats the first position and saves the rook
+    playMove(losing, {56, 48, '\0'});
+    playMove(losing, {4, 3, '\0'});
+    playMove(losing, {48, 56, '\0'});
+    Move saving = engine.search(losing, score);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(across_irreversible, 0);
+    EXPECT_EQ(reversible, 1);
+    EXPECT_EQ(repetitions_once, 1);
+    EXPECT_FALSE(drawn_early);
+    EXPECT_EQ(repetitions_twice, 2);
+    EXPECT_TRUE(drawn);
+    EXPECT_EQ(repetitions_undone, 1);
+    EXPECT_FALSE(drawn_undone);
+    EXPECT_TRUE(fifty.getStalemate());
+    EXPECT_FALSE(losing.getStalemate());
+    EXPECT_EQ(saving.src, 3);                       // Ke8
+    EXPECT_EQ(saving.dest, 4);
+    EXPECT_EQ(score, 0);
 }
 
-TEST_F(ChessTest, doubleCheckwithBishop)
+TEST_F(ChessTest, copiesAndMovesPositions)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/31-doubleCheckwithBishop.txt");
-    SetUp(myfile);
+    Chess original;
+    original.setHeadless(true);
+    original.setFromFEN(START_FEN);
+    playMove(original, {52, 36, '\0'});             // e4
+    string before = original.toFEN();
+
+    Chess reused;
+    reused.setHeadless(true);
+    reused.setFromFEN("4k3/8/8/8/8/8/8/R3K3 w - - 0 1");
+
+    // a game shown on the console saves its states to files, its copies do not
+    const char *state_files[] = {"GUI/object_states/move598.txt", "GUI/object_states/move599.txt"};
+    Chess shown;
+    shown.setFromFEN("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR[-] w KQkq - 0 300");
+    for(const auto & file : state_files)
+        remove(file);
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    Chess copy(original);
+    bool replied = playMove(copy, {12, 28, '\0'}); // e5 (on the copy only)
+    string after_copy = original.toFEN();
+
+    reused = copy;
+    bool reused_plays = playMove(reused, {62, 45, '\0'}); // Nf3
+    reused = copy;
+    size_t allocations = heap_allocations;
+    reused = copy;
+    allocations = heap_allocations - allocations;
+    string reassigned = reused.toFEN();
+
+    Chess shown_copy(shown);
+    bool shown_plays = playMove(shown_copy, {51, 35, '\0'}); // d4
+    shown_copy.setNumMoves(shown_copy.getNumMoves() - 1);
+    restoreObject(shown_copy);
+    bool files_written = filesystem::exists(state_files[0]) || filesystem::exists(state_files[1]);
+
+    Chess moved(std::move(reused));
+    Chess swapped;
+    swapped = std::move(moved);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(replied);
+    EXPECT_EQ(after_copy, before);
+    EXPECT_NE(copy.toFEN(), before);
+    EXPECT_TRUE(reused_plays);
+    EXPECT_EQ(reassigned, copy.toFEN());
+    EXPECT_EQ(allocations, 0u); // re-uses the pieces of 'reused'
+    EXPECT_TRUE(shown_copy.getHeadless());
+    EXPECT_TRUE(shown_plays);
+    EXPECT_EQ(shown_copy.toFEN(), shown.toFEN()); // undone
+    EXPECT_FALSE(files_written);
+    EXPECT_EQ(swapped.toFEN(), copy.toFEN());
+    EXPECT_EQ(swapped.getHash(), copy.getHash());
+    EXPECT_EQ(swapped.getHistory().hashes, copy.getHistory().hashes);
+    EXPECT_TRUE(std::is_nothrow_move_constructible<Chess>::value);
+    EXPECT_TRUE(std::is_nothrow_move_assignable<Chess>::value);
 }
 
-TEST_F(ChessTest, doubleCheckmateKnight)
+TEST_F(ChessTest, residentGamesKeepPositionAndRepetitions)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/32-doubleCheckmateKnight.txt");
-    SetUp(myfile);
-
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    Chess played, other;
+    played.setHeadless(true);
+    played.setFromFEN(START_FEN);
+    other.setHeadless(true);
+    other.setFromFEN("4k3/8/8/8/8/8/8/R3K3 w - - 0 1");
 
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
+    // the knights go out and back (Nf3 Nf6 Ng1 Ng8)
+    const Move knights[4] = {{62, 45, '\0'}, {6, 21, '\0'}, {45, 62, '\0'}, {21, 6, '\0'}};
+    for(const auto & move : knights)
+        playMove(played, move);
 
-TEST_F(ChessTest, doubleCheckmateBishop)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/33-doubleCheckmateBishop.txt");
-    SetUp(myfile);
+    ResidentGames resident;
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
-
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
+    uint32_t first = resident.add(other);
+    uint32_t second = resident.add(played);
+
+    Chess loaded;
+    loaded.setHeadless(true);
+    bool was_loaded = resident.load(second, loaded);
+    string loaded_fen = loaded.toFEN();
+    uint64_t loaded_hash = loaded.getHash();
+    int loaded_repetitions = loaded.getRepetitions();
+
+    // the second time round is a threefold repetition
+    bool drawn_early = false;
+    for(int i = 0; i < 4; i++)
+    {
+        drawn_early = drawn_early || loaded.getStalemate();
+        playMove(loaded, knights[i]);
+    }
+    resident.store(second, loaded);
 
-TEST_F(ChessTest, doubleCheckPawnKingMovesOutofCheck)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/34-doubleCheckPawnKingMovesOutofCheck.txt");
-    SetUp(myfile);
+    Chess reloaded;
+    reloaded.setHeadless(true);
+    resident.load(second, reloaded);
 
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    resident.erase(first);
+    bool erased_loads = resident.load(first, reloaded);
+    uint32_t reused = resident.add(other);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(sizeof(ResidentGame), 43u);
+    EXPECT_TRUE(was_loaded);
+    EXPECT_EQ(loaded_fen, played.toFEN());
+    EXPECT_EQ(loaded_hash, played.getHash());
+    EXPECT_EQ(loaded_repetitions, 1);
+    EXPECT_FALSE(drawn_early);
+    EXPECT_TRUE(loaded.getStalemate());
+    EXPECT_TRUE(resident.getGame(second).drawn);
+    EXPECT_TRUE(reloaded.getStalemate());
+    EXPECT_EQ(reloaded.getRepetitions(), 2);
+    EXPECT_FALSE(erased_loads);
+    EXPECT_EQ(reused, first);
+    EXPECT_EQ(resident.size(), 2u);
+    EXPECT_GE(resident.memoryUsage(), 2 * sizeof(ResidentGame));
 }
 
-TEST_F(ChessTest, doubleCheckPawnKingChoosesToTake)
+TEST_F(ChessTest, selectivePruningKeepsTacticsWithFewerNodes)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/35-doubleCheckPawnKingChoosesToTake.txt");
-    SetUp(myfile);
+    EngineConfig full_width;
+    full_width.null_move = false;
+    full_width.late_move_reductions = false;
+    full_width.futility = false;
+    full_width.reverse_futility = false;
+    full_width.razoring = false;
+
+    Engine pruning, plain(full_width);
+    atomic<bool> stop(false);
+
+    Chess fork;
+    fork.setHeadless(true);
+    fork.setFromFEN("r3k3/8/8/1N6/8/8/8/6K1 w - - 0 1");
+
+    // a null move clears the en-passant square and updates the hash
+    Chess passed;
+    passed.setHeadless(true);
+    passed.setFromFEN("r3k2r/pppq1ppp/2n2n2/3pP3/8/2N2N2/PPPQ1PPP/R3K2R[BNPPq] w KQkq d6 0 8");
+    string reservoir = passed.toFEN().substr(passed.toFEN().find('['));
+    reservoir = reservoir.substr(0, reservoir.find(' '));
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    Move pruned = pruning.analyze(fork, 5, stop);
+    Move searched = plain.analyze(fork, 5, stop);
 
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
-
-TEST_F(ChessTest, doubleCheckPawnKingMustTake)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/36-doubleCheckPawnKingMustTake.txt");
-    SetUp(myfile);
-
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    uint64_t null_hash = passed.makeNullMove(passed.getHash());
+    fen_obtained = passed.toFEN();
+    bool replied = playMove(passed, {15, 31, '\0'}); // h7h5
+    passed.setNumMoves(passed.getNumMoves() - 1);
+    restoreObject(passed);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(pruned.src, 25);                      // Nc7+ and Nxa8
+    EXPECT_EQ(pruned.dest, 10);
+    EXPECT_EQ(searched.src, 25);
+    EXPECT_EQ(searched.dest, 10);
+    EXPECT_LT(pruning.getNodes(), plain.getNodes());
+    EXPECT_EQ(null_hash, passed.getHash());
+    EXPECT_EQ(fen_obtained, "r3k2r/pppq1ppp/2n2n2/3pP3/8/2N2N2/PPPQ1PPP/R3K2R" + reservoir + " b KQkq - 0 8");
+    EXPECT_TRUE(replied);
+    EXPECT_EQ(passed.toFEN(), fen_obtained);         // undone to the null move
+
+    EXPECT_EQ(pruning.getReduction(6, pruning.getConfig().lmr_moves, false), 0);
+    EXPECT_GT(pruning.getReduction(6, pruning.getConfig().lmr_moves + 1, false), 0);
+    EXPECT_GT(pruning.getReduction(6, 1, true), 0);  // reservoir moves from the first one on
+    EXPECT_LT(pruning.getReduction(2, 60, true), 2); // the move itself is always searched
 }
 
-TEST_F(ChessTest, pinnedWithBishop)
+TEST_F(ChessTest, tablebaseSolvesReservoirEndgames)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/37-pinnedWithBishop.txt");
-    SetUp(myfile);
+    // a knight and a queen in the reservoir (the queen can replace the
+    // knight, and the knight the queen)
+    TablebaseStats stats;
+    ASSERT_TRUE(Tablebase::generate("KNvK+q", ".", 2, &stats));
 
-    // -------------------- Act -------------------- 
-    fen_obtained = boardFenConverter(chess);
+    Tablebase table;
+    ASSERT_TRUE(table.open(".", "KNvK+q"));
+    EXPECT_FALSE(table.open(".", "KRvK"));
+    ASSERT_TRUE(table.open(".", "KNvK+q"));
 
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    Chess chess;
+    chess.setHeadless(true);
+    TablebaseProbe probe;
+
+    EngineConfig config;
+    config.depth = 2;
+    Engine engine(config);
+    vector<const Tablebase *> tables = {&table};
+    engine.setTablebases(tables);
+
+    // -------------------- Act & Assert --------------------
+    EXPECT_EQ(stats.positions, 2u * 2 * 2 * 64 * 64 * 64);
+    EXPECT_EQ(stats.legal, stats.wins + stats.losses + stats.draws);
+    EXPECT_EQ(stats.longest, 26);
+
+    // the queen already replaced the knight (Qg8#), for either color
+    chess.setFromFEN("k7/8/1K6/8/8/8/8/6Q1[] w - - 0 1");
+    ASSERT_TRUE(table.probe(chess, probe));
+    EXPECT_EQ(probe.wdl, TB_WIN);
+    EXPECT_EQ(probe.dtm, 1);
+
+    chess.setFromFEN("6q1/8/8/8/8/1k6/8/K7[] b - - 0 1");
+    ASSERT_TRUE(table.probe(chess, probe));
+    EXPECT_EQ(probe.wdl, TB_WIN);
+    EXPECT_EQ(probe.dtm, 1);
+
+    // a knight alone draws, with the queen in the reservoir it wins
+    chess.setFromFEN("k7/8/8/8/8/8/8/K6N[] w - - 0 1");
+    ASSERT_TRUE(table.probe(chess, probe));
+    EXPECT_EQ(probe.wdl, TB_DRAW);
+
+    chess.setFromFEN("k7/8/8/8/8/8/8/K6N[Q] w - - 0 1");
+    ASSERT_TRUE(table.probe(chess, probe));
+    EXPECT_EQ(probe.wdl, TB_WIN);
+    EXPECT_EQ(probe.dtm, 17);
+
+    chess.setFromFEN("k7/8/8/8/8/8/8/K6N[Q] b - - 0 1");
+    ASSERT_TRUE(table.probe(chess, probe, false));
+    EXPECT_EQ(probe.wdl, TB_LOSS);
+
+    // other material, or more reservoir pieces than the table has
+    chess.setFromFEN("k7/8/8/8/8/8/8/K5RN[] w - - 0 1");
+    EXPECT_FALSE(table.probe(chess, probe));
+    chess.setFromFEN("k7/8/8/8/8/8/8/K6N[QQ] w - - 0 1");
+    EXPECT_FALSE(table.probe(chess, probe));
+
+    // the search scores the table's checkmate, far beyond its depth
+    int score;
+    chess.setFromFEN("k7/8/8/8/8/8/8/K6N[Q] w - - 0 1");
+    Move best = engine.search(chess, score);
+    EXPECT_NE(best.src, -1);
+    EXPECT_EQ(score, MATE_SCORE - 17);
+
+    remove("KNvK+q.wdl");
+    remove("KNvK+q.dtm");
 }
 
-TEST_F(ChessTest, pinnedWithQueen)
+TEST_F(ChessTest, openingBookBuildAndChoose)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/37-pinnedWithQueen.txt");
-    SetUp(myfile);
+    const char *archive_file = "openingBookBuildAndChoose.txt", *book_file = "openingBookBuildAndChoose.book";
+    ofstream archive(archive_file);
+    archive << "# a reservoir move, an unfinished game and an illegal game\n"
+            << "startpos | e2e4 e7e5 g1f3 | 1-0\n"
+            << "startpos | e2e4 c7c5 | 0-1\n"
+            << "startpos | e2e4 e7e5 N@e4 | 1/2-1/2\n"
+            << "startpos | d2d4 | *\n"
+            << "startpos | e2e5 | *\n";
+    archive.close();
+
+    Chess after_e4, after_e5, unknown;
+    after_e4.setHeadless(true);
+    after_e5.setHeadless(true);
+    unknown.setHeadless(true);
+    chess.setHeadless(true);
+    chess.setFromFEN(START_FEN);
+    after_e4.setFromFEN("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    after_e5.setFromFEN("rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq e6 0 2");
+    unknown.setFromFEN("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 4 4");
+
+    BookOptions pruned;
+    pruned.max_ply = 2;
+    pruned.min_games = 2;
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    BookStats stats, pruned_stats;
+    OpeningBook book;
+    bool built = OpeningBook::build(archive_file, book_file, 2, BookOptions(), &stats);
+    bool opened = book.open(book_file);
+    vector<BookEntry> start = book.query(chess.getHash());
+    vector<BookEntry> black = book.query(after_e4.getHash());
+    vector<BookEntry> white = book.query(after_e5.getHash());
+
+    Move heaviest, drop, other, none;
+    bool chosen = book.choose(after_e5, 0, heaviest);
+    book.choose(after_e5, 2, drop);
+    book.choose(after_e5, 1, other);
+    bool found = book.choose(unknown, 0, none);
+
+    Engine engine;
+    engine.setBook(&book);
+    int score;
+    Move engine_move = engine.search(chess, score);
+    book.close();
+
+    bool rebuilt = OpeningBook::build(archive_file, book_file, 1, pruned, &pruned_stats);
+    remove(archive_file);
+    remove(book_file);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(built);
+    EXPECT_TRUE(opened);
+    EXPECT_EQ(stats.games, 5u);
+    EXPECT_EQ(stats.invalid, 1u);
+    EXPECT_EQ(stats.moves, 3u + 2u + 3u + 1u);
+    EXPECT_EQ(stats.entries, 6u);
+    EXPECT_EQ(stats.positions, 3u);
+
+    // e2e4 won once, drew once and lost once for white
+    ASSERT_EQ(start.size(), 2u);
+    EXPECT_EQ(formatMove(start[0].src, start[0].dest, start[0].promotion), "e2e4");
+    EXPECT_EQ(start[0].weight, 3u);
+    EXPECT_EQ(start[0].games, 3u);
+    EXPECT_EQ(start[0].wins + start[0].draws + start[0].losses, 3u);
+    EXPECT_EQ(formatMove(start[1].src, start[1].dest, start[1].promotion), "d2d4");
+    EXPECT_EQ(start[1].weight, 1u);
+
+    // the results are for black after 1. e4
+    ASSERT_EQ(black.size(), 2u);
+    EXPECT_EQ(formatMove(black[0].src, black[0].dest, black[0].promotion), "c7c5");
+    EXPECT_EQ(black[0].wins, 1u);
+    EXPECT_EQ(black[1].losses, 1u);
+    EXPECT_EQ(black[1].draws, 1u);
+
+    ASSERT_EQ(white.size(), 2u);
+    EXPECT_EQ(formatMove(white[1].src, white[1].dest, white[1].promotion), "N@e4");
+    EXPECT_TRUE(chosen);
+    EXPECT_EQ(formatMove(heaviest.src, heaviest.dest, heaviest.promotion), "g1f3");
+    EXPECT_EQ(formatMove(drop.src, drop.dest, drop.promotion), "N@e4");
+    EXPECT_EQ(formatMove(other.src, other.dest, other.promotion), "g1f3");
+    EXPECT_FALSE(found);
+
+    EXPECT_EQ(formatMove(engine_move.src, engine_move.dest, engine_move.promotion), "e2e4");
+    EXPECT_EQ(engine.getNodes(), 0u);
+
+    EXPECT_TRUE(rebuilt);
+    EXPECT_EQ(pruned_stats.entries, 2u);
+    EXPECT_EQ(pruned_stats.positions, 2u);
 }
 
-TEST_F(ChessTest, pinnedWithRook)
+TEST_F(ChessTest, nnueMatchesEvaluationAndUpdates)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/37-pinnedWithRook.txt");
-    SetUp(myfile);
+    // a castling, an en-passant, a promotion (with a capture) and the
+    // reservoir moves of each position
+    const char *fens[] = {START_FEN,
+                          "r3k2r/pppq1ppp/2n2n2/3pP3/8/2N2N2/PPPQ1PPP/R3K2R w KQkq d6 0 8",
+                          "1n2k3/P7/8/8/8/8/7p/4K1N1[PNOQpnor] w - - 0 40",
+                          "4k3/8/8/8/8/8/8/4K3[PPPPNNOORQ] b - - 0 30"};
+    const char *network_file = "nnueMatchesEvaluationAndUpdates.nnue";
+
+    Nnue network, scalar, loaded;
+    scalar.setKernel(KERNEL_SCALAR);
+    Engine engine, searcher;
+    searcher.setNetwork(&network);
+    Chess mate;
+    mate.setHeadless(true);
+    mate.setFromFEN("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 4 4");
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    int largest = 0, children = 0, mismatches = 0, kernel_mismatches = 0, load_mismatches = 0;
+    bool saved = network.save(network_file), opened = loaded.load(network_file);
+    remove(network_file);
 
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
-
-TEST_F(ChessTest, enPassantPawnRight)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/39-enPassantPawnLeft.txt");
-    SetUp(myfile);
-
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    for(const auto & fen : fens)
+    {
+        Chess parent;
+        parent.setHeadless(true);
+        parent.setFromFEN(fen);
 
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
+        NnueAccumulator parent_acc;
+        network.refresh(parent, parent_acc);
 
-TEST_F(ChessTest, enPassantPawnLeft)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/40-enPassantPawnRight.txt");
-    SetUp(myfile);
+        for(const auto & move : legalMoves(parent))
+        {
+            Chess child(parent);
+            child.setHeadless(true);
+            if(!playMove(child, move))
+                continue;
+
+            NnueAccumulator full, diffed, moved, slow;
+            network.refresh(child, full);
+            network.update(child, parent_acc, diffed);
+            network.update(child, parent_acc, moved, move);
+            scalar.refresh(child, slow);
+
+            mismatches += memcmp(full.values, diffed.values, sizeof(full.values)) != 0 ||
+                          memcmp(full.values, moved.values, sizeof(full.values)) != 0 ||
+                          memcmp(full.pieces, moved.pieces, sizeof(full.pieces)) != 0;
+            kernel_mismatches += memcmp(full.values, slow.values, sizeof(full.values)) != 0 ||
+                                 network.evaluate(full, child.getTurn()) != scalar.evaluate(slow, child.getTurn());
+            load_mismatches += loaded.evaluate(child) != network.evaluate(child);
+            largest = max(largest, abs(network.evaluate(child) - engine.evaluate(child)));
+            children++;
+        }
+    }
 
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    int score;
+    Move best = searcher.search(mate, score);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(saved);
+    EXPECT_TRUE(opened);
+    EXPECT_GT(children, 100);
+    EXPECT_EQ(mismatches, 0);
+    EXPECT_EQ(kernel_mismatches, 0);
+    EXPECT_EQ(load_mismatches, 0);
+    EXPECT_LE(largest, 10); // the default network rounds to 4 centipawns
+    EXPECT_EQ(formatMove(best.src, best.dest, best.promotion), "f3f7");
+    EXPECT_EQ(score, MATE_SCORE - 1);
+    EXPECT_FALSE(loaded.load("nnueMatchesEvaluationAndUpdates.missing"));
 }
 
-TEST_F(ChessTest, checkmateQueenBlack)
+TEST_F(ChessTest, evalTunerLoadsAndTunes)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/45-checkmateQueenBlack.txt");
-    SetUp(myfile);
+    const char *archive_file = "evalTunerLoadsAndTunes.txt", *eval_file = "evalTunerLoadsAndTunes.eval";
+    ofstream archive(archive_file);
+    archive << "# a mate, a reservoir move, an unfinished game and an illegal move\n"
+            << "startpos | e2e4 e7e5 f1c4 b8c6 d1h5 g8f6 h5f7 | 1-0\n"
+            << "startpos | e2e4 e7e5 N@e4 | 1/2-1/2\n"
+            << "startpos | e2e4 | *\n"
+            << "startpos | e2e4 e7e6 e4e6 | 0-1\n";
+    archive.close();
+
+    const char *fens[] = {START_FEN,
+                          "1n2k3/P7/8/8/8/8/7p/4K1N1[PNOQpnor] w - - 0 40",
+                          "r3k2r/pppq1ppp/2n2n2/3pP3/8/2N2N2/PPPQ1PPP/R3K2R[PPQ] b KQkq - 0 8"};
+
+    TuningOptions options;
+    options.skip_plies = 0;
+    options.iterations = 30;
+    options.scale = 1.0;
+
+    Engine engine;
+    EngineConfig tuned, read, unchanged;
+    ofstream bad("evalTunerLoadsAndTunes.bad");
+    bad << "material 100 320\n";
+    bad.close();
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
-
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
-
-TEST_F(ChessTest, stalemateBlack)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/46-stalemateBlack.txt");
-    SetUp(myfile);
+    EvalTuner tuner(2), single(1), scorer(1);
+    TuningStats stats;
+    bool loaded = tuner.load(archive_file, options, &stats);
+    single.load(archive_file, options);
+    remove(archive_file);
+
+    int mismatches = 0;
+    double parameters[TUNING_PARAMETERS];
+    EvalTuner::toParameters(EngineConfig(), parameters);
+    for(const auto & fen : fens)
+    {
+        chess.setHeadless(true);
+        chess.setFromFEN(fen);
+        scorer.addPosition(chess, 1);
 
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+        int white_score = engine.evaluate(chess) * (chess.getTurn() == WHITE ? 1 : -1);
+        mismatches += EvalTuner::evaluate(scorer.getPositions().back(), parameters) != white_score;
+    }
 
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
+    // the gradient is the slope of the loss
+    double gradient[TUNING_PARAMETERS], largest_error = 0;
+    double start_loss = tuner.loss(parameters, options.scale, gradient), single_loss = single.loss(parameters, options.scale);
+    for(int i = 0; i < TUNING_PARAMETERS; i++)
+    {
+        double up[TUNING_PARAMETERS], down[TUNING_PARAMETERS];
+        copy(parameters, parameters + TUNING_PARAMETERS, up);
+        copy(parameters, parameters + TUNING_PARAMETERS, down);
+        up[i] += 0.01;
+        down[i] -= 0.01;
+
+        double slope = (tuner.loss(up, options.scale) - tuner.loss(down, options.scale)) / 0.02;
+        largest_error = max(largest_error, abs(slope - gradient[i]) / max(1e-9, abs(gradient[i])));
+    }
 
-TEST_F(ChessTest, resignBlack)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/47-resignBlack.txt");
-    SetUp(myfile);
+    int iterations = 0;
+    double tuned_loss = tuner.tune(tuned, options, [&](const TuningIteration &) {iterations++;});
+    EvalTuner::toParameters(tuned, parameters);
 
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    bool written = writeEvaluation(eval_file, tuned);
+    bool reread = readEvaluation(eval_file, read);
+    bool rejected = !readEvaluation("evalTunerLoadsAndTunes.bad", unchanged);
+    remove(eval_file);
+    remove("evalTunerLoadsAndTunes.bad");
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_TRUE(loaded);
+    EXPECT_EQ(stats.games, 4u);
+    EXPECT_EQ(stats.invalid, 1u);
+    EXPECT_EQ(stats.unfinished, 1u);
+    EXPECT_EQ(stats.positions, 7u + 4u + 3u); // the mate is in check
+    ASSERT_EQ(tuner.getPositions().size(), 14u);
+    EXPECT_EQ(tuner.getPositions()[0].result, 2);
+    EXPECT_EQ(tuner.getPositions()[7].result, 1);
+    EXPECT_EQ(tuner.getPositions()[10].reservoir[KNIGHT], -1); // white used a knight
+    EXPECT_EQ(sizeof(TuningPosition), 14u);
+
+    EXPECT_EQ(mismatches, 0);
+    EXPECT_NEAR(start_loss, single_loss, 1e-12); // only the order of the sums differs
+    EXPECT_LT(largest_error, 1e-3);
+
+    EXPECT_EQ(iterations, options.iterations + 1);
+    EXPECT_LT(tuned_loss, start_loss);
+    EXPECT_TRUE(written);
+    EXPECT_TRUE(reread);
+    EXPECT_EQ(read.material[KNIGHT], tuned.material[KNIGHT]);
+    EXPECT_EQ(read.reservoir_percent, tuned.reservoir_percent);
+    EXPECT_EQ(read.center_bonus, tuned.center_bonus);
+    EXPECT_TRUE(rejected);
+    EXPECT_EQ(unchanged.material[ROOK], EngineConfig().material[ROOK]);
 }
 
-TEST_F(ChessTest, scholarMate)
+TEST_F(ChessTest, selfPlaySamplesRoundTrip)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/48-scholarMate.txt");
-    SetUp(myfile);
+    const char *sample_file = "selfPlaySamplesRoundTrip.bin";
+    chess.setHeadless(true);
+    chess.setFromFEN("r3k2r/pppq1ppp/2n2n2/3pP3/8/2N2N2/PPPQ1PPP/R3K2R[PPQnor] b Kq - 0 8");
 
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
-
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
-
-TEST_F(ChessTest, enpassantDeniedPawnMoves)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/49-enpassantDeniedPawnMoves.txt");
-    SetUp(myfile);
+    SelfPlayConfig config;
+    config.games = 3;
+    config.threads = 2;
+    config.random_plies = 2;
+    config.adjudication.max_plies = 12;
+    config.buffer_samples = 5;
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    TrainingSample sample;
+    PackedPosition position;
+    char fen[FEN_SIZE];
+    bool packed = packSample(chess, -MATE_SCORE, 2, sample);
+    unpackSample(sample, position);
+    unpackPosition(position, fen, sizeof(fen));
+
+    SelfPlayStats stats;
+    bool generated = generateSamples(sample_file, config, stats);
+
+    SampleReader reader;
+    bool opened = reader.open(sample_file);
+    vector<TrainingSample> in_order(reader.getNumSamples() + 1), shuffled(reader.getNumSamples() + 1);
+    size_t num_in_order = reader.read(in_order.data(), in_order.size());
+    reader.rewind(true, 7);
+    size_t num_shuffled = reader.read(shuffled.data(), 3);
+    num_shuffled += reader.read(shuffled.data() + num_shuffled, shuffled.size() - num_shuffled);
+    size_t after_end = reader.read(shuffled.data(), 1);
+
+    int wrong_results = 0;
+    for(uint64_t i = 0; i < reader.getNumSamples(); i++)
+        wrong_results += (reader.getSamples()[i].flags >> 5) > 2;
+
+    auto bytes = [](const TrainingSample &a, const TrainingSample &b) {return memcmp(&a, &b, sizeof(a)) < 0;};
+    in_order.resize(num_in_order);
+    shuffled.resize(num_shuffled);
+    sort(in_order.begin(), in_order.end(), bytes);
+    sort(shuffled.begin(), shuffled.end(), bytes);
+    bool same_samples = memcmp(in_order.data(), shuffled.data(), in_order.size() * sizeof(TrainingSample)) == 0;
+    reader.close();
+
+    // a file cut short is not read
+    filesystem::resize_file(sample_file, sizeof(SampleHeader) + sizeof(TrainingSample) / 2);
+    bool truncated_opened = reader.open(sample_file);
+    remove(sample_file);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(sizeof(TrainingSample), 32u);
+    EXPECT_TRUE(packed);
+    EXPECT_TRUE(matchesFEN("r3k2r/pppq1ppp/2n2n2/3pP3/8/2N2N2/PPPQ1PPP/R3K2R[QPPrbn] b Kq - 0 1", fen));
+    EXPECT_TRUE(matchesFEN(string(fen, strlen(fen) - 4), chess.toFEN())); // but the move counters
+    EXPECT_EQ(sample.score, -32000);
+    EXPECT_EQ(sample.flags >> 5, 2);
+
+    EXPECT_TRUE(generated);
+    EXPECT_EQ(stats.games, 3u);
+    EXPECT_EQ(stats.white_wins + stats.draws + stats.black_wins, 3u);
+    EXPECT_GT(stats.samples, 3u * 5u);
+    EXPECT_LE(stats.samples, 3u * 12u);
+    EXPECT_TRUE(opened);
+    EXPECT_EQ(reader.getNumSamples(), 0u); // closed
+    EXPECT_EQ(num_in_order, stats.samples);
+    EXPECT_EQ(num_shuffled, stats.samples);
+    EXPECT_EQ(after_end, 0u);
+    EXPECT_EQ(wrong_results, 0);
+    EXPECT_TRUE(same_samples);
+    EXPECT_FALSE(truncated_opened);
 }
 
-TEST_F(ChessTest, scholarAttemptWithJustQueen)
+TEST_F(ChessTest, benchSignatureIsUnchanged)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/50-scholarAttemptWithJustQueen.txt");
-    SetUp(myfile);
+    BenchResult result;
+    int searched = 0;
+    uint64_t sum = 0;
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
-
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
-
-TEST_F(ChessTest, enpassantWithBlackPawn)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/51-enpassantWithBlackPawn.txt");
-    SetUp(myfile);
+    // the quick depth only (the signature of BENCH_DEPTH is checked by
+    // main bench)
+    runBench(BENCH_QUICK_DEPTH, result, [&](const BenchPosition &position, int index)
+    {
+        searched += index == searched;
+        sum += position.nodes;
+    });
 
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    // the positions are written as Chess::toFEN() writes them
+    int round_trips = 0;
+    for(const auto & fen : benchPositions())
+        round_trips += chess.setFromFEN(fen) && chess.toFEN() == fen;
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    // a change of the signature changes what the engine searches: if it is
+    // meant, BENCH_QUICK_SIGNATURE is updated with it
+    EXPECT_EQ(result.nodes, BENCH_QUICK_SIGNATURE);
+    EXPECT_EQ(result.positions.size(), benchPositions().size());
+    EXPECT_EQ(searched, (int) benchPositions().size());
+    EXPECT_EQ(sum, result.nodes);
+    EXPECT_EQ(round_trips, (int) benchPositions().size());
+    EXPECT_EQ(result.positions[1].score, MATE_SCORE - 1); // mate in one
 }
 
-TEST_F(ChessTest, pinWithWrongPiece)
+TEST_F(ChessTest, makeMoveWithPromotionPiece)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/52-pinWithWrongPiece.txt");
-    SetUp(myfile);
+    const char *fen = "1k6/4P3/8/8/8/8/8/K7 w - - 0 1";
+    Chess knight, queen, invalid;
+    knight.setHeadless(true);
+    queen.setHeadless(true);
+    invalid.setHeadless(true);
+    knight.setFromFEN(fen);
+    queen.setFromFEN(fen);
+    invalid.setFromFEN(fen);
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    bool illegal = knight.makeMove(preProcessInput(string("e7")), preProcessInput(string("e5")), 'n');
+    bool promoted = knight.makeMove(preProcessInput(string("e7")), preProcessInput(string("e8")), 'N');
+    queen.makeMove(preProcessInput(string("e7")), preProcessInput(string("e8")), '\0');
+    invalid.makeMove(preProcessInput(string("e7")), preProcessInput(string("e8")), 'x');
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_FALSE(illegal);
+    EXPECT_TRUE(promoted);
+    EXPECT_EQ(knight.toFEN(), "1k2N3/8/8/8/8/8/8/K7[QRBBNNPPPPqrbbnnpppp] b - - 0 1");
+    EXPECT_EQ(queen.toFEN(), "1k2Q3/8/8/8/8/8/8/K7[QRBBNNPPPPqrbbnnpppp] b - - 0 1");
+    EXPECT_TRUE(queen.getCheck());
+    EXPECT_EQ(invalid.toFEN(), queen.toFEN()); // not a promotion piece, so a queen
 }
 
-TEST_F(ChessTest, promotionWithCheckKingMoves)
+TEST_F(ChessTest, mctsScoresRepetitionsAndFiftyMoveRuleAsDraws)
 {
     // ------------------ Arrange ------------------
-    ifstream myfile("tests/53-promotionWithCheckKingMoves.txt");
-    SetUp(myfile);
+    EngineConfig config;
+    config.search = SEARCH_MCTS;
+    config.search_threads = 1;
 
-    // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
+    Chess losing, fifty;
+    losing.setHeadless(true);
+    losing.setFromFEN("4k3/8/8/8/8/8/8/R3K3 w - - 0 1");
+    fifty.setHeadless(true);
+    fifty.setFromFEN("4k3/8/8/8/8/8/8/R3K3 w - - 99 60");
 
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
-
-TEST_F(ChessTest, trickyEnPassant)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/54-trickyEnPassant.txt");
-    SetUp(myfile);
+    MctsTree tree(config);
+    int saving_score, fifty_score;
 
     // -------------------- Act --------------------
-    fen_obtained = boardFenConverter(chess);
-
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
-
-TEST_F(ChessTest, pieceReservoirUsage)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/55-pieceReservoirUsage.txt");
-    SetUp(myfile);
-
-    // -------------------- Act -------------------- 
-    fen_obtained = boardFenConverter(chess);
-
-    // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
-}
-
-TEST_F(ChessTest, pieceReservoirForCoverage)
-{
-    // ------------------ Arrange ------------------
-    ifstream myfile("tests/56-pieceReservoirForCoverage.txt");
-    SetUp(myfile);
-
-    // -------------------- Act -------------------- 
-    fen_obtained = boardFenConverter(chess);
+    // Ra2 Kd8 Ra1, where Ke8 repeats the first position and saves the rook
+    playMove(losing, {56, 48, '\0'});
+    playMove(losing, {4, 3, '\0'});
+    playMove(losing, {48, 56, '\0'});
+    tree.setRoot(losing);
+    tree.run(2000);
+    Move saving = tree.best(saving_score);
+
+    // every move but a capture or a pawn move is the 100th reversible ply
+    tree.setRoot(fifty);
+    tree.run(500);
+    tree.best(fifty_score);
 
     // ------------------- Assert ------------------
-    EXPECT_EQ(fen_expected, fen_obtained);
+    EXPECT_EQ(saving.src, 3);                       // Ke8
+    EXPECT_EQ(saving.dest, 4);
+    EXPECT_EQ(saving_score, 0);
+    EXPECT_EQ(fifty_score, 0);
 }
-
-// -lgtest_main does this for you automatically to avoid writing main
-// int main(int argc, char **argv)
-// {
-//  ::testing::InitGoogleTest(&argc, argv);
-//  return RUN_ALL_TESTS();
-// }
-#endif /* DOXYGEN_SHOULD_SKIP_THIS */
-
-/*************************************************************************************/
-/*                       LOCAL FUNCTION DEFINITIONS                                  */
-/*************************************************************************************/
-namespace
-{
-    /**
-     * @brief      Converts a given board position into a <a
-     *             href="https://en.wikipedia.org/wiki/Forsyth%E2%80%93Edwards_Notation"
-     *             target="__blank">FEN</a> string representation
-     *
-     * @param      chess  The chess object
-     *
-     * @pre        Start with an initialized board vector
-     *
-     * @post       None
-     *
-     * @return     The FEN string based on piece type and common FEN making rules
-     */   
-    string boardFenConverter(Chess &chess)
-    {
-        int elem_count = 0, empty_count = 0;
-        string fen;
-        char temp[15];
-
-        vector<Piece*> board = chess.getBoard();
-        for(auto elem : board)
-        {
-            // piece square handling
-            if(elem->isPawn())
-                appendFEN(fen, empty_count, 'P', elem->isPieceWhite());
-            else if(elem->isKnight())
-                appendFEN(fen, empty_count, 'N', elem->isPieceWhite());
-            else if(elem->isBishop())
-                appendFEN(fen, empty_count, 'B', elem->isPieceWhite());
-            else if(elem->isRook())
-                appendFEN(fen, empty_count, 'R', elem->isPieceWhite());
-            else if(elem->isQueen())
-                appendFEN(fen, empty_count, 'Q', elem->isPieceWhite());
-            else if(elem->isKing())
-                appendFEN(fen, empty_count, 'K', elem->isPieceWhite());
-            else{empty_count++;} // elem->isEmpty() -> don't append anything to the FEN string
-
-            // empty square handling (must count number of empty square before and after a figure in a given row)
-            // E.g. _ _ _ _ P _ _ _ = 4P3
-            if(empty_count == 8 || (elem_count % 8 == 7 && empty_count != 0))
-            {
-                sprintf(temp, "%i", empty_count);
-                fen.append(temp);
-                empty_count = 0;
-            }
-
-            // end of row handling
-            if(elem_count % 8 == 7 && elem_count != 63){fen.append("/");}
-
-            elem_count++;
-        }
-
-        // player turn handling
-        fen.append(chess.getTurn() == WHITE ? " w " : " b ");
-
-        // castle handling (for both sides)
-        // White player
-        if(board[63]->isRook() && board[60]->isKing() && board[60]->isSameColor(63, chess) && !board[60]->getPieceMoveInfo() && !board[63]->getPieceMoveInfo())
-            fen.append("K");
-        if(board[56]->isRook() && board[60]->isKing() && board[60]->isSameColor(56, chess) && !board[56]->getPieceMoveInfo() && !board[60]->getPieceMoveInfo())
-            fen.append("Q");
-
-        // Black player
-        if(board[7]->isRook() && board[4]->isKing() && board[4]->isSameColor(7, chess) && !board[4]->getPieceMoveInfo() && !board[7]->getPieceMoveInfo())
-            fen.append("k");
-        if(board[0]->isRook() && board[4]->isKing() && board[4]->isSameColor(0, chess) && !board[0]->getPieceMoveInfo() && !board[4]->getPieceMoveInfo())
-            fen.append("q");
-
-        return fen;
-    }
-
-    /**
-     * @brief      Decides what type of character to append to the formed FEN string
-     *
-     * @param      fen          The FEN string that characters will be appended to
-     *                          (can be empty)
-     * @param      empty_count  The number of empty squares found in the current row
-     * @param[in]  next_char    The next character to append to 'fen', must be one
-     *                          of P, N, B, Q, K (upper case)
-     * @param[in]  isWhite      True if the passed piece is white, False otherwise.
-     *                          Used to determine piece's letter case in 'fen'.
-     *
-     * @pre        An empty 'fen' string
-     *
-     * @post       Appends 'next_char' to 'fen' and returns updated variables by
-     *             reference
-     */
-    void appendFEN(string & fen, int & empty_count, char next_char, bool isWhite)
-    {
-        // accumulated empty squares leading up to a piece in a given row?
-        // append this number to the FEN string and reset the empty squares counter for the row
-        if(empty_count > 0)
-        {
-            char temp[15];
-            sprintf(temp, "%i", empty_count);
-            fen.append(temp);
-            empty_count = 0; // found a piece or went to new line, so empty square counter cannot be > 0
-        }
-
-        // White piece -> upper case letter, black piece -> lower case letter
-        isWhite ? fen.push_back((char) next_char) : fen.push_back((char) tolower(next_char));
-    }
-}
\ No newline at end of file